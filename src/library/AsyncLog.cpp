@@ -0,0 +1,634 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AsyncLog.h"
+#include "logging.h"
+#include "global.h" // Global::shared_config
+#include "GlobalState.h"
+#include "checkpoint/ReservedMemory.h"
+#include "checkpoint/Futex.h"
+
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cstddef>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <errno.h>
+
+namespace libtas {
+
+namespace AsyncLog {
+
+static const uint32_t RECORD_MAGIC = 0x4c4f4752; // "LOGR"
+static const uint32_t PADDING_MAGIC = 0x50414444; // "PADD"
+
+/* Maximum size of a record, including copied strings */
+static const size_t MAX_RECORD_SIZE = 2048;
+
+/* Maximum number of argument slots in a record */
+static const int MAX_ARGS = 32;
+
+/* Single-producer single-consumer byte ring. `head` and `tail` are byte
+ * counts that only increase, the position in `data` is their value modulo
+ * the data size. */
+struct LogRing {
+    std::atomic<pid_t> owner;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint64_t> head;
+    char pad1[64 - sizeof(std::atomic<pid_t>) - sizeof(std::atomic<uint32_t>) - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> tail;
+    char pad2[64 - sizeof(std::atomic<uint64_t>)];
+    char data[ReservedMemory::LOG_RING_DATA_SIZE];
+};
+
+static_assert(sizeof(LogRing) == ReservedMemory::LOG_RING_SIZE, "LogRing size mismatch");
+
+/* Header of a message. It is followed by the argument slots, then by the
+ * strings copied from `%s` arguments, which slots store as an offset from
+ * the start of the record. */
+struct LogRecord {
+    uint32_t magic;
+    uint32_t size;
+    const char* fmt;
+    const char* file;
+    uint64_t frame;
+    int32_t line;
+    int32_t tid;
+    uint32_t lcf;
+    uint8_t level;
+    uint8_t main;
+    uint8_t nargs;
+    uint8_t unused;
+};
+
+/* Conversion specification parsed from a printf format */
+struct FormatSpec {
+    enum Length {
+        LEN_NONE,
+        LEN_HH,
+        LEN_H,
+        LEN_L,
+        LEN_LL,
+        LEN_J,
+        LEN_Z,
+        LEN_T,
+        LEN_BIGL,
+    };
+
+    const char* begin; // position of '%'
+    const char* end; // position after the conversion character
+    const char* flags;
+    int nflags;
+    const char* width;
+    int nwidth;
+    bool star_width;
+    bool has_prec;
+    const char* prec;
+    int nprec;
+    bool star_prec;
+    int length;
+    char conv;
+};
+
+static std::thread* log_thread = nullptr;
+static std::atomic<bool> accepting(false);
+static std::atomic<bool> thread_quit(false);
+static std::atomic<int> wakeup(0);
+
+static thread_local LogRing* current_ring = nullptr;
+
+static LogRing* getRing(int i)
+{
+    char* base = static_cast<char*>(ReservedMemory::getAddr(ReservedMemory::LOG_RINGS_ADDR));
+    return reinterpret_cast<LogRing*>(base + i * ReservedMemory::LOG_RING_SIZE);
+}
+
+/* Find the next conversion specification in `p`. Returns false at the end
+ * of the format. Sets `spec.conv` to 0 if the specification is not one we
+ * can defer, such as positional or wide-character arguments. */
+static bool nextSpec(const char* p, FormatSpec& spec)
+{
+    while (true) {
+        p = strchr(p, '%');
+        if (!p)
+            return false;
+        if (p[1] != '%')
+            break;
+        p += 2;
+    }
+
+    spec.begin = p++;
+
+    spec.flags = p;
+    while (*p && strchr("-+ #0'I", *p))
+        p++;
+    spec.nflags = p - spec.flags;
+
+    spec.star_width = (*p == '*');
+    spec.width = p;
+    if (spec.star_width)
+        p++;
+    else
+        while (*p >= '0' && *p <= '9')
+            p++;
+    spec.nwidth = p - spec.width;
+
+    spec.has_prec = (*p == '.');
+    spec.star_prec = false;
+    if (spec.has_prec) {
+        p++;
+        spec.star_prec = (*p == '*');
+        spec.prec = p;
+        if (spec.star_prec)
+            p++;
+        else
+            while (*p >= '0' && *p <= '9')
+                p++;
+        spec.nprec = p - spec.prec;
+    }
+
+    spec.length = FormatSpec::LEN_NONE;
+    switch (*p) {
+        case 'h':
+            p++;
+            spec.length = FormatSpec::LEN_H;
+            if (*p == 'h') {
+                p++;
+                spec.length = FormatSpec::LEN_HH;
+            }
+            break;
+        case 'l':
+            p++;
+            spec.length = FormatSpec::LEN_L;
+            if (*p == 'l') {
+                p++;
+                spec.length = FormatSpec::LEN_LL;
+            }
+            break;
+        case 'q':
+            p++;
+            spec.length = FormatSpec::LEN_LL;
+            break;
+        case 'j':
+            p++;
+            spec.length = FormatSpec::LEN_J;
+            break;
+        case 'z':
+            p++;
+            spec.length = FormatSpec::LEN_Z;
+            break;
+        case 't':
+            p++;
+            spec.length = FormatSpec::LEN_T;
+            break;
+        case 'L':
+            p++;
+            spec.length = FormatSpec::LEN_BIGL;
+            break;
+    }
+
+    spec.conv = *p;
+    spec.end = *p ? p + 1 : p;
+
+    /* Keep rebuilt specifications short */
+    if (spec.end - spec.begin > 32)
+        spec.conv = 0;
+
+    switch (spec.conv) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        case 'p':
+            break;
+        case 'c': case 's':
+            if (spec.length != FormatSpec::LEN_NONE)
+                spec.conv = 0;
+            break;
+        default:
+            /* Positional arguments, %n, %m or malformed format */
+            spec.conv = 0;
+    }
+
+    return true;
+}
+
+/* Copy the arguments of `fmt` into the record. Returns the record size, or
+ * 0 if the message cannot be deferred. */
+static size_t captureArgs(LogRecord* rec, const char* fmt, va_list* args)
+{
+    uint64_t* slots = reinterpret_cast<uint64_t*>(rec + 1);
+    char* base = reinterpret_cast<char*>(rec);
+    FormatSpec spec;
+    int nargs = 0;
+
+    /* First count the argument slots, strings are appended after them */
+    for (const char* p = fmt; nextSpec(p, spec); p = spec.end) {
+        if (!spec.conv)
+            return 0;
+        nargs += 1 + spec.star_width + spec.star_prec;
+    }
+    if (nargs > MAX_ARGS)
+        return 0;
+
+    size_t size = sizeof(LogRecord) + nargs * sizeof(uint64_t);
+    int n = 0;
+
+    for (const char* p = fmt; nextSpec(p, spec); p = spec.end) {
+        if (spec.star_width)
+            slots[n++] = static_cast<int64_t>(va_arg(*args, int));
+        if (spec.star_prec)
+            slots[n++] = static_cast<int64_t>(va_arg(*args, int));
+
+        switch (spec.conv) {
+            case 'd': case 'i':
+                switch (spec.length) {
+                    case FormatSpec::LEN_L: slots[n] = va_arg(*args, long); break;
+                    case FormatSpec::LEN_LL: slots[n] = va_arg(*args, long long); break;
+                    case FormatSpec::LEN_J: slots[n] = va_arg(*args, intmax_t); break;
+                    case FormatSpec::LEN_Z: slots[n] = va_arg(*args, ssize_t); break;
+                    case FormatSpec::LEN_T: slots[n] = va_arg(*args, ptrdiff_t); break;
+                    default: {
+                        /* Apply the conversion of hh and h now */
+                        int v = va_arg(*args, int);
+                        if (spec.length == FormatSpec::LEN_HH)
+                            v = static_cast<signed char>(v);
+                        else if (spec.length == FormatSpec::LEN_H)
+                            v = static_cast<short>(v);
+                        slots[n] = static_cast<int64_t>(v);
+                    }
+                }
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                switch (spec.length) {
+                    case FormatSpec::LEN_L: slots[n] = va_arg(*args, unsigned long); break;
+                    case FormatSpec::LEN_LL: slots[n] = va_arg(*args, unsigned long long); break;
+                    case FormatSpec::LEN_J: slots[n] = va_arg(*args, uintmax_t); break;
+                    case FormatSpec::LEN_Z: slots[n] = va_arg(*args, size_t); break;
+                    case FormatSpec::LEN_T: slots[n] = va_arg(*args, ptrdiff_t); break;
+                    default: {
+                        unsigned int v = va_arg(*args, unsigned int);
+                        if (spec.length == FormatSpec::LEN_HH)
+                            v = static_cast<unsigned char>(v);
+                        else if (spec.length == FormatSpec::LEN_H)
+                            v = static_cast<unsigned short>(v);
+                        slots[n] = v;
+                    }
+                }
+                break;
+            case 'c':
+                slots[n] = static_cast<int64_t>(va_arg(*args, int));
+                break;
+            case 'p':
+                slots[n] = reinterpret_cast<uintptr_t>(va_arg(*args, void*));
+                break;
+            case 's': {
+                /* The string may not outlive the call, so it is copied */
+                const char* str = va_arg(*args, const char*);
+                if (!str)
+                    str = "(null)";
+                size_t len = strnlen(str, MAX_RECORD_SIZE);
+                if (size + len + 1 > MAX_RECORD_SIZE)
+                    return 0;
+                memcpy(base + size, str, len);
+                base[size + len] = '\0';
+                slots[n] = size;
+                size += len + 1;
+                break;
+            }
+            default: {
+                /* Floating-point */
+                double d;
+                if (spec.length == FormatSpec::LEN_BIGL)
+                    d = static_cast<double>(va_arg(*args, long double));
+                else
+                    d = va_arg(*args, double);
+                memcpy(&slots[n], &d, sizeof(double));
+            }
+        }
+        n++;
+    }
+
+    rec->nargs = nargs;
+
+    /* Keep records aligned */
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/* Append the format text between `p` and `end` to `out`, unescaping "%%" */
+static size_t appendLiteral(char* out, size_t size, size_t outsize, const char* p, const char* end)
+{
+    while ((p < end) && (size + 1 < outsize)) {
+        if ((p[0] == '%') && (p[1] == '%'))
+            p++;
+        out[size++] = *p++;
+    }
+    out[size] = '\0';
+    return size;
+}
+
+/* Format a record into `out`, which has `outsize` bytes */
+static void formatRecord(const LogRecord* rec, char* out, size_t outsize)
+{
+    const uint64_t* slots = reinterpret_cast<const uint64_t*>(rec + 1);
+    const char* base = reinterpret_cast<const char*>(rec);
+    FormatSpec spec;
+    int n = 0;
+    size_t size = 0;
+    const char* p = rec->fmt;
+    out[0] = '\0';
+
+    while ((size + 1 < outsize) && nextSpec(p, spec) && (n < rec->nargs)) {
+        size = appendLiteral(out, size, outsize, p, spec.begin);
+        if (size + 1 >= outsize)
+            break;
+
+        /* Rebuild the specification with resolved width and precision, and
+         * with the length matching our 64-bit slots */
+        char specstr[64];
+        int sl = 0;
+        specstr[sl++] = '%';
+        memcpy(specstr + sl, spec.flags, spec.nflags);
+        sl += spec.nflags;
+        if (spec.star_width)
+            sl += snprintf(specstr + sl, sizeof(specstr) - sl, "%d", static_cast<int>(slots[n++]));
+        else {
+            memcpy(specstr + sl, spec.width, spec.nwidth);
+            sl += spec.nwidth;
+        }
+        if (spec.has_prec) {
+            specstr[sl++] = '.';
+            if (spec.star_prec)
+                sl += snprintf(specstr + sl, sizeof(specstr) - sl, "%d", static_cast<int>(slots[n++]));
+            else {
+                memcpy(specstr + sl, spec.prec, spec.nprec);
+                sl += spec.nprec;
+            }
+        }
+
+        switch (spec.conv) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                specstr[sl++] = 'l';
+                specstr[sl++] = 'l';
+                break;
+        }
+        specstr[sl++] = spec.conv;
+        specstr[sl] = '\0';
+
+        uint64_t slot = slots[n++];
+        int ret = 0;
+        switch (spec.conv) {
+            case 'd': case 'i':
+                ret = snprintf(out + size, outsize - size, specstr, static_cast<long long>(slot));
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                ret = snprintf(out + size, outsize - size, specstr, static_cast<unsigned long long>(slot));
+                break;
+            case 'c':
+                ret = snprintf(out + size, outsize - size, specstr, static_cast<int>(slot));
+                break;
+            case 'p':
+                ret = snprintf(out + size, outsize - size, specstr, reinterpret_cast<void*>(static_cast<uintptr_t>(slot)));
+                break;
+            case 's':
+                ret = snprintf(out + size, outsize - size, specstr, base + slot);
+                break;
+            default: {
+                double d;
+                memcpy(&d, &slot, sizeof(double));
+                ret = snprintf(out + size, outsize - size, specstr, d);
+            }
+        }
+        if (ret > 0)
+            size += ret;
+        if (size >= outsize)
+            size = outsize - 1;
+
+        p = spec.end;
+    }
+
+    appendLiteral(out, size, outsize, p, p + strlen(p));
+}
+
+/* Return the ring owned by the current thread, claiming one if needed */
+static LogRing* ownRing(pid_t tid)
+{
+    if (current_ring && (current_ring->owner.load(std::memory_order_relaxed) == tid))
+        return current_ring;
+
+    current_ring = nullptr;
+
+    for (int i = 0; i < ReservedMemory::LOG_RING_COUNT; i++) {
+        LogRing* ring = getRing(i);
+        pid_t owner = 0;
+        if (ring->owner.compare_exchange_strong(owner, tid)) {
+            current_ring = ring;
+            return ring;
+        }
+    }
+
+    /* Take over a drained ring from a thread that has exited */
+    pid_t pid = getpid();
+    for (int i = 0; i < ReservedMemory::LOG_RING_COUNT; i++) {
+        LogRing* ring = getRing(i);
+        pid_t owner = ring->owner.load();
+        if (ring->head.load() != ring->tail.load())
+            continue;
+        if ((syscall(SYS_tgkill, pid, owner, 0) == 0) || (errno != ESRCH))
+            continue;
+        if (ring->owner.compare_exchange_strong(owner, tid)) {
+            current_ring = ring;
+            return ring;
+        }
+    }
+
+    return nullptr;
+}
+
+bool push(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+    uint64_t frame, pid_t tid, bool main, const char* fmt, va_list args)
+{
+    if (!accepting.load(std::memory_order_relaxed) || (tid == 0))
+        return false;
+
+    alignas(8) char buffer[MAX_RECORD_SIZE];
+    LogRecord* rec = reinterpret_cast<LogRecord*>(buffer);
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    size_t size = captureArgs(rec, fmt, &args_copy);
+    va_end(args_copy);
+    if (size == 0)
+        return false;
+
+    LogRing* ring = ownRing(tid);
+    if (!ring)
+        return false;
+
+    rec->magic = RECORD_MAGIC;
+    rec->size = size;
+    rec->fmt = fmt;
+    rec->file = file;
+    rec->frame = frame;
+    rec->line = line;
+    rec->tid = tid;
+    rec->lcf = lcf;
+    rec->level = ll;
+    rec->main = main;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+
+    /* Records are never split, pad to the end of the buffer instead */
+    size_t offset = head % ReservedMemory::LOG_RING_DATA_SIZE;
+    size_t padding = 0;
+    if (offset + size > ReservedMemory::LOG_RING_DATA_SIZE)
+        padding = ReservedMemory::LOG_RING_DATA_SIZE - offset;
+
+    if ((head + padding + size - tail) > ReservedMemory::LOG_RING_DATA_SIZE) {
+        /* The logging thread is late, the message is lost */
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        wakeup.fetch_add(1);
+        Futex::wake(reinterpret_cast<volatile int*>(&wakeup), 1);
+        return true;
+    }
+
+    if (padding) {
+        LogRecord* pad = reinterpret_cast<LogRecord*>(ring->data + offset);
+        pad->magic = PADDING_MAGIC;
+        pad->size = padding;
+        offset = 0;
+    }
+    memcpy(ring->data + offset, rec, size);
+
+    /* The thread may have been interrupted here by a state loading, in which
+     * case the head moved and the record is discarded. */
+    if (!ring->head.compare_exchange_strong(head, head + padding + size, std::memory_order_release)) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /* Wake the logging thread early if the ring is getting full */
+    if ((head + padding + size - tail) > ReservedMemory::LOG_RING_DATA_SIZE / 2) {
+        wakeup.fetch_add(1);
+        Futex::wake(reinterpret_cast<volatile int*>(&wakeup), 1);
+    }
+
+    return true;
+}
+
+/* Print all records of a ring. Returns true if any was printed. */
+static bool drainRing(LogRing* ring)
+{
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+
+    /* Counters are inconsistent after a thread was rolled back by a state
+     * loading, skip everything in that case */
+    if ((head < tail) || (head - tail > ReservedMemory::LOG_RING_DATA_SIZE)) {
+        ring->tail.store(head, std::memory_order_release);
+        return false;
+    }
+
+    bool printed = false;
+    while (tail < head) {
+        size_t offset = tail % ReservedMemory::LOG_RING_DATA_SIZE;
+        const LogRecord* rec = reinterpret_cast<const LogRecord*>(ring->data + offset);
+
+        if ((rec->size < sizeof(uint64_t)) || (rec->size % 8) ||
+            (rec->size > ReservedMemory::LOG_RING_DATA_SIZE - offset) ||
+            ((rec->magic != RECORD_MAGIC) && (rec->magic != PADDING_MAGIC))) {
+            tail = head;
+            break;
+        }
+
+        if (rec->magic == RECORD_MAGIC) {
+            char msg[2048];
+            formatRecord(rec, msg, sizeof(msg));
+            printLog(static_cast<LogLevel>(rec->level), rec->lcf, rec->file, rec->line,
+                rec->frame, rec->tid, rec->main, msg);
+            printed = true;
+        }
+
+        tail += rec->size;
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+
+    uint32_t dropped = ring->dropped.exchange(0);
+    if (dropped) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%u log messages were dropped", dropped);
+        printLog(LL_WARN, LCF_NONE, __FILE__, __LINE__, 0, ring->owner.load(), false, msg);
+    }
+
+    return printed;
+}
+
+static void drainAll()
+{
+    for (int i = 0; i < ReservedMemory::LOG_RING_COUNT; i++)
+        drainRing(getRing(i));
+}
+
+static void threadLoop()
+{
+    /* Messages printed by this thread must not come back to the rings */
+    GlobalState::setNoLog(true);
+
+    while (!thread_quit.load()) {
+        int seen = wakeup.load();
+        drainAll();
+
+        struct timespec timeout = {0, 10000000};
+        Futex::wait(reinterpret_cast<volatile int*>(&wakeup), seen, &timeout);
+    }
+
+    drainAll();
+}
+
+void startThread()
+{
+    if (log_thread || !Global::shared_config.logging_async || Global::is_fork)
+        return;
+
+    GlobalNative gn;
+    thread_quit = false;
+    log_thread = new std::thread(threadLoop);
+    accepting = true;
+}
+
+void stopThread()
+{
+    if (!log_thread)
+        return;
+
+    accepting = false;
+
+    GlobalNative gn;
+    thread_quit = true;
+    wakeup.fetch_add(1);
+    Futex::wake(reinterpret_cast<volatile int*>(&wakeup), 1);
+    log_thread->join();
+    delete log_thread;
+    log_thread = nullptr;
+}
+
+}
+
+}
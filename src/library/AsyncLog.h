@@ -0,0 +1,52 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_ASYNCLOG_H_INCL
+#define LIBTAS_ASYNCLOG_H_INCL
+
+#include "../shared/lcf.h"
+
+#include <cstdarg>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace libtas {
+
+/* Deferred formatting of log messages. The calling thread only copies the
+ * format pointer and its raw arguments into a per-thread ring buffer stored
+ * in the reserved memory, and a separate thread formats and prints them. */
+namespace AsyncLog {
+
+    /* Try to push a message. Returns false if the message must be printed
+     * synchronously instead: logging thread not running, unsupported format,
+     * or no ring available for this thread. */
+    bool push(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+        uint64_t frame, pid_t tid, bool main, const char* fmt, va_list args);
+
+    /* Start the logging thread if asynchronous logging is enabled */
+    void startThread();
+
+    /* Print all pending messages and terminate the logging thread. It is not
+     * known by the thread manager, so it must be stopped before saving or
+     * loading a state. */
+    void stopThread();
+}
+}
+
+#endif
@@ -43,6 +43,11 @@
 #include <stdint.h>
 #include <execinfo.h>
 #include <map>
+#include <set>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdarg>
+#include <sys/mman.h> // PROT_EXEC
 
 extern char**environ;
 
@@ -53,8 +58,322 @@ namespace libtas {
 static uint64_t hash;
 static uint64_t timecall_count;
 
+/* Contribution of one stack frame to the hash, so that the hash of a frame
+ * is `hash * mul + add`. Cached by return address, because `dladdr()` and
+ * reading the memory mappings are too costly to perform on each time call. */
+struct FrameEntry {
+    uintptr_t addr;
+    uint32_t generation;
+    bool anonymous;
+    bool has_text;
+    uint64_t mul;
+    uint64_t add;
+    /* Frame description for the time trace, stored out of line because
+     * it contains a full library path and a symbol name */
+    std::string text;
+};
+
+/* Range of executable memory */
+struct CodeRange {
+    uintptr_t begin;
+    uintptr_t end;
+};
+
+static const int FRAME_CACHE_SIZE = 2048; // must be a power of two
+static const int FRAME_CACHE_PROBES = 16;
+static const int MAX_CODE_RANGES = 16384;
+
+struct FrameCache {
+    FrameEntry entries[FRAME_CACHE_SIZE];
+
+    /* Sorted executable memory ranges, used for frames in code that does not
+     * belong to a loaded library, which is often the sign of JIT execution */
+    CodeRange ranges[MAX_CODE_RANGES];
+    int range_count;
+
+    /* Frames inside libraries are invalidated when a new library is loaded,
+     * and frames in anonymous code when the memory ranges are refreshed */
+    uint32_t lib_generation;
+    uint32_t range_generation;
+    bool ranges_dirty;
+};
+
+/* Allocated once and never freed */
+static FrameCache* frame_cache = nullptr;
+
+/* Traced time calls of the current frame, aggregated by stack hash, and
+ * sent to the program at the frame boundary */
+struct TraceCount {
+    uint64_t hash;
+    int type;
+    unsigned int count;
+};
+
+static const int TRACE_COUNTS_SIZE = 256; // must be a power of two
+static TraceCount trace_counts[TRACE_COUNTS_SIZE];
+static int trace_counts_used = 0;
+
+/* Frame of the traced time calls, recorded when the first one is added,
+ * because the table is sent after the frame count was incremented */
+static uint64_t trace_frame = 0;
+
+/* Stack hashes whose stack trace was already sent to the program */
+static std::set<uint64_t>* sent_stacks = nullptr;
+
+void BusyLoopDetection::sendTimeTrace()
+{
+    if (trace_counts_used == 0)
+        return;
+
+    sendMessage(MSGB_GETTIME_COUNTS);
+    sendData(&trace_frame, sizeof(uint64_t));
+    sendData(&trace_counts_used, sizeof(int));
+    for (int i = 0; i < TRACE_COUNTS_SIZE; i++) {
+        TraceCount& tc = trace_counts[i];
+        if (tc.count == 0)
+            continue;
+        sendData(&tc.type, sizeof(int));
+        sendData(&tc.hash, sizeof(uint64_t));
+        sendData(&tc.count, sizeof(unsigned int));
+        tc.count = 0;
+    }
+    trace_counts_used = 0;
+}
+
+static void addTraceCount(int type, uint64_t hash)
+{
+    /* Send early if the table is getting full */
+    if (trace_counts_used >= (TRACE_COUNTS_SIZE * 3 / 4)) {
+        lockSocket();
+        BusyLoopDetection::sendTimeTrace();
+        unlockSocket();
+    }
+
+    for (int i = 0; ; i++) {
+        TraceCount& tc = trace_counts[(hash + i) & (TRACE_COUNTS_SIZE - 1)];
+        if (tc.count == 0) {
+            if (trace_counts_used == 0)
+                trace_frame = framecount;
+            tc.hash = hash;
+            tc.type = type;
+            tc.count = 1;
+            trace_counts_used++;
+            return;
+        }
+        if (tc.hash == hash) {
+            tc.count++;
+            return;
+        }
+    }
+}
+
+void BusyLoopDetection::invalidateCache()
+{
+    if (!frame_cache)
+        return;
+
+    frame_cache->lib_generation++;
+    frame_cache->ranges_dirty = true;
+}
+
+static void refreshRanges()
+{
+    frame_cache->range_count = 0;
+    frame_cache->range_generation++;
+    frame_cache->ranges_dirty = false;
+
+#ifdef __unix__
+    ProcSelfMaps memMapLayout;
+#elif defined(__APPLE__) && defined(__MACH__)
+    MachVmMaps memMapLayout;
+#endif
+    Area area;
+    while (memMapLayout.getNextArea(&area)) {
+        /* Return addresses can only be in executable memory */
+        if (!(area.prot & PROT_EXEC))
+            continue;
+        if (frame_cache->range_count == MAX_CODE_RANGES)
+            break;
+        CodeRange& range = frame_cache->ranges[frame_cache->range_count++];
+        range.begin = reinterpret_cast<uintptr_t>(area.addr);
+        range.end = reinterpret_cast<uintptr_t>(area.endAddr);
+    }
+}
+
+static uintptr_t searchRange(uintptr_t addr)
+{
+    /* Mappings are listed in address order */
+    int lo = 0, hi = frame_cache->range_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (frame_cache->ranges[mid].end <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ((lo < frame_cache->range_count) && (frame_cache->ranges[lo].begin <= addr))
+        return frame_cache->ranges[lo].begin;
+    return 0;
+}
+
+/* Return the beginning of the executable range containing `addr`, or 0 */
+static uintptr_t findRange(uintptr_t addr)
+{
+    uintptr_t begin = searchRange(addr);
+
+    /* The code may have been mapped after the last refresh */
+    if (!begin && frame_cache->ranges_dirty) {
+        refreshRanges();
+        begin = searchRange(addr);
+    }
+    return begin;
+}
+
+/* Format the description of a frame, without truncating long names */
+static void formatText(FrameEntry& entry, const char* format, ...)
+{
+    va_list args;
+    va_list args_copy;
+    va_start(args, format);
+    va_copy(args_copy, args);
+
+    int len = vsnprintf(nullptr, 0, format, args);
+    if (len > 0) {
+        entry.text.resize(len);
+        vsnprintf(&entry.text[0], len + 1, format, args_copy);
+    }
+
+    va_end(args_copy);
+    va_end(args);
+}
+
+static void foldString(FrameEntry& entry, const char* string)
+{
+    for (const char* c = string; *c != '\0'; c++) {
+        entry.mul = entry.mul * 33;
+        entry.add = entry.add * 33 + *c;
+    }
+}
+
+static void foldValue(FrameEntry& entry, intptr_t addr)
+{
+    entry.mul = entry.mul * 33;
+    entry.add = entry.add * 33 + addr;
+}
+
+/* Compute the hash contribution and description of a frame */
+static void resolveFrame(void* address, FrameEntry& entry, const char* ld_path)
+{
+    entry.mul = 1;
+    entry.add = 0;
+    entry.anonymous = false;
+    entry.has_text = Global::shared_config.time_trace;
+    entry.text.clear();
+
+    Dl_info info;
+    int status = dladdr(address, &info);
+    if (status && info.dli_fname != NULL && info.dli_fname[0] != '\0') {
+        /* Check if the program or library is provided by the game,
+         * using the content of LD_LIBRARY_PATH
+         */
+        bool isGameLibrary = false;
+        /* Putting executable base addresses directly, because I'm lazy... */
+        if (info.dli_fbase == (void*)0x400000 || info.dli_fbase == (void*)0x8048000)
+            isGameLibrary = true;
+        else if (ld_path) {
+            isGameLibrary = strstr(info.dli_fname, ld_path);
+        }
+
+        if (isGameLibrary) {
+            /* Hash the file name */
+            const char* filename = strrchr(info.dli_fname, '/');
+            foldString(entry, filename? ++filename : info.dli_fname);
+
+            /* Hash the address offset */
+            if (info.dli_fbase && (address >= info.dli_fbase))
+                foldValue(entry, reinterpret_cast<intptr_t>(address) - reinterpret_cast<intptr_t>(info.dli_fbase));
+        }
+        else {
+            /* We should be safe to push the function called inside the library.
+             * everything else may change (even library name) */
+            if (info.dli_sname != NULL) {
+                foldString(entry, info.dli_sname);
+            }
+        }
+
+        /* Building stack trace string */
+        if (entry.has_text) {
+            if (info.dli_sname == NULL)
+                info.dli_saddr = info.dli_fbase;
+
+            if (info.dli_sname != NULL || info.dli_saddr != 0) {
+                if (info.dli_saddr == 0)
+                    formatText(entry, "%s(%s) ", info.dli_fname, info.dli_sname);
+                else if (address >= (void *)info.dli_saddr)
+                    formatText(entry, "%s(%s+%" PRIxPTR ") ", info.dli_fname, info.dli_sname ? info.dli_sname : "",
+                        reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_saddr));
+                else
+                    formatText(entry, "%s(%s-%" PRIxPTR ") ", info.dli_fname, info.dli_sname ? info.dli_sname : "",
+                        reinterpret_cast<uintptr_t>(info.dli_saddr) - reinterpret_cast<uintptr_t>(address));
+            }
+            else {
+                formatText(entry, "%s ", info.dli_fname);
+            }
+        }
+    }
+    else {
+        /* Executed code comes from some anonymous mapping, which is often
+         * the sign of JIT execution. For now, we trust that the code always
+         * has the same offset from the beginning of the mapped section. */
+        entry.anonymous = true;
+        uintptr_t begin = findRange(reinterpret_cast<uintptr_t>(address));
+        if (begin)
+            foldValue(entry, reinterpret_cast<uintptr_t>(address) - begin);
+    }
+
+    entry.generation = entry.anonymous ? frame_cache->range_generation : frame_cache->lib_generation;
+}
+
+/* Return the cached entry of a frame, resolving it if needed */
+static const FrameEntry& getFrame(void* address, const char* ld_path)
+{
+    static FrameEntry uncached;
+    uintptr_t addr = reinterpret_cast<uintptr_t>(address);
+
+    /* Fibonacci hashing of the return address */
+    size_t h = static_cast<size_t>((static_cast<uint64_t>(addr) * 0x9E3779B97F4A7C15ULL) >> 32);
+
+    FrameEntry* slot = nullptr;
+    for (int i = 0; i < FRAME_CACHE_PROBES; i++) {
+        FrameEntry& entry = frame_cache->entries[(h + i) & (FRAME_CACHE_SIZE - 1)];
+        bool valid = entry.generation == (entry.anonymous ? frame_cache->range_generation : frame_cache->lib_generation);
+
+        if (entry.addr == addr) {
+            if (valid && (entry.has_text || !Global::shared_config.time_trace))
+                return entry;
+            slot = &entry;
+            break;
+        }
+
+        /* Reuse empty or outdated entries */
+        if (!slot && ((entry.addr == 0) || !valid))
+            slot = &entry;
+    }
+
+    if (!slot)
+        slot = &uncached;
+
+    resolveFrame(address, *slot, ld_path);
+    slot->addr = addr;
+    return *slot;
+}
+
 void BusyLoopDetection::reset()
 {
+    /* Anonymous code may be remapped between frames */
+    if (frame_cache)
+        frame_cache->ranges_dirty = true;
+
     if (!Global::shared_config.busyloop_detection)
         return;
 
@@ -69,13 +388,6 @@ void BusyLoopDetection::resetHash()
     hash = 0;
 }
 
-void BusyLoopDetection::toHash(const char* string)
-{
-    const char* c = string;
-    for (; *c != '\0'; c++)
-        hash = hash * 33 + *c;
-}
-
 void BusyLoopDetection::toHash(intptr_t addr)
 {
     hash = hash * 33 + addr;
@@ -120,96 +432,42 @@ void BusyLoopDetection::increment(int type)
         }
     }
 
-    /* We don't need the whole `backtrace_symbols()` feature, only some information,
-     * so this is a simplified implementation of this function. */
-    std::ostringstream oss;
+    if (!frame_cache) {
+        frame_cache = new FrameCache();
+        /* Generation 0 is used by empty entries */
+        frame_cache->lib_generation = 1;
+        frame_cache->ranges_dirty = true;
+    }
 
     /* Start the stack at frame 3 to skip this, DeterministicTimer::getTicks() and gettime() */
     for (int cnt = 3; cnt < n; ++cnt) {
-        Dl_info info;
-        int status = dladdr(addresses[cnt], &info);
-        if (status && info.dli_fname != NULL && info.dli_fname[0] != '\0') {
-            /* Check if the program or library is provided by the game,
-             * using the content of LD_LIBRARY_PATH
-             */
-            bool isGameLibrary = false;
-            /* Putting executable base addresses directly, because I'm lazy... */
-            if (info.dli_fbase == (void*)0x400000 || info.dli_fbase == (void*)0x8048000)
-                isGameLibrary = true;
-            else if (ld_path) {
-                isGameLibrary = strstr(info.dli_fname, ld_path);
-            }
-
-            if (isGameLibrary) {
-                /* Hash the file name */
-                const char* filename = strrchr(info.dli_fname, '/');
-                toHash(filename? ++filename : info.dli_fname);
-
-                /* Hash the address offset */
-                if (info.dli_fbase && (addresses[cnt] >= info.dli_fbase))
-                    toHash(reinterpret_cast<intptr_t>(addresses[cnt]) - reinterpret_cast<intptr_t>(info.dli_fbase));
-            }
-            else {
-                /* We should be safe to push the function called inside the library.
-                 * everything else may change (even library name) */
-                if (info.dli_sname != NULL) {
-                    toHash(info.dli_sname);
-                }
-            }
+        const FrameEntry& entry = getFrame(addresses[cnt], ld_path);
+        hash = hash * entry.mul + entry.add;
+    }
 
-            /* Building stack trace string */
-            if (Global::shared_config.time_trace) {
-                oss << info.dli_fname;
-
-                if (info.dli_sname == NULL)
-                    info.dli_saddr = info.dli_fbase;
-
-                if (info.dli_sname != NULL || info.dli_saddr != 0) {
-                    oss << "(" << (info.dli_sname ? info.dli_sname : "");
-                    if (info.dli_saddr != 0) {
-                        if (addresses[cnt] >= (void *)info.dli_saddr) {
-                            oss << '+' << std::hex << (reinterpret_cast<intptr_t>(addresses[cnt]) - reinterpret_cast<intptr_t>(info.dli_saddr));
-                        }
-                        else {
-                            oss << '-' << std::hex << (reinterpret_cast<intptr_t>(info.dli_saddr) - reinterpret_cast<intptr_t>(addresses[cnt]));
-                        }
-                    }
-                    oss << ")";
-                }
-                oss << " ";
+    if (Global::shared_config.time_trace) {
+        if (!sent_stacks)
+            sent_stacks = new std::set<uint64_t>;
+
+        /* The stack trace is only sent the first time it is encountered */
+        if (sent_stacks->insert(hash).second) {
+            /* We don't need the whole `backtrace_symbols()` feature, only some information,
+             * so this is a simplified implementation of this function. */
+            std::ostringstream oss;
+            for (int cnt = 3; cnt < n; ++cnt) {
+                const FrameEntry& entry = getFrame(addresses[cnt], ld_path);
+                oss << entry.text << "[" << addresses[cnt] << "]\n";
             }
-        }
-        else {
-            /* Executed code comes from some anonymous mapping, which is often
-             * the sign of JIT execution. For now, we trust that the code always
-             * has the same offset from the beginning of the mapped section. */
 
-            /* Find the corresponding memory area */
-#ifdef __unix__
-            ProcSelfMaps memMapLayout;
-#elif defined(__APPLE__) && defined(__MACH__)
-            MachVmMaps memMapLayout;
-#endif
-            Area area;
-            while (memMapLayout.getNextArea(&area)) {
-                if ((addresses[cnt] >= area.addr) && (addresses[cnt] < area.endAddr)) {
-                    toHash(reinterpret_cast<intptr_t>(addresses[cnt]) - reinterpret_cast<intptr_t>(area.addr));
-                    break;
-                }
-            }
-        }
-        if (Global::shared_config.time_trace) {
-            oss << "[" << addresses[cnt] << "]\n";
+            lockSocket();
+            sendMessage(MSGB_GETTIME_BACKTRACE);
+            sendData(&type, sizeof(int));
+            sendData(&hash, sizeof(uint64_t));
+            sendString(oss.str());
+            unlockSocket();
         }
-    }
 
-    if (Global::shared_config.time_trace) {
-        lockSocket();
-        sendMessage(MSGB_GETTIME_BACKTRACE);
-        sendData(&type, sizeof(int));
-        sendData(&hash, sizeof(uint64_t));
-        sendString(oss.str());
-        unlockSocket();
+        addTraceCount(type, hash);
     }
     GlobalState::setNative(false);
 
@@ -30,13 +30,17 @@ void reset();
 
 void resetHash();
 
-void toHash(const char* string);
-
 void toHash(intptr_t addr);
 
+/* Drop the cached stack frames, after a library was loaded */
+void invalidateCache();
+
 /* Update the state after a time call was made */
 void increment(int type);
 
+/* Send the traced time calls of the current frame. Socket must be locked */
+void sendTimeTrace();
+
 }
 }
 
@@ -119,33 +119,33 @@ struct timespec DeterministicTimer::getTicks(SharedConfig::TimeCallType type)
         gettimes_threshold >= 0) {
 
         /* We actually track this time call */
-        std::lock_guard<std::mutex> lock(ticks_mutex);
-        int* gettimes_count = mainT ? &main_gettimes[type] : &sec_gettimes[type];
-        (*gettimes_count)++;
+        std::atomic<int>& gettimes_count = mainT ? main_gettimes[type].count : sec_gettimes[type].count;
 
-        if(*gettimes_count > gettimes_threshold) {
-            /*
-             * We reached the limit of the number of calls.
-             * We advance the deterministic timer by some value
-             */
-            int tickDelta = 1;
+        if ((gettimes_count.fetch_add(1, std::memory_order_relaxed) + 1) > gettimes_threshold) {
+            /* Other threads may have reached the limit at the same time, so
+             * only the first one to take the lock advances time */
+            std::lock_guard<std::mutex> lock(ticks_mutex);
+
+            if (gettimes_count.load(std::memory_order_relaxed) > gettimes_threshold) {
+                /*
+                 * We reached the limit of the number of calls.
+                 * We advance the deterministic timer by some value
+                 */
+                int tickDelta = 1;
 
-            LOG(LL_DEBUG, LCF_TIMESET, "WARNING! force-advancing time of type %d", type);
+                LOG(LL_DEBUG, LCF_TIMESET, "WARNING! force-advancing time of type %d", type);
 
-            ticksExtra += tickDelta;
+                ticksExtra += tickDelta;
 
-            /* Reseting the number of calls from all functions */
-            for (int i = 0; i < SharedConfig::TIMETYPE_NUMTRACKEDTYPES; i++) {
-                main_gettimes[i] = 0;
-                sec_gettimes[i] = 0;
+                /* Reseting the number of calls from all functions */
+                resetGetTimes();
             }
         }
     }
     else if (mainT && !insideFrameBoundary) {
         /* Still register calls to time functions, so that we can inform users
          * of potential options to tweak. */
-        main_gettimes[type]++;
-        if (main_gettimes[type] == ALERT_CALL_THRESHOLD) {            
+        if ((main_gettimes[type].count.fetch_add(1, std::memory_order_relaxed) + 1) == ALERT_CALL_THRESHOLD) {
             LOG(LL_WARN, LCF_TIMESET, "WARNING! many calls to function %s, you may need to enable time-tracking", gettimes_names[type]);
         }
     }
@@ -162,6 +162,14 @@ struct timespec DeterministicTimer::getTicks(SharedConfig::TimeCallType type)
     return returnTicks;
 }
 
+void DeterministicTimer::resetGetTimes()
+{
+    for (int i = 0; i < SharedConfig::TIMETYPE_NUMTRACKEDTYPES; i++) {
+        main_gettimes[i].count.store(0, std::memory_order_relaxed);
+        sec_gettimes[i].count.store(0, std::memory_order_relaxed);
+    }
+}
+
 void DeterministicTimer::addDelay(struct timespec delayTicks)
 {
     LOG(LL_DEBUG, LCF_TIMESET | LCF_SLEEP, "%s call with delay %u.%010u sec", __func__, delayTicks.tv_sec, delayTicks.tv_nsec);
@@ -238,10 +246,7 @@ void DeterministicTimer::exitFrameBoundary()
     LOGTRACE(LCF_TIMEGET);
 
     /* Reset the counts of each time get function */
-    for (int i = 0; i < SharedConfig::TIMETYPE_NUMTRACKEDTYPES; i++) {
-        main_gettimes[i] = 0;
-        sec_gettimes[i] = 0;
-    }
+    resetGetTimes();
 
     /* We sleep the right amount of time so that the game runs at normal speed */
 
@@ -355,10 +360,7 @@ void DeterministicTimer::initialize(uint64_t initial_sec, uint64_t initial_nsec)
 
     NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &lastEnterTime));
 
-    for (int i = 0; i < SharedConfig::TIMETYPE_NUMTRACKEDTYPES; i++) {
-        main_gettimes[i] = 0;
-        sec_gettimes[i] = 0;
-    }
+    resetGetTimes();
 
     addedDelay = {0, 0};
     fakeExtraTicks = {0, 0};
@@ -25,6 +25,7 @@
 #include <time.h>
 
 #include <mutex>
+#include <atomic>
 
 namespace libtas {
 /* A timer that gives deterministic values, at least in the main thread.
@@ -143,11 +144,20 @@ private:
 
     /* Count for each time-getting method before time auto-advances to
      * avoid a freeze. Distinguish between main and secondary threads.
+     * Counters are updated without locking, and each one sits on its own
+     * cache line so that threads querying different clocks don't contend.
      */
-    int main_gettimes[SharedConfig::TIMETYPE_NUMTRACKEDTYPES];
-    int sec_gettimes[SharedConfig::TIMETYPE_NUMTRACKEDTYPES];
+    struct alignas(64) GetTimesCounter {
+        std::atomic<int> count;
+    };
+    GetTimesCounter main_gettimes[SharedConfig::TIMETYPE_NUMTRACKEDTYPES];
+    GetTimesCounter sec_gettimes[SharedConfig::TIMETYPE_NUMTRACKEDTYPES];
 
-    /* Mutex to protect access to the ticks value */
+    /* Reset the counts of each time get function */
+    void resetGetTimes();
+
+    /* Mutex to protect access to the ticks value, and to the counters when
+     * they reach the threshold */
     std::mutex ticks_mutex;
     std::mutex frame_mutex;
 
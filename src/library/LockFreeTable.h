@@ -0,0 +1,138 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LOCKFREETABLE_H_INCL
+#define LIBTAS_LOCKFREETABLE_H_INCL
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace libtas {
+
+/* Fixed-size open-addressing table mapping a pointer-like key to a value.
+ * Lookups never take a lock and never allocate, so they can be performed
+ * from any wrapped function. Inserts and removals are lock-free as well,
+ * using a reserved marker while a slot is being filled.
+ *
+ * Probing is bounded to `MaxProbe` slots from the home slot, so that
+ * lookups stay constant-time even after many tombstones have accumulated.
+ * Callers must handle `insert()` returning false when no slot is available.
+ *
+ * Instances are meant to be static objects: the members are zero-initialized
+ * without any dynamic constructor, and the table lives in our data segment
+ * so that it is saved and restored along with the objects it refers to.
+ * Keys 0, 1 and 2 are reserved.
+ */
+template <typename V, size_t N, size_t MaxProbe = 32>
+class LockFreeTable
+{
+    static_assert((N & (N - 1)) == 0, "table size must be a power of two");
+    static_assert(MaxProbe <= N, "probe length larger than table");
+
+    public:
+        /* Return the value associated to `key` into `value` if found */
+        bool find(uintptr_t key, V& value) const
+        {
+            size_t h = home(key);
+            for (size_t i = 0; i < MaxProbe; i++) {
+                const Slot& s = slots[(h + i) & (N - 1)];
+                uintptr_t k = s.key.load(std::memory_order_acquire);
+                if (k == EMPTY)
+                    return false;
+                if (k == key) {
+                    value = s.value.load(std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /* Associate `value` to `key`, replacing any previous value. Returns
+         * false if the table has no free slot in the probe range. */
+        bool insert(uintptr_t key, V value)
+        {
+            size_t h = home(key);
+
+            /* Update the value in place if the key is already present */
+            for (size_t i = 0; i < MaxProbe; i++) {
+                Slot& s = slots[(h + i) & (N - 1)];
+                uintptr_t k = s.key.load(std::memory_order_acquire);
+                if (k == EMPTY)
+                    break;
+                if (k == key) {
+                    s.value.store(value, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            /* Claim the first empty or removed slot, fill the value, then
+             * publish the key so that readers never see a partial entry. */
+            for (size_t i = 0; i < MaxProbe; i++) {
+                Slot& s = slots[(h + i) & (N - 1)];
+                uintptr_t k = s.key.load(std::memory_order_relaxed);
+                while ((k == EMPTY) || (k == TOMBSTONE)) {
+                    if (s.key.compare_exchange_weak(k, BUSY, std::memory_order_acquire)) {
+                        s.value.store(value, std::memory_order_relaxed);
+                        s.key.store(key, std::memory_order_release);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /* Remove `key` from the table. Returns false if it was not present */
+        bool erase(uintptr_t key)
+        {
+            size_t h = home(key);
+            for (size_t i = 0; i < MaxProbe; i++) {
+                Slot& s = slots[(h + i) & (N - 1)];
+                uintptr_t k = s.key.load(std::memory_order_relaxed);
+                if (k == EMPTY)
+                    return false;
+                if ((k == key) && s.key.compare_exchange_strong(k, TOMBSTONE))
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        static const uintptr_t EMPTY = 0;
+        static const uintptr_t TOMBSTONE = 1;
+        static const uintptr_t BUSY = 2;
+
+        struct Slot {
+            std::atomic<uintptr_t> key;
+            std::atomic<V> value;
+        };
+
+        Slot slots[N];
+
+        static size_t home(uintptr_t key)
+        {
+            /* Fibonacci hashing, pointers have their low bits unset */
+            uint64_t h = static_cast<uint64_t>(key >> 4) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<size_t>(h >> 32) & (N - 1);
+        }
+};
+
+}
+
+#endif
@@ -39,6 +39,12 @@ AudioBuffer::AudioBuffer(void)
     blockSize = 0;
     loop_point_beg = 0;
     loop_point_end = 0;
+    resampledValid = false;
+    resampledInFrequency = 0;
+    resampledFrequency = 0;
+    resampledChannels = 0;
+    resampledLoopBeg = 0;
+    resampledLoopEnd = 0;
 }
 
 void AudioBuffer::makeSilent() {
@@ -52,6 +58,9 @@ void AudioBuffer::makeSilent() {
 
 void AudioBuffer::update(void)
 {
+    /* Samples or parameters may have changed */
+    resampledValid = false;
+
     switch (format) {
         case SAMPLE_FMT_U8:
             bitDepth = 8;
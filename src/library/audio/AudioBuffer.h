@@ -113,6 +113,24 @@ class AudioBuffer
          * Computed from blockSamples and format.
         */
         int blockSize;
+
+        /*** Cache of the whole buffer resampled into float samples, used by
+         * looping static sources. Invalidated by update function ***/
+
+        /* Is the cache filled */
+        bool resampledValid;
+
+        /* Parameters of the resampling */
+        int resampledInFrequency;
+        int resampledFrequency;
+        int resampledChannels;
+
+        /* Resampled loop points, in output samples */
+        int resampledLoopBeg;
+        int resampledLoopEnd;
+
+        /* Resampled float samples */
+        std::vector<float> resampled;
 };
 }
 
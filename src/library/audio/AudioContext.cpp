@@ -20,6 +20,13 @@
 #include "AudioContext.h"
 #include "AudioBuffer.h"
 #include "AudioSource.h"
+#include "AudioMixer.h"
+#include "AudioConverterDirect.h"
+#ifdef __unix__
+#include "AudioConverterSwr.h"
+#elif defined(__APPLE__) && defined(__MACH__)
+#include "AudioConverterCoreAudio.h"
+#endif
 #ifdef __linux__
 #include "AudioPlayerAlsa.h"
 #elif defined(__APPLE__) && defined(__MACH__)
@@ -36,6 +43,7 @@
 
 #define MAXBUFFERS 2048 // Max I've seen so far: 960
 #define MAXSOURCES 256 // Max I've seen so far: 112
+#define MAXIDLECONVERTERS 32
 
 namespace libtas {
 
@@ -77,6 +85,8 @@ AudioContext::AudioContext(void)
 {
     outVolume = 1.0f;
     audio_thread = 0;
+    ditherState = 0;
+    resamplerUnavailable = false;
     init();
 }
 
@@ -88,6 +98,7 @@ AudioContext& AudioContext::get() {
 void AudioContext::init(void)
 {
     outBitDepth = Global::shared_config.audio_bitdepth;
+    outFloat = (outBitDepth == 32) && Global::shared_config.audio_float;
     outNbChannels = Global::shared_config.audio_channels;
     outFrequency = Global::shared_config.audio_frequency;
     outAlignSize = outNbChannels * outBitDepth / 8;
@@ -178,7 +189,9 @@ void AudioContext::deleteSource(int id)
     sources.remove_if([id,this](std::shared_ptr<AudioSource> const& source)
         {
             if (source->id == id) {
-                /* Push the deleted source into the pool */
+                /* Give back its converter, and push the deleted source
+                 * into the pool */
+                source->dirty();
                 sources_pool.push_front(source);
                 return true;
             }
@@ -186,6 +199,64 @@ void AudioContext::deleteSource(int id)
         });
 }
 
+std::unique_ptr<AudioConverter> AudioContext::acquireConverter(const AudioConverterParams& params)
+{
+    /* Look for an idle converter with the same parameters */
+    for (auto it = converters_pool.begin(); it != converters_pool.end(); ++it) {
+        if ((*it)->params == params) {
+            std::unique_ptr<AudioConverter> converter = std::move(*it);
+            converters_pool.erase(it);
+            return converter;
+        }
+    }
+
+    if (AudioConverterDirect::canConvert(params.inChannels, params.inFreq, AudioBuffer::SAMPLE_FMT_FLT, params.outChannels, params.outFreq)) {
+        /* No resampling needed, skip the resampler entirely */
+        std::unique_ptr<AudioConverter> converter(new AudioConverterDirect());
+        converter->params = params;
+        converter->init(params.inFormat, params.inChannels, params.inFreq, AudioBuffer::SAMPLE_FMT_FLT, params.outChannels, params.outFreq);
+        return converter;
+    }
+
+    return createResampler(params);
+}
+
+std::unique_ptr<AudioConverter> AudioContext::createResampler(const AudioConverterParams& params)
+{
+    /* Don't try to link to the resampler again if it already failed */
+    if (resamplerUnavailable)
+        return nullptr;
+
+    std::unique_ptr<AudioConverter> converter;
+#ifdef __unix__
+    converter.reset(new AudioConverterSwr());
+#elif defined(__APPLE__) && defined(__MACH__)
+    converter.reset(new AudioConverterCoreAudio());
+#endif
+    if (!converter || !converter->isAvailable()) {
+        resamplerUnavailable = true;
+        return nullptr;
+    }
+
+    converter->params = params;
+    converter->init(params.inFormat, params.inChannels, params.inFreq, AudioBuffer::SAMPLE_FMT_FLT, params.outChannels, params.outFreq);
+    return converter;
+}
+
+void AudioContext::releaseConverter(std::unique_ptr<AudioConverter> converter)
+{
+    if (!converter || !converter->isInited())
+        return;
+
+    converter->reset();
+    if (!converter->isInited())
+        return;
+
+    converters_pool.push_front(std::move(converter));
+    if (converters_pool.size() > MAXIDLECONVERTERS)
+        converters_pool.pop_back();
+}
+
 bool AudioContext::isSource(int id) const
 {
     for (auto& source : sources) {
@@ -229,11 +300,13 @@ void AudioContext::mixAllSources(struct timespec ticks)
     /* Silent the output buffer */
     if (outBitDepth == 8) // Unsigned 8-bit samples
         outSamples.assign(outBytes, 0x80);
-    if (outBitDepth == 16) // Signed 16-bit samples
+    else // Signed or float samples
         outSamples.assign(outBytes, 0);
 
     if (paused) return;
 
+    mixBus.assign(outNbSamples * outNbChannels, 0.0f);
+
     pthread_t mix_thread = ThreadManager::getThreadId();
 
     mutex.lock();
@@ -250,26 +323,31 @@ void AudioContext::mixAllSources(struct timespec ticks)
             source->willEnd(ticks)) {
 
             LOG(LL_WARN, LCF_SOUND, "Audio mixing will underrun, waiting for the game to send audio samples");
-            int i;
-            for (i=0; i<1000; i++) {
 
-                mutex.unlock();
-                NATIVECALL(usleep(100));
-                mutex.lock();
+            /* Wait until the game queues enough samples, or 100 ms passed.
+             * The mutex is already locked, so we adopt it for the wait and
+             * keep it locked afterwards. The wait is native because it
+             * checks the real clock time for the timeout. */
+            std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+            bool filled;
+            NATIVECALL(filled = queue_cond.wait_for(lock, std::chrono::milliseconds(100), [&source, ticks]{ return !source->willEnd(ticks); }));
+            lock.release();
 
-                if (!source->willEnd(ticks))
-                    break;
-            }
-            if (i == 1000) {
+            if (!filled) {
                 LOG(LL_WARN, LCF_SOUND, "    Timeout");
             }
         }
 
-        source->mixWith(ticks, &outSamples[0], outBytes, outBitDepth, outNbChannels, outFrequency, outVolume);
+        source->mixWith(ticks, mixBus.data(), outNbSamples, outNbChannels, outFrequency, outVolume);
     }
     
     mutex.unlock();
 
+    /* Single conversion of the mix bus into the output format */
+    int nbSaturate = AudioMixer::convert(mixBus.data(), outSamples.data(), outNbSamples * outNbChannels, outBitDepth, outFloat, ditherState);
+    if (nbSaturate > 0)
+        LOG(LL_WARN, LCF_SOUND, "Saturation during mixing for %d samples", nbSaturate);
+
     if (!isLoopback && !Global::shared_config.audio_mute) {
         /* Play the music */
 #ifdef __linux__
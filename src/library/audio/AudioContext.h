@@ -21,9 +21,13 @@
 #define LIBTAS_AUDIOCONTEXT_H_INCL
 
 #include <vector>
+#include <cstdint>
 #include <memory>
 #include <list>
 #include <mutex>
+#include <condition_variable>
+
+#include "AudioConverter.h"
 
 namespace libtas {
 /* This class stores a set of audio sources and audio buffers, and
@@ -49,9 +53,12 @@ class AudioContext
          * Can be larger than 1 but output volume will be clamped to one */
         float outVolume;
 
-        /* Bit depth of the buffer (usually 8 or 16) */
+        /* Bit depth of the buffer (8, 16 or 32) */
         int outBitDepth;
 
+        /* Are 32-bit samples floating point instead of signed integers */
+        bool outFloat;
+
         /* Number of channels of the buffer */
         int outNbChannels;
 
@@ -64,6 +71,13 @@ class AudioContext
         /* Mixed buffer during a frame */
         std::vector<uint8_t> outSamples;
 
+        /* Float mix bus where all sources are added, before the conversion
+         * into `outSamples` */
+        std::vector<float> mixBus;
+
+        /* State of the dither noise generator */
+        uint32_t ditherState;
+
         /* Size of the mixed buffer in samples */
         int outNbSamples;
 
@@ -103,6 +117,22 @@ class AudioContext
         /* Return the source of requested id, or nullptr if not exists */
         std::shared_ptr<AudioSource> getSource(int id) const;
 
+        /* Return a converter into float samples initialized with `params`.
+         * An idle converter with the same parameters is reused if possible,
+         * and no resampler is used if the frequencies and channels match.
+         * Returns nullptr if no resampler is available. */
+        std::unique_ptr<AudioConverter> acquireConverter(const AudioConverterParams& params);
+
+        /* Return a new resampler initialized with `params`, without looking
+         * at idle converters. Used by sources whose pitch is changed, because
+         * their input frequency may vary at each mix.
+         * Returns nullptr if no resampler is available. */
+        std::unique_ptr<AudioConverter> createResampler(const AudioConverterParams& params);
+
+        /* Give back a converter that is not used anymore, so that another
+         * source can reuse it */
+        void releaseConverter(std::unique_ptr<AudioConverter> converter);
+
         /* Mix all source that are playing */
         void mixAllSources(struct timespec ticks);
         void mixAllSources(int nbSamples);
@@ -110,6 +140,10 @@ class AudioContext
         /* Mutex to protect access to all audio objects */
         std::mutex mutex;
 
+        /* Notified each time the game queues samples to a continuous
+         * streaming source, so that the mixer can wait on an underrun */
+        std::condition_variable queue_cond;
+
         /* Game thread that fills audio buffer */
         pthread_t audio_thread;
 
@@ -124,6 +158,12 @@ class AudioContext
         /* Extra buffers and sources that have been deleted and can be recycled */
         std::list<std::shared_ptr<AudioBuffer>> buffers_pool;
         std::list<std::shared_ptr<AudioSource>> sources_pool;
+
+        /* Idle converters, most recently released first */
+        std::list<std::unique_ptr<AudioConverter>> converters_pool;
+
+        /* Did we fail to link to the resampler library */
+        bool resamplerUnavailable;
 };
 
 }
@@ -23,10 +23,34 @@
 #include "AudioBuffer.h"
 
 namespace libtas {
+/* Parameters of a converter into float samples, used to find an idle
+ * converter that can be reused */
+struct AudioConverterParams
+{
+    AudioBuffer::SampleFormat inFormat;
+    int inChannels;
+    int inFreq;
+    int outChannels;
+    int outFreq;
+
+    bool operator==(const AudioConverterParams& other) const
+    {
+        return (inFormat == other.inFormat) && (inChannels == other.inChannels) &&
+            (inFreq == other.inFreq) && (outChannels == other.outChannels) &&
+            (outFreq == other.outFreq);
+    }
+};
+
 /* Interface class to resample audio buffers */
 class AudioConverter
 {
 public:
+    virtual ~AudioConverter() {}
+
+    /* Parameters the converter was initialized with, when it was obtained
+     * from AudioContext::acquireConverter() */
+    AudioConverterParams params;
+
     /* Returns if the resampler available */
     virtual bool isAvailable() = 0;
 
@@ -40,6 +64,10 @@ public:
      * to reinit on the next resampling */
     virtual void dirty() = 0;
 
+    /* Drop all pending samples but keep the parameters, so that the
+     * converter can be used for another stream without reinit */
+    virtual void reset() = 0;
+
     /* Queue input buffer to be resampled */
     virtual void queueSamples(const uint8_t* inSamples, int inNbSamples) = 0;
 
@@ -130,6 +130,16 @@ void AudioConverterCoreAudio::dirty(void)
     converter = nullptr;
 }
 
+void AudioConverterCoreAudio::reset(void)
+{
+    if (!isAvailable() || !isInited())
+        return;
+
+    AudioConverterReset(converter);
+    tempBuffer.resize(0);
+    tempBufferOffset = 0;
+}
+
 static OSStatus converterCallback(AudioConverterRef inAudioConverter, uint32_t *ioNumberDataPackets, AudioBufferList *ioData, AudioStreamPacketDescription **outDataPacketDescription, void *inUserData)
 {
     AudioConverterCoreAudio *converter = static_cast<AudioConverterCoreAudio*>(inUserData);
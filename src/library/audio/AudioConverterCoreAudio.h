@@ -41,6 +41,8 @@ public:
 
     void dirty();
 
+    void reset();
+
     void queueSamples(const uint8_t* inSamples, int inNbSamples);
 
     int getSamples(uint8_t* outSamples, int outNbSamples);
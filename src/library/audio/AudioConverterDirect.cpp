@@ -0,0 +1,154 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioConverterDirect.h"
+
+#include "logging.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace libtas {
+
+bool AudioConverterDirect::canConvert(int inChannels, int inFreq, AudioBuffer::SampleFormat outFormat, int outChannels, int outFreq)
+{
+    if ((outFormat != AudioBuffer::SAMPLE_FMT_FLT) || (inFreq != outFreq))
+        return false;
+
+    /* Channel remixing is left to the resampler, which applies the same
+     * gains whatever the frequencies are */
+    return (inChannels == outChannels);
+}
+
+bool AudioConverterDirect::isAvailable()
+{
+    return true;
+}
+
+bool AudioConverterDirect::isInited()
+{
+    return inited;
+}
+
+void AudioConverterDirect::init(AudioBuffer::SampleFormat inFmt, int inChans, int inFreq, AudioBuffer::SampleFormat outFormat, int outChans, int outFreq)
+{
+    if (!canConvert(inChans, inFreq, outFormat, outChans, outFreq)) {
+        LOG(LL_ERROR, LCF_SOUND, "Direct converter cannot handle these parameters");
+        return;
+    }
+
+    inFormat = inFmt;
+    outChannels = outChans;
+    pending.clear();
+    inited = true;
+}
+
+void AudioConverterDirect::dirty()
+{
+    inited = false;
+    pending.clear();
+}
+
+void AudioConverterDirect::reset()
+{
+    pending.clear();
+}
+
+/* Read one sample and convert it into float */
+static inline float readSample(const uint8_t* in, AudioBuffer::SampleFormat format)
+{
+    switch (format) {
+        case AudioBuffer::SAMPLE_FMT_U8:
+            return (static_cast<int>(*in) - 128) / 128.0f;
+        case AudioBuffer::SAMPLE_FMT_S16:
+        case AudioBuffer::SAMPLE_FMT_MSADPCM: {
+            int16_t s;
+            memcpy(&s, in, sizeof(s));
+            return s / 32768.0f;
+        }
+        case AudioBuffer::SAMPLE_FMT_S32: {
+            int32_t s;
+            memcpy(&s, in, sizeof(s));
+            return static_cast<float>(s / 2147483648.0);
+        }
+        case AudioBuffer::SAMPLE_FMT_FLT: {
+            float s;
+            memcpy(&s, in, sizeof(s));
+            return s;
+        }
+        case AudioBuffer::SAMPLE_FMT_DBL: {
+            double s;
+            memcpy(&s, in, sizeof(s));
+            return static_cast<float>(s);
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+void AudioConverterDirect::queueSamples(const uint8_t* inSamples, int inNbSamples)
+{
+    if (!inited || (inNbSamples <= 0))
+        return;
+
+    int sampleBytes = 2;
+    switch (inFormat) {
+        case AudioBuffer::SAMPLE_FMT_U8:
+            sampleBytes = 1;
+            break;
+        case AudioBuffer::SAMPLE_FMT_S32:
+        case AudioBuffer::SAMPLE_FMT_FLT:
+            sampleBytes = 4;
+            break;
+        case AudioBuffer::SAMPLE_FMT_DBL:
+            sampleBytes = 8;
+            break;
+        default:
+            break;
+    }
+
+    size_t start = pending.size();
+    pending.resize(start + static_cast<size_t>(inNbSamples) * outChannels);
+    float* out = &pending[start];
+
+    if (inFormat == AudioBuffer::SAMPLE_FMT_FLT) {
+        /* Samples are already in the output format */
+        memcpy(out, inSamples, static_cast<size_t>(inNbSamples) * outChannels * sizeof(float));
+        return;
+    }
+
+    for (int i = 0; i < inNbSamples * outChannels; i++)
+        out[i] = readSample(inSamples + i * sampleBytes, inFormat);
+}
+
+int AudioConverterDirect::getSamples(uint8_t* outSamples, int outNbSamples)
+{
+    if (!inited)
+        return 0;
+
+    int available = pending.size() / outChannels;
+    int nbSamples = (available < outNbSamples) ? available : outNbSamples;
+
+    memcpy(outSamples, pending.data(), static_cast<size_t>(nbSamples) * outChannels * sizeof(float));
+    pending.erase(pending.begin(), pending.begin() + static_cast<size_t>(nbSamples) * outChannels);
+
+    return nbSamples;
+}
+
+}
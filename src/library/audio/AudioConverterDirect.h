@@ -0,0 +1,65 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_AUDIOCONVERTERDIRECT_H_INCL
+#define LIBTAS_AUDIOCONVERTERDIRECT_H_INCL
+
+#include "AudioBuffer.h"
+#include "AudioConverter.h"
+
+#include <vector>
+
+namespace libtas {
+/* Converter used when the input and output frequencies are identical, so
+ * as well as the number of channels, so that no resampling is needed.
+ * Samples are only converted into float.
+ */
+class AudioConverterDirect : public AudioConverter
+{
+public:
+    /* Returns if samples with these parameters can be handled without
+     * resampling */
+    static bool canConvert(int inChannels, int inFreq, AudioBuffer::SampleFormat outFormat, int outChannels, int outFreq);
+
+    bool isAvailable();
+
+    bool isInited();
+
+    void init(AudioBuffer::SampleFormat inFormat, int inChannels, int inFreq, AudioBuffer::SampleFormat outFormat, int outChannels, int outFreq);
+
+    void dirty();
+
+    void reset();
+
+    void queueSamples(const uint8_t* inSamples, int inNbSamples);
+
+    int getSamples(uint8_t* outSamples, int outNbSamples);
+
+private:
+    bool inited = false;
+
+    AudioBuffer::SampleFormat inFormat = AudioBuffer::SAMPLE_FMT_S16;
+    int outChannels = 0;
+
+    /* Converted samples not read yet */
+    std::vector<float> pending;
+};
+}
+
+#endif
@@ -210,6 +210,18 @@ void AudioConverterSwr::dirty(void)
     }
 }
 
+void AudioConverterSwr::reset(void)
+{
+    if (!isAvailable() || !isInited())
+        return;
+
+    /* Initializing the context again drops the buffered samples and the
+     * filter history, while keeping the same options */
+    LINK_NAMESPACE(swr_init, "swresample");
+    if (orig::swr_init(swr) < 0)
+        LOG(LL_ERROR, LCF_SOUND, "Error resetting swr context");
+}
+
 void AudioConverterSwr::queueSamples(const uint8_t* inSamples, int inNbSamples)
 {
     if (!isAvailable() || !isInited())
@@ -0,0 +1,162 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioMixer.h"
+
+#include <cstring>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LIBTAS_MIXER_X86
+#endif
+
+namespace libtas {
+namespace AudioMixer {
+
+static void mixScalar(float* dst, const float* src, int count, float gain)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] += src[i] * gain;
+}
+
+#ifdef LIBTAS_MIXER_X86
+
+__attribute__((target("sse")))
+static void mixSSE(float* dst, const float* src, int count, float gain)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 d0 = _mm_loadu_ps(dst + i);
+        __m128 d1 = _mm_loadu_ps(dst + i + 4);
+        d0 = _mm_add_ps(d0, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        d1 = _mm_add_ps(d1, _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(dst + i, d0);
+        _mm_storeu_ps(dst + i + 4, d1);
+    }
+    mixScalar(dst + i, src + i, count - i, gain);
+}
+
+/* No FMA here, so that results are identical to the SSE version */
+__attribute__((target("avx")))
+static void mixAVX(float* dst, const float* src, int count, float gain)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 d0 = _mm256_loadu_ps(dst + i);
+        __m256 d1 = _mm256_loadu_ps(dst + i + 8);
+        d0 = _mm256_add_ps(d0, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        d1 = _mm256_add_ps(d1, _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), g));
+        _mm256_storeu_ps(dst + i, d0);
+        _mm256_storeu_ps(dst + i + 8, d1);
+    }
+    mixScalar(dst + i, src + i, count - i, gain);
+}
+
+#endif
+
+typedef void (*MixFunc)(float*, const float*, int, float);
+
+static MixFunc selectMix()
+{
+#ifdef LIBTAS_MIXER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+        return mixAVX;
+    if (__builtin_cpu_supports("sse"))
+        return mixSSE;
+#endif
+    return mixScalar;
+}
+
+void mix(float* dst, const float* src, int count, float gain)
+{
+    static MixFunc mixFunc = selectMix();
+    mixFunc(dst, src, count, gain);
+}
+
+/* Triangular dither of one unit of the output format, from two uniform
+ * values of a linear congruential generator. Digital silence is kept silent. */
+static inline float tpdf(uint32_t& state, float sample)
+{
+    if (sample == 0.0f)
+        return 0.0f;
+    state = state * 1664525u + 1013904223u;
+    float a = static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+    state = state * 1664525u + 1013904223u;
+    float b = static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+    return a - b;
+}
+
+int convert(const float* src, uint8_t* dst, int count, int bitDepth, bool isFloat, uint32_t& ditherState)
+{
+    int nbSaturate = 0;
+
+    switch (bitDepth) {
+        case 8:
+            for (int i = 0; i < count; i++) {
+                float v = std::floor(src[i] * 128.0f + tpdf(ditherState, src[i]) + 0.5f);
+                if (v < -128.0f) { v = -128.0f; nbSaturate++; }
+                if (v > 127.0f) { v = 127.0f; nbSaturate++; }
+                dst[i] = static_cast<uint8_t>(static_cast<int>(v) + 128);
+            }
+            break;
+        case 16: {
+            int16_t* dst16 = reinterpret_cast<int16_t*>(dst);
+            for (int i = 0; i < count; i++) {
+                float v = std::floor(src[i] * 32768.0f + tpdf(ditherState, src[i]) + 0.5f);
+                if (v < -32768.0f) { v = -32768.0f; nbSaturate++; }
+                if (v > 32767.0f) { v = 32767.0f; nbSaturate++; }
+                dst16[i] = static_cast<int16_t>(v);
+            }
+            break;
+        }
+        case 32:
+            if (isFloat) {
+                float* dstf = reinterpret_cast<float*>(dst);
+                for (int i = 0; i < count; i++) {
+                    float v = src[i];
+                    if (v < -1.0f) { v = -1.0f; nbSaturate++; }
+                    if (v > 1.0f) { v = 1.0f; nbSaturate++; }
+                    dstf[i] = v;
+                }
+            }
+            else {
+                /* Float samples are less precise than the output, no dithering needed */
+                int32_t* dst32 = reinterpret_cast<int32_t*>(dst);
+                for (int i = 0; i < count; i++) {
+                    double v = static_cast<double>(src[i]) * 2147483648.0;
+                    if (v < -2147483648.0) { v = -2147483648.0; nbSaturate++; }
+                    if (v > 2147483647.0) { v = 2147483647.0; nbSaturate++; }
+                    dst32[i] = static_cast<int32_t>(v);
+                }
+            }
+            break;
+        default:
+            memset(dst, 0, count * bitDepth / 8);
+            break;
+    }
+
+    return nbSaturate;
+}
+
+}
+}
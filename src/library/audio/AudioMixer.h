@@ -0,0 +1,43 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_AUDIOMIXER_H_INCL
+#define LIBTAS_AUDIOMIXER_H_INCL
+
+#include <cstdint>
+
+namespace libtas {
+/* Kernels of the float mix bus. The fastest implementation supported by the
+ * processor (AVX or SSE) is selected on first use. */
+namespace AudioMixer {
+
+    /* Add `count` samples of `src` multiplied by `gain` into `dst` */
+    void mix(float* dst, const float* src, int count, float gain);
+
+    /* Convert `count` float samples into the output format, clamping them to
+     * the full range. 8-bit and 16-bit outputs are dithered with triangular
+     * noise from `ditherState`, so that the result stays deterministic.
+     * Samples that are exactly zero are not dithered.
+     * Returns the number of samples that were clamped. */
+    int convert(const float* src, uint8_t* dst, int count, int bitDepth, bool isFloat, uint32_t& ditherState);
+
+}
+}
+
+#endif
@@ -40,6 +40,8 @@ bool AudioPlayerAlsa::init(AudioContext& ac)
         format = SND_PCM_FORMAT_U8;
     if (ac.outBitDepth == 16)
         format = SND_PCM_FORMAT_S16_LE;
+    if (ac.outBitDepth == 32)
+        format = ac.outFloat ? SND_PCM_FORMAT_FLOAT_LE : SND_PCM_FORMAT_S32_LE;
 
     /* Build a 50 ms silence buffer */
     int sil_bytes = static_cast<int>(0.05 * ac.outFrequency) * ac.outAlignSize;
@@ -47,7 +49,7 @@ bool AudioPlayerAlsa::init(AudioContext& ac)
     if (ac.outBitDepth == 8) {
         silence.assign(sil_bytes, -128);
     }
-    if (ac.outBitDepth == 16) {
+    if ((ac.outBitDepth == 16) || (ac.outBitDepth == 32)) {
         silence.assign(sil_bytes, 0x00);
     }
 
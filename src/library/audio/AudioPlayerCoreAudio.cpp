@@ -89,6 +89,10 @@ bool AudioPlayerCoreAudio::init(AudioContext& ac)
             strdesc.mBitsPerChannel = 16;
             strdesc.mFormatFlags |= kLinearPCMFormatFlagIsSignedInteger;
             break;
+        case 32:
+            strdesc.mBitsPerChannel = 32;
+            strdesc.mFormatFlags |= ac.outFloat ? kLinearPCMFormatFlagIsFloat : kLinearPCMFormatFlagIsSignedInteger;
+            break;
         default:
             LOG(LL_ERROR, LCF_SOUND, "Unsupported audio format %d", ac.outBitDepth);
             return false;
@@ -20,11 +20,8 @@
 #include "AudioSource.h"
 #include "AudioConverter.h"
 #include "AudioBuffer.h"
-#ifdef __unix__
-#include "AudioConverterSwr.h"
-#elif defined(__APPLE__) && defined(__MACH__)
-#include "AudioConverterCoreAudio.h"
-#endif
+#include "AudioContext.h"
+#include "AudioMixer.h"
 
 #include "logging.h"
 #include "global.h" // Global::shared_config
@@ -32,6 +29,11 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+/* Maximum length of a buffer that is resampled at once, in seconds */
+#define MAXRESAMPLEDLENGTH 10
 
 namespace libtas {
 
@@ -50,12 +52,6 @@ int AudioSource::ticksToSamples(struct timespec ticks, int frequency)
 
 AudioSource::AudioSource(void)
 {
-#ifdef __unix__
-    audioConverter = std::unique_ptr<AudioConverter>(new AudioConverterSwr());
-#elif defined(__APPLE__) && defined(__MACH__)
-    audioConverter = std::unique_ptr<AudioConverter>(new AudioConverterCoreAudio());
-#endif
-
     init();
 }
 
@@ -69,6 +65,7 @@ void AudioSource::init(void)
     buffer_queue.clear();
     callback = nullptr;
     callback_data = nullptr;
+    resampledBufferId = 0;
     rewind();
 }
 
@@ -82,7 +79,23 @@ void AudioSource::rewind(void)
 
 void AudioSource::dirty(void)
 {
-    audioConverter->dirty();
+    /* Give back the converter, a new one with the current parameters will
+     * be obtained on the next mixing */
+    releaseConverter();
+    resampledPosition = -1;
+}
+
+void AudioSource::releaseConverter(void)
+{
+    /* Resamplers of pitched sources are not shared, because their input
+     * frequency is unlikely to match any other source */
+    if (audioConverter) {
+        if (pitchedConverter)
+            audioConverter.reset();
+        else
+            AudioContext::get().releaseConverter(std::move(audioConverter));
+    }
+    pitchedConverter = false;
 }
 
 int AudioSource::nbQueue()
@@ -132,6 +145,7 @@ void AudioSource::setPosition(int pos)
             queue_index = bi;
             position = pos;
             samples_frac = 0;
+            resampledPosition = -1;
             return;
         }
         else {
@@ -151,6 +165,7 @@ void AudioSource::setPosition(int pos)
         position = 0;
     }
     samples_frac = 0;
+    resampledPosition = -1;
 }
 
 bool AudioSource::willEnd(struct timespec ticks)
@@ -178,7 +193,7 @@ bool AudioSource::willEnd(struct timespec ticks)
 }
 
 
-int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outBytes, int outBitDepth, int outNbChannels, int outFrequency, float outVolume)
+int AudioSource::mixWith( struct timespec ticks, float* mixBus, int outNbSamples, int outNbChannels, int outFrequency, float outVolume)
 {
     if (state != SOURCE_PLAYING)
         return -1;
@@ -188,36 +203,60 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
 
     LOG(LL_DEBUG, LCF_SOUND, "Start mixing source %d", id);
 
-    bool skipMixing = (!audioConverter->isAvailable()) || 
-                        (!Global::shared_config.av_dumping && 
+    bool skipMixing = !Global::shared_config.av_dumping && 
                             (Global::shared_config.audio_mute ||
                                 (Global::shared_config.fastforward && 
-                                    (Global::shared_config.fastforward_mode & SharedConfig::FF_MIXING))));
+                                    (Global::shared_config.fastforward_mode & SharedConfig::FF_MIXING)));
 
     std::shared_ptr<AudioBuffer> curBuf = buffer_queue[queue_index];
-
-    if (!skipMixing) {
-        /* Check if audio converter is initialized.
-         * If not, set parameters and init it */
-        if (! audioConverter->isInited()) {
-            /* Get the sample format */
-            AudioBuffer::SampleFormat outFormat = AudioBuffer::SAMPLE_FMT_U8;
-            switch (outBitDepth) {
-                case 8:
-                    outFormat = AudioBuffer::SAMPLE_FMT_U8;
-                    break;
-                case 16:
-                    outFormat = AudioBuffer::SAMPLE_FMT_S16;
-                    break;
-                default:
-                    LOG(LL_ERROR, LCF_SOUND, "Unknown audio format");
-                    break;
+    int inFrequency = static_cast<int>(curBuf->frequency*pitch);
+
+    /* A source whose pitch is changed can vary its input frequency at each
+     * mix, so it uses neither the resampled cache nor the shared converters */
+    bool pitched = (pitch != 1.0f);
+
+    /* Looping static sources that need resampling are read from a copy of
+     * the whole buffer resampled once */
+    bool useCache = false;
+    if (!skipMixing && !pitched && (source == SOURCE_STATIC) && looping && (inFrequency != outFrequency)) {
+        useCache = fillResampledCache(*curBuf, inFrequency, outNbChannels, outFrequency);
+        if (useCache) {
+            releaseConverter();
+            if ((resampledPosition < 0) || (resampledBufferId != curBuf->id)) {
+                resampledPosition = static_cast<int64_t>(position) * outFrequency / inFrequency;
+                resampledBufferId = curBuf->id;
             }
+        }
+    }
 
-            audioConverter->init(curBuf->format, curBuf->nbChannels, static_cast<int>(curBuf->frequency*pitch), outFormat, outNbChannels, outFrequency);
+    if (!skipMixing && !useCache) {
+        /* Get a converter into float samples for the mix bus, or change it
+         * if the buffer parameters have changed */
+        AudioConverterParams params = {curBuf->format, curBuf->nbChannels, inFrequency, outNbChannels, outFrequency};
+        if (audioConverter && !(audioConverter->params == params)) {
+            if (pitched && pitchedConverter) {
+                /* Only the pitch changed, init our own resampler again */
+                audioConverter->params = params;
+                audioConverter->init(params.inFormat, params.inChannels, params.inFreq, AudioBuffer::SAMPLE_FMT_FLT, params.outChannels, params.outFreq);
+            }
+            else {
+                releaseConverter();
+            }
         }
+        if (!audioConverter) {
+            if (pitched)
+                audioConverter = AudioContext::get().createResampler(params);
+            else
+                audioConverter = AudioContext::get().acquireConverter(params);
+            pitchedConverter = pitched;
+        }
+        if (!audioConverter)
+            skipMixing = true;
     }
 
+    /* Do we push samples into the converter */
+    bool feedConverter = !skipMixing && !useCache;
+
     /* Mixing source volume and master volume.
      * Taken from openAL doc:
      * "The implementation is free to clamp the total gain (effective gain
@@ -229,11 +268,8 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
     if (resultVolume > 1.0f)
         resultVolume = 1.0f;
 
-    int lvas = (int)(resultVolume * 65536.0f);
-    int rvas = (int)(resultVolume * 65536.0f);
-
     /* Number of samples to advance in the buffer. */
-    int inNbSamples = ticksToSamples(ticks, static_cast<int>(curBuf->frequency*pitch));
+    int inNbSamples = ticksToSamples(ticks, inFrequency);
 
     int oldPosition = position;
     int newPosition = position + inNbSamples;
@@ -246,14 +282,14 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
 
         position = newPosition;
         LOG(LL_DEBUG, LCF_SOUND, "  Buffer %d in read in range %d - %d", curBuf->id, oldPosition, position);
-        if (!skipMixing) {
+        if (feedConverter) {
             audioConverter->queueSamples(begSamples, inNbSamples);
         }
     }
     else {
         /* We reached the end of the buffer */
         LOG(LL_DEBUG, LCF_SOUND, "  Buffer %d is read from %d to its end %d", curBuf->id, oldPosition, curBuf->sampleSize);
-        if (!skipMixing) {
+        if (feedConverter) {
             if (availableSamples > 0)
                 audioConverter->queueSamples(begSamples, availableSamples);
         }
@@ -274,7 +310,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                 callback(*curBuf);
                 detTimer.fakeAdvanceTimer({0, 0});
                 availableSamples = curBuf->getSamples(begSamples, remainingSamples, 0, false);
-                if (!skipMixing) {
+                if (feedConverter) {
                     audioConverter->queueSamples(begSamples, availableSamples);
                 }
 
@@ -296,7 +332,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                     availableSamples = loopbuf->getSamples(begSamples, remainingSamples, loopbuf->loop_point_beg, (source == SOURCE_STATIC) && looping);
                     LOG(LL_DEBUG, LCF_SOUND, "  Buffer %d in read in range %d - %d", loopbuf->id, loopbuf->loop_point_beg, availableSamples);
 
-                    if (!skipMixing) {
+                    if (feedConverter) {
                         audioConverter->queueSamples(begSamples, availableSamples);
                     }
 
@@ -311,7 +347,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                     availableSamples = loopbuf->getSamples(begSamples, remainingSamples, 0, false);
                     LOG(LL_DEBUG, LCF_SOUND, "  Buffer %d in read in range 0 - %d", loopbuf->id, availableSamples);
 
-                    if (!skipMixing) {
+                    if (feedConverter) {
                         audioConverter->queueSamples(begSamples, availableSamples);
                     }
 
@@ -340,7 +376,7 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
                             availableSamples = loopbuf->getSamples(begSamples, remainingSamples, 0, false);
                             LOG(LL_DEBUG, LCF_SOUND, "  Buffer %d in read in range 0 - %d", loopbuf->id, availableSamples);
 
-                            if (!skipMixing) {
+                            if (feedConverter) {
                                 audioConverter->queueSamples(begSamples, availableSamples);
                             }
 
@@ -376,57 +412,18 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
 
     if (!skipMixing) {
         /* Allocate the mixed audio array */
-        int outNbSamples = outBytes / (outNbChannels * outBitDepth / 8);
-        mixedSamples.resize(outBytes);
-
-        /* Get the converter samples */
-        convOutSamples = audioConverter->getSamples(mixedSamples.data(), outNbSamples);
-
-        #define clamptofullsignedrange(x,lo,hi) ((static_cast<unsigned int>((x)-(lo))<=static_cast<unsigned int>((hi)-(lo)))?(x):(((x)<0)?(lo):(hi)))
-
-        int nbSaturate = 0;
-
-        /* Add mixed source to the output buffer */
-        if (outBitDepth == 8) {
-            for (int s=0; s<convOutSamples*outNbChannels; s+=outNbChannels) {
-                int myL = mixedSamples[s];
-                int otherL = outSamples[s];
-                int sumL = otherL + ((myL * lvas) >> 16) - 256;
-                outSamples[s] = clamptofullsignedrange(sumL, 0, UINT8_MAX);
-                nbSaturate += (sumL < 0) || (sumL > UINT8_MAX);
-
-                if (outNbChannels == 2) {
-                    int myR = mixedSamples[s+1];
-                    int otherR = outSamples[s+1];
-                    int sumR = otherR + ((myR * rvas) >> 16) - 256;
-                    outSamples[s+1] = clamptofullsignedrange(sumR, 0, UINT8_MAX);
-                    nbSaturate += (sumR < 0) || (sumR > UINT8_MAX);
-                }
-            }
-        }
+        mixedSamples.resize(outNbSamples * outNbChannels);
 
-        if (outBitDepth == 16) {
-            int16_t* mixedSamples16 = reinterpret_cast<int16_t*>(mixedSamples.data());
-            int16_t* outSamples16 = reinterpret_cast<int16_t*>(outSamples);
-            for (int s=0; s<convOutSamples*outNbChannels; s+=outNbChannels) {
-                int myL = mixedSamples16[s];
-                int otherL = outSamples16[s];
-                int sumL = otherL + ((myL * lvas) >> 16);
-                outSamples16[s] = clamptofullsignedrange(sumL, INT16_MIN, INT16_MAX);
-                nbSaturate += (sumL < INT16_MIN) || (sumL > INT16_MAX);
-
-                if (outNbChannels == 2) {
-                    int myR = mixedSamples16[s+1];
-                    int otherR = outSamples16[s+1];
-                    int sumR = otherR + ((myR * rvas) >> 16);
-                    outSamples16[s+1] = clamptofullsignedrange(sumR, INT16_MIN, INT16_MAX);
-                    nbSaturate += (sumR < INT16_MIN) || (sumR > INT16_MAX);
-                }
-            }
-        }
-        
-        if (nbSaturate > 0)
-            LOG(LL_WARN, LCF_SOUND, "Saturation during mixing for %d samples", nbSaturate);        
+        /* Get the converted samples */
+        if (useCache)
+            convOutSamples = readResampledCache(*curBuf, outNbSamples, outNbChannels);
+        else
+            convOutSamples = audioConverter->getSamples(reinterpret_cast<uint8_t*>(mixedSamples.data()), outNbSamples);
+
+        /* Add mixed source to the mix bus. Saturation is handled when
+         * converting the bus into the output format */
+        if (convOutSamples > 0)
+            AudioMixer::mix(mixBus, mixedSamples.data(), convOutSamples * outNbChannels, resultVolume);
     }
 
     /* Reset the audio converter if the source has stopped */
@@ -436,4 +433,74 @@ int AudioSource::mixWith( struct timespec ticks, uint8_t* outSamples, int outByt
     return convOutSamples;
 }
 
+bool AudioSource::fillResampledCache(AudioBuffer& buffer, int inFrequency, int outNbChannels, int outFrequency)
+{
+    if (buffer.resampledValid && (buffer.resampledInFrequency == inFrequency) &&
+        (buffer.resampledChannels == outNbChannels) && (buffer.resampledFrequency == outFrequency))
+        return true;
+
+    if ((inFrequency <= 0) || (buffer.sampleSize == 0) ||
+        (buffer.sampleSize > static_cast<int64_t>(MAXRESAMPLEDLENGTH) * inFrequency))
+        return false;
+
+    AudioContext& audiocontext = AudioContext::get();
+    AudioConverterParams params = {buffer.format, buffer.nbChannels, inFrequency, outNbChannels, outFrequency};
+    std::unique_ptr<AudioConverter> converter = audiocontext.acquireConverter(params);
+    if (!converter)
+        return false;
+
+    if (!converter->isInited()) {
+        audiocontext.releaseConverter(std::move(converter));
+        return false;
+    }
+
+    LOG(LL_DEBUG, LCF_SOUND, "Resample the whole buffer %d", buffer.id);
+
+    uint8_t* inSamples;
+    int inNbSamples = buffer.getSamples(inSamples, buffer.sampleSize, 0, false);
+    converter->queueSamples(inSamples, inNbSamples);
+
+    /* Get all samples at once, with some margin for the resampler delay */
+    int outNbSamples = static_cast<int64_t>(inNbSamples) * outFrequency / inFrequency + 256;
+    buffer.resampled.resize(static_cast<size_t>(outNbSamples) * outNbChannels);
+    int convOutSamples = converter->getSamples(reinterpret_cast<uint8_t*>(buffer.resampled.data()), outNbSamples);
+    if (convOutSamples < 0)
+        convOutSamples = 0;
+    buffer.resampled.resize(static_cast<size_t>(convOutSamples) * outNbChannels);
+
+    audiocontext.releaseConverter(std::move(converter));
+
+    buffer.resampledInFrequency = inFrequency;
+    buffer.resampledFrequency = outFrequency;
+    buffer.resampledChannels = outNbChannels;
+    buffer.resampledLoopEnd = convOutSamples;
+    if (buffer.loop_point_end != 0)
+        buffer.resampledLoopEnd = std::min(convOutSamples, static_cast<int>(static_cast<int64_t>(buffer.loop_point_end) * outFrequency / inFrequency));
+    buffer.resampledLoopBeg = std::min(buffer.resampledLoopEnd, static_cast<int>(static_cast<int64_t>(buffer.loop_point_beg) * outFrequency / inFrequency));
+    buffer.resampledValid = true;
+    return true;
+}
+
+int AudioSource::readResampledCache(const AudioBuffer& buffer, int outNbSamples, int outNbChannels)
+{
+    int64_t loopBeg = buffer.resampledLoopBeg;
+    int64_t loopEnd = buffer.resampledLoopEnd;
+    if (loopEnd <= loopBeg)
+        return 0;
+
+    int written = 0;
+    while (written < outNbSamples) {
+        if (resampledPosition >= loopEnd)
+            resampledPosition = loopBeg;
+
+        int nbSamples = static_cast<int>(std::min(static_cast<int64_t>(outNbSamples - written), loopEnd - resampledPosition));
+        memcpy(&mixedSamples[static_cast<size_t>(written) * outNbChannels],
+            &buffer.resampled[static_cast<size_t>(resampledPosition) * outNbChannels],
+            static_cast<size_t>(nbSamples) * outNbChannels * sizeof(float));
+        written += nbSamples;
+        resampledPosition += nbSamples;
+    }
+    return written;
+}
+
 }
@@ -108,11 +108,22 @@ class AudioSource
         /* Indicate the current position in the buffer queue */
         int queue_index;
 
-        /* Object for resampling audio */
+        /* Object for resampling audio, obtained from the audio context */
         std::unique_ptr<AudioConverter> audioConverter;
 
-        /* Temporary array of mixed samples */
-        std::vector<uint8_t> mixedSamples;
+        /* Is the converter a resampler owned by this source because its
+         * pitch is changed, instead of one shared with other sources */
+        bool pitchedConverter;
+
+        /* Position inside the resampled cache of the buffer, in output
+         * samples, or -1 if it must be computed from `position` */
+        int64_t resampledPosition;
+
+        /* Buffer the position inside the resampled cache refers to */
+        int resampledBufferId;
+
+        /* Temporary array of converted float samples */
+        std::vector<float> mixedSamples;
 
         /* In case of callback type, callback function.
          * We send as an argument a pointer to the buffer to refill.
@@ -133,7 +144,7 @@ class AudioSource
         /* Rewind source to the beginning of the first buffer */
         void rewind();
 
-        /* Some parameters have changed, so we must set a new resample context */
+        /* Some parameters have changed, so we must get a new resample context */
         void dirty();
 
         /* Returns the number of buffers in its queue */
@@ -165,11 +176,23 @@ class AudioSource
         /* Check if reading a number of ticks will reach the end of the source */
         bool willEnd(struct timespec ticks);
 
-        /* Mix the buffer with an external buffer of the given format.
+        /* Mix the buffer into a float mix bus of `outNbSamples` samples.
          * The number of samples to mix correspond to the number of ticks given.
-         * The function returns the number of samples written in the output buffer.
+         * The function returns the number of samples written in the mix bus.
          */
-        int mixWith( struct timespec ticks, uint8_t* outSamples, int outBytes, int outBitDepth, int outNbChannels, int outFrequency, float outVolume);
+        int mixWith( struct timespec ticks, float* mixBus, int outNbSamples, int outNbChannels, int outFrequency, float outVolume);
+
+    private:
+        /* Give back or delete the converter */
+        void releaseConverter();
+
+        /* Fill the cache of the whole buffer resampled into float samples if
+         * needed. Returns if the cache can be used. */
+        bool fillResampledCache(AudioBuffer& buffer, int inFrequency, int outNbChannels, int outFrequency);
+
+        /* Read `outNbSamples` samples from the resampled cache of the buffer
+         * into `mixedSamples`, following the loop points */
+        int readResampledCache(const AudioBuffer& buffer, int outNbSamples, int outNbChannels);
 };
 }
 
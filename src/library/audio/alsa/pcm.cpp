@@ -640,6 +640,9 @@ snd_pcm_sframes_t snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_ufr
 
     source->buffer_queue.push_back(ab);
 
+    /* Wake up the mixer if it is waiting for samples */
+    audiocontext.queue_cond.notify_all();
+
     return static_cast<snd_pcm_sframes_t>(size);
 }
 
@@ -733,9 +736,13 @@ snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t *pcm, snd_pcm_uframes_t offset,
 
     /* Push the mmap buffer to the source */
     int sourceId = reinterpret_cast<intptr_t>(pcm);
-    auto source = AudioContext::get().getSource(sourceId);
+    AudioContext& audiocontext = AudioContext::get();
+    auto source = audiocontext.getSource(sourceId);
     source->buffer_queue.push_back(mmap_ab);
 
+    /* Wake up the mixer if it is waiting for samples */
+    audiocontext.queue_cond.notify_all();
+
     /* We should unlock the audio mutex here, but we don't (see above comment) */
     // audiocontext.mutex.unlock();
 
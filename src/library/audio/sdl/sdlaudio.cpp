@@ -300,6 +300,9 @@ static int open_audio_device(const SDL_AudioSpec * desired, SDL_AudioSpec * obta
         case 16:
             spec->format = AUDIO_S16LSB;
             break;
+        case 32:
+            spec->format = Global::shared_config.audio_float ? AUDIO_F32LSB : AUDIO_S32LSB;
+            break;
     }
     spec->channels = Global::shared_config.audio_channels;
 
@@ -324,6 +327,9 @@ static int open_audio_device(const SDL_AudioSpec * desired, SDL_AudioSpec * obta
         case 16:
             spec->format = AUDIO_S16LSB;
             break;
+        case 32:
+            spec->format = Global::shared_config.audio_float ? AUDIO_F32LSB : AUDIO_S32LSB;
+            break;
     }
     spec->channels = Global::shared_config.audio_channels;
 
@@ -456,6 +462,9 @@ void SDL_MixAudio(Uint8 * dst, const Uint8 * src, Uint32 len, int volume)
     ab->update();
     sourcesSDL[dev-1]->buffer_queue.push_back(ab);
 
+    /* Wake up the mixer if it is waiting for samples */
+    audiocontext.queue_cond.notify_all();
+
     /* If an underrun occurred, resume the playback */
     sourcesSDL[dev-1]->state = AudioSource::SOURCE_UNDERRUN;
         sourcesSDL[dev-1]->state = AudioSource::SOURCE_PLAYING;
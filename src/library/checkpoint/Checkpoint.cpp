@@ -90,6 +90,12 @@ static int ss_index = -1;
 static int parent_ss_index = -1;
 static int base_ss_index = -1;
 
+/* Index of the parent state that was removed while still being the parent */
+#define REMOVED_PARENT_INDEX SharedConfig::SS_SLOT_COUNT
+
+/* Parent state was removed and its pages are not available anymore */
+static bool parent_removed = false;
+
 /* Savestate ucontext (must be stored outside the alt stack) */
 static ucontext_t ss_ucontext;
 #if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
@@ -135,15 +141,6 @@ void Checkpoint::setBaseSavestateIndex(int index)
     base_ss_index = index;
 }
 
-void Checkpoint::setCurrentToParent()
-{
-    if (Global::shared_config.savestate_settings & SharedConfig::SS_INCREMENTAL) {
-        strcpy(parentpagemappath, pagemappath);
-        strcpy(parentpagespath, pagespath);
-        parent_ss_index = ss_index;
-    }
-}
-
 static void resetParent()
 {
     parentpagemappath[0] = '\0';
@@ -176,6 +173,57 @@ static void setPagesFd(int index, int fd)
     pages[index] = fd;
 }
 
+static void closeSavestate(int index)
+{
+    if (getPagemapFd(index)) {
+        NATIVECALL(close(getPagemapFd(index)));
+        setPagemapFd(index, 0);
+    }
+
+    if (getPagesFd(index)) {
+        NATIVECALL(close(getPagesFd(index)));
+        setPagesFd(index, 0);
+    }
+}
+
+void Checkpoint::setCurrentToParent()
+{
+    if (Global::shared_config.savestate_settings & SharedConfig::SS_INCREMENTAL) {
+        strcpy(parentpagemappath, pagemappath);
+        strcpy(parentpagespath, pagespath);
+        parent_ss_index = ss_index;
+        parent_removed = false;
+
+        /* The removed parent state is not needed anymore */
+        closeSavestate(REMOVED_PARENT_INDEX);
+    }
+}
+
+void Checkpoint::removeSavestate(int index)
+{
+    if (index == parent_ss_index) {
+        /* Soft-dirty bits were cleared when saving the parent state, so the
+         * next state must still get unmodified pages from it. We keep its
+         * memfds alive until another state becomes the parent. */
+        if (Global::shared_config.savestate_settings & SharedConfig::SS_RAM) {
+            closeSavestate(REMOVED_PARENT_INDEX);
+            setPagemapFd(REMOVED_PARENT_INDEX, getPagemapFd(index));
+            setPagesFd(REMOVED_PARENT_INDEX, getPagesFd(index));
+            setPagemapFd(index, 0);
+            setPagesFd(index, 0);
+            parent_ss_index = REMOVED_PARENT_INDEX;
+            return;
+        }
+
+        /* Savestate files are removed by the program, so the next state
+         * must store all its pages */
+        resetParent();
+        parent_removed = true;
+    }
+
+    closeSavestate(index);
+}
+
 int Checkpoint::checkCheckpoint()
 {
     if (Global::shared_config.savestate_settings & SharedConfig::SS_RAM)
@@ -1069,6 +1117,9 @@ static size_t writeAnArea(SaveStateSaving state, int spmfd, SaveStateLoading &pa
                     state.savePageFlag(parent_flag);
                 }
             }
+            else if (parent_removed) {
+                area_size += state.queuePageSave(curAddr);
+            }
             else {
                 state.savePageFlag(Area::BASE_PAGE);
             }
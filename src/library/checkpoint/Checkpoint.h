@@ -39,6 +39,9 @@ namespace Checkpoint
 
     void setCurrentToParent();
 
+    /* Free the memory of a savestate stored in RAM, and forget it as parent */
+    void removeSavestate(int index);
+
     void getStateHeader(StateHeader* sh);
     int checkCheckpoint();
     int checkRestore();
@@ -0,0 +1,57 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Futex.h"
+
+#include "GlobalState.h"
+
+#include <cerrno>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace libtas {
+
+bool Futex::wait(volatile int* addr, int val, const struct timespec* timeout, bool shared)
+{
+#ifdef __linux__
+    int op = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    long ret = syscall(SYS_futex, addr, op, val, timeout, nullptr, 0);
+    return !((ret == -1) && (errno == ETIMEDOUT));
+#else
+    /* No futex, just sleep a bit and let the caller check again */
+    struct timespec sleepTime = { 0, 10 * 1000 };
+    if (timeout && (timeout->tv_sec == 0) && (timeout->tv_nsec < sleepTime.tv_nsec))
+        sleepTime = *timeout;
+    NATIVECALL(nanosleep(&sleepTime, nullptr));
+    return *addr != val;
+#endif
+}
+
+void Futex::wake(volatile int* addr, int count, bool shared)
+{
+#ifdef __linux__
+    int op = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    syscall(SYS_futex, addr, op, count, nullptr, nullptr, 0);
+#endif
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_FUTEX_H
+#define LIBTAS_FUTEX_H
+
+#include <time.h>
+
+namespace libtas {
+namespace Futex
+{
+    /* Sleep while `*addr` equals `val`, for at most `timeout` (relative) or
+     * indefinitely if null. `shared` must be set for futexes woken by the
+     * kernel, such as the tid cleared at thread exit.
+     * Returns false if the timeout expired. */
+    bool wait(volatile int* addr, int val, const struct timespec* timeout, bool shared = false);
+
+    /* Wake up to `count` threads sleeping on `addr` */
+    void wake(volatile int* addr, int count, bool shared = false);
+}
+}
+
+#endif
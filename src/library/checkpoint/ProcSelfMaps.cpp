@@ -39,7 +39,12 @@ ProcSelfMaps::ProcSelfMaps() : off(0)
     int fd;
     NATIVECALL(fd = open("/proc/self/maps", O_RDONLY));
     MYASSERT(fd != -1);
-    NATIVECALL(tmp_fd = open("/tmp/libtas-maps", O_RDWR | O_CREAT | O_TRUNC, 0666));
+    /* Use an unnamed file, so that several game instances don't share it */
+#ifdef O_TMPFILE
+    NATIVECALL(tmp_fd = open("/tmp", O_RDWR | O_TMPFILE, 0600));
+    if (tmp_fd == -1)
+#endif
+        NATIVECALL(tmp_fd = open("/tmp/libtas-maps", O_RDWR | O_CREAT | O_TRUNC, 0666));
     MYASSERT(tmp_fd != -1);
     
     ssize_t sz = 1;
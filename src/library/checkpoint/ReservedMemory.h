@@ -23,6 +23,7 @@
 #define LIBTAS_RESERVEDMEMORY_H
 
 #include "StateHeader.h"
+#include "../shared/SharedConfig.h"
 
 #include <cstdint> // intptr_t
 #include <cstddef> // size_t
@@ -34,10 +35,15 @@ namespace ReservedMemory {
     enum Sizes {
         COMPRESSED_SIZE = 4 * ONE_MB,
         STACK_SIZE = 5 * ONE_MB,
-        PAGEMAPS_SIZE = 11*sizeof(int),
-        PAGES_SIZE = 11*sizeof(int),
-        SS_SLOTS_SIZE = 11*sizeof(bool),
+        /* One more entry to hold the removed parent state */
+        PAGEMAPS_SIZE = (SharedConfig::SS_SLOT_COUNT+1)*sizeof(int),
+        PAGES_SIZE = (SharedConfig::SS_SLOT_COUNT+1)*sizeof(int),
+        SS_SLOTS_SIZE = SharedConfig::SS_SLOT_COUNT*sizeof(bool),
         SH_SIZE = sizeof(StateHeader),
+        LOG_RING_COUNT = 32,
+        LOG_RING_DATA_SIZE = 64 * 1024,
+        LOG_RING_SIZE = 128 + LOG_RING_DATA_SIZE,
+        LOG_RINGS_SIZE = LOG_RING_COUNT * LOG_RING_SIZE,
     };
     enum Addresses {
         COMPRESSED_ADDR = 0,
@@ -46,7 +52,8 @@ namespace ReservedMemory {
         PAGES_ADDR = PAGEMAPS_ADDR + PAGEMAPS_SIZE,
         SS_SLOTS_ADDR = PAGES_ADDR + PAGES_SIZE,
         SH_ADDR = SS_SLOTS_ADDR + SS_SLOTS_SIZE,
-        RESTORE_TOTAL_SIZE = SH_ADDR + SH_SIZE,
+        LOG_RINGS_ADDR = ((SH_ADDR + SH_SIZE + 63) / 64) * 64,
+        RESTORE_TOTAL_SIZE = LOG_RINGS_ADDR + LOG_RINGS_SIZE,
     };
 
     void init();
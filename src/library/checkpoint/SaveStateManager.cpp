@@ -26,17 +26,21 @@
 #include "AltStack.h"
 #include "ReservedMemory.h"
 #include "ThreadInfo.h"
+#include "Futex.h"
 
 #include "general/timewrappers.h" // clock_gettime
 #include "logging.h"
 #include "global.h"
 #include "GlobalState.h"
+#include "AsyncLog.h"
 #ifdef __linux__
 #include "fileio/URandom.h"
 #include "audio/AudioPlayerAlsa.h"
 #elif defined(__APPLE__) && defined(__MACH__)
 #include "audio/AudioPlayerCoreAudio.h"
 #endif
+#include "encoding/AVEncoder.h"
+#include "encoding/Screenshot.h"
 #include "fileio/FileHandleList.h"
 #include "renderhud/MessageWindow.h"
 #ifdef __unix__
@@ -46,6 +50,7 @@
 
 #include <sstream>
 #include <utility>
+#include <atomic>
 #include <csignal>
 #include <algorithm> // std::find
 #include <sys/mman.h>
@@ -63,6 +68,9 @@ static sem_t semWaitForCkptThreadSignal;
 static pthread_mutex_t threadResumeLock = PTHREAD_MUTEX_INITIALIZER;
 static volatile bool restoreInProgress = false;
 static int numThreads;
+/* Number of signaled threads that are not suspended yet, also used as a futex */
+static std::atomic<int> threadsToSuspend(0);
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "atomic int cannot be used as a futex");
 static int sig_suspend_threads = SIGXFSZ;
 static int sig_checkpoint = SIGSYS;
 static bool* state_dirty;
@@ -105,7 +113,7 @@ void SaveStateManager::init()
     ReservedMemory::init();
 
     state_dirty = static_cast<bool*>(ReservedMemory::getAddr(ReservedMemory::SS_SLOTS_ADDR));
-    memset(state_dirty, 0, 11*sizeof(bool));
+    memset(state_dirty, 0, SharedConfig::SS_SLOT_COUNT*sizeof(bool));
 }
 
 void SaveStateManager::initCheckpointThread()
@@ -153,7 +161,7 @@ int SaveStateManager::waitChild()
         return -1;
     }
     status = WEXITSTATUS(status);
-    if ((status < 0) && (status > 10)) {
+    if ((status < 0) || (status >= SharedConfig::SS_SLOT_COUNT)) {
         LOG(LL_ERROR, LCF_CHECKPOINT, "Got unknown status code %d from pid %d", status, pid);
         return -1;
     }
@@ -171,7 +179,7 @@ bool SaveStateManager::stateReady(int slot)
     if (!(Global::shared_config.savestate_settings & SharedConfig::SS_FORK))
         return true;
 
-    if ((slot < 0) && (slot > 10)) {
+    if ((slot < 0) || (slot >= SharedConfig::SS_SLOT_COUNT)) {
         LOG(LL_ERROR, LCF_CHECKPOINT, "Wrong slot number");
         return false;
     }
@@ -189,6 +197,10 @@ int SaveStateManager::checkpoint(int slot)
     if (!stateReady(slot))
         return ESTATE_NOTCOMPLETE;
 
+    /* Codec threads of the in-process encoder are not suspended */
+    if (avencoder && avencoder->hasWorkerThreads())
+        return ESTATE_ENCODING;
+
     ThreadInfo *current_thread = ThreadManager::getCurrentThread();
     MYASSERT(current_thread->state == ThreadInfo::ST_CKPNTHREAD)
 
@@ -205,6 +217,14 @@ int SaveStateManager::checkpoint(int slot)
     AudioPlayerCoreAudio::close();
 #endif
 
+    /* The encoder, screenshot and logging threads are not known by the
+     * thread manager, so we write all queued frames and messages and
+     * terminate them. They are restarted when needed. */
+    if (avencoder)
+        avencoder->stopThread();
+    Screenshot::stopThread();
+    AsyncLog::stopThread();
+
     /* Perform a series of checks before attempting to checkpoint */
     int ret = Checkpoint::checkCheckpoint();
     if (ret < 0) {
@@ -348,6 +368,10 @@ int SaveStateManager::restore(int slot)
     if (!stateReady(slot))
         return ESTATE_NOTCOMPLETE;
 
+    /* Codec threads of the in-process encoder are not suspended */
+    if (avencoder && avencoder->hasWorkerThreads())
+        return ESTATE_ENCODING;
+
     ThreadInfo *current_thread = ThreadManager::getCurrentThread();
     MYASSERT(current_thread->state == ThreadInfo::ST_CKPNTHREAD)
     ThreadSync::acquireLocks();
@@ -361,6 +385,14 @@ int SaveStateManager::restore(int slot)
     AudioPlayerCoreAudio::close();
 #endif
 
+    /* The encoder, screenshot and logging threads are not known by the
+     * thread manager, so we write all queued frames and messages and
+     * terminate them. They are restarted when needed. */
+    if (avencoder)
+        avencoder->stopThread();
+    Screenshot::stopThread();
+    AsyncLog::stopThread();
+
     /* Perform a series of checks before attempting to restore */
     int ret = Checkpoint::checkRestore();
     if (ret < 0) {
@@ -481,21 +513,64 @@ void SaveStateManager::terminateThreads()
     ThreadManager::unlockList();
 }
 
+/* Wait for a thread to exit, for at most `timeout_ms` milliseconds or
+ * indefinitely if negative. A terminating thread sets the tid in pthread
+ * struct to 0 and the kernel wakes futex waiters on it, like `pthread_join()`
+ * does. Returns if the thread has exited */
+static bool waitForThreadExit(ThreadInfo *thread, int timeout_ms)
+{
+    struct timespec deadline;
+    NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &deadline));
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    volatile pid_t *ptid = thread->ptid;
+    pid_t tid;
+    while ((tid = *ptid) != 0) {
+        LOG(LL_DEBUG, LCF_CHECKPOINT, "Wait for tid %d to become 0", tid);
+
+        if (timeout_ms < 0) {
+            Futex::wait(ptid, tid, nullptr, true);
+            continue;
+        }
+
+        struct timespec now, remaining;
+        NATIVECALL(clock_gettime(CLOCK_MONOTONIC, &now));
+        remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+        remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (remaining.tv_nsec < 0) {
+            remaining.tv_sec--;
+            remaining.tv_nsec += 1000000000;
+        }
+        if (remaining.tv_sec < 0)
+            return false;
+
+        Futex::wait(ptid, tid, &remaining, true);
+    }
+    return true;
+}
+
 void SaveStateManager::suspendThreads()
 {
     MYASSERT(pthread_mutex_lock(&threadResumeLock) == 0)
 
     /* Terminate threads flagged as such.
      * Halt all other threads - force them to call stopthisthread
-     * If any have blocked checkpointing, wait for them to unblock before
-     * signalling
+     * Each signaled thread is counted in `threadsToSuspend`, and the last
+     * thread to be suspended wakes us up.
      */
     ThreadManager::lockList();
 
+    numThreads = 0;
+    threadsToSuspend = 0;
+
     bool needrescan = false;
     do {
         needrescan = false;
-        numThreads = 0;
         ThreadInfo *next;
         for (ThreadInfo *thread = ThreadManager::getThreadList(); thread != nullptr; thread = next) {
             next = thread->next;
@@ -511,44 +586,33 @@ void SaveStateManager::suspendThreads()
 
             case ThreadInfo::ST_RUNNING:
                 /* Thread is running. Send it a signal so it will call stopthisthread.
-                * We will need to rescan (hopefully it will be suspended by then)
-                */
+                 * It must be counted before being signaled, because it may
+                 * be suspended before `pthread_kill()` returns.
+                 */
                 thread->orig_state = thread->state;
                 if (ThreadManager::updateState(thread, ThreadInfo::ST_SIGNALED, ThreadInfo::ST_RUNNING)) {
+                    threadsToSuspend++;
+
                     /* Send the suspend signal to the thread */
                     LOG(LL_DEBUG, LCF_CHECKPOINT, "Signaling thread %d", thread->real_tid);
                     NATIVECALL(ret = pthread_kill(thread->pthread_id, sig_suspend_threads));
 
                     if (ret == 0) {
-                        needrescan = true;
+                        numThreads++;
                     }
                     else {
                         MYASSERT(ret == ESRCH)
                         LOG(LL_DEBUG, LCF_CHECKPOINT, "Thread %d has died since", thread->real_tid);
+                        threadsToSuspend--;
                         ThreadManager::threadIsDead(thread);
                     }
                 }
                 break;
 
             case ThreadInfo::ST_SIGNALED:
-                NATIVECALL(ret = pthread_kill(thread->pthread_id, 0));
-
-                if (ret == 0) {
-                    needrescan = true;
-                }
-                else {
-                    MYASSERT(ret == ESRCH)
-                    LOG(LL_ERROR, LCF_CHECKPOINT, "Signalled thread %d died", thread->real_tid);
-                    ThreadManager::threadIsDead(thread);
-                }
-                break;
-
             case ThreadInfo::ST_SUSPINPROG:
-                numThreads++;
-                break;
-
             case ThreadInfo::ST_SUSPENDED:
-                numThreads++;
+                /* Already counted when signaled */
                 break;
 
             case ThreadInfo::ST_CKPNTHREAD:
@@ -576,27 +640,14 @@ void SaveStateManager::suspendThreads()
                     }
 
                     /* We must wait until the thread terminates entirely, because
-                     * it may release resources during state loading.
-                     * A terminating thread sets the tid in pthread struct to 0 */
-                    int i = 0;
-                    while (*thread->ptid != 0) {
-                        LOG(LL_DEBUG, LCF_CHECKPOINT, "Wait for tid %d to become 0", *thread->ptid);                        
-                        NATIVECALL(usleep(1000));
-                        i++;
-                        if (i > 1000)
-                            break;
-                    }
-                    
-                    if (*thread->ptid != 0) {
+                     * it may release resources during state loading. */
+                    if (!waitForThreadExit(thread, 1000)) {
                         /* If we couldn't cancel the thread, try to signal it so that
                         * it can call pthread_exit(). This is unsafe! */
                         LOG(LL_DEBUG, LCF_CHECKPOINT, "Cancel failed, signaling thread %d to terminate", thread->real_tid);
                         NATIVECALL(ret = pthread_kill(thread->pthread_id, sig_suspend_threads));
-                        
-                        while (*thread->ptid != 0) {
-                            LOG(LL_DEBUG, LCF_CHECKPOINT, "Wait for tid %d to become 0", *thread->ptid);                        
-                            NATIVECALL(usleep(1000));
-                        }
+
+                        waitForThreadExit(thread, -1);
                     }
                 }
                 break;
@@ -614,12 +665,36 @@ void SaveStateManager::suspendThreads()
         }
     } while (needrescan);
 
-    ThreadManager::unlockList();
+    /* Wait for all signaled threads to be suspended. A thread that died
+     * before handling the signal will never be suspended, so we look for
+     * dead threads each time the wait times out. */
+    int remaining;
+    while ((remaining = threadsToSuspend.load()) > 0) {
+        struct timespec timeout = { 0, 10 * 1000 * 1000 };
+        if (Futex::wait(reinterpret_cast<volatile int*>(&threadsToSuspend), remaining, &timeout))
+            continue;
 
-    for (int i = 0; i < numThreads; i++) {
-        NATIVECALL(sem_wait(&semNotifyCkptThread));
+        ThreadInfo *next;
+        for (ThreadInfo *thread = ThreadManager::getThreadList(); thread != nullptr; thread = next) {
+            next = thread->next;
+            if (thread->state != ThreadInfo::ST_SIGNALED)
+                continue;
+
+            int ret;
+            NATIVECALL(ret = pthread_kill(thread->pthread_id, 0));
+            if (ret != 0) {
+                MYASSERT(ret == ESRCH)
+                LOG(LL_ERROR, LCF_CHECKPOINT, "Signalled thread %d died", thread->real_tid);
+                ThreadManager::threadIsDead(thread);
+                numThreads--;
+                if (--threadsToSuspend == 0)
+                    break;
+            }
+        }
     }
 
+    ThreadManager::unlockList();
+
     LOG(LL_DEBUG, LCF_CHECKPOINT, "%d threads were suspended", numThreads);
 }
 
@@ -663,7 +738,8 @@ void SaveStateManager::stopThisThread(int signum)
 
             /* Tell the checkpoint thread that we're all saved away */
             MYASSERT(ThreadManager::updateState(current_thread, ThreadInfo::ST_SUSPENDED, ThreadInfo::ST_SUSPINPROG))
-            NATIVECALL(sem_post(&semNotifyCkptThread));
+            if (threadsToSuspend.fetch_sub(1) == 1)
+                Futex::wake(reinterpret_cast<volatile int*>(&threadsToSuspend), 1);
 
             /* Then wait for the ckpt thread to write the ckpt file then wake us up */
             LOG(LL_DEBUG, LCF_CHECKPOINT, "Thread suspended");
@@ -826,6 +902,7 @@ void SaveStateManager::printError(int err)
         "Savestate does not exist",
         "Loading not allowed because new threads were created",
         "State still saving",
+        "Savestates are not allowed while encoding with codec threads",
         0 };
 
     if (err < 0) {
@@ -31,6 +31,7 @@
 #include "hook.h"
 #include "global.h"
 #include "GlobalState.h"
+#include "LockFreeTable.h"
 
 #include <sstream>
 #include <utility>
@@ -50,6 +51,13 @@ static pthread_mutex_t threadStateLock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t threadListLock = PTHREAD_MUTEX_INITIALIZER;
 static bool is_child_fork = false;
 
+/* Index of the thread list by pthread id, so that getThread() does not walk
+ * the list on each wrapped pthread call. Writers are serialized by
+ * threadListLock, readers do not lock. Being a static object, it is saved
+ * and restored together with the heap-allocated ThreadInfo it points to. */
+static LockFreeTable<ThreadInfo*, 2048> thread_table;
+static bool thread_table_full = false;
+
 void ThreadManager::init()
 {
     /* Create a ThreadInfo struct for this thread */
@@ -144,7 +152,15 @@ bool ThreadManager::isMainThread()
 
 ThreadInfo* ThreadManager::getThread(pthread_t pthread_id)
 {
-    for (ThreadInfo* thread = thread_list; thread != nullptr; thread = thread->next)
+    ThreadInfo* thread = nullptr;
+    if (thread_table.find(static_cast<uintptr_t>(pthread_id), thread))
+        return thread;
+
+    /* Only threads that could not be indexed need a list walk */
+    if (!thread_table_full)
+        return nullptr;
+
+    for (thread = thread_list; thread != nullptr; thread = thread->next)
         if (thread->pthread_id == pthread_id)
             return thread;
 
@@ -277,6 +293,13 @@ void ThreadManager::addToList(ThreadInfo* thread)
     }
     thread_list = thread;
 
+    /* The newest thread wins when a zombie shares its pthread id */
+    if (thread->pthread_id && !thread_table.insert(static_cast<uintptr_t>(thread->pthread_id), thread)) {
+        if (!thread_table_full)
+            LOG(LL_WARN, LCF_THREAD, "Thread table is full, falling back to list lookups");
+        thread_table_full = true;
+    }
+
     unlockList();
 }
 
@@ -309,6 +332,19 @@ void ThreadManager::threadIsDead(ThreadInfo *thread)
         thread_list = thread_list->next;
     }
 
+    /* Point the table to the next newest thread with the same id if any */
+    ThreadInfo* indexed = nullptr;
+    uintptr_t key = static_cast<uintptr_t>(thread->pthread_id);
+    if (key && thread_table.find(key, indexed) && (indexed == thread)) {
+        ThreadInfo* other = thread->next;
+        while (other && (other->pthread_id != thread->pthread_id))
+            other = other->next;
+        if (other)
+            thread_table.insert(key, other);
+        else
+            thread_table.erase(key);
+    }
+
     delete(thread);
 }
 
@@ -19,6 +19,7 @@
 
 #include "AVEncoder.h"
 #include "NutMuxer.h"
+#include "LibavMuxer.h"
 
 #include "logging.h"
 #include "screencapture/ScreenCapture.h"
@@ -29,6 +30,7 @@
 #include "../shared/messages.h"
 
 #include <cstdint>
+#include <chrono>
 #include <unistd.h> // usleep
 #include <sstream>
 #include <iomanip>
@@ -44,23 +46,18 @@ std::unique_ptr<AVEncoder> avencoder;
 
 
 AVEncoder::AVEncoder() {
-    std::ostringstream commandline;
-    commandline << "ffmpeg -hide_banner -y -f nut -i - ";
-    commandline << ffmpeg_options;
-    commandline << " \"";
-    commandline.write(dumpfile, static_cast<int>(strrchr(dumpfile, '.') - dumpfile));
+    std::ostringstream filename;
+    filename.write(dumpfile, static_cast<int>(strrchr(dumpfile, '.') - dumpfile));
     /* Add segment number to filename if not the first */
     if (segment_number > 0) {
-        commandline << "_" << segment_number;
+        filename << "_" << segment_number;
     }
-    commandline << strrchr(dumpfile, '.');
-    commandline << "\"";
+    filename << strrchr(dumpfile, '.');
+    encodefile = filename.str();
 
-    NATIVECALL(ffmpeg_pipe = popen(commandline.str().c_str(), "w"));
-
-    if (! ffmpeg_pipe) {
-        LOG(LL_ERROR, LCF_DUMP, "Could not create a pipe to ffmpeg");
-        return;
+    if (Global::shared_config.encoding_backend == SharedConfig::ENCODER_FFMPEG_PIPE) {
+        if (!openPipe())
+            return;
     }
 
     if (ScreenCapture::isInited()) {
@@ -73,6 +70,21 @@ AVEncoder::AVEncoder() {
     sendData(&segment_number, sizeof(int));
 }
 
+bool AVEncoder::openPipe() {
+    std::ostringstream commandline;
+    commandline << "ffmpeg -hide_banner -y -f nut -i - ";
+    commandline << ffmpeg_options;
+    commandline << " \"" << encodefile << "\"";
+
+    NATIVECALL(ffmpeg_pipe = popen(commandline.str().c_str(), "w"));
+
+    if (! ffmpeg_pipe) {
+        LOG(LL_ERROR, LCF_DUMP, "Could not create a pipe to ffmpeg");
+        return false;
+    }
+    return true;
+}
+
 void AVEncoder::initMuxer() {
     int width, height;
     ScreenCapture::getDimensions(width, height);
@@ -81,10 +93,33 @@ void AVEncoder::initMuxer() {
 
     /* Initialize the muxer with either framerate or video framerate */
     AudioContext& audiocontext = AudioContext::get();
-    if (Global::shared_config.variable_framerate)
-        nutMuxer = new NutMuxer(width, height, Global::shared_config.video_framerate, 1, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe);
-    else
-        nutMuxer = new NutMuxer(width, height, Global::shared_config.initial_framerate_num, Global::shared_config.initial_framerate_den, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, ffmpeg_pipe);
+    int fpsnum, fpsden;
+    if (Global::shared_config.variable_framerate) {
+        fpsnum = Global::shared_config.video_framerate;
+        fpsden = 1;
+    }
+    else {
+        fpsnum = Global::shared_config.initial_framerate_num;
+        fpsden = Global::shared_config.initial_framerate_den;
+    }
+
+    if (Global::shared_config.encoding_backend == SharedConfig::ENCODER_LIBAV) {
+        LibavMuxer* libavMuxer = new LibavMuxer();
+        if (libavMuxer->init(encodefile.c_str(), ffmpeg_options, width, height, fpsnum, fpsden, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, audiocontext.outFloat)) {
+            muxer = libavMuxer;
+            return;
+        }
+
+        /* Fall back to the ffmpeg pipe */
+        delete libavMuxer;
+        LOG(LL_WARN, LCF_DUMP, "Could not encode in-process, falling back to the ffmpeg pipe");
+        if (!openPipe())
+            return;
+    }
+
+    NutMuxer* nutMuxer = new NutMuxer(width, height, fpsnum, fpsden, pixfmt, audiocontext.outFrequency, audiocontext.outAlignSize, audiocontext.outNbChannels, audiocontext.outFloat, ffmpeg_pipe);
+    nutMuxer->skipduplicates = Global::shared_config.encoding_skip_duplicates;
+    muxer = nutMuxer;
 }
 
 void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
@@ -93,12 +128,14 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
      * that we skipped one frame and we need to encode it later.
      */
     AudioContext& audiocontext = AudioContext::get();
-    if (!nutMuxer) {
+    if (!muxer) {
         if (ScreenCapture::isInited()) {
             initMuxer();
+            if (!muxer)
+                return;
 
             /* Encode audio samples that we skipped */
-            nutMuxer->writeAudioFrame(startup_audio_bytes.data(), startup_audio_bytes.size());
+            muxer->writeAudioFrame(startup_audio_bytes.data(), startup_audio_bytes.size());
 
             /* Encode startup frames that we skipped */
 
@@ -106,7 +143,7 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
             int size = ScreenCapture::getSize();
             startup_audio_bytes.resize(size, 0); // reusing the audio samples vector
             for (int i=0; i<startup_video_frames; i++) {
-                nutMuxer->writeVideoFrame(startup_audio_bytes.data(), size);
+                muxer->writeVideoFrame(startup_audio_bytes.data(), size);
             }
         }
         else {
@@ -117,10 +154,14 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
         }
     }
 
+    /* Startup frames are written synchronously, the encoder thread takes
+     * over from here */
+    startThread();
+
     /*** Audio ***/
     LOG(LL_DEBUG, LCF_DUMP, "Encode an audio frame");
 
-    nutMuxer->writeAudioFrame(audiocontext.outSamples.data(), audiocontext.outBytes);
+    queuePacket(EncoderPacket::AUDIO, audiocontext.outSamples.data(), audiocontext.outBytes, 1, false);
 
     /*** Video ***/
 
@@ -135,18 +176,186 @@ void AVEncoder::encodeOneFrame(bool draw, TimeHolder frametime) {
         frame_remainder -= frames;
     }
 
-    /* Access to the screen pixels, or last screen pixels if not a draw frame */
-    int size = ScreenCapture::getPixelsFromSurface(&pixels, draw);
+    /* Start the transfer of the screen pixels. Depending on the screen
+     * capture, pixels are available immediately or a few frames later, so
+     * video frames are queued until their pixels can be accessed. If the
+     * transfer could not be started, the previous frame is repeated. */
+    bool readback = draw && ScreenCapture::startReadback();
+    video_frame_index++;
+    pending_video.push_back({readback, frames, video_frame_index});
+
+    writePendingVideo(ScreenCapture::readbackLatency());
+}
+
+void AVEncoder::writePendingVideo(int latency) {
+    while (!pending_video.empty()) {
+        const PendingVideoFrame& pending = pending_video.front();
+
+        /* Frames without readback repeat the last video frame */
+        bool duplicate = false;
+
+        if (pending.readback) {
+            /* The readback of frame K is finished at frame K + latency,
+             * whether frames in between were drawn or not */
+            if ((pending.index + latency) > video_frame_index)
+                break;
+
+            pixels_size = ScreenCapture::finishReadback(&pixels);
+        }
+        else if (!pixels) {
+            /* No frame was drawn yet, access the last screen pixels */
+            pixels_size = ScreenCapture::getPixelsFromSurface(&pixels, false);
+        }
+        else {
+            duplicate = true;
+        }
 
-    for (int f=0; f<frames; f++) {
         LOG(LL_DEBUG, LCF_DUMP, "Encode a video frame");
-        nutMuxer->writeVideoFrame(pixels, size);
+
+        /* The muxer does not need the pixels of a skipped duplicate */
+        if (duplicate && Global::shared_config.encoding_skip_duplicates)
+            queuePacket(EncoderPacket::VIDEO, nullptr, 0, pending.frames, true);
+        else
+            queuePacket(EncoderPacket::VIDEO, pixels, pixels_size, pending.frames, duplicate);
+
+        pending_video.pop_front();
+    }
+}
+
+void AVEncoder::startThread() {
+    if (encoder_thread.joinable() || (Global::shared_config.encoding_queue_size <= 0))
+        return;
+
+    /* Each frame is made of one audio and one video packet */
+    size_t capacity = 2 * Global::shared_config.encoding_queue_size;
+    if (packets.size() != capacity) {
+        packets.clear();
+        packets.resize(capacity);
+    }
+    packet_first = 0;
+    packet_count = 0;
+    thread_quit = false;
+
+    /* The encoder thread is entirely in native state */
+    GlobalNative gn;
+    encoder_thread = std::thread(&AVEncoder::threadLoop, this);
+}
+
+void AVEncoder::stopThread() {
+    if (!encoder_thread.joinable())
+        return;
+
+    GlobalNative gn;
+    {
+        std::lock_guard<std::mutex> lock(packet_mutex);
+        thread_quit = true;
+    }
+    packet_cond.notify_all();
+    encoder_thread.join();
+}
+
+bool AVEncoder::hasWorkerThreads() {
+    return muxer && muxer->hasWorkerThreads();
+}
+
+void AVEncoder::threadLoop() {
+    std::unique_lock<std::mutex> lock(packet_mutex);
+
+    while (true) {
+        packet_cond.wait(lock, [this]{ return (packet_count > 0) || thread_quit; });
+
+        /* Only quit when all packets have been written */
+        if (packet_count == 0)
+            break;
+
+        /* The game thread does not touch queued packets, so we can write
+         * without holding the lock */
+        EncoderPacket& packet = packets[packet_first];
+        lock.unlock();
+        writePacket(packet.type, packet.data.data(), packet.data.size(), packet.count, packet.duplicate);
+        lock.lock();
+
+        packet_first = (packet_first + 1) % packets.size();
+        packet_count--;
+        packet_cond.notify_all();
+    }
+}
+
+void AVEncoder::queuePacket(EncoderPacket::Type type, const uint8_t* data, unsigned int size, int count, bool duplicate) {
+    if (!encoder_thread.joinable()) {
+        writePacket(type, data, size, count, duplicate);
+        return;
+    }
+
+    GlobalNative gn;
+    size_t index;
+    {
+        std::unique_lock<std::mutex> lock(packet_mutex);
+
+        /* Wait for a free packet if the encoder thread is late */
+        if (packet_count == packets.size()) {
+            stall_count++;
+            auto start = std::chrono::steady_clock::now();
+            packet_cond.wait(lock, [this]{ return packet_count < packets.size(); });
+            stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        index = (packet_first + packet_count) % packets.size();
+    }
+
+    /* The packet is not seen by the encoder thread until it is counted, so
+     * it can be filled without holding the lock */
+    EncoderPacket& packet = packets[index];
+    packet.type = type;
+    packet.count = count;
+    packet.duplicate = duplicate;
+    packet.data.assign(data, data + size);
+
+    {
+        std::lock_guard<std::mutex> lock(packet_mutex);
+        packet_count++;
+    }
+    packet_cond.notify_all();
+}
+
+void AVEncoder::writePacket(EncoderPacket::Type type, const uint8_t* data, unsigned int size, int count, bool duplicate) {
+    switch (type) {
+        case EncoderPacket::AUDIO:
+            muxer->writeAudioFrame(data, size);
+            break;
+        case EncoderPacket::VIDEO:
+            /* Frames after the first one are known duplicates */
+            for (int f=0; f<count; f++) {
+                muxer->writeVideoFrame(data, size, duplicate || (f > 0));
+            }
+            break;
+    }
+}
+
+AVEncoder::QueueStats AVEncoder::getQueueStats() {
+    QueueStats stats;
+
+    GlobalNative gn;
+    std::lock_guard<std::mutex> lock(packet_mutex);
+    stats.depth = packet_count;
+    stats.capacity = encoder_thread.joinable() ? packets.size() : 0;
+    stats.stalls = stall_count;
+    stats.stall_seconds = stall_seconds;
+    return stats;
+}
+
+void AVEncoder::flushVideo() {
+    if (muxer) {
+        writePendingVideo(0);
     }
 }
 
 AVEncoder::~AVEncoder() {
-    if (nutMuxer) {
-        nutMuxer->finish();
+    if (muxer) {
+        writePendingVideo(0);
+        stopThread();
+        muxer->finish(pixels, pixels_size);
+        delete muxer;
     }
 
     if (ffmpeg_pipe) {
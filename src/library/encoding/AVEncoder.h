@@ -23,16 +23,23 @@
 #include "TimeHolder.h"
 
 #include <vector>
+#include <string>
+#include <deque>
 #include <memory> // std::unique_ptr
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
 
 namespace libtas {
 
-class NutMuxer;
+class Muxer;
 
 class AVEncoder {
     public:
         /* The constructor sets up the AV dumping into a file.
-         * It sets the pipe to an ffmpeg process, and initialize the muxer
+         * It sets the pipe to an ffmpeg process or encodes in-process,
+         * and initialize the muxer
          * with the proper screen/sound parameters.
          */
         AVEncoder();
@@ -48,6 +55,29 @@ class AVEncoder {
          */
         void encodeOneFrame(bool draw, TimeHolder frametime);
 
+        /* Write all video frames that are waiting for their screen readback.
+         * Must be called before the screen surface is destroyed.
+         */
+        void flushVideo();
+
+        /* Write all queued frames and terminate the encoder thread. It is
+         * started again on the next encoded frame. Must be called before
+         * saving or loading a state, because the thread is not suspended.
+         */
+        void stopThread();
+
+        /* Does the encoder run codec threads, which prevents savestates */
+        bool hasWorkerThreads();
+
+        /* Statistics of the encoder queue, for display */
+        struct QueueStats {
+            int depth;
+            int capacity;
+            uint64_t stalls;
+            double stall_seconds;
+        };
+        QueueStats getQueueStats();
+
         /* Close all allocated objects and close the pipe at the end of an av dump
          */
         ~AVEncoder();
@@ -63,10 +93,72 @@ class AVEncoder {
 
         static int segment_number;
     private:
+        /* Start an ffmpeg process reading from a pipe */
+        bool openPipe();
+
+        /* Filename of this segment */
+        std::string encodefile;
+
         FILE *ffmpeg_pipe = nullptr;
-        NutMuxer* nutMuxer = nullptr;
+        Muxer* muxer = nullptr;
 
         uint8_t* pixels = nullptr;
+        int pixels_size = 0;
+
+        /* Video frames whose screen readback may still be in progress */
+        struct PendingVideoFrame {
+            bool readback; // a screen readback was started for this frame
+            int frames;
+            uint64_t index; // value of `video_frame_index` for this frame
+        };
+        std::deque<PendingVideoFrame> pending_video;
+
+        /* Number of encoded frames, used to know when a readback is done */
+        uint64_t video_frame_index = 0;
+
+        /* Write pending video frames whose readback was started at least
+         * `latency` frames ago */
+        void writePendingVideo(int latency);
+
+        /* Muxer operation waiting to be executed by the encoder thread.
+         * Packets and their buffers are reused in a ring, so that no
+         * allocation is performed once the ring has been filled. */
+        struct EncoderPacket {
+            enum Type {
+                AUDIO,
+                VIDEO,
+            };
+            Type type;
+            std::vector<uint8_t> data;
+            int count;
+            bool duplicate;
+        };
+
+        std::vector<EncoderPacket> packets;
+        size_t packet_first = 0;
+        size_t packet_count = 0;
+
+        std::thread encoder_thread;
+        std::mutex packet_mutex;
+        std::condition_variable packet_cond;
+        bool thread_quit = false;
+
+        /* Number of times and total duration that the game had to wait for
+         * the encoder thread */
+        uint64_t stall_count = 0;
+        double stall_seconds = 0;
+
+        void startThread();
+
+        /* Main loop of the encoder thread */
+        void threadLoop();
+
+        /* Queue a muxer operation, or execute it directly if there is no
+         * encoder thread */
+        void queuePacket(EncoderPacket::Type type, const uint8_t* data, unsigned int size, int count, bool duplicate);
+
+        /* Execute a muxer operation */
+        void writePacket(EncoderPacket::Type type, const uint8_t* data, unsigned int size, int count, bool duplicate);
 
         int startup_video_frames = 0;
         std::vector<uint8_t> startup_audio_bytes;
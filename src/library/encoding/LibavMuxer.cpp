@@ -0,0 +1,735 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibavMuxer.h"
+
+#include "config.h"
+#include "logging.h"
+#include "hook.h"
+#include "GlobalState.h"
+
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cstdlib> // strtol
+
+#ifdef LIBTAS_HAS_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#include <libavutil/dict.h>
+#include <libavutil/pixdesc.h>
+}
+#endif
+
+namespace libtas {
+
+#ifdef LIBTAS_HAS_LIBAV
+
+/* Link dynamically to libav functions, like for swresample */
+DEFINE_ORIG_POINTER(avutil_version)
+DEFINE_ORIG_POINTER(avcodec_version)
+DEFINE_ORIG_POINTER(avformat_version)
+DEFINE_ORIG_POINTER(swscale_version)
+
+DEFINE_ORIG_POINTER(av_frame_alloc)
+DEFINE_ORIG_POINTER(av_frame_free)
+DEFINE_ORIG_POINTER(av_frame_unref)
+DEFINE_ORIG_POINTER(av_frame_get_buffer)
+DEFINE_ORIG_POINTER(av_frame_make_writable)
+DEFINE_ORIG_POINTER(av_dict_set)
+DEFINE_ORIG_POINTER(av_dict_free)
+DEFINE_ORIG_POINTER(av_get_pix_fmt)
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57,28,100)
+DEFINE_ORIG_POINTER(av_channel_layout_default)
+DEFINE_ORIG_POINTER(av_channel_layout_copy)
+#else
+DEFINE_ORIG_POINTER(av_get_default_channel_layout)
+#endif
+
+DEFINE_ORIG_POINTER(avcodec_find_encoder_by_name)
+DEFINE_ORIG_POINTER(avcodec_alloc_context3)
+DEFINE_ORIG_POINTER(avcodec_open2)
+DEFINE_ORIG_POINTER(avcodec_parameters_from_context)
+DEFINE_ORIG_POINTER(avcodec_send_frame)
+DEFINE_ORIG_POINTER(avcodec_receive_packet)
+DEFINE_ORIG_POINTER(avcodec_free_context)
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61,13,100)
+DEFINE_ORIG_POINTER(avcodec_get_supported_config)
+#endif
+DEFINE_ORIG_POINTER(av_packet_alloc)
+DEFINE_ORIG_POINTER(av_packet_free)
+DEFINE_ORIG_POINTER(av_packet_rescale_ts)
+
+DEFINE_ORIG_POINTER(avformat_alloc_output_context2)
+DEFINE_ORIG_POINTER(avformat_new_stream)
+DEFINE_ORIG_POINTER(avformat_write_header)
+DEFINE_ORIG_POINTER(avformat_free_context)
+DEFINE_ORIG_POINTER(av_interleaved_write_frame)
+DEFINE_ORIG_POINTER(av_write_trailer)
+DEFINE_ORIG_POINTER(avio_open)
+DEFINE_ORIG_POINTER(avio_closep)
+
+DEFINE_ORIG_POINTER(sws_getContext)
+DEFINE_ORIG_POINTER(sws_scale)
+DEFINE_ORIG_POINTER(sws_freeContext)
+
+/* Link with the library of the same major version as our headers, because
+ * we access structure members directly */
+#define LINK_LIBAV(FUNC, LIB, MAJOR) LINK_NAMESPACE_FULLNAME(FUNC, "lib" LIB ".so." AV_STRINGIFY(MAJOR))
+#define LINK_AVUTIL(FUNC) LINK_LIBAV(FUNC, "avutil", LIBAVUTIL_VERSION_MAJOR)
+#define LINK_AVCODEC(FUNC) LINK_LIBAV(FUNC, "avcodec", LIBAVCODEC_VERSION_MAJOR)
+#define LINK_AVFORMAT(FUNC) LINK_LIBAV(FUNC, "avformat", LIBAVFORMAT_VERSION_MAJOR)
+#define LINK_SWSCALE(FUNC) LINK_LIBAV(FUNC, "swscale", LIBSWSCALE_VERSION_MAJOR)
+
+bool LibavMuxer::link()
+{
+    /* Disabling logging because we expect some of these to fail */
+    GlobalNoLog gnl;
+
+    LINK_AVUTIL(avutil_version);
+    LINK_AVCODEC(avcodec_version);
+    LINK_AVFORMAT(avformat_version);
+    LINK_SWSCALE(swscale_version);
+
+    if (!orig::avutil_version || !orig::avcodec_version || !orig::avformat_version || !orig::swscale_version)
+        return false;
+
+    /* The game may have loaded a different version */
+    if ((AV_VERSION_MAJOR(orig::avutil_version()) != LIBAVUTIL_VERSION_MAJOR) ||
+        (AV_VERSION_MAJOR(orig::avcodec_version()) != LIBAVCODEC_VERSION_MAJOR) ||
+        (AV_VERSION_MAJOR(orig::avformat_version()) != LIBAVFORMAT_VERSION_MAJOR) ||
+        (AV_VERSION_MAJOR(orig::swscale_version()) != LIBSWSCALE_VERSION_MAJOR))
+        return false;
+
+    LINK_AVUTIL(av_frame_alloc);
+    LINK_AVUTIL(av_frame_free);
+    LINK_AVUTIL(av_frame_unref);
+    LINK_AVUTIL(av_frame_get_buffer);
+    LINK_AVUTIL(av_frame_make_writable);
+    LINK_AVUTIL(av_dict_set);
+    LINK_AVUTIL(av_dict_free);
+    LINK_AVUTIL(av_get_pix_fmt);
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57,28,100)
+    LINK_AVUTIL(av_channel_layout_default);
+    LINK_AVUTIL(av_channel_layout_copy);
+#else
+    LINK_AVUTIL(av_get_default_channel_layout);
+#endif
+
+    LINK_AVCODEC(avcodec_find_encoder_by_name);
+    LINK_AVCODEC(avcodec_alloc_context3);
+    LINK_AVCODEC(avcodec_open2);
+    LINK_AVCODEC(avcodec_parameters_from_context);
+    LINK_AVCODEC(avcodec_send_frame);
+    LINK_AVCODEC(avcodec_receive_packet);
+    LINK_AVCODEC(avcodec_free_context);
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61,13,100)
+    LINK_AVCODEC(avcodec_get_supported_config);
+#endif
+    LINK_AVCODEC(av_packet_alloc);
+    LINK_AVCODEC(av_packet_free);
+    LINK_AVCODEC(av_packet_rescale_ts);
+
+    LINK_AVFORMAT(avformat_alloc_output_context2);
+    LINK_AVFORMAT(avformat_new_stream);
+    LINK_AVFORMAT(avformat_write_header);
+    LINK_AVFORMAT(avformat_free_context);
+    LINK_AVFORMAT(av_interleaved_write_frame);
+    LINK_AVFORMAT(av_write_trailer);
+    LINK_AVFORMAT(avio_open);
+    LINK_AVFORMAT(avio_closep);
+
+    LINK_SWSCALE(sws_getContext);
+    LINK_SWSCALE(sws_scale);
+    LINK_SWSCALE(sws_freeContext);
+
+    return orig::av_frame_alloc && orig::av_frame_free && orig::av_frame_unref &&
+        orig::av_frame_get_buffer && orig::av_frame_make_writable &&
+        orig::av_dict_set && orig::av_dict_free && orig::av_get_pix_fmt &&
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57,28,100)
+        orig::av_channel_layout_default && orig::av_channel_layout_copy &&
+#else
+        orig::av_get_default_channel_layout &&
+#endif
+        orig::avcodec_find_encoder_by_name && orig::avcodec_alloc_context3 &&
+        orig::avcodec_open2 && orig::avcodec_parameters_from_context &&
+        orig::avcodec_send_frame && orig::avcodec_receive_packet &&
+        orig::avcodec_free_context &&
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61,13,100)
+        orig::avcodec_get_supported_config &&
+#endif
+        orig::av_packet_alloc && orig::av_packet_free && orig::av_packet_rescale_ts &&
+        orig::avformat_alloc_output_context2 && orig::avformat_new_stream &&
+        orig::avformat_write_header && orig::avformat_free_context &&
+        orig::av_interleaved_write_frame && orig::av_write_trailer &&
+        orig::avio_open && orig::avio_closep &&
+        orig::sws_getContext && orig::sws_scale && orig::sws_freeContext;
+}
+
+/* Pixel format corresponding to the nut fourcc of ScreenCapture */
+static AVPixelFormat fourccToPixFmt(const char* pixfmt)
+{
+    static const struct {
+        const char fourcc[4];
+        AVPixelFormat format;
+    } formats[] = {
+        {{'R','G','B','A'}, AV_PIX_FMT_RGBA},
+        {{'B','G','R','A'}, AV_PIX_FMT_BGRA},
+        {{'A','R','G','B'}, AV_PIX_FMT_ARGB},
+        {{'A','B','G','R'}, AV_PIX_FMT_ABGR},
+        {{'R','G','B',0}, AV_PIX_FMT_RGB0},
+        {{'B','G','R',0}, AV_PIX_FMT_BGR0},
+        {{0,'R','G','B'}, AV_PIX_FMT_0RGB},
+        {{0,'B','G','R'}, AV_PIX_FMT_0BGR},
+        {{'2','4','B','G'}, AV_PIX_FMT_BGR24},
+        {{'R','A','W',' '}, AV_PIX_FMT_RGB24},
+        {{'R','B','A',64}, AV_PIX_FMT_RGBA64LE},
+    };
+
+    for (const auto& f : formats)
+        if (memcmp(f.fourcc, pixfmt, 4) == 0)
+            return f.format;
+
+    return AV_PIX_FMT_NONE;
+}
+
+/* Get the list of pixel formats or sample formats supported by an encoder */
+static const void* supportedFormats(const AVCodec* codec, bool video)
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61,13,100)
+    const void* configs = nullptr;
+    int count = 0;
+    orig::avcodec_get_supported_config(nullptr, codec,
+        video ? AV_CODEC_CONFIG_PIX_FORMAT : AV_CODEC_CONFIG_SAMPLE_FORMAT,
+        0, &configs, &count);
+    return configs;
+#else
+    return video ? static_cast<const void*>(codec->pix_fmts) : static_cast<const void*>(codec->sample_fmts);
+#endif
+}
+
+static AVPixelFormat choosePixFmt(const AVCodec* codec, AVPixelFormat input)
+{
+    const AVPixelFormat* formats = static_cast<const AVPixelFormat*>(supportedFormats(codec, true));
+
+    /* Any format is accepted (e.g. rawvideo) */
+    if (!formats)
+        return input;
+
+    for (const AVPixelFormat* f = formats; *f != AV_PIX_FMT_NONE; f++)
+        if (*f == input)
+            return input;
+
+    return formats[0];
+}
+
+static inline int16_t toS16(float s)
+{
+    float v = s * 32768.0f;
+    return static_cast<int16_t>(v > 32767.0f ? 32767.0f : v);
+}
+
+static inline int32_t toS32(float s)
+{
+    double v = s * 2147483648.0;
+    return static_cast<int32_t>(v > 2147483647.0 ? 2147483647.0 : v);
+}
+
+static AVSampleFormat chooseSampleFmt(const AVCodec* codec)
+{
+    const AVSampleFormat* formats = static_cast<const AVSampleFormat*>(supportedFormats(codec, false));
+
+    if (!formats)
+        return AV_SAMPLE_FMT_S16;
+
+    /* Formats we can convert to, by order of preference */
+    static const AVSampleFormat preferred[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P,
+        AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P};
+
+    for (AVSampleFormat p : preferred)
+        for (const AVSampleFormat* f = formats; *f != AV_SAMPLE_FMT_NONE; f++)
+            if (*f == p)
+                return p;
+
+    return AV_SAMPLE_FMT_NONE;
+}
+
+bool LibavMuxer::init(const char* filename, const char* options, int w, int h, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int nbchannels, bool floatsamples)
+{
+    GlobalNative gn;
+
+    if (!link()) {
+        LOG(LL_WARN, LCF_DUMP, "Could not link to libav libraries version %d", LIBAVCODEC_VERSION_MAJOR);
+        return false;
+    }
+
+    width = w;
+    height = h;
+    channels = nbchannels;
+    bytes_per_sample = samplesize / nbchannels;
+    float_samples = floatsamples;
+
+    AVPixelFormat in_pixfmt = fourccToPixFmt(pixfmt);
+    if (in_pixfmt == AV_PIX_FMT_NONE) {
+        LOG(LL_WARN, LCF_DUMP, "Unsupported pixel format for in-process encoding");
+        return false;
+    }
+
+    if ((bytes_per_sample != 1) && (bytes_per_sample != 2) && (bytes_per_sample != 4)) {
+        LOG(LL_WARN, LCF_DUMP, "Unsupported audio format for in-process encoding");
+        return false;
+    }
+
+    /* Parse the options of the ffmpeg command-line */
+    std::string vcodec_name = "libx264";
+    std::string acodec_name = "aac";
+    std::string format_name;
+    std::string pixfmt_name;
+    /* Codec threads are not suspended by savestates, so libavcodec only
+     * starts worker threads if asked with -threads */
+    int threads = 1;
+    AVDictionary* video_opts = nullptr;
+    AVDictionary* audio_opts = nullptr;
+
+    std::istringstream iss(options);
+    std::string key, value;
+    while (iss >> key) {
+        if ((key.size() < 2) || (key[0] != '-') || !(iss >> value))
+            continue;
+        key.erase(0, 1);
+
+        /* Stream specifier */
+        bool for_video = true, for_audio = true;
+        if ((key.size() > 2) && (key.compare(key.size() - 2, 2, ":v") == 0)) {
+            for_audio = false;
+            key.erase(key.size() - 2);
+        }
+        else if ((key.size() > 2) && (key.compare(key.size() - 2, 2, ":a") == 0)) {
+            for_video = false;
+            key.erase(key.size() - 2);
+        }
+
+        if ((key == "c") || (key == "codec")) {
+            if (for_video) vcodec_name = value;
+            if (for_audio) acodec_name = value;
+        }
+        else if (key == "vcodec")
+            vcodec_name = value;
+        else if (key == "acodec")
+            acodec_name = value;
+        else if (key == "f")
+            format_name = value;
+        else if (key == "pix_fmt")
+            pixfmt_name = value;
+        else if (key == "threads") {
+            /* 0 lets libavcodec use a thread per core */
+            if (value == "auto")
+                threads = 0;
+            else {
+                char* end;
+                long n = strtol(value.c_str(), &end, 10);
+                if ((end == value.c_str()) || (*end != '\0') || (n < 0) || (n > 64))
+                    LOG(LL_WARN, LCF_DUMP, "Invalid number of threads %s", value.c_str());
+                else
+                    threads = static_cast<int>(n);
+            }
+        }
+        else {
+            if (for_video) orig::av_dict_set(&video_opts, key.c_str(), value.c_str(), 0);
+            if (for_audio) orig::av_dict_set(&audio_opts, key.c_str(), value.c_str(), 0);
+        }
+    }
+
+    bool success = false;
+
+    do {
+        if (orig::avformat_alloc_output_context2(&fmt_ctx, nullptr, format_name.empty() ? nullptr : format_name.c_str(), filename) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not find an output format for %s", filename);
+            break;
+        }
+
+        /* Video encoder */
+        const AVCodec* vcodec = orig::avcodec_find_encoder_by_name(vcodec_name.c_str());
+        if (!vcodec) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not find video encoder %s", vcodec_name.c_str());
+            break;
+        }
+
+        video_ctx = orig::avcodec_alloc_context3(vcodec);
+        if (!video_ctx) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate video encoder context");
+            break;
+        }
+        video_ctx->width = width;
+        video_ctx->height = height;
+        video_ctx->time_base = AVRational{fpsden, fpsnum};
+        video_ctx->framerate = AVRational{fpsnum, fpsden};
+        video_ctx->pix_fmt = pixfmt_name.empty() ? choosePixFmt(vcodec, in_pixfmt) : orig::av_get_pix_fmt(pixfmt_name.c_str());
+        video_ctx->thread_count = threads;
+        if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+            video_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (orig::avcodec_open2(video_ctx, vcodec, &video_opts) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not open video encoder %s", vcodec_name.c_str());
+            break;
+        }
+
+        /* libavcodec sets the number of threads that were started */
+        video_threads = video_ctx->thread_count;
+
+        video_stream = orig::avformat_new_stream(fmt_ctx, nullptr);
+        if (!video_stream) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not create video stream");
+            break;
+        }
+        video_stream->time_base = video_ctx->time_base;
+        orig::avcodec_parameters_from_context(video_stream->codecpar, video_ctx);
+
+        /* Audio encoder */
+        const AVCodec* acodec = orig::avcodec_find_encoder_by_name(acodec_name.c_str());
+        if (!acodec) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not find audio encoder %s", acodec_name.c_str());
+            break;
+        }
+
+        audio_ctx = orig::avcodec_alloc_context3(acodec);
+        if (!audio_ctx) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate audio encoder context");
+            break;
+        }
+        audio_ctx->sample_fmt = chooseSampleFmt(acodec);
+        if (audio_ctx->sample_fmt == AV_SAMPLE_FMT_NONE) {
+            LOG(LL_ERROR, LCF_DUMP, "Unsupported sample format for audio encoder %s", acodec_name.c_str());
+            break;
+        }
+        audio_ctx->sample_rate = samplerate;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57,28,100)
+        orig::av_channel_layout_default(&audio_ctx->ch_layout, channels);
+#else
+        audio_ctx->channels = channels;
+        audio_ctx->channel_layout = orig::av_get_default_channel_layout(channels);
+#endif
+        audio_ctx->time_base = AVRational{1, samplerate};
+        audio_ctx->thread_count = 1;
+        if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+            audio_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (orig::avcodec_open2(audio_ctx, acodec, &audio_opts) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not open audio encoder %s", acodec_name.c_str());
+            break;
+        }
+
+        audio_stream = orig::avformat_new_stream(fmt_ctx, nullptr);
+        if (!audio_stream) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not create audio stream");
+            break;
+        }
+        audio_stream->time_base = audio_ctx->time_base;
+        orig::avcodec_parameters_from_context(audio_stream->codecpar, audio_ctx);
+
+        /* Pixel conversion. No scaling is performed */
+        sws_ctx = orig::sws_getContext(width, height, in_pixfmt, width, height, video_ctx->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
+        if (!sws_ctx) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not create the pixel converter");
+            break;
+        }
+
+        video_frame = orig::av_frame_alloc();
+        if (!video_frame) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate video frame");
+            break;
+        }
+        video_frame->format = video_ctx->pix_fmt;
+        video_frame->width = width;
+        video_frame->height = height;
+        if (orig::av_frame_get_buffer(video_frame, 0) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate video frame");
+            break;
+        }
+
+        audio_frame = orig::av_frame_alloc();
+        packet = orig::av_packet_alloc();
+        if (!audio_frame || !packet) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate audio frame or packet");
+            break;
+        }
+
+        /* Open the output file */
+        if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+            if (orig::avio_open(&fmt_ctx->pb, filename, AVIO_FLAG_WRITE) < 0) {
+                LOG(LL_ERROR, LCF_DUMP, "Could not open %s", filename);
+                break;
+            }
+        }
+
+        if (orig::avformat_write_header(fmt_ctx, nullptr) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not write header to %s", filename);
+            break;
+        }
+        header_written = true;
+
+        success = true;
+    } while (false);
+
+    orig::av_dict_free(&video_opts);
+    orig::av_dict_free(&audio_opts);
+
+    if (!success) {
+        close();
+        return false;
+    }
+
+    LOG(LL_INFO, LCF_DUMP, "Encoding in-process with %s and %s", vcodec_name.c_str(), acodec_name.c_str());
+    return true;
+}
+
+void LibavMuxer::encode(AVCodecContext* ctx, AVStream* stream, AVFrame* frame)
+{
+    if (orig::avcodec_send_frame(ctx, frame) < 0) {
+        LOG(LL_ERROR, LCF_DUMP, "Could not send a frame to the encoder");
+        return;
+    }
+
+    while (true) {
+        int ret = orig::avcodec_receive_packet(ctx, packet);
+        if ((ret == AVERROR(EAGAIN)) || (ret == AVERROR_EOF))
+            break;
+        if (ret < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not encode a frame");
+            break;
+        }
+
+        orig::av_packet_rescale_ts(packet, ctx->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+
+        /* Takes ownership of the packet content */
+        if (orig::av_interleaved_write_frame(fmt_ctx, packet) < 0)
+            LOG(LL_ERROR, LCF_DUMP, "Could not write an encoded packet");
+    }
+}
+
+void LibavMuxer::writeVideoFrame(const uint8_t* video, unsigned int len, bool duplicate)
+{
+    if (!header_written)
+        return;
+
+    GlobalNative gn;
+
+    /* Send the previous frame again, the encoder deals with duplicates */
+    if (!(duplicate && has_video_frame)) {
+        if (!video || (len == 0))
+            return;
+
+        orig::av_frame_make_writable(video_frame);
+
+        const uint8_t* src[1] = {video};
+        int src_stride[1] = {static_cast<int>(len / height)};
+        orig::sws_scale(sws_ctx, src, src_stride, 0, height, video_frame->data, video_frame->linesize);
+        has_video_frame = true;
+    }
+
+    video_frame->pts = videopts++;
+    encode(video_ctx, video_stream, video_frame);
+}
+
+void LibavMuxer::writeAudioFrame(const uint8_t* samples, unsigned int len)
+{
+    if (!header_written)
+        return;
+
+    GlobalNative gn;
+
+    audio_queue.insert(audio_queue.end(), samples, samples + len);
+    encodeAudio(false);
+}
+
+void LibavMuxer::encodeAudio(bool flush)
+{
+    int sample_bytes = bytes_per_sample * channels;
+    int available = audio_queue.size() / sample_bytes;
+
+    /* Encoders with a variable frame size report a size of 0 */
+    int frame_size = audio_ctx->frame_size;
+    if ((frame_size == 0) || (audio_ctx->codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
+        frame_size = available;
+
+    int pos = 0;
+    while ((available - pos > 0) && ((available - pos >= frame_size) || flush)) {
+        int nb_samples = std::min(frame_size, available - pos);
+
+        orig::av_frame_unref(audio_frame);
+        audio_frame->format = audio_ctx->sample_fmt;
+        audio_frame->sample_rate = audio_ctx->sample_rate;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57,28,100)
+        orig::av_channel_layout_copy(&audio_frame->ch_layout, &audio_ctx->ch_layout);
+#else
+        audio_frame->channels = audio_ctx->channels;
+        audio_frame->channel_layout = audio_ctx->channel_layout;
+#endif
+        /* The last frame is padded with silence if the encoder needs full frames */
+        audio_frame->nb_samples = (audio_ctx->codec->capabilities & AV_CODEC_CAP_SMALL_LAST_FRAME) ? nb_samples : frame_size;
+        if (orig::av_frame_get_buffer(audio_frame, 0) < 0) {
+            LOG(LL_ERROR, LCF_DUMP, "Could not allocate audio frame");
+            return;
+        }
+
+        /* Convert from interleaved u8, s16, s32 or float samples */
+        const uint8_t* in = audio_queue.data() + pos * sample_bytes;
+        for (int i = 0; i < audio_frame->nb_samples; i++) {
+            for (int c = 0; c < channels; c++) {
+                float s = 0.0f;
+                if (i < nb_samples) {
+                    const uint8_t* sp = in + (i * channels + c) * bytes_per_sample;
+                    if (bytes_per_sample == 4) {
+                        if (float_samples) {
+                            memcpy(&s, sp, 4);
+                        }
+                        else {
+                            int32_t s32;
+                            memcpy(&s32, sp, 4);
+                            s = static_cast<float>(s32 / 2147483648.0);
+                        }
+                    }
+                    else if (bytes_per_sample == 2) {
+                        int16_t s16;
+                        memcpy(&s16, sp, 2);
+                        s = s16 / 32768.0f;
+                    }
+                    else {
+                        s = (static_cast<int>(*sp) - 128) / 128.0f;
+                    }
+                }
+
+                /* Clamped value for the integer formats */
+                float cs = (s > 1.0f) ? 1.0f : ((s < -1.0f) ? -1.0f : s);
+
+                switch (audio_frame->format) {
+                    case AV_SAMPLE_FMT_S16:
+                        reinterpret_cast<int16_t*>(audio_frame->data[0])[i * channels + c] = toS16(cs);
+                        break;
+                    case AV_SAMPLE_FMT_S16P:
+                        reinterpret_cast<int16_t*>(audio_frame->data[c])[i] = toS16(cs);
+                        break;
+                    case AV_SAMPLE_FMT_FLT:
+                        reinterpret_cast<float*>(audio_frame->data[0])[i * channels + c] = s;
+                        break;
+                    case AV_SAMPLE_FMT_FLTP:
+                        reinterpret_cast<float*>(audio_frame->data[c])[i] = s;
+                        break;
+                    case AV_SAMPLE_FMT_S32:
+                        reinterpret_cast<int32_t*>(audio_frame->data[0])[i * channels + c] = toS32(cs);
+                        break;
+                    case AV_SAMPLE_FMT_S32P:
+                        reinterpret_cast<int32_t*>(audio_frame->data[c])[i] = toS32(cs);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        audio_frame->pts = audiopts;
+        audiopts += nb_samples;
+        encode(audio_ctx, audio_stream, audio_frame);
+
+        pos += nb_samples;
+    }
+
+    audio_queue.erase(audio_queue.begin(), audio_queue.begin() + pos * sample_bytes);
+}
+
+void LibavMuxer::finish(const uint8_t* video, unsigned int len)
+{
+    if (!header_written)
+        return;
+
+    GlobalNative gn;
+
+    /* Encode remaining samples and flush the encoders */
+    encodeAudio(true);
+    encode(video_ctx, video_stream, nullptr);
+    encode(audio_ctx, audio_stream, nullptr);
+
+    orig::av_write_trailer(fmt_ctx);
+
+    close();
+}
+
+bool LibavMuxer::hasWorkerThreads() const
+{
+    return video_ctx && (video_threads != 1);
+}
+
+void LibavMuxer::close()
+{
+    GlobalNative gn;
+
+    if (fmt_ctx && !(fmt_ctx->oformat->flags & AVFMT_NOFILE))
+        orig::avio_closep(&fmt_ctx->pb);
+    if (fmt_ctx)
+        orig::avformat_free_context(fmt_ctx);
+    fmt_ctx = nullptr;
+
+    if (video_ctx)
+        orig::avcodec_free_context(&video_ctx);
+    if (audio_ctx)
+        orig::avcodec_free_context(&audio_ctx);
+    if (sws_ctx)
+        orig::sws_freeContext(sws_ctx);
+    sws_ctx = nullptr;
+    if (video_frame)
+        orig::av_frame_free(&video_frame);
+    if (audio_frame)
+        orig::av_frame_free(&audio_frame);
+    if (packet)
+        orig::av_packet_free(&packet);
+
+    header_written = false;
+}
+
+LibavMuxer::~LibavMuxer()
+{
+    /* The stream was not finished, we still write the trailer so that the
+     * file is readable */
+    if (header_written)
+        finish(nullptr, 0);
+}
+
+#else
+
+bool LibavMuxer::init(const char*, const char*, int, int, int, int, const char*, int, int, int, bool)
+{
+    LOG(LL_WARN, LCF_DUMP, "libTAS was built without in-process encoding support");
+    return false;
+}
+
+void LibavMuxer::writeVideoFrame(const uint8_t*, unsigned int, bool) {}
+void LibavMuxer::writeAudioFrame(const uint8_t*, unsigned int) {}
+void LibavMuxer::finish(const uint8_t*, unsigned int) {}
+bool LibavMuxer::hasWorkerThreads() const { return false; }
+void LibavMuxer::close() {}
+LibavMuxer::~LibavMuxer() {}
+
+#endif
+
+}
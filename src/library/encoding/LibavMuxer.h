@@ -0,0 +1,110 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LIBAVMUXER_H_INCL
+#define LIBTAS_LIBAVMUXER_H_INCL
+
+#include "Muxer.h"
+
+#include <vector>
+#include <cstdint>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace libtas {
+
+/* Encode audio and video inside the game process using libavcodec, instead
+ * of piping raw frames to an ffmpeg process. Libraries are linked at runtime,
+ * and must have the same major version as the headers used when building. */
+class LibavMuxer : public Muxer {
+public:
+    ~LibavMuxer();
+
+    /* Open the output file and the encoders. `options` is a subset of ffmpeg
+     * command-line options: codecs (-c:v, -c:a), bitrates (-b:v, -b:a),
+     * -pix_fmt, -threads, -f, and codec private options. The video encoder
+     * is single-threaded unless -threads is given, and savestates are not
+     * allowed while it runs codec threads.
+     * Returns false if the libraries are not available or if an error
+     * occured, so that the caller can fall back to the ffmpeg pipe. */
+    bool init(const char* filename, const char* options, int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, bool floatsamples);
+
+    void writeVideoFrame(const uint8_t* video, unsigned int len, bool duplicate = false) override;
+
+    void writeAudioFrame(const uint8_t* samples, unsigned int len) override;
+
+    void finish(const uint8_t* video, unsigned int len) override;
+
+    bool hasWorkerThreads() const override;
+
+private:
+    /* Link to all library functions. Returns false if one is missing. */
+    static bool link();
+
+    /* Send a frame to the encoder (or flush it if null) and write all
+     * packets that are ready */
+    void encode(AVCodecContext* ctx, AVStream* stream, AVFrame* frame);
+
+    /* Encode queued audio samples, by chunks of the encoder frame size.
+     * If `flush`, also encode the remaining samples. */
+    void encodeAudio(bool flush);
+
+    /* Free all contexts */
+    void close();
+
+    AVFormatContext* fmt_ctx = nullptr;
+    AVCodecContext* video_ctx = nullptr;
+    AVCodecContext* audio_ctx = nullptr;
+    AVStream* video_stream = nullptr;
+    AVStream* audio_stream = nullptr;
+    SwsContext* sws_ctx = nullptr;
+    AVFrame* video_frame = nullptr;
+    AVFrame* audio_frame = nullptr;
+    AVPacket* packet = nullptr;
+
+    int width = 0;
+    int height = 0;
+
+    /* Input audio parameters */
+    int channels = 0;
+    int bytes_per_sample = 0;
+    bool float_samples = false;
+
+    /* Interleaved input samples not encoded yet */
+    std::vector<uint8_t> audio_queue;
+
+    int64_t videopts = 0;
+    int64_t audiopts = 0;
+
+    /* Does `video_frame` contain a converted frame that can be sent again */
+    bool has_video_frame = false;
+
+    bool header_written = false;
+
+    /* Number of threads of the video encoder */
+    int video_threads = 1;
+};
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_MUXER_H_INCL
+#define LIBTAS_MUXER_H_INCL
+
+#include <cstdint>
+
+namespace libtas {
+/* Interface class to write the audio and video frames of an encode */
+class Muxer
+{
+public:
+    virtual ~Muxer() {}
+
+    /* Write a video frame. `duplicate` indicates that the frame is known to be
+     * identical to the previous one, in which case `video` may be empty. */
+    virtual void writeVideoFrame(const uint8_t* video, unsigned int len, bool duplicate = false) = 0;
+
+    /* Write interleaved audio samples */
+    virtual void writeAudioFrame(const uint8_t* samples, unsigned int len) = 0;
+
+    /* Finish the stream. `video` is the last video frame. */
+    virtual void finish(const uint8_t* video, unsigned int len) = 0;
+
+    /* Does the muxer run threads that cannot be suspended by savestates */
+    virtual bool hasWorkerThreads() const { return false; }
+};
+}
+
+#endif
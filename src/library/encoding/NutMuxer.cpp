@@ -23,6 +23,9 @@
 
 #include "logging.h"
 
+#include <sys/uio.h> // writev
+#include <cerrno>
+
 namespace libtas {
 
 void NutMuxer::writeVarU(uint64_t v, std::vector<uint8_t> &stream)
@@ -105,47 +108,64 @@ void NutMuxer::writeBE32(int v, std::vector<uint8_t> &stream)
     stream.insert(stream.end(), b, b + 4);
 }
 
-unsigned int NutMuxer::CRCtable[] =
-{
-	0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
-	0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
-	0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
-	0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD,
+/* Tables for slicing-by-8: crctable[0] is the usual byte-wise table of the
+ * NUT polynomial 0x04C11DB7, and crctable[k][i] is the CRC of byte i followed
+ * by k zero bytes. */
+struct NutCRCTables {
+	uint32_t t[8][256];
+
+	NutCRCTables()
+	{
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i << 24;
+			for (int j = 0; j < 8; j++)
+				crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04C11DB7 : 0);
+			t[0][i] = crc;
+		}
+		for (int k = 1; k < 8; k++)
+			for (uint32_t i = 0; i < 256; i++)
+				t[k][i] = (t[k-1][i] << 8) ^ t[0][t[k-1][i] >> 24];
+	}
 };
 
-unsigned int NutMuxer::nutCRC32(const std::vector<uint8_t> &buf)
+uint32_t NutMuxer::nutCRC32(const uint8_t* buf, size_t len)
 {
-	unsigned int crc = 0;
-	for (unsigned int i = 0; i < buf.size(); i++)
+	static const NutCRCTables crctables;
+	const uint32_t (*t)[256] = crctables.t;
+
+	uint32_t crc = 0;
+	for (; len >= 8; buf += 8, len -= 8)
 	{
-		crc ^= static_cast<unsigned int>(buf[i]) << 24;
-		crc = (crc << 4) ^ CRCtable[crc >> 28];
-		crc = (crc << 4) ^ CRCtable[crc >> 28];
+		uint32_t one = crc ^ ((static_cast<uint32_t>(buf[0]) << 24) | (static_cast<uint32_t>(buf[1]) << 16) | (static_cast<uint32_t>(buf[2]) << 8) | buf[3]);
+		uint32_t two = (static_cast<uint32_t>(buf[4]) << 24) | (static_cast<uint32_t>(buf[5]) << 16) | (static_cast<uint32_t>(buf[6]) << 8) | buf[7];
+		crc = t[7][one >> 24] ^ t[6][(one >> 16) & 0xff] ^ t[5][(one >> 8) & 0xff] ^ t[4][one & 0xff] ^
+		      t[3][two >> 24] ^ t[2][(two >> 16) & 0xff] ^ t[1][(two >> 8) & 0xff] ^ t[0][two & 0xff];
 	}
+	for (; len > 0; buf++, len--)
+		crc = (crc << 8) ^ t[0][(crc >> 24) ^ *buf];
 	return crc;
 }
 
-NutMuxer::NutPacket::NutPacket(StartCode sc, FILE *u)
+NutMuxer::NutPacket::NutPacket(StartCode sc, std::vector<uint8_t> &scratch) : data(scratch)
 {
 	startcode = sc;
-	underlying = u;
+	data.clear();
 }
 
-void NutMuxer::NutPacket::flush()
+void NutMuxer::NutPacket::flush(std::vector<uint8_t> &stream)
 {
 	// first, prep header
-	std::vector<uint8_t> header;
-	writeBE64(static_cast<uint64_t>(startcode), header);
-	writeVarU(static_cast<int>(data.size() + 4), header); // +4 for checksum
+	size_t start = stream.size();
+	writeBE64(static_cast<uint64_t>(startcode), stream);
+	writeVarU(static_cast<int>(data.size() + 4), stream); // +4 for checksum
 	if (data.size() > 4092)
 	{
-		writeBE32(nutCRC32(header), header);
+		writeBE32(nutCRC32(stream.data() + start, stream.size() - start), stream);
 	}
 
-	fwrite(header.data(), 1, header.size(), underlying);
-
-    writeBE32(nutCRC32(data), data);
-    fwrite(data.data(), 1, data.size(), underlying);
+	stream.insert(stream.end(), data.begin(), data.end());
+	writeBE32(nutCRC32(data.data(), data.size()), stream);
+	data.clear();
 }
 
 void NutMuxer::NutPacket::write(const char* buffer, int count)
@@ -173,9 +193,10 @@ void NutMuxer::writeMainHeader()
 
 	// note: this file start tag not actually part of main headers
     const char tag[] = "nut/multimedia container\0";
-	fwrite(tag, 1, strlen(tag)+1, output);
+	headerbuf.clear();
+	headerbuf.insert(headerbuf.end(), tag, tag + strlen(tag)+1);
 
-	NutPacket header_packet(NutPacket::Main, output);
+	NutPacket header_packet(NutPacket::Main, packetbuf);
 
 	writeVarU(3, header_packet.data); // version
 	writeVarU(2, header_packet.data); // stream_count
@@ -201,14 +222,16 @@ void NutMuxer::writeMainHeader()
 	// BROADCAST_MODE only useful for realtime transmission clock recovery
 	writeVarU(0, header_packet.data); // main_flags
 
-	header_packet.flush();
+	header_packet.flush(headerbuf);
+	writeOutput(nullptr, 0);
 }
 
 void NutMuxer::writeVideoHeader()
 {
 	LOG(LL_DEBUG, LCF_DUMP, "Write nut video header");
 
-    NutPacket header_packet(NutPacket::Stream, output);
+	headerbuf.clear();
+    NutPacket header_packet(NutPacket::Stream, packetbuf);
 
 	writeVarU(0, header_packet.data); // stream_id
 	writeVarU(0, header_packet.data); // stream_class = video
@@ -227,18 +250,26 @@ void NutMuxer::writeVideoHeader()
 	writeVarU(1, header_packet.data); // sample_height
 	writeVarU(18, header_packet.data); // colorspace_type = full range rec709 (avisynth's "PC.709")
 
-	header_packet.flush();
+	header_packet.flush(headerbuf);
+	writeOutput(nullptr, 0);
 }
 
 void NutMuxer::writeAudioHeader()
 {
 	LOG(LL_DEBUG, LCF_DUMP, "Write nut audio header");
 
-    NutPacket header_packet(NutPacket::Stream, output);
+	headerbuf.clear();
+    NutPacket header_packet(NutPacket::Stream, packetbuf);
 
 	writeVarU(1, header_packet.data); // stream_id
 	writeVarU(1, header_packet.data); // stream_class = audio
-	if ((avparams.samplesize / avparams.channels) == 2)
+	if ((avparams.samplesize / avparams.channels) == 4) {
+		if (avparams.floatsamples)
+			writeBytes("PFD\x20", 4, header_packet.data); // fourcc = little-endian float interleaved 32-bit
+		else
+			writeBytes("PSD\x20", 4, header_packet.data); // fourcc = little-endian signed interleaved 32-bit
+	}
+	else if ((avparams.samplesize / avparams.channels) == 2)
 		writeBytes("PSD\x10", 4, header_packet.data); // fourcc = little-endian signed interleaved 16-bit
 	else if ((avparams.samplesize / avparams.channels) == 1)
 		writeBytes("PUD\x08", 4, header_packet.data); // fourcc = little-endian unsigned interleaved 8-bit
@@ -258,19 +289,54 @@ void NutMuxer::writeAudioHeader()
 	writeVarU(1, header_packet.data); // samplerate_den
 	writeVarU(avparams.channels, header_packet.data); // channel_count
 
-	header_packet.flush();
+	header_packet.flush(headerbuf);
+	writeOutput(nullptr, 0);
+}
+
+void NutMuxer::writeOutput(const uint8_t* payload, unsigned int payloadlen)
+{
+	struct iovec iov[2];
+	iov[0].iov_base = headerbuf.data();
+	iov[0].iov_len = headerbuf.size();
+	iov[1].iov_base = const_cast<uint8_t*>(payload);
+	iov[1].iov_len = payload ? payloadlen : 0;
+	int iovcnt = (iov[1].iov_len > 0) ? 2 : 1;
+	struct iovec* iovp = iov;
+
+	while (iovcnt > 0) {
+		ssize_t written = writev(outputfd, iovp, iovcnt);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG(LL_WARN, LCF_DUMP, "Incomplete transfer to ffmpeg");
+			return;
+		}
+
+		/* Skip what was written, in case of a partial write */
+		while ((iovcnt > 0) && (static_cast<size_t>(written) >= iovp->iov_len)) {
+			written -= iovp->iov_len;
+			iovp++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iovp->iov_base = static_cast<uint8_t*>(iovp->iov_base) + written;
+			iovp->iov_len -= written;
+		}
+	}
 }
 
-void NutMuxer::writeFrame(const uint8_t* payload, unsigned int payloadlen, uint64_t pts, uint64_t ptsnum, uint64_t ptsden, int ptsindex, FILE *underlying)
+void NutMuxer::writeFrame(const uint8_t* payload, unsigned int payloadlen, uint64_t pts, uint64_t ptsnum, uint64_t ptsden, int ptsindex)
 {
+	headerbuf.clear();
+
 	// create syncpoint
-	NutPacket sync(NutPacket::Syncpoint, underlying);
+	NutPacket sync(NutPacket::Syncpoint, packetbuf);
 	writeVarU(pts * 2 + static_cast<uint64_t>(ptsindex), sync.data); // global_key_pts
 	writeVarU(1, sync.data); // back_ptr_div_16, this is wrong
-	sync.flush();
+	sync.flush(headerbuf);
 
-	std::vector<uint8_t> frameheader;
-	frameheader.push_back(0); // frame_code
+	size_t start = headerbuf.size();
+	headerbuf.push_back(0); // frame_code
 	// frame_flags = FLAG_CODED, so:
 	int flags = 0;
 	flags |= 1 << 0; // FLAG_KEY
@@ -280,32 +346,73 @@ void NutMuxer::writeFrame(const uint8_t* payload, unsigned int payloadlen, uint6
 	flags |= 1 << 4; // FLAG_STREAM_ID
 	flags |= 1 << 5; // FLAG_SIZE_MSB
 	flags |= 1 << 6; // FLAG_CHECKSUM
-	writeVarU(flags, frameheader);
-	writeVarU(ptsindex, frameheader); // stream_id
-	writeVarU(pts + 256, frameheader); // coded_pts = pts + 1 << msb_pts_shift
-	writeVarU(payloadlen, frameheader); // data_size_msb
+	writeVarU(flags, headerbuf);
+	writeVarU(ptsindex, headerbuf); // stream_id
+	writeVarU(pts + 256, headerbuf); // coded_pts = pts + 1 << msb_pts_shift
+	writeVarU(payloadlen, headerbuf); // data_size_msb
 
-    writeBE32(nutCRC32(frameheader), frameheader); // checksum
-    size_t written = fwrite(frameheader.data(), 1, frameheader.size(), underlying);
+    writeBE32(nutCRC32(headerbuf.data() + start, headerbuf.size() - start), headerbuf); // checksum
 
-	if (written != frameheader.size())
-		LOG(LL_WARN, LCF_DUMP, "Incomplete header transfer to ffmpeg");
+	/* Syncpoint, frame header and payload in a single system call */
+	writeOutput(payload, payloadlen);
+}
 
-	if (payload) {
-		written = fwrite(payload, 1, payloadlen, underlying);
-		if (written != payloadlen)
-			LOG(LL_WARN, LCF_DUMP, "Incomplete buffer transfer to ffmpeg");
+uint64_t NutMuxer::hashVideo(const uint8_t* video, unsigned int len)
+{
+	/* Four independent lanes, so that the multiplications are pipelined */
+	const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+	uint64_t h0 = len, h1 = prime, h2 = ~prime, h3 = prime ^ len;
+
+	unsigned int i = 0;
+	for (; i + 32 <= len; i += 32) {
+		uint64_t w[4];
+		memcpy(w, video + i, 32);
+		h0 = (h0 ^ w[0]) * prime;
+		h1 = (h1 ^ w[1]) * prime;
+		h2 = (h2 ^ w[2]) * prime;
+		h3 = (h3 ^ w[3]) * prime;
 	}
+	for (; i < len; i++) {
+		h0 = (h0 ^ video[i]) * prime;
+	}
+
+	uint64_t h = h0 ^ (h1 >> 17) ^ (h2 << 23) ^ (h3 >> 41);
+	return h ^ (h >> 29);
 }
 
-void NutMuxer::writeVideoFrame(const uint8_t* video, unsigned int len)
+void NutMuxer::writeVideoFrame(const uint8_t* video, unsigned int len, bool duplicate)
 {
+	if (skipduplicates) {
+		/* The first frame is always written */
+		if (videopts == 0)
+			duplicate = false;
+
+		if (!duplicate) {
+			uint64_t hash = hashVideo(video, len);
+			/* Compare the frames when hashes match, so that a hash collision
+			 * never drops a frame */
+			duplicate = (videopts > 0) && (hash == lastvideohash) &&
+				(len == lastvideo.size()) && (memcmp(video, lastvideo.data(), len) == 0);
+			if (!duplicate) {
+				lastvideohash = hash;
+				lastvideo.assign(video, video + len);
+			}
+		}
+
+		if (duplicate) {
+			LOG(LL_DEBUG, LCF_DUMP, "Skip duplicate nut video frame");
+			skippedvideo++;
+			videopts++;
+			return;
+		}
+	}
+
 	LOG(LL_DEBUG, LCF_DUMP, "Write nut video frame");
 	LOG(LL_DEBUG, LCF_DUMP, "Video pts is %f", (double)videopts * avparams.fpsden / avparams.fpsnum);
 
-	writeFrame(video, len, videopts, static_cast<uint64_t>(avparams.fpsden), static_cast<uint64_t>(avparams.fpsnum), 0, output);
+	writeFrame(video, len, videopts, static_cast<uint64_t>(avparams.fpsden), static_cast<uint64_t>(avparams.fpsnum), 0);
 	videopts++;
-
+	skippedvideo = 0;
 }
 
 void NutMuxer::writeAudioFrame(const uint8_t* samples, unsigned int len)
@@ -313,12 +420,12 @@ void NutMuxer::writeAudioFrame(const uint8_t* samples, unsigned int len)
 	LOG(LL_DEBUG, LCF_DUMP, "Write nut audio frame");
 	LOG(LL_DEBUG, LCF_DUMP, "Audio pts is %f", (double)audiopts / avparams.samplerate);
 
-	writeFrame(samples, len, audiopts, 1, static_cast<uint64_t>(avparams.samplerate), 1, output);
+	writeFrame(samples, len, audiopts, 1, static_cast<uint64_t>(avparams.samplerate), 1);
 
 	audiopts += static_cast<uint64_t>(len) / static_cast<uint64_t>(avparams.samplesize);
 }
 
-NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying)
+NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, bool floatsamples, FILE *underlying)
 {
 	avparams.width = width;
 	avparams.height = height;
@@ -328,12 +435,21 @@ NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pi
 	avparams.samplerate = samplerate;
 	avparams.samplesize = samplesize;
 	avparams.channels = channels;
+	avparams.floatsamples = floatsamples;
 	avparams.pixfmt = pixfmt;
-	output = underlying;
+	outputfd = fileno(underlying);
+
+	/* Reserve the scratch buffers for the largest headers */
+	packetbuf.reserve(1024);
+	headerbuf.reserve(1024);
 
 	audiopts = 0;
 	videopts = 0;
 
+	skipduplicates = false;
+	lastvideohash = 0;
+	skippedvideo = 0;
+
 	writeMainHeader();
 	writeVideoHeader();
 	writeAudioHeader();
@@ -342,8 +458,16 @@ NutMuxer::NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pi
 	audiodone = false;
 }
 
-void NutMuxer::finish()
+void NutMuxer::finish(const uint8_t* video, unsigned int len)
 {
+	/* Write the last frame if it was skipped, otherwise the end of the
+	 * stream would be truncated */
+	if ((skippedvideo > 0) && video) {
+		LOG(LL_DEBUG, LCF_DUMP, "Write last skipped nut video frame");
+		writeFrame(video, len, videopts - 1, static_cast<uint64_t>(avparams.fpsden), static_cast<uint64_t>(avparams.fpsnum), 0);
+		skippedvideo = 0;
+	}
+
 	LOG(LL_DEBUG, LCF_DUMP, "Write nut EOF frames");
 	// writeVideoFrame(nullptr, 0);
 	// writeAudioFrame(nullptr, 0);
@@ -22,6 +22,8 @@
 #ifndef LIBTAS_NUTMUXER_H_INCL
 #define LIBTAS_NUTMUXER_H_INCL
 
+#include "Muxer.h"
+
 #include <vector>
 #include <cstdint>
 #include <cstdio> // FILE
@@ -29,7 +31,7 @@
 
 namespace libtas {
 
-class NutMuxer {
+class NutMuxer : public Muxer {
 public:
 
 	static void writeVarU(uint64_t v, std::vector<uint8_t> &stream);
@@ -42,9 +44,8 @@ public:
 	static void writeBE32(unsigned int v, std::vector<uint8_t> &stream);
 	static void writeBE32(int v, std::vector<uint8_t> &stream);
 
-	static unsigned int CRCtable[];
-
-	static unsigned int nutCRC32(const std::vector<uint8_t> &buf);
+	/* CRC32 with the NUT polynomial, computed 8 bytes at a time */
+	static uint32_t nutCRC32(const uint8_t* buf, size_t len);
 
 	class NutPacket {
     public:
@@ -58,19 +59,21 @@ public:
 			Info = 0x4e49ab68b596ba78
 		};
 
-		std::vector<uint8_t> data;
+		/* Scratch buffer owned by the muxer, so that it is not reallocated */
+		std::vector<uint8_t> &data;
 		StartCode startcode;
-		FILE *underlying;
 
-		NutPacket(StartCode startcode, FILE *underlying);
+		NutPacket(StartCode startcode, std::vector<uint8_t> &scratch);
 
-		void flush();
+		/* Append the packet with its header and checksums to `stream` */
+		void flush(std::vector<uint8_t> &stream);
 		void write(const char* buffer, int count);
 	};
 
 	class AVParams {
     public:
 		int width, height, samplerate, samplesize, fpsnum, fpsden, channels;
+		bool floatsamples;
 		const char* pixfmt;
 		void reduce();
 	};
@@ -81,9 +84,20 @@ public:
 	AVParams avparams;
 
 	/// <summary>
-	/// target output for nut stream
+	/// file descriptor of the target output for nut stream
+	/// </summary>
+	int outputfd;
+
+	/// <summary>
+	/// scratch buffers for packet content and for all headers preceding a payload
+	/// </summary>
+	std::vector<uint8_t> packetbuf;
+	std::vector<uint8_t> headerbuf;
+
+	/// <summary>
+	/// write the content of headerbuf followed by the payload with a single writev
 	/// </summary>
-	FILE *output;
+	void writeOutput(const uint8_t* payload, unsigned int payloadlen);
 
 	/// <summary>
 	/// PTS of video stream.  timebase is 1/framerate, so this is equal to number of frames
@@ -104,6 +118,31 @@ public:
 	/// </summary>
 	bool audiodone;
 
+	/// <summary>
+	/// skip video frames identical to the previous one, leaving a gap in the video pts
+	/// </summary>
+	bool skipduplicates;
+
+	/// <summary>
+	/// hash of the last video frame
+	/// </summary>
+	uint64_t lastvideohash;
+
+	/// <summary>
+	/// last video frame, to confirm duplicates when hashes match
+	/// </summary>
+	std::vector<uint8_t> lastvideo;
+
+	/// <summary>
+	/// number of video frames skipped since the last written one
+	/// </summary>
+	uint64_t skippedvideo;
+
+	/// <summary>
+	/// hash a video frame to detect duplicates
+	/// </summary>
+	static uint64_t hashVideo(const uint8_t* video, unsigned int len);
+
 	/// <summary>
 	/// write out the main header
 	/// </summary>
@@ -119,15 +158,20 @@ public:
 	/// </summary>
 	void writeAudioHeader();
 
-    void writeFrame(const uint8_t* payload, unsigned int payloadlen, uint64_t pts, uint64_t ptsnum, uint64_t ptsden, int ptsindex, FILE *underlying);
+    void writeFrame(const uint8_t* payload, unsigned int payloadlen, uint64_t pts, uint64_t ptsnum, uint64_t ptsden, int ptsindex);
 
-    void writeVideoFrame(const uint8_t* video, unsigned int len);
+    /* Write a video frame. `duplicate` indicates that the frame is known to be
+     * identical to the previous one, in which case `video` may be empty when
+     * skipping duplicates. */
+    void writeVideoFrame(const uint8_t* video, unsigned int len, bool duplicate = false) override;
 
-    void writeAudioFrame(const uint8_t* samples, unsigned int len);
+    void writeAudioFrame(const uint8_t* samples, unsigned int len) override;
 
-	NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, FILE *underlying);
+	NutMuxer(int width, int height, int fpsnum, int fpsden, const char* pixfmt, int samplerate, int samplesize, int channels, bool floatsamples, FILE *underlying);
 
-	void finish();
+	/* Finish the stream. `video` is the last video frame, which is written
+	 * if it was skipped, so that the stream keeps its full length. */
+	void finish(const uint8_t* video, unsigned int len) override;
 
 };
 }
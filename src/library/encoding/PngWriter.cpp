@@ -0,0 +1,389 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PngWriter.h"
+
+#include "logging.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+namespace libtas {
+namespace PngWriter {
+
+/* Layout of the supported pixel formats: bytes per pixel and offsets of the
+ * red, green and blue components. 16-bit formats point to the high byte. */
+struct PixelLayout {
+    char fourcc[4];
+    int bpp;
+    int r, g, b;
+};
+
+static const PixelLayout layouts[] = {
+    {{'R','G','B','A'}, 4, 0, 1, 2},
+    {{'B','G','R','A'}, 4, 2, 1, 0},
+    {{'A','R','G','B'}, 4, 1, 2, 3},
+    {{'A','B','G','R'}, 4, 3, 2, 1},
+    {{'R','G','B',0}, 4, 0, 1, 2},
+    {{'B','G','R',0}, 4, 2, 1, 0},
+    {{0,'R','G','B'}, 4, 1, 2, 3},
+    {{0,'B','G','R'}, 4, 3, 2, 1},
+    {{'2','4','B','G'}, 3, 2, 1, 0},
+    {{'R','A','W',' '}, 3, 0, 1, 2},
+    {{'R','B','A',64}, 8, 1, 3, 5},
+};
+
+/* Tables of the fixed Huffman codes of deflate, and of the length and
+ * distance symbols */
+struct DeflateTables {
+    /* Bit-reversed code and code length of each literal/length symbol */
+    uint16_t litcode[288];
+    uint8_t litbits[288];
+
+    /* Symbol for each match length and distance */
+    uint16_t lensym[259];
+    uint8_t distsym[32769];
+
+    static const uint16_t lenbase[29];
+    static const uint8_t lenextra[29];
+    static const uint16_t distbase[30];
+    static const uint8_t distextra[30];
+
+    static uint16_t reverse(uint16_t code, int bits)
+    {
+        uint16_t r = 0;
+        for (int i = 0; i < bits; i++) {
+            r = (r << 1) | (code & 1);
+            code >>= 1;
+        }
+        return r;
+    }
+
+    DeflateTables()
+    {
+        for (int s = 0; s < 288; s++) {
+            if (s < 144) {
+                litbits[s] = 8;
+                litcode[s] = reverse(0x30 + s, 8);
+            }
+            else if (s < 256) {
+                litbits[s] = 9;
+                litcode[s] = reverse(0x190 + s - 144, 9);
+            }
+            else if (s < 280) {
+                litbits[s] = 7;
+                litcode[s] = reverse(s - 256, 7);
+            }
+            else {
+                litbits[s] = 8;
+                litcode[s] = reverse(0xc0 + s - 280, 8);
+            }
+        }
+
+        for (int i = 0; i < 29; i++)
+            for (int l = lenbase[i]; (l < 259) && ((i == 28) || (l < lenbase[i+1])); l++)
+                lensym[l] = i;
+
+        for (int i = 0; i < 30; i++)
+            for (int d = distbase[i]; (d <= 32768) && ((i == 29) || (d < distbase[i+1])); d++)
+                distsym[d] = i;
+    }
+};
+
+const uint16_t DeflateTables::lenbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t DeflateTables::lenextra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DeflateTables::distbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DeflateTables::distextra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* Write bits least significant first, as deflate expects */
+class BitWriter {
+public:
+    BitWriter(std::vector<uint8_t>& o) : out(o) {}
+
+    void put(uint32_t value, int count)
+    {
+        bits |= static_cast<uint64_t>(value) << bitcount;
+        bitcount += count;
+        while (bitcount >= 8) {
+            out.push_back(bits & 0xff);
+            bits >>= 8;
+            bitcount -= 8;
+        }
+    }
+
+    void flush()
+    {
+        if (bitcount > 0)
+            out.push_back(bits & 0xff);
+        bits = 0;
+        bitcount = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    int bitcount = 0;
+};
+
+static inline uint32_t load32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static const int HASH_BITS = 15;
+
+static inline uint32_t hash4(const uint8_t* p)
+{
+    return (load32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Compress data into a zlib stream, using a single deflate block with fixed
+ * Huffman codes and a greedy match search with one candidate per hash.
+ * This is much faster than a full zlib compression while still packing the
+ * large flat areas of game screens. */
+static void zlibCompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+    static const DeflateTables tables;
+
+    /* zlib header: deflate with 32K window, fastest compression */
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter bw(out);
+
+    /* Final block, fixed Huffman codes */
+    bw.put(1, 1);
+    bw.put(1, 2);
+
+    std::vector<int32_t> head(1 << HASH_BITS, -1);
+
+    size_t pos = 0;
+    while (pos + 4 <= size) {
+        uint32_t h = hash4(data + pos);
+        int32_t cand = head[h];
+        head[h] = pos;
+
+        if ((cand >= 0) && (pos - cand <= 32768) && (load32(data + cand) == load32(data + pos))) {
+            size_t maxlen = std::min<size_t>(258, size - pos);
+            size_t len = 4;
+            while ((len < maxlen) && (data[cand + len] == data[pos + len]))
+                len++;
+
+            int dist = pos - cand;
+            int ls = tables.lensym[len];
+            bw.put(tables.litcode[257 + ls], tables.litbits[257 + ls]);
+            bw.put(len - DeflateTables::lenbase[ls], DeflateTables::lenextra[ls]);
+            int ds = tables.distsym[dist];
+            bw.put(DeflateTables::reverse(ds, 5), 5);
+            bw.put(dist - DeflateTables::distbase[ds], DeflateTables::distextra[ds]);
+
+            /* Insert the positions inside the match */
+            for (size_t i = pos + 1; (i < pos + len) && (i + 4 <= size); i++)
+                head[hash4(data + i)] = i;
+
+            pos += len;
+        }
+        else {
+            bw.put(tables.litcode[data[pos]], tables.litbits[data[pos]]);
+            pos++;
+        }
+    }
+
+    for (; pos < size; pos++)
+        bw.put(tables.litcode[data[pos]], tables.litbits[data[pos]]);
+
+    /* End of block */
+    bw.put(tables.litcode[256], tables.litbits[256]);
+    bw.flush();
+
+    /* Adler-32 checksum of uncompressed data */
+    uint32_t a = 1, b = 0;
+    size_t i = 0;
+    while (i < size) {
+        /* Largest number of bytes before the sums can overflow */
+        size_t end = std::min<size_t>(size, i + 5552);
+        for (; i < end; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    out.push_back(adler >> 24);
+    out.push_back(adler >> 16);
+    out.push_back(adler >> 8);
+    out.push_back(adler);
+}
+
+static uint32_t pngCRC32(const uint8_t* data, size_t len, uint32_t crc)
+{
+    struct CRCTable {
+        uint32_t t[256];
+        CRCTable()
+        {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                t[i] = c;
+            }
+        }
+    };
+    static const CRCTable table;
+
+    for (size_t i = 0; i < len; i++)
+        crc = table.t[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static bool writeChunk(FILE* f, const char type[4], const uint8_t* data, size_t len)
+{
+    uint8_t header[8] = {
+        static_cast<uint8_t>(len >> 24), static_cast<uint8_t>(len >> 16),
+        static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len),
+        static_cast<uint8_t>(type[0]), static_cast<uint8_t>(type[1]),
+        static_cast<uint8_t>(type[2]), static_cast<uint8_t>(type[3])};
+
+    uint32_t crc = pngCRC32(header + 4, 4, 0xffffffff);
+    crc = pngCRC32(data, len, crc) ^ 0xffffffff;
+    uint8_t footer[4] = {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+        static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)};
+
+    return (fwrite(header, 8, 1, f) == 1) &&
+        ((len == 0) || (fwrite(data, len, 1, f) == 1)) &&
+        (fwrite(footer, 4, 1, f) == 1);
+}
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if ((pa <= pb) && (pa <= pc))
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+bool save(const std::string& filename, const uint8_t* pixels, int width, int height, int stride, const char* pixfmt)
+{
+    const PixelLayout* layout = nullptr;
+    for (const auto& l : layouts)
+        if (memcmp(l.fourcc, pixfmt, 4) == 0)
+            layout = &l;
+
+    if (!layout) {
+        LOG(LL_ERROR, LCF_DUMP, "Unsupported pixel format for png screenshot");
+        return false;
+    }
+
+    /* Convert to RGB */
+    const int rowsize = 3 * width;
+    std::vector<uint8_t> rgb(static_cast<size_t>(rowsize) * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = pixels + static_cast<size_t>(y) * stride;
+        uint8_t* dst = rgb.data() + static_cast<size_t>(y) * rowsize;
+        for (int x = 0; x < width; x++) {
+            dst[3*x] = src[layout->r];
+            dst[3*x+1] = src[layout->g];
+            dst[3*x+2] = src[layout->b];
+            src += layout->bpp;
+        }
+    }
+
+    /* Filter each row with the filter giving the smallest sum of absolute
+     * values, which is the usual heuristic for good compression */
+    std::vector<uint8_t> filtered(static_cast<size_t>(rowsize + 1) * height);
+    std::vector<uint8_t> zeros(rowsize, 0);
+    std::vector<uint8_t> candidate(rowsize);
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* cur = rgb.data() + static_cast<size_t>(y) * rowsize;
+        const uint8_t* prev = (y > 0) ? (cur - rowsize) : zeros.data();
+        uint8_t* dst = filtered.data() + static_cast<size_t>(y) * (rowsize + 1);
+
+        uint64_t bestsum = UINT64_MAX;
+        for (int type = 0; type < 5; type++) {
+            uint64_t sum = 0;
+            for (int i = 0; i < rowsize; i++) {
+                int left = (i >= 3) ? cur[i-3] : 0;
+                int upleft = (i >= 3) ? prev[i-3] : 0;
+                int pred = 0;
+                switch (type) {
+                    case 1: pred = left; break;
+                    case 2: pred = prev[i]; break;
+                    case 3: pred = (left + prev[i]) >> 1; break;
+                    case 4: pred = paeth(left, prev[i], upleft); break;
+                }
+                uint8_t v = cur[i] - pred;
+                candidate[i] = v;
+                sum += std::abs(static_cast<int8_t>(v));
+            }
+            if (sum < bestsum) {
+                bestsum = sum;
+                dst[0] = type;
+                memcpy(dst + 1, candidate.data(), rowsize);
+            }
+        }
+    }
+
+    std::vector<uint8_t> idat;
+    idat.reserve(filtered.size() / 4);
+    zlibCompress(filtered.data(), filtered.size(), idat);
+
+    FILE* f = fopen(filename.c_str(), "wb");
+    if (!f) {
+        LOG(LL_ERROR, LCF_DUMP, "Could not open screenshot file %s", filename.c_str());
+        return false;
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    uint8_t ihdr[13] = {
+        static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16),
+        static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+        static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+        static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+        8, // bit depth
+        2, // color type RGB
+        0, 0, 0}; // compression, filter, interlace
+
+    bool ok = (fwrite(signature, 8, 1, f) == 1) &&
+        writeChunk(f, "IHDR", ihdr, sizeof(ihdr)) &&
+        writeChunk(f, "IDAT", idat.data(), idat.size()) &&
+        writeChunk(f, "IEND", nullptr, 0);
+
+    if (fclose(f) != 0)
+        ok = false;
+
+    if (!ok)
+        LOG(LL_ERROR, LCF_DUMP, "Could not write screenshot file %s", filename.c_str());
+
+    return ok;
+}
+
+}
+}
@@ -0,0 +1,39 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_PNGWRITER_H_INCL
+#define LIBTAS_PNGWRITER_H_INCL
+
+#include <string>
+#include <cstdint>
+
+namespace libtas {
+namespace PngWriter {
+
+    /* Save pixels as a RGB png file, without spawning an external process.
+     * `pixfmt` is the fourcc returned by ScreenCapture::getPixelFormat(),
+     * and `stride` is the size of a row in bytes.
+     * Returns false if the pixel format is not supported or the file could
+     * not be written. */
+    bool save(const std::string& filename, const uint8_t* pixels, int width, int height, int stride, const char* pixfmt);
+
+}
+}
+
+#endif
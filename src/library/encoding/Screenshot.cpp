@@ -19,6 +19,7 @@
 
 #include "Screenshot.h"
 #include "NutMuxer.h"
+#include "PngWriter.h"
 
 #include "logging.h"
 #include "screencapture/ScreenCapture.h"
@@ -27,56 +28,175 @@
 
 #include <cstdint>
 #include <sstream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <strings.h> // strcasecmp
 
 namespace libtas {
 
-int Screenshot::save(const std::string& screenshotfile, bool draw) {
-    
-    if (!ScreenCapture::isInited()) {
-        LOG(LL_ERROR, LCF_DUMP, "Screen was not inited");
-        return ESCREENSHOT_NOSCREEN;
-    }
-
+namespace Screenshot {
+
+/* A screenshot waiting to be written by the screenshot thread */
+struct ScreenshotJob {
+    std::string filename;
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+    char pixfmt[4];
+};
+
+/* Maximum number of screenshots waiting to be written, before the game waits
+ * for the screenshot thread */
+static const size_t MAX_JOBS = 8;
+
+/* Objects are allocated once and never freed, so that nothing is destroyed
+ * at exit while the thread may still run */
+static std::thread* writer_thread = nullptr;
+static std::mutex* job_mutex = nullptr;
+static std::condition_variable* job_cond = nullptr;
+static std::deque<ScreenshotJob>* jobs = nullptr;
+static bool thread_quit = false;
+
+/* Pipe the screenshot to an ffmpeg process, for formats other than png */
+static int saveWithFfmpeg(const ScreenshotJob& job)
+{
     std::ostringstream commandline;
     commandline << "ffmpeg -loglevel warning -hide_banner -y -guess_layout_max 0 -f nut -i - -frames:v 1 -update 1 \"";
-    commandline << screenshotfile;
+    commandline << job.filename;
     commandline << "\"";
 
-    FILE *ffmpeg_pipe = nullptr;
-    NATIVECALL(ffmpeg_pipe = popen(commandline.str().c_str(), "w"));
+    FILE *ffmpeg_pipe = popen(commandline.str().c_str(), "w");
 
     if (! ffmpeg_pipe) {
         LOG(LL_ERROR, LCF_DUMP, "Could not create a pipe to ffmpeg");
         return ESCREENSHOT_NOPIPE;
     }
-    
-    int width, height;
-    ScreenCapture::getDimensions(width, height);
-
-    const char* pixfmt = ScreenCapture::getPixelFormat();
 
     /* Initialize the muxer. Audio parameters don't matter here for screenshot */
-    NutMuxer* nutMuxer = new NutMuxer(width, height, Global::shared_config.initial_framerate_num, Global::shared_config.initial_framerate_den, pixfmt, 44100, 1, 1, ffmpeg_pipe);
+    {
+        NutMuxer nutMuxer(job.width, job.height, Global::shared_config.initial_framerate_num, Global::shared_config.initial_framerate_den, job.pixfmt, 44100, 1, 1, false, ffmpeg_pipe);
+        nutMuxer.writeVideoFrame(job.pixels.data(), job.pixels.size());
+    }
+
+    int status = pclose(ffmpeg_pipe);
+    if (status < 0) {
+        LOG(LL_ERROR, LCF_DUMP, "Could not close the pipe to ffmpeg");
+        return ESCREENSHOT_NOPIPE;
+    }
+    if (status != 0) {
+        LOG(LL_ERROR, LCF_DUMP, "ffmpeg could not write the screenshot %s", job.filename.c_str());
+        return ESCREENSHOT_NOPIPE;
+    }
+
+    return ESCREENSHOT_OK;
+}
+
+static void writeJob(const ScreenshotJob& job)
+{
+    LOG(LL_DEBUG, LCF_DUMP, "Perform the screenshot");
+
+    /* Png files are written directly, other formats go through ffmpeg */
+    const char* ext = strrchr(job.filename.c_str(), '.');
+    if (ext && (strcasecmp(ext, ".png") == 0)) {
+        if (PngWriter::save(job.filename, job.pixels.data(), job.width, job.height, job.pixels.size() / job.height, job.pixfmt))
+            return;
+    }
+
+    if (saveWithFfmpeg(job) == ESCREENSHOT_OK)
+        return;
+
+    /* The game already returned from `save()`, so we tell the user here */
+    std::string alert = "Could not save screenshot ";
+    alert += job.filename;
+    sendAlertMsg(alert);
+}
+
+static void threadLoop()
+{
+    std::unique_lock<std::mutex> lock(*job_mutex);
+
+    while (true) {
+        job_cond->wait(lock, []{ return !jobs->empty() || thread_quit; });
+
+        /* Only quit when all screenshots have been written */
+        if (jobs->empty())
+            break;
+
+        /* The game thread only appends to the queue, so the front job can be
+         * written without holding the lock */
+        ScreenshotJob& job = jobs->front();
+        lock.unlock();
+        writeJob(job);
+        lock.lock();
+
+        jobs->pop_front();
+        job_cond->notify_all();
+    }
+}
+
+int save(const std::string& screenshotfile, bool draw) {
+
+    if (!ScreenCapture::isInited()) {
+        LOG(LL_ERROR, LCF_DUMP, "Screen was not inited");
+        return ESCREENSHOT_NOSCREEN;
+    }
 
     /* Access to the screen pixels, or last screen pixels if not a draw frame */
     uint8_t* pixels = nullptr;
     int size = ScreenCapture::getPixelsFromSurface(&pixels, draw);
 
-    LOG(LL_DEBUG, LCF_DUMP, "Perform the screenshot");
-    nutMuxer->writeVideoFrame(pixels, size);
-    
-    if (ffmpeg_pipe) {
-        int ret;
-        NATIVECALL(ret = pclose(ffmpeg_pipe));
-        if (ret < 0) {
-            LOG(LL_ERROR, LCF_DUMP, "Could not close the pipe to ffmpeg");
-            return ESCREENSHOT_NOPIPE;
-        }
+    GlobalNative gn;
+
+    if (!jobs) {
+        job_mutex = new std::mutex;
+        job_cond = new std::condition_variable;
+        jobs = new std::deque<ScreenshotJob>;
     }
-    
+
+    std::unique_lock<std::mutex> lock(*job_mutex);
+
+    /* Wait if the screenshot thread is late */
+    job_cond->wait(lock, []{ return jobs->size() < MAX_JOBS; });
+
+    jobs->emplace_back();
+    ScreenshotJob& job = jobs->back();
+    job.filename = screenshotfile;
+    job.pixels.assign(pixels, pixels + size);
+    ScreenCapture::getDimensions(job.width, job.height);
+    memcpy(job.pixfmt, ScreenCapture::getPixelFormat(), 4);
+
+    if (!writer_thread) {
+        thread_quit = false;
+        /* The screenshot thread is entirely in native state */
+        writer_thread = new std::thread(threadLoop);
+    }
+
+    lock.unlock();
+    job_cond->notify_all();
+
     return ESCREENSHOT_OK;
 }
 
+void stopThread() {
+    if (!writer_thread)
+        return;
+
+    GlobalNative gn;
+    {
+        std::lock_guard<std::mutex> lock(*job_mutex);
+        thread_quit = true;
+    }
+    job_cond->notify_all();
+    writer_thread->join();
+    delete writer_thread;
+    writer_thread = nullptr;
+}
+
+}
+
 }
 
 // #endif
@@ -33,9 +33,16 @@ namespace Screenshot {
     };
 
     /* Save the screenshot to file, `draw` indicates if the current frame is
-     * a draw frame. */
+     * a draw frame. The screen is copied immediately, and the file is
+     * written by the screenshot thread, which sends an alert if writing
+     * failed. */
     int save(const std::string& screenshotfile, bool draw);
 
+    /* Write all queued screenshots and terminate the screenshot thread. Must
+     * be called before saving or loading a state, because the thread is not
+     * suspended. */
+    void stopThread();
+
 };
 
 }
@@ -34,6 +34,7 @@
 #include "screencapture/ScreenCapture.h"
 #include "WindowTitle.h"
 #include "BusyLoopDetection.h"
+#include "AsyncLog.h"
 #include "FPSMonitor.h"
 #include "hook.h"
 #include "UnityHacks.h"
@@ -162,6 +163,9 @@ void frameBoundary(std::function<void()> draw, RenderHUD& hud)
     /* Reset the busy loop detector */
     BusyLoopDetection::reset();
 
+    /* (Re)start the logging thread, which is stopped around savestates */
+    AsyncLog::startThread();
+
     /* Initialize Screen Capture on the first real screen draw */
     ScreenCapture::init();
 
@@ -248,6 +252,9 @@ void frameBoundary(std::function<void()> draw, RenderHUD& hud)
         Global::game_info.tosend = false;
     }
 
+    /* Send the time calls traced during the frame */
+    BusyLoopDetection::sendTimeTrace();
+
     /* Send fps and lfps values */
     sendMessage(MSGB_FPS);
     sendData(&fps, sizeof(float));
@@ -592,6 +599,7 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
     while (1) {
         int slot = SaveStateManager::waitChild();
         if (slot < 0) break;
+        if (slot >= SharedConfig::SS_SLOT_GREENZONE) continue;
         std::string msg = "State ";
         msg += std::to_string(slot);
         msg += " saved";
@@ -633,6 +641,7 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
             while (1) {
                 int slot = SaveStateManager::waitChild();
                 if (slot < 0) break;
+                if (slot >= SharedConfig::SS_SLOT_GREENZONE) continue;
                 std::string msg = "State ";
                 msg += std::to_string(slot);
                 msg += " saved";
@@ -718,7 +727,8 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
                 break;
 
             case MSGN_SAVESTATE:
-                {
+                /* Greenzone states are performed silently every few frames */
+                if (slot < SharedConfig::SS_SLOT_GREENZONE) {
                     std::string saving_msg = "Saving state ";
                     saving_msg += std::to_string(slot);
                     MessageWindow::insert(saving_msg.c_str());
@@ -766,7 +776,8 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
                     sendMessage(MSGB_SAVING_SUCCEEDED);
 
                     /* Print the successful message, unless we are saving in a fork */
-                    if (!(Global::shared_config.savestate_settings & SharedConfig::SS_FORK)) {
+                    if (!(Global::shared_config.savestate_settings & SharedConfig::SS_FORK) &&
+                        (slot < SharedConfig::SS_SLOT_GREENZONE)) {
                         std::string msg;
                         msg = "State ";
                         msg += std::to_string(slot);
@@ -782,6 +793,14 @@ static void receive_messages(std::function<void()> draw, RenderHUD& hud)
 
                 break;
 
+            case MSGN_REMOVE_SAVESTATE:
+                {
+                    int index;
+                    receiveData(&index, sizeof(int));
+                    Checkpoint::removeSavestate(index);
+                }
+                break;
+
             case MSGN_LOADSTATE:
                 // Force redraw because screen refresh won't happen during state loading
                 screen_redraw(draw, hud, preview_ai, true);
@@ -32,6 +32,7 @@
 #include "backtrace.h"
 #include "GameHacks.h"
 #include "UnityHacks.h"
+#include "BusyLoopDetection.h"
 #include "fileio/SaveFileList.h"
 #include "fileio/SaveFile.h"
 #include "../external/elfhacks.h"
@@ -251,6 +252,10 @@ __attribute__((noipa)) void *dlopen(const char *file, int mode) __THROW {
         }
     }
 
+    /* New code may be mapped where the busy loop detector cached frames */
+    if (result)
+        BusyLoopDetection::invalidateCache();
+
 #ifdef __linux__
     if (result && file && std::strstr(file, "wined3d.dll.so") != nullptr) {
         /* Hook wine wined3d functions */
@@ -31,6 +31,7 @@
 #include "GameHacks.h"
 #include "GlobalState.h"
 #include "UnityHacks.h"
+#include "LockFreeTable.h"
 
 #include <errno.h>
 #include <unistd.h>
@@ -38,12 +39,15 @@
 #include <atomic>
 #include <memory>
 #include <exception>
+#include <map>
+#include <mutex>
 
 namespace libtas {
 
 DEFINE_ORIG_POINTER(pthread_create)
 DEFINE_ORIG_POINTER(pthread_detach)
 DEFINE_ORIG_POINTER(pthread_cond_init)
+DEFINE_ORIG_POINTER(pthread_cond_destroy)
 DEFINE_ORIG_POINTER(pthread_cond_wait)
 DEFINE_ORIG_POINTER(pthread_cond_timedwait)
 DEFINE_ORIG_POINTER(pthread_cond_signal)
@@ -306,9 +310,65 @@ static void *pthread_native_start(void *arg)
     return ETIMEDOUT;
 }
 
-static std::map<pthread_cond_t*, clockid_t>& getCondClock() {
-    static std::map<pthread_cond_t*, clockid_t> condClocks;
-    return condClocks;
+/* Clock of each condition variable that was initialized with a clock other
+ * than CLOCK_REALTIME, looked up on each `pthread_cond_timedwait()` call.
+ * Conditions with the default clock are not stored. */
+static LockFreeTable<clockid_t, 4096> condClocks;
+
+/* Clocks of conditions that did not fit in the table, only looked up once
+ * the table has overflowed */
+static std::mutex condClocksOverflowMutex;
+static std::atomic<bool> condClocksFull(false);
+
+static std::map<uintptr_t, clockid_t>& getCondClocksOverflow() {
+    static std::map<uintptr_t, clockid_t> cond_clocks;
+    return cond_clocks;
+}
+
+static void eraseCondClock(uintptr_t cond)
+{
+    condClocks.erase(cond);
+
+    if (condClocksFull.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(condClocksOverflowMutex);
+        getCondClocksOverflow().erase(cond);
+    }
+}
+
+static void storeCondClock(uintptr_t cond, clockid_t clock_id)
+{
+    /* The address may be reused from a previously destroyed condition */
+    if (clock_id == CLOCK_REALTIME) {
+        eraseCondClock(cond);
+        return;
+    }
+
+    if (condClocks.insert(cond, clock_id)) {
+        if (condClocksFull.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(condClocksOverflowMutex);
+            getCondClocksOverflow().erase(cond);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(condClocksOverflowMutex);
+    if (!condClocksFull.load(std::memory_order_relaxed))
+        LOG(LL_WARN, LCF_WAIT, "Condition clock table is full, falling back to a locked map");
+    getCondClocksOverflow()[cond] = clock_id;
+    condClocksFull.store(true, std::memory_order_release);
+}
+
+static clockid_t findCondClock(uintptr_t cond)
+{
+    clockid_t clock_id = CLOCK_REALTIME;
+    if (condClocks.find(cond, clock_id) || !condClocksFull.load(std::memory_order_acquire))
+        return clock_id;
+
+    std::lock_guard<std::mutex> lock(condClocksOverflowMutex);
+    auto it = getCondClocksOverflow().find(cond);
+    if (it != getCondClocksOverflow().end())
+        clock_id = it->second;
+    return clock_id;
 }
 
 /* Override */ int pthread_cond_init (pthread_cond_t *cond, const pthread_condattr_t *cond_attr) __THROW
@@ -320,18 +380,29 @@ static std::map<pthread_cond_t*, clockid_t>& getCondClock() {
     LOG(LL_TRACE, LCF_WAIT, "%s call with cond %p", __func__, static_cast<void*>(cond));
 
     /* Store the clock if one is set for `pthread_cond_timedwait()` */
+    clockid_t clock_id = CLOCK_REALTIME;
     if (cond_attr) {        
-        clockid_t clock_id;
         LINK_NAMESPACE(pthread_condattr_getclock, "pthread");
         orig::pthread_condattr_getclock(cond_attr, &clock_id);
-        
-        std::map<pthread_cond_t*, clockid_t>& condClocks = getCondClock();
-        condClocks[cond] = clock_id;
     }
 
+    storeCondClock(reinterpret_cast<uintptr_t>(cond), clock_id);
+
     return orig::pthread_cond_init(cond, cond_attr);
 }
 
+/* Override */ int pthread_cond_destroy (pthread_cond_t *cond) __THROW
+{
+    LINK_NAMESPACE_VERSION(pthread_cond_destroy, "pthread", "GLIBC_2.3.2");
+    if (GlobalState::isNative())
+        return orig::pthread_cond_destroy(cond);
+
+    LOG(LL_TRACE, LCF_WAIT, "%s call with cond %p", __func__, static_cast<void*>(cond));
+
+    eraseCondClock(reinterpret_cast<uintptr_t>(cond));
+    return orig::pthread_cond_destroy(cond);
+}
+
 /* Override */ int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
     LINK_NAMESPACE_VERSION(pthread_cond_wait, "pthread", "GLIBC_2.3.2");
@@ -363,12 +434,7 @@ static std::map<pthread_cond_t*, clockid_t>& getCondClock() {
     
 #ifdef __unix__
     /* Get clock_id of cond */
-    clockid_t clock_id = CLOCK_REALTIME;
-    const std::map<pthread_cond_t*, clockid_t>& condClocks = getCondClock();
-
-    auto it = condClocks.find(cond);
-    if (it != condClocks.end())
-        clock_id = it->second;
+    clockid_t clock_id = findCondClock(reinterpret_cast<uintptr_t>(cond));
 
     NATIVECALL(clock_gettime(clock_id, &real_time));
     time_type = DeterministicTimer::get().clockToTypeUntracked(clock_id);
@@ -72,6 +72,9 @@ OVERRIDE int pthread_timedjoin_np(pthread_t thread, void **retval, const struct
    the default values if later is NULL.  */
 OVERRIDE int pthread_cond_init (pthread_cond_t *cond, const pthread_condattr_t *cond_attr) __THROW;
 
+/* Destroy condition variable COND.  */
+OVERRIDE int pthread_cond_destroy (pthread_cond_t *cond) __THROW;
+
 /* Wake up one thread waiting for condition variable COND.  */
 OVERRIDE int pthread_cond_signal (pthread_cond_t *cond) __THROW;
 
@@ -18,6 +18,7 @@
  */
 
 #include "logging.h"
+#include "AsyncLog.h"
 #include "checkpoint/ThreadManager.h" // isMainThread()
 #include "frame.h" // For framecount
 #include "global.h" // Global::shared_config
@@ -57,31 +58,10 @@
 
 namespace libtas {
 
-void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line, ...)
+/* Format and print a message with its header */
+static void printLogv(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+    uint64_t frame, pid_t tid, const char* thread_flag, const char* fmt, va_list args)
 {
-    /* Check log level and categories */
-    if (Global::shared_config.logging_level < ll)
-        return;
-
-    if (lcf & Global::shared_config.logging_exclude_flags)
-        return;
-
-    if ((lcf != LCF_NONE) && !(lcf & Global::shared_config.logging_include_flags))
-        return;
-
-    if ((Global::shared_config.logging_include_flags & LCF_MAINTHREAD) &&
-        !ThreadManager::isMainThread())
-        return;
-
-    /* Not printing anything if global state is set to NOLOG */
-    if (GlobalState::isNoLog())
-        return;
-
-    /* We avoid recursive loops by protecting eventual recursive calls to debuglog
-     * in the following code
-     */
-    GlobalNoLog tnl;
-
     /* Sanitize values */
     if (ll > LL_TRACE)
         ll = LL_TRACE;
@@ -96,7 +76,9 @@ void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
     int size = 0;
 
     /* We only print colors if displayed on a terminal */
-    bool isTerm = isatty(/*cerr*/ 2);
+    static int isTerm = -1;
+    if (isTerm < 0)
+        isTerm = isatty(/*cerr*/ 2);
     if (isTerm) {
         if (ll <= LL_ERROR)
             /* Write the header text in red */
@@ -110,14 +92,7 @@ void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
     }
     size = strlen(s);
 
-    pid_t tid;
-    if (Global::is_fork)
-        /* For forked processes, the thread manager have wrong pid values (those of parent process) */
-        NATIVECALL(tid = getpid());
-    else
-        tid = ThreadManager::getThreadTid();
-
-    snprintf(s + size, maxsize-size-1, "[f:%" PRIu64 " t:%d%s] ", framecount, tid, Global::is_fork?"F":(ThreadManager::isMainThread()?"M":""));
+    snprintf(s + size, maxsize-size-1, "[f:%" PRIu64 " t:%d%s] ", frame, tid, thread_flag);
 
     /* We append the string in multiple parts to the log window twice, to
      * not show the color characters */
@@ -142,11 +117,7 @@ void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
     }
     size = strlen(s);
 
-    va_list args;
-    va_start(args, line);
-    char* fmt = va_arg(args, char *);
     vsnprintf(s + size, maxsize-size-1, fmt, args);
-    va_end(args);
 
     size = strlen(s);
 
@@ -169,6 +140,72 @@ void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
 #endif
 }
 
+static void printLogf(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+    uint64_t frame, pid_t tid, const char* thread_flag, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    printLogv(ll, lcf, file, line, frame, tid, thread_flag, fmt, args);
+    va_end(args);
+}
+
+void printLog(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+    uint64_t frame, pid_t tid, bool main, const char* msg)
+{
+    printLogf(ll, lcf, file, line, frame, tid, main?"M":"", "%s", msg);
+}
+
+void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line, ...)
+{
+    /* Check log level and categories */
+    if (Global::shared_config.logging_level < ll)
+        return;
+
+    if (lcf & Global::shared_config.logging_exclude_flags)
+        return;
+
+    if ((lcf != LCF_NONE) && !(lcf & Global::shared_config.logging_include_flags))
+        return;
+
+    if ((Global::shared_config.logging_include_flags & LCF_MAINTHREAD) &&
+        !ThreadManager::isMainThread())
+        return;
+
+    /* Not printing anything if global state is set to NOLOG */
+    if (GlobalState::isNoLog())
+        return;
+
+    /* We avoid recursive loops by protecting eventual recursive calls to debuglog
+     * in the following code
+     */
+    GlobalNoLog tnl;
+
+    pid_t tid;
+    if (Global::is_fork)
+        /* For forked processes, the thread manager have wrong pid values (those of parent process) */
+        NATIVECALL(tid = getpid());
+    else
+        tid = ThreadManager::getThreadTid();
+
+    bool isMain = ThreadManager::isMainThread();
+
+    va_list args;
+    va_start(args, line);
+    char* fmt = va_arg(args, char *);
+
+    /* Errors and checkpoint messages are printed right away, the latter
+     * because the logging thread is stopped during checkpointing */
+    if (Global::shared_config.logging_async && !Global::is_fork &&
+        (ll > LL_ERROR) && !(lcf & LCF_CHECKPOINT) &&
+        AsyncLog::push(ll, lcf, file, line, framecount, tid, isMain, fmt, args)) {
+        va_end(args);
+        return;
+    }
+
+    printLogv(ll, lcf, file, line, framecount, tid, Global::is_fork?"F":(isMain?"M":""), fmt, args);
+    va_end(args);
+}
+
 void sendAlertMsg(const std::string alert)
 {
     lockSocket();
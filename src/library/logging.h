@@ -29,12 +29,18 @@
 #include <sstream>
 #include <cstdio>
 #include <string.h>
+#include <cstdint>
+#include <sys/types.h>
 
 namespace libtas {
 
 /* Actual implementation with file and line */
 void debuglogfull(LogLevel ll, LogCategoryFlag lcf, const char* file, int line, ...);
 
+/* Print an already formatted message, used by the asynchronous logger */
+void printLog(LogLevel ll, LogCategoryFlag lcf, const char* file, int line,
+    uint64_t frame, pid_t tid, bool main, const char* msg);
+
 /* Main logging function */
 #define LOG(ll, lcf, ...) do {\
 /*    PerfTimerCall ptc(lcf); */ \
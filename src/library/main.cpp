@@ -26,8 +26,10 @@
 #include "Stack.h"
 #include "GlobalState.h"
 #include "UnityHacks.h"
+#include "AsyncLog.h"
 #include "audio/AudioContext.h"
 #include "encoding/AVEncoder.h"
+#include "encoding/Screenshot.h"
 #include "steam/isteamuser.h" // SteamSetUserDataFolder
 #include "general/dlhook.h"
 #include "general/monowrappers.h"
@@ -217,6 +219,9 @@ void __attribute__((destructor)) term(void)
             sendMessage(MSGB_QUIT);
             closeSocket();
         }
+        /* Write the screenshots that are still queued */
+        Screenshot::stopThread();
+        AsyncLog::stopThread();
         LOG(LL_DEBUG, LCF_SOCKET, "Exiting.");
         ThreadManager::deallocateThreads();
     }
@@ -0,0 +1,61 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EncodeDebug.h"
+
+#include "encoding/AVEncoder.h"
+#include "../external/imgui/imgui.h"
+
+#include <cinttypes>
+
+namespace libtas {
+
+void EncodeDebug::draw(bool* p_open = nullptr)
+{
+    if (!ImGui::Begin("Encode Debug", p_open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!avencoder) {
+        ImGui::TextUnformatted("Not encoding");
+        ImGui::End();
+        return;
+    }
+
+    AVEncoder::QueueStats stats = avencoder->getQueueStats();
+
+    if (stats.capacity == 0) {
+        ImGui::TextUnformatted("Encoding on the game thread");
+    }
+    else {
+        char overlay[32];
+        snprintf(overlay, 32, "%d / %d packets", stats.depth, stats.capacity);
+        ImGui::TextUnformatted("Encoder queue");
+        ImGui::ProgressBar(static_cast<float>(stats.depth) / stats.capacity, ImVec2(-1.0f, 0.0f), overlay);
+    }
+
+    ImGui::Text("Stalls: %" PRIu64, stats.stalls);
+    ImGui::Text("Stall time: %.3f sec", stats.stall_seconds);
+
+    ImGui::End();
+}
+
+}
@@ -26,131 +26,289 @@
 #include "screencapture/ScreenCapture.h"
 #include "../shared/sockethelpers.h"
 #include "../shared/messages.h"
+#include "../shared/LuaDrawCommands.h"
 
-#include <list>
-#include <utility>
+#include <vector>
 #include <string>
-#include <memory>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace libtas {
-    
-static std::list<std::unique_ptr<LuaDraw::LuaShape>> lua_shapes;
-ImFont* LuaDraw::LuaText::regular_font;
-ImFont* LuaDraw::LuaText::monospace_font;
+
+/* Decoded drawings of the current frame, and the strings they use. Both
+ * keep their capacity between frames. */
+static std::vector<LuaDraw::LuaPrimitive> lua_primitives;
+static std::string string_pool;
+
+/* Buffer receiving the draw list */
+static std::vector<uint8_t> drawlist;
+
+ImFont* LuaDraw::regular_font;
+ImFont* LuaDraw::monospace_font;
 static int new_id = 0;
 
-void LuaDraw::LuaText::render(ImDrawList* draw_list, ImVec2 offset, float scale)
+/* Maximum number of filled rectangles written with a single vertex
+ * reservation, so that 16-bit indices don't overflow */
+#define MAX_RECT_BATCH 4096
+
+static uint32_t toImColor(uint32_t color)
 {
-    ImFont* font = regular_font;
-    
-    if (monospace)
-        font = monospace_font;
-    
-    /* Sanitize and process anchor values */
-    if (anchor_x < 0.0f)
-        anchor_x = 0.0f;
-    if (anchor_x > 1.0f)
-        anchor_x = 1.0f;
-    if (anchor_y < 0.0f)
-        anchor_y = 0.0f;
-    if (anchor_y > 1.0f)
-        anchor_y = 1.0f;
-    
-    /* Try avoiding computing the text length */
-    if (anchor_x == 0.0f && anchor_y == 0.0f) {
-        draw_list->AddText(font, font_size*scale, ImVec2(x, y)*scale + offset, color, text.c_str());
-    }
-    else {
-        const ImVec2 size = font->CalcTextSizeA(font_size, FLT_MAX, -1.0f, text.c_str(), NULL, NULL);
-        float new_x = x - size.x * anchor_x;
-        float new_y = y - size.y * anchor_y;
-        draw_list->AddText(font, font_size*scale, ImVec2(new_x, new_y)*scale + offset, color, text.c_str());
-    }    
+    return IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
+                    static_cast<uint8_t>((color >> 8) & 0xff),
+                    static_cast<uint8_t>(color & 0xff),
+                    static_cast<uint8_t>((color >> 24) & 0xff));
 }
 
-void LuaDraw::LuaWindow::render(ImDrawList* draw_list, ImVec2 offset, float scale)
+/* Helper to read a draw list with bounds checking */
+class DrawListReader
 {
-    ImGuiWindowFlags window_flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoSavedSettings;
-    if (id.empty())
-        window_flags |= ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoNav;
-    
-    ImGui::SetNextWindowPos(ImVec2(x, y), id.empty() ? ImGuiCond_Always : ImGuiCond_Once, ImVec2(0.0f, 0.0f));
-
-    /* Generate a unique id */
-    std::string unique_id;
-    if (id.empty()) {
-        unique_id = "temp_";
-        unique_id += std::to_string(new_id);
-        new_id++;
+public:
+    DrawListReader(const uint8_t* data, size_t size) : data(data), size(size), pos(0), error(false) {}
+
+    template<typename T>
+    T read()
+    {
+        T value = T();
+        if (pos + sizeof(T) > size) {
+            error = true;
+            return value;
+        }
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
     }
 
-    if (ImGui::Begin(id.empty() ? unique_id.c_str() : id.c_str(), nullptr, window_flags)) {
-        ImGui::TextUnformatted(text.c_str());
+    /* Copy a string at the end of the string pool, and return its offset */
+    uint32_t readString()
+    {
+        uint32_t len = read<uint32_t>();
+        uint32_t offset = string_pool.size();
+        if (error || (pos + len > size)) {
+            error = true;
+            return offset;
+        }
+        string_pool.append(reinterpret_cast<const char*>(data + pos), len);
+        string_pool.push_back('\0');
+        pos += len;
+        return offset;
     }
-    ImGui::End();
-}
 
-void LuaDraw::LuaPixel::render(ImDrawList* draw_list, ImVec2 offset, float scale)
-{
-    draw_list->AddLine(ImVec2(x, y)*scale + offset, ImVec2(x, y)*scale + offset, color);
-}
+    bool done() const {return error || (pos >= size);}
 
-bool LuaDraw::LuaPixel::isInbound()
-{
-    return LuaDraw::isInbound(x, y, x, y);
-}
+    bool failed() const {return error;}
 
-void LuaDraw::LuaRect::render(ImDrawList* draw_list, ImVec2 offset, float scale)
-{
-    if (filled)
-        draw_list->AddRectFilled(ImVec2(x, y)*scale + offset, ImVec2(x+w, y+h)*scale + offset, color);
-    else
-        draw_list->AddRect(ImVec2(x, y)*scale + offset, ImVec2(x+w, y+h)*scale + offset, color, 0.0f, 0, thickness);
-}
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    bool error;
+};
 
-bool LuaDraw::LuaRect::isInbound()
+void LuaDraw::decode(const uint8_t* data, size_t size)
 {
-    return LuaDraw::isInbound(x, y, x+w, y+h);
-}
+    int w = 0, h = 0;
+    ScreenCapture::getDimensions(w, h);
 
-void LuaDraw::LuaLine::render(ImDrawList* draw_list, ImVec2 offset, float scale)
-{
-    draw_list->AddLine(ImVec2(x0, y0)*scale + offset, ImVec2(x1, y1)*scale + offset, color);
-}
+    /* Check if the bounding box of a shape, extended by the outline
+     * thickness, intersects the screen */
+    auto inbound = [w, h](float min_x, float min_y, float max_x, float max_y, float thickness) {
+        return (max_x + thickness >= 0) && (max_y + thickness >= 0) &&
+            (min_x - thickness <= w) && (min_y - thickness <= h);
+    };
+
+    DrawListReader reader(data, size);
+    while (!reader.done()) {
+        LuaPrimitive prim = {};
+        prim.type = reader.read<uint8_t>();
+        bool keep = true;
+
+        switch (prim.type) {
+            case LUA_DRAW_TEXT:
+                prim.p[0] = reader.read<float>();
+                prim.p[1] = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                /* Sanitize anchor values */
+                prim.p[2] = std::min(std::max(reader.read<float>(), 0.0f), 1.0f);
+                prim.p[3] = std::min(std::max(reader.read<float>(), 0.0f), 1.0f);
+                prim.thickness = reader.read<float>();
+                prim.flag = reader.read<uint8_t>();
+                prim.str[0] = reader.readString();
+                break;
+            case LUA_DRAW_WINDOW:
+                prim.p[0] = reader.read<float>();
+                prim.p[1] = reader.read<float>();
+                prim.str[0] = reader.readString();
+                prim.str[1] = reader.readString();
+                break;
+            case LUA_DRAW_PIXEL:
+                prim.p[0] = reader.read<float>();
+                prim.p[1] = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                keep = inbound(prim.p[0], prim.p[1], prim.p[0], prim.p[1], 0);
+                break;
+            case LUA_DRAW_RECT:
+                prim.p[0] = reader.read<float>();
+                prim.p[1] = reader.read<float>();
+                /* Store the opposite corner */
+                prim.p[2] = prim.p[0] + reader.read<float>();
+                prim.p[3] = prim.p[1] + reader.read<float>();
+                prim.thickness = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                prim.flag = reader.read<uint8_t>();
+                /* Width and height may be negative */
+                keep = inbound(std::min(prim.p[0], prim.p[2]), std::min(prim.p[1], prim.p[3]),
+                               std::max(prim.p[0], prim.p[2]), std::max(prim.p[1], prim.p[3]),
+                               std::abs(prim.thickness)) &&
+                    ((prim.color & IM_COL32_A_MASK) != 0);
+                break;
+            case LUA_DRAW_LINE:
+                for (int i = 0; i < 4; i++)
+                    prim.p[i] = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                keep = inbound(std::min(prim.p[0], prim.p[2]), std::min(prim.p[1], prim.p[3]),
+                               std::max(prim.p[0], prim.p[2]), std::max(prim.p[1], prim.p[3]), 1);
+                break;
+            case LUA_DRAW_QUAD:
+                for (int i = 0; i < 8; i++)
+                    prim.p[i] = reader.read<float>();
+                prim.thickness = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                prim.flag = reader.read<uint8_t>();
+                keep = inbound(std::min(std::min(prim.p[0], prim.p[2]), std::min(prim.p[4], prim.p[6])),
+                               std::min(std::min(prim.p[1], prim.p[3]), std::min(prim.p[5], prim.p[7])),
+                               std::max(std::max(prim.p[0], prim.p[2]), std::max(prim.p[4], prim.p[6])),
+                               std::max(std::max(prim.p[1], prim.p[3]), std::max(prim.p[5], prim.p[7])),
+                               std::abs(prim.thickness));
+                break;
+            case LUA_DRAW_ELLIPSE:
+                for (int i = 0; i < 4; i++)
+                    prim.p[i] = reader.read<float>();
+                prim.thickness = reader.read<float>();
+                prim.color = toImColor(reader.read<uint32_t>());
+                prim.flag = reader.read<uint8_t>();
+                keep = inbound(prim.p[0] - std::abs(prim.p[2]), prim.p[1] - std::abs(prim.p[3]),
+                               prim.p[0] + std::abs(prim.p[2]), prim.p[1] + std::abs(prim.p[3]),
+                               std::abs(prim.thickness));
+                break;
+            default:
+                LOG(LL_ERROR, LCF_WINDOW, "Unknown lua draw command %d", prim.type);
+                return;
+        }
 
-bool LuaDraw::LuaLine::isInbound()
-{
-    return LuaDraw::isInbound(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
-}
+        if (reader.failed()) {
+            LOG(LL_ERROR, LCF_WINDOW, "Truncated lua draw list");
+            return;
+        }
 
-void LuaDraw::LuaQuad::render(ImDrawList* draw_list, ImVec2 offset, float scale)
-{
-    if (filled)
-        draw_list->AddQuadFilled(ImVec2(x0, y0)*scale + offset, ImVec2(x1, y1)*scale + offset, ImVec2(x2, y2)*scale + offset, ImVec2(x3, y3)*scale + offset, color);
-    else
-        draw_list->AddQuad(ImVec2(x0, y0)*scale + offset, ImVec2(x1, y1)*scale + offset, ImVec2(x2, y2)*scale + offset, ImVec2(x3, y3)*scale + offset, color, thickness);
+        if (keep)
+            lua_primitives.push_back(prim);
+    }
 }
 
-bool LuaDraw::LuaQuad::isInbound()
+static void renderText(ImDrawList* draw_list, const LuaDraw::LuaPrimitive& prim, ImVec2 offset, float scale)
 {
-    return LuaDraw::isInbound(std::min(std::min(x0, x1), std::min(x2, x3)),
-                              std::min(std::min(y0, y1), std::min(y2, y3)),
-                              std::max(std::max(x0, x1), std::max(x2, x3)),
-                              std::max(std::max(y0, y1), std::max(y2, y3)));
+    ImFont* font = prim.flag ? LuaDraw::monospace_font : LuaDraw::regular_font;
+    const char* text = &string_pool[prim.str[0]];
+    float font_size = prim.thickness;
+    float x = prim.p[0];
+    float y = prim.p[1];
+
+    /* Try avoiding computing the text length */
+    if (prim.p[2] != 0.0f || prim.p[3] != 0.0f) {
+        const ImVec2 size = font->CalcTextSizeA(font_size, FLT_MAX, -1.0f, text, NULL, NULL);
+        x -= size.x * prim.p[2];
+        y -= size.y * prim.p[3];
+    }
+    draw_list->AddText(font, font_size*scale, ImVec2(x, y)*scale + offset, prim.color, text);
 }
 
-void LuaDraw::LuaEllipse::render(ImDrawList* draw_list, ImVec2 offset, float scale)
+static void renderWindow(const LuaDraw::LuaPrimitive& prim)
 {
-    if (filled)
-        draw_list->AddEllipseFilled(ImVec2(center_x, center_y)*scale + offset, radius_x*scale, radius_y*scale, color);
-    else
-        draw_list->AddEllipse(ImVec2(center_x, center_y)*scale + offset, radius_x*scale, radius_y*scale, color, 0.0f, 0, thickness);
+    const char* id = &string_pool[prim.str[0]];
+    const char* text = &string_pool[prim.str[1]];
+    bool hasId = (id[0] != '\0');
+
+    ImGuiWindowFlags window_flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoSavedSettings;
+    if (!hasId)
+        window_flags |= ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoNav;
+    
+    ImGui::SetNextWindowPos(ImVec2(prim.p[0], prim.p[1]), hasId ? ImGuiCond_Once : ImGuiCond_Always, ImVec2(0.0f, 0.0f));
+
+    /* Generate a unique id */
+    std::string unique_id;
+    if (!hasId) {
+        unique_id = "temp_";
+        unique_id += std::to_string(new_id);
+        new_id++;
+    }
+
+    if (ImGui::Begin(hasId ? id : unique_id.c_str(), nullptr, window_flags)) {
+        ImGui::TextUnformatted(text);
+    }
+    ImGui::End();
 }
 
-bool LuaDraw::LuaEllipse::isInbound()
+void LuaDraw::draw(ImDrawList* draw_list, ImVec2 offset, float scale)
 {
-    return LuaDraw::isInbound(center_x - radius_x, center_y - radius_y, center_x + radius_x, center_y + radius_y);
+    /* Reset the generation of unique ids */
+    new_id = 0;
+    
+    size_t count = lua_primitives.size();
+    size_t i = 0;
+    while (i < count) {
+        const LuaPrimitive& prim = lua_primitives[i];
+        const float* p = prim.p;
+
+        switch (prim.type) {
+            case LUA_DRAW_TEXT:
+                renderText(draw_list, prim, offset, scale);
+                break;
+            case LUA_DRAW_WINDOW:
+                renderWindow(prim);
+                break;
+            case LUA_DRAW_PIXEL:
+                draw_list->AddLine(ImVec2(p[0], p[1])*scale + offset, ImVec2(p[0], p[1])*scale + offset, prim.color);
+                break;
+            case LUA_DRAW_RECT:
+                if (prim.flag) {
+                    /* Write consecutive filled rectangles directly into the
+                     * vertex buffer, with a single reservation */
+                    size_t end = i + 1;
+                    while ((end < count) && ((end - i) < MAX_RECT_BATCH) &&
+                           (lua_primitives[end].type == LUA_DRAW_RECT) && lua_primitives[end].flag)
+                        end++;
+
+                    int nb = end - i;
+                    draw_list->PrimReserve(6*nb, 4*nb);
+                    for (; i < end; i++) {
+                        const LuaPrimitive& rect = lua_primitives[i];
+                        draw_list->PrimRect(ImVec2(rect.p[0], rect.p[1])*scale + offset, ImVec2(rect.p[2], rect.p[3])*scale + offset, rect.color);
+                    }
+                    continue;
+                }
+                draw_list->AddRect(ImVec2(p[0], p[1])*scale + offset, ImVec2(p[2], p[3])*scale + offset, prim.color, 0.0f, 0, prim.thickness);
+                break;
+            case LUA_DRAW_LINE:
+                draw_list->AddLine(ImVec2(p[0], p[1])*scale + offset, ImVec2(p[2], p[3])*scale + offset, prim.color);
+                break;
+            case LUA_DRAW_QUAD:
+                if (prim.flag)
+                    draw_list->AddQuadFilled(ImVec2(p[0], p[1])*scale + offset, ImVec2(p[2], p[3])*scale + offset, ImVec2(p[4], p[5])*scale + offset, ImVec2(p[6], p[7])*scale + offset, prim.color);
+                else
+                    draw_list->AddQuad(ImVec2(p[0], p[1])*scale + offset, ImVec2(p[2], p[3])*scale + offset, ImVec2(p[4], p[5])*scale + offset, ImVec2(p[6], p[7])*scale + offset, prim.color, prim.thickness);
+                break;
+            case LUA_DRAW_ELLIPSE:
+                if (prim.flag)
+                    draw_list->AddEllipseFilled(ImVec2(p[0], p[1])*scale + offset, p[2]*scale, p[3]*scale, prim.color);
+                else
+                    draw_list->AddEllipse(ImVec2(p[0], p[1])*scale + offset, p[2]*scale, p[3]*scale, prim.color, 0.0f, 0, prim.thickness);
+                break;
+            default:
+                break;
+        }
+        i++;
+    }
 }
 
 void LuaDraw::processSocket(int message)
@@ -165,140 +323,13 @@ void LuaDraw::processSocket(int message)
             sendData(&h, sizeof(int));
             break;
         }
-        case MSGN_LUA_TEXT:
-        {
-            auto lt = new LuaText();
-            receiveData(&lt->x, sizeof(float));
-            receiveData(&lt->y, sizeof(float));
-            lt->text = receiveString();
-            
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            lt->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                         static_cast<uint8_t>((color >> 8) & 0xff),
-                         static_cast<uint8_t>(color & 0xff),
-                         static_cast<uint8_t>((color >> 24) & 0xff));
-            
-            receiveData(&lt->anchor_x, sizeof(float));
-            receiveData(&lt->anchor_y, sizeof(float));
-            receiveData(&lt->font_size, sizeof(float));
-            receiveData(&lt->monospace, sizeof(bool));
-            lua_shapes.emplace_back(lt);
-            break;
-        }
-        case MSGN_LUA_WINDOW:
-        {
-            auto lw = new LuaWindow();
-            receiveData(&lw->x, sizeof(float));
-            receiveData(&lw->y, sizeof(float));
-            lw->id = receiveString();
-            lw->text = receiveString();
-            lua_shapes.emplace_back(lw);
-            break;
-        }
-        case MSGN_LUA_PIXEL:
-        {
-            auto lp = std::unique_ptr<LuaPixel>(new LuaPixel);
-            receiveData(&lp->x, sizeof(float));
-            receiveData(&lp->y, sizeof(float));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            lp->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                         static_cast<uint8_t>((color >> 8) & 0xff),
-                         static_cast<uint8_t>(color & 0xff),
-                         static_cast<uint8_t>((color >> 24) & 0xff));
-
-            if (lp->isInbound())
-                lua_shapes.push_back(std::move(lp));
-            break;
-        }
-        case MSGN_LUA_RECT:
-        {
-            auto lr = std::unique_ptr<LuaRect>(new LuaRect());
-            receiveData(&lr->x, sizeof(float));
-            receiveData(&lr->y, sizeof(float));
-            receiveData(&lr->w, sizeof(float));
-            receiveData(&lr->h, sizeof(float));
-            receiveData(&lr->thickness, sizeof(float));
-
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            lr->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                           static_cast<uint8_t>((color >> 8) & 0xff),
-                           static_cast<uint8_t>(color & 0xff),
-                           static_cast<uint8_t>((color >> 24) & 0xff));
-            
-            receiveData(&lr->filled, sizeof(int));
-
-            if (lr->isInbound())
-                lua_shapes.push_back(std::move(lr));
-            break;
-        }
-        case MSGN_LUA_LINE:
+        case MSGN_LUA_DRAWLIST:
         {
-            auto ll = std::unique_ptr<LuaLine>(new LuaLine());
-            receiveData(&ll->x0, sizeof(float));
-            receiveData(&ll->y0, sizeof(float));
-            receiveData(&ll->x1, sizeof(float));
-            receiveData(&ll->y1, sizeof(float));
-
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            ll->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                         static_cast<uint8_t>((color >> 8) & 0xff),
-                         static_cast<uint8_t>(color & 0xff),
-                         static_cast<uint8_t>((color >> 24) & 0xff));
-
-            if (ll->isInbound())
-                lua_shapes.push_back(std::move(ll));
-
-            break;
-        }
-        case MSGN_LUA_QUAD:
-        {
-            auto lq = std::unique_ptr<LuaQuad>(new LuaQuad());
-            receiveData(&lq->x0, sizeof(float));
-            receiveData(&lq->y0, sizeof(float));
-            receiveData(&lq->x1, sizeof(float));
-            receiveData(&lq->y1, sizeof(float));
-            receiveData(&lq->x2, sizeof(float));
-            receiveData(&lq->y2, sizeof(float));
-            receiveData(&lq->x3, sizeof(float));
-            receiveData(&lq->y3, sizeof(float));
-            receiveData(&lq->thickness, sizeof(float));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            lq->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                           static_cast<uint8_t>((color >> 8) & 0xff),
-                           static_cast<uint8_t>(color & 0xff),
-                           static_cast<uint8_t>((color >> 24) & 0xff));
-
-            receiveData(&lq->filled, sizeof(int));
-            
-            if (lq->isInbound())
-                lua_shapes.push_back(std::move(lq));    
-
-            break;
-        }
-        case MSGN_LUA_ELLIPSE:
-        {
-            auto le = std::unique_ptr<LuaEllipse>(new LuaEllipse());
-            receiveData(&le->center_x, sizeof(float));
-            receiveData(&le->center_y, sizeof(float));
-            receiveData(&le->radius_x, sizeof(float));
-            receiveData(&le->radius_y, sizeof(float));
-            receiveData(&le->thickness, sizeof(float));
-            uint32_t color;
-            receiveData(&color, sizeof(uint32_t));
-            le->color = IM_COL32(static_cast<uint8_t>((color >> 16) & 0xff),
-                         static_cast<uint8_t>((color >> 8) & 0xff),
-                         static_cast<uint8_t>(color & 0xff),
-                         static_cast<uint8_t>((color >> 24) & 0xff));
-            receiveData(&le->filled, sizeof(int));
-
-            if (le->isInbound())
-                lua_shapes.push_back(std::move(le));
-
+            uint32_t size;
+            receiveData(&size, sizeof(uint32_t));
+            drawlist.resize(size);
+            receiveData(drawlist.data(), size);
+            decode(drawlist.data(), size);
             break;
         }
         default:
@@ -306,33 +337,10 @@ void LuaDraw::processSocket(int message)
     }
 }
 
-void LuaDraw::draw(ImDrawList* draw_list, ImVec2 offset, float scale)
-{
-    /* Reset the generation of unique ids */
-    new_id = 0;
-    
-    for (auto &shape : lua_shapes) {
-        shape->render(draw_list, offset, scale);
-    }
-}
-
 void LuaDraw::reset()
 {
-    lua_shapes.clear();
-}
-
-bool LuaDraw::isInbound(float min_x, float min_y, float max_x, float max_y)
-{
-    if (max_x < 0) return false;
-    if (max_y < 0) return false;
-
-    int w = 0, h = 0;
-    ScreenCapture::getDimensions(w, h);
-
-    if (min_x > w) return false;
-    if (min_y > h) return false;
-
-    return true;
+    lua_primitives.clear();
+    string_pool.clear();
 }
 
 }
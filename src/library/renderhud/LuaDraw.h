@@ -22,120 +22,53 @@
 
 #include "../external/imgui/imgui.h"
 
-#include <string>
 #include <cstdint>
+#include <cstddef>
 
 namespace libtas {
 
 namespace LuaDraw
 {
 
-struct LuaShape
+/* One lua drawing decoded from the draw list sent by the program. All
+ * drawings of a frame are stored in a single flat array. */
+struct LuaPrimitive
 {
-    virtual void render(ImDrawList* draw_list, ImVec2 offset, float scale) = 0;
-    virtual bool isInbound() = 0;
-};
-
-struct LuaText : public LuaShape
-{
-    std::string text;
-    uint32_t color;
-    float x;
-    float y;
-    float anchor_x;
-    float anchor_y;
-    float font_size;
-    bool monospace;
-    static ImFont* regular_font;
-    static ImFont* monospace_font;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override {return true;}
-};
+    /* Type of drawing, from LuaDrawCommand */
+    uint8_t type;
 
-struct LuaWindow : public LuaShape
-{
-    std::string id;
-    std::string text;
-    float x;
-    float y;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override {return true;}
-};
+    /* Filled shape, or monospace font for text */
+    uint8_t flag;
 
-struct LuaPixel : public LuaShape
-{
-    float x;
-    float y;
+    /* Color in ImGui format */
     uint32_t color;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override;
-};
 
-struct LuaRect : public LuaShape
-{
-    float x;
-    float y;
-    float w;
-    float h;
+    /* Line thickness, or font size for text */
     float thickness;
-    uint32_t color;
-    int filled;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override;
-};
 
-struct LuaLine : public LuaShape
-{
-    float x0;
-    float y0;
-    float x1;
-    float y1;
-    uint32_t color;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override;
-};
+    /* Coordinates of the drawing, depending on its type. Text stores its
+     * anchor in p[2] and p[3] */
+    float p[8];
 
-struct LuaQuad : public LuaShape
-{
-    float x0;
-    float y0;
-    float x1;
-    float y1;
-    float x2;
-    float y2;
-    float x3;
-    float y3;
-    float thickness;
-    uint32_t color;
-    int filled;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override;
+    /* Offsets of the strings (text, window id) inside the string pool */
+    uint32_t str[2];
 };
 
-struct LuaEllipse : public LuaShape
-{
-    float center_x;
-    float center_y;
-    float radius_x;
-    float radius_y;
-    float thickness;
-    uint32_t color;
-    int filled;
-    void render(ImDrawList* draw_list, ImVec2 offset, float scale) override;
-    bool isInbound() override;
-};
+/* Fonts used to draw text */
+extern ImFont* regular_font;
+extern ImFont* monospace_font;
 
 /* Process incoming data from libTAS program */
 void processSocket(int message);
 
+/* Decode a draw list of `size` bytes into primitives */
+void decode(const uint8_t* data, size_t size);
+
 /* Clear all lua drawings */
 void reset();
 
 void draw(ImDrawList* draw_list, ImVec2 offset, float scale);
 
-/* Check if lua shape is inbound */
-bool isInbound(float min_x, float min_y, float max_x, float max_y);
-
 }
 
 }
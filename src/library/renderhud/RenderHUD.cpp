@@ -26,6 +26,7 @@
 #include "MessageWindow.h"
 #include "WatchesWindow.h"
 #include "AudioDebug.h"
+#include "EncodeDebug.h"
 #include "UnityDebug.h"
 
 #include "GlobalState.h"
@@ -69,8 +70,8 @@ bool RenderHUD::init()
                 GlobalNative gn;
                 
                 ImGuiIO& io = ImGui::GetIO();
-                LuaDraw::LuaText::regular_font = io.Fonts->AddFontFromMemoryCompressedTTF(Roboto_compressed_data, Roboto_compressed_size, 16.0f);
-                LuaDraw::LuaText::monospace_font = io.Fonts->AddFontFromMemoryCompressedTTF(ProggyClean_compressed_data, ProggyClean_compressed_size, 16.0f);
+                LuaDraw::regular_font = io.Fonts->AddFontFromMemoryCompressedTTF(Roboto_compressed_data, Roboto_compressed_size, 16.0f);
+                LuaDraw::monospace_font = io.Fonts->AddFontFromMemoryCompressedTTF(ProggyClean_compressed_data, ProggyClean_compressed_size, 16.0f);
 
                 /* Disable config file */
                 io.IniFilename = NULL;
@@ -127,6 +128,7 @@ void RenderHUD::drawAll(uint64_t framecount, uint64_t nondraw_framecount, const
     static bool show_crosshair = false;
     static bool show_log = false;
     static bool show_audio = false;
+    static bool show_encode = false;
     static bool show_unity = false;
     static bool show_demo = false;
     
@@ -202,6 +204,7 @@ void RenderHUD::drawAll(uint64_t framecount, uint64_t nondraw_framecount, const
             if (ImGui::BeginMenu("Debug")) {
                 ImGui::MenuItem("Log", nullptr, &show_log);
                 ImGui::MenuItem("Audio", nullptr, &show_audio);
+                ImGui::MenuItem("Encode", nullptr, &show_encode);
                 ImGui::MenuItem("Unity", nullptr, &show_unity, UnityHacks::isUnity());
                 ImGui::MenuItem("Demo", nullptr, &show_demo);
                 ImGui::EndMenu();
@@ -250,6 +253,9 @@ void RenderHUD::drawAll(uint64_t framecount, uint64_t nondraw_framecount, const
     if (show_audio)
         AudioDebug::draw(framecount, &show_audio);
 
+    if (show_encode)
+        EncodeDebug::draw(&show_encode);
+
     if (show_unity)
         UnityDebug::draw(framecount, &show_unity);
 
@@ -110,6 +110,11 @@ void gl_load_procs(GLGetProcAddressProc proc)
     GET_GL_POINTER(DeleteShader)
     GET_GL_POINTER(BlendFunc)
     GET_GL_POINTER(DeleteBuffers)
+    GET_GL_POINTER(MapBufferRange)
+    GET_GL_POINTER(UnmapBuffer)
+    GET_GL_POINTER(FenceSync)
+    GET_GL_POINTER(ClientWaitSync)
+    GET_GL_POINTER(DeleteSync)
     GET_GL_POINTER(DeleteVertexArrays)
     GET_GL_POINTER(DeleteProgram)
     GET_GL_POINTER(Viewport)
@@ -103,6 +103,11 @@ struct GLProcs {
     DEFINE_GL_POINTER(DeleteShader)
     DEFINE_GL_POINTER(BlendFunc)
     DEFINE_GL_POINTER(DeleteBuffers)
+    DEFINE_GL_POINTER(MapBufferRange)
+    DEFINE_GL_POINTER(UnmapBuffer)
+    DEFINE_GL_POINTER(FenceSync)
+    DEFINE_GL_POINTER(ClientWaitSync)
+    DEFINE_GL_POINTER(DeleteSync)
     DEFINE_GL_POINTER(DeleteVertexArrays)
     DEFINE_GL_POINTER(DeleteProgram)
     DEFINE_GL_POINTER(Viewport)
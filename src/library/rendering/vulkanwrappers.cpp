@@ -134,6 +134,14 @@ DEFINE_ORIG_POINTER(vkDestroySampler)
 DEFINE_ORIG_POINTER(vkDestroyFramebuffer)
 DEFINE_ORIG_POINTER(vkDestroySwapchainKHR)
 DEFINE_ORIG_POINTER(vkCmdClearColorImage)
+DEFINE_ORIG_POINTER(vkCreateBuffer)
+DEFINE_ORIG_POINTER(vkDestroyBuffer)
+DEFINE_ORIG_POINTER(vkGetBufferMemoryRequirements)
+DEFINE_ORIG_POINTER(vkBindBufferMemory)
+DEFINE_ORIG_POINTER(vkCmdCopyImageToBuffer)
+DEFINE_ORIG_POINTER(vkWaitForFences)
+DEFINE_ORIG_POINTER(vkResetFences)
+DEFINE_ORIG_POINTER(vkInvalidateMappedMemoryRanges)
 
 
 #define VKFUNCSKIPDRAW(NAME, DECL, ARGS) \
@@ -210,6 +218,14 @@ static void* store_orig_and_return_my_symbol(const char* symbol, void* real_poin
     STORE_SYMBOL(vkDestroySampler)
     STORE_SYMBOL(vkDestroyFramebuffer)
     STORE_SYMBOL(vkCmdClearColorImage)
+    STORE_SYMBOL(vkCreateBuffer)
+    STORE_SYMBOL(vkDestroyBuffer)
+    STORE_SYMBOL(vkGetBufferMemoryRequirements)
+    STORE_SYMBOL(vkBindBufferMemory)
+    STORE_SYMBOL(vkCmdCopyImageToBuffer)
+    STORE_SYMBOL(vkWaitForFences)
+    STORE_SYMBOL(vkResetFences)
+    STORE_SYMBOL(vkInvalidateMappedMemoryRanges)
     STORE_RETURN_SYMBOL(vkCmdDraw)
     STORE_RETURN_SYMBOL(vkCmdDrawIndirect)
     STORE_RETURN_SYMBOL(vkCmdDrawIndexed)
@@ -331,6 +347,14 @@ VkResult myvkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateI
         GETPROCADDR(vkDestroySampler)
         GETPROCADDR(vkDestroyFramebuffer)
         GETPROCADDR(vkCmdClearColorImage)
+        GETPROCADDR(vkCreateBuffer)
+        GETPROCADDR(vkDestroyBuffer)
+        GETPROCADDR(vkGetBufferMemoryRequirements)
+        GETPROCADDR(vkBindBufferMemory)
+        GETPROCADDR(vkCmdCopyImageToBuffer)
+        GETPROCADDR(vkWaitForFences)
+        GETPROCADDR(vkResetFences)
+        GETPROCADDR(vkInvalidateMappedMemoryRanges)
         
         /* Create the descriptor pool that will create descriptor sets for the
          * font texture and game window texture */
@@ -169,6 +169,39 @@ int ScreenCapture::copySurfaceToScreen()
     return 0;
 }
 
+int ScreenCapture::readbackLatency()
+{
+    if (!inited)
+        return 0;
+
+    if (impl) {
+        return impl->readbackLatency();
+    }
+    return 0;
+}
+
+bool ScreenCapture::startReadback()
+{
+    if (!inited)
+        return false;
+
+    if (impl) {
+        return impl->startReadback();
+    }
+    return false;
+}
+
+int ScreenCapture::finishReadback(uint8_t **pixels)
+{
+    if (!inited)
+        return 0;
+
+    if (impl) {
+        return impl->finishReadback(pixels);
+    }
+    return 0;
+}
+
 void ScreenCapture::restoreScreenState()
 {
     if (!inited)
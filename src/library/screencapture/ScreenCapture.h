@@ -69,6 +69,18 @@ public:
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     static int copySurfaceToScreen();
 
+    /* Number of frames of delay of the asynchronous readback */
+    static int readbackLatency();
+
+    /* Start an asynchronous transfer of the screen buffer/surface/texture.
+     * Returns false if no transfer was started, in which case
+     * `finishReadback()` must not be called for this frame. */
+    static bool startReadback();
+
+    /* Get the pixels of the oldest asynchronous transfer, pointed by `pixels`.
+     * Returns the size of the array. */
+    static int finishReadback(uint8_t **pixels);
+
     /* Restore the state of the screen (backbuffer usually), because some methods
      * of rendering reuse the backbuffer from the previous frame.
      * It is equivalent to `copySurfaceToScreen()` in most cases. */
@@ -93,7 +93,26 @@ void ScreenCapture_GL::initScreenSurface()
     GL_CALL(BindFramebuffer, (GL_DRAW_FRAMEBUFFER, draw_buffer));
     GL_CALL(BindFramebuffer, (GL_READ_FRAMEBUFFER, read_buffer));
 
+    /* Generate the ring of pixel pack buffers */
+    GLint pixel_buffer;
+    GL_CALL(GetIntegerv, (GL_PIXEL_PACK_BUFFER_BINDING, &pixel_buffer));
+
+    if (screenPBOs[0] == 0) {
+        GL_CALL(GenBuffers, (PBO_COUNT, screenPBOs));
+    }
+
+    for (int i = 0; i < PBO_COUNT; i++) {
+        GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, screenPBOs[i]));
+        GL_CALL(BufferData, (GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ));
+    }
+
+    GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, pixel_buffer));
+
+    pbo_first = 0;
+    pbo_pending = 0;
+
     gllinepixels.resize(pitch);
+    readbackpixels.resize(size);
 }
 
 void ScreenCapture_GL::destroyScreenSurface()
@@ -111,6 +130,21 @@ void ScreenCapture_GL::destroyScreenSurface()
         glProcs.DeleteTextures(1, &screenTex);
         screenTex = 0;
     }
+
+    /* Delete pending fences and pixel pack buffers */
+    for (int i = 0; i < PBO_COUNT; i++) {
+        if (screenFences[i]) {
+            glProcs.DeleteSync(screenFences[i]);
+            screenFences[i] = nullptr;
+        }
+    }
+    if (screenPBOs[0] != 0) {
+        glProcs.DeleteBuffers(PBO_COUNT, screenPBOs);
+        for (int i = 0; i < PBO_COUNT; i++)
+            screenPBOs[i] = 0;
+    }
+    pbo_first = 0;
+    pbo_pending = 0;
 }
 
 uint64_t ScreenCapture_GL::screenTexture()
@@ -212,6 +246,110 @@ int ScreenCapture_GL::getPixelsFromSurface(uint8_t **pixels, bool draw)
     return size;
 }
 
+int ScreenCapture_GL::readbackLatency()
+{
+    return PBO_COUNT - 1;
+}
+
+bool ScreenCapture_GL::startReadback()
+{
+    /* All buffers are in use, so we must consume the oldest one. This should
+     * not happen if the caller respects the readback latency. */
+    if (pbo_pending == PBO_COUNT)
+        finishReadback(nullptr);
+
+    GlobalNative gn;
+
+    /* Copy the original read framebuffer */
+    GLint read_buffer;
+    glProcs.GetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_buffer);
+
+    /* Copy the original pixel buffer */
+    GLint pixel_buffer;
+    glProcs.GetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pixel_buffer);
+
+    /* Copy the original pack row length */
+    GLint pack_row;
+    glProcs.GetIntegerv(GL_PACK_ROW_LENGTH, &pack_row);
+
+    glProcs.GetError();
+
+    int index = (pbo_first + pbo_pending) % PBO_COUNT;
+
+    GL_CALL(BindFramebuffer, (GL_READ_FRAMEBUFFER, screenFBO));
+    GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, screenPBOs[index]));
+
+    if (pack_row != 0)
+        glProcs.PixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+    /* With a pixel pack buffer bound, this only queues the transfer and
+     * returns immediately. */
+    GL_CALL(ReadPixels, (0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+    screenFences[index] = glProcs.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (pack_row != 0)
+        glProcs.PixelStorei(GL_PACK_ROW_LENGTH, pack_row);
+
+    GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, pixel_buffer));
+    GL_CALL(BindFramebuffer, (GL_READ_FRAMEBUFFER, read_buffer));
+
+    pbo_pending++;
+    return true;
+}
+
+int ScreenCapture_GL::finishReadback(uint8_t **pixels)
+{
+    if (pixels) {
+        *pixels = readbackpixels.data();
+    }
+
+    /* Nothing to read, return the last pixels */
+    if (pbo_pending == 0)
+        return size;
+
+    GlobalNative gn;
+
+    int index = pbo_first;
+
+    /* Wait for the transfer to complete, which should already be the case
+     * after a few frames */
+    if (screenFences[index]) {
+        GLenum ret = glProcs.ClientWaitSync(screenFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (ret == GL_TIMEOUT_EXPIRED || ret == GL_WAIT_FAILED)
+            LOG(LL_WARN, LCF_WINDOW | LCF_OGL, "Waiting for screen readback failed with %d", ret);
+        glProcs.DeleteSync(screenFences[index]);
+        screenFences[index] = nullptr;
+    }
+
+    GLint pixel_buffer;
+    glProcs.GetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pixel_buffer);
+
+    glProcs.GetError();
+
+    GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, screenPBOs[index]));
+
+    const uint8_t* mapped = static_cast<const uint8_t*>(glProcs.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+
+    if (mapped) {
+        /* Flip image while copying out of the buffer, because OpenGL has a
+         * different reference point */
+        for (int line = 0; line < height; line++) {
+            memcpy(&readbackpixels[line * pitch], mapped + (height-line-1) * pitch, pitch);
+        }
+        GL_CALL(UnmapBuffer, (GL_PIXEL_PACK_BUFFER));
+    }
+    else {
+        LOG(LL_ERROR, LCF_WINDOW | LCF_OGL, "Could not map the screen pixel buffer");
+    }
+
+    GL_CALL(BindBuffer, (GL_PIXEL_PACK_BUFFER, pixel_buffer));
+
+    pbo_first = (pbo_first + 1) % PBO_COUNT;
+    pbo_pending--;
+
+    return size;
+}
+
 int ScreenCapture_GL::copySurfaceToScreen()
 {
     GlobalNative gn;
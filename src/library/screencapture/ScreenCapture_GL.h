@@ -25,6 +25,8 @@
 #include <stdint.h>
 #include <vector>
 
+typedef struct __GLsync *GLsync;
+
 namespace libtas {
 
 class ScreenCapture_GL : public ScreenCapture_Impl {
@@ -54,6 +56,16 @@ public:
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     int copySurfaceToScreen();
 
+    int readbackLatency();
+
+    /* Read the screen texture into the next pixel pack buffer of the ring,
+     * and insert a fence after the transfer */
+    bool startReadback();
+
+    /* Wait on the fence of the oldest pixel pack buffer, and copy its content
+     * flipped into `readbackpixels` */
+    int finishReadback(uint8_t **pixels);
+
     void clearScreen();
 
     uint64_t screenTexture();
@@ -70,6 +82,23 @@ private:
     
     /* OpenGL screen texture */
     uint32_t screenTex = 0;
+
+    /* Number of pixel pack buffers used for asynchronous readback. A frame
+     * started at frame K is read back at frame K+PBO_COUNT-1. */
+    static const int PBO_COUNT = 3;
+
+    /* OpenGL pixel pack buffers */
+    uint32_t screenPBOs[PBO_COUNT] = {};
+
+    /* Fences signaled when each pixel pack buffer transfer is done */
+    GLsync screenFences[PBO_COUNT] = {};
+
+    /* Index of the oldest pending readback, and number of pending readbacks */
+    int pbo_first = 0;
+    int pbo_pending = 0;
+
+    /* Pixel array returned by asynchronous readback */
+    std::vector<uint8_t> readbackpixels;
 };
 }
 
@@ -102,6 +102,11 @@ int ScreenCapture_Impl::postInit()
 
 void ScreenCapture_Impl::fini()
 {
+    /* Write the frames of pending readbacks before the surface is gone */
+    if (avencoder) {
+        avencoder->flushVideo();
+    }
+
     winpixels.clear();
 
     destroyScreenSurface();
@@ -116,6 +121,11 @@ void ScreenCapture_Impl::resize(int w, int h)
     }
 #endif
 
+    /* Write the frames of pending readbacks before the surface is gone */
+    if (avencoder) {
+        avencoder->flushVideo();
+    }
+
     destroyScreenSurface();
 
     width = w;
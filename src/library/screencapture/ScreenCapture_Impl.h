@@ -69,6 +69,20 @@ public:
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     virtual int copySurfaceToScreen() = 0;
 
+    /* Number of frames between a call to `startReadback()` and the call to
+     * `finishReadback()` that returns its pixels. Implementations without
+     * asynchronous readback return 0. */
+    virtual int readbackLatency() {return 0;}
+
+    /* Start transferring the screen buffer/surface/texture into client
+     * memory, without waiting for the transfer to complete. Returns false if
+     * the transfer could not be started. */
+    virtual bool startReadback() {return true;}
+
+    /* Wait for the oldest transfer started by `startReadback()`, and point
+     * `pixels` to the transferred array. Returns the size of the array. */
+    virtual int finishReadback(uint8_t **pixels) {return getPixelsFromSurface(pixels, true);}
+
     /* Restore the state of the screen (backbuffer usually), because some methods
      * of rendering reuse the backbuffer from the previous frame.
      * It is equivalent to `copySurfaceToScreen()` in most cases. */
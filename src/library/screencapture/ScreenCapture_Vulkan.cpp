@@ -51,6 +51,29 @@ DECLARE_ORIG_POINTER(vkCreateSampler)
 DECLARE_ORIG_POINTER(vkDestroyImageView)
 DECLARE_ORIG_POINTER(vkDestroySampler)
 DECLARE_ORIG_POINTER(vkCmdClearColorImage)
+DECLARE_ORIG_POINTER(vkCreateBuffer)
+DECLARE_ORIG_POINTER(vkDestroyBuffer)
+DECLARE_ORIG_POINTER(vkGetBufferMemoryRequirements)
+DECLARE_ORIG_POINTER(vkBindBufferMemory)
+DECLARE_ORIG_POINTER(vkCmdCopyImageToBuffer)
+DECLARE_ORIG_POINTER(vkWaitForFences)
+DECLARE_ORIG_POINTER(vkResetFences)
+DECLARE_ORIG_POINTER(vkInvalidateMappedMemoryRanges)
+DECLARE_ORIG_POINTER(vkCreateFence)
+DECLARE_ORIG_POINTER(vkDestroyFence)
+DECLARE_ORIG_POINTER(vkCreateCommandPool)
+DECLARE_ORIG_POINTER(vkDestroyCommandPool)
+
+/* Return the index of a memory type with all `properties`, or -1 */
+static int findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties)
+{
+    for (uint32_t i = 0; i < vk::context.deviceMemoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) &&
+            ((vk::context.deviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+            return i;
+    }
+    return -1;
+}
 
 int ScreenCapture_Vulkan::init()
 {
@@ -140,6 +163,13 @@ void ScreenCapture_Vulkan::initScreenSurface()
     }
 
     orig::vkBindImageMemory(vk::context.device, vkScreenImage, vkScreenImageMemory, 0);
+
+    /* Keep the image memory mapped, so that reading pixels does not need to
+     * map it each time */
+    if ((res = orig::vkMapMemory(vk::context.device, vkScreenImageMemory, 0, VK_WHOLE_SIZE, 0, (void**)&vkScreenImageData)) != VK_SUCCESS) {
+        LOG(LL_ERROR, LCF_VULKAN, "vkMapMemory failed with error %d", res);
+        vkScreenImageData = nullptr;
+    }
     
     /* From Dear ImGui Display example page 
      * <https://github.com/ocornut/imgui/wiki/Image-Loading-and-Displaying-Examples#example-for-vulkan-users> */
@@ -184,10 +214,140 @@ void ScreenCapture_Vulkan::initScreenSurface()
      * `ImGui_ImplVulkan_Init()` has been called! We will run this on the first
      * query of the textureId in `ScreenCapture_Vulkan::screenTexture()` */
     // vkScreenDescriptorSet = ImGui_ImplVulkan_AddTexture(vkScreenSampler, vkScreenImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    initReadback();
+}
+
+void ScreenCapture_Vulkan::initReadback()
+{
+    VkResult res;
+
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(size);
+
+    for (int i = 0; i < STAGING_COUNT; i++) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = bufferSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if ((res = orig::vkCreateBuffer(vk::context.device, &bufferInfo, vk::context.allocator, &stagingBuffers[i])) != VK_SUCCESS) {
+            LOG(LL_ERROR, LCF_VULKAN, "vkCreateBuffer failed with error %d", res);
+            destroyReadback();
+            return;
+        }
+
+        VkMemoryRequirements memRequirements;
+        orig::vkGetBufferMemoryRequirements(vk::context.device, stagingBuffers[i], &memRequirements);
+
+        /* Prefer host cached memory, which is much faster to read from */
+        int memoryType = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        if (memoryType < 0)
+            memoryType = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (memoryType < 0) {
+            LOG(LL_WARN, LCF_VULKAN, "No host visible memory for screen readback");
+            destroyReadback();
+            return;
+        }
+        stagingCoherent = vk::context.deviceMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        if ((res = orig::vkAllocateMemory(vk::context.device, &allocInfo, vk::context.allocator, &stagingMemory[i])) != VK_SUCCESS) {
+            LOG(LL_ERROR, LCF_VULKAN, "vkAllocateMemory failed with error %d", res);
+            destroyReadback();
+            return;
+        }
+
+        orig::vkBindBufferMemory(vk::context.device, stagingBuffers[i], stagingMemory[i], 0);
+
+        if ((res = orig::vkMapMemory(vk::context.device, stagingMemory[i], 0, VK_WHOLE_SIZE, 0, (void**)&stagingData[i])) != VK_SUCCESS) {
+            LOG(LL_ERROR, LCF_VULKAN, "vkMapMemory failed with error %d", res);
+            destroyReadback();
+            return;
+        }
+    }
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = vk::context.queueFamily;
+    if ((res = orig::vkCreateCommandPool(vk::context.device, &poolInfo, vk::context.allocator, &readbackCommandPool)) != VK_SUCCESS) {
+        LOG(LL_ERROR, LCF_VULKAN, "vkCreateCommandPool failed with error %d", res);
+        destroyReadback();
+        return;
+    }
+
+    VkCommandBufferAllocateInfo cmdInfo{};
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdInfo.commandPool = readbackCommandPool;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandBufferCount = STAGING_COUNT;
+    if ((res = orig::vkAllocateCommandBuffers(vk::context.device, &cmdInfo, readbackCommandBuffers)) != VK_SUCCESS) {
+        LOG(LL_ERROR, LCF_VULKAN, "vkAllocateCommandBuffers failed with error %d", res);
+        destroyReadback();
+        return;
+    }
+
+    for (int i = 0; i < STAGING_COUNT; i++) {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if ((res = orig::vkCreateFence(vk::context.device, &fenceInfo, vk::context.allocator, &readbackFences[i])) != VK_SUCCESS) {
+            LOG(LL_ERROR, LCF_VULKAN, "vkCreateFence failed with error %d", res);
+            destroyReadback();
+            return;
+        }
+    }
+
+    staging_first = 0;
+    staging_pending = 0;
+    readbackpixels.resize(size);
+}
+
+void ScreenCapture_Vulkan::destroyReadback()
+{
+    /* Wait for transfers that are still running */
+    for (int i = 0; i < staging_pending; i++) {
+        int index = (staging_first + i) % STAGING_COUNT;
+        orig::vkWaitForFences(vk::context.device, 1, &readbackFences[index], VK_TRUE, 1000000000);
+    }
+    staging_first = 0;
+    staging_pending = 0;
+
+    for (int i = 0; i < STAGING_COUNT; i++) {
+        if (readbackFences[i] != VK_NULL_HANDLE) {
+            orig::vkDestroyFence(vk::context.device, readbackFences[i], vk::context.allocator);
+            readbackFences[i] = VK_NULL_HANDLE;
+        }
+        if (stagingBuffers[i] != VK_NULL_HANDLE) {
+            orig::vkDestroyBuffer(vk::context.device, stagingBuffers[i], vk::context.allocator);
+            stagingBuffers[i] = VK_NULL_HANDLE;
+        }
+        if (stagingMemory[i] != VK_NULL_HANDLE) {
+            /* Freeing the memory also unmaps it */
+            orig::vkFreeMemory(vk::context.device, stagingMemory[i], vk::context.allocator);
+            stagingMemory[i] = VK_NULL_HANDLE;
+        }
+        stagingData[i] = nullptr;
+    }
+
+    if (readbackCommandPool != VK_NULL_HANDLE) {
+        if (readbackCommandBuffers[0] != VK_NULL_HANDLE)
+            orig::vkFreeCommandBuffers(vk::context.device, readbackCommandPool, STAGING_COUNT, readbackCommandBuffers);
+        orig::vkDestroyCommandPool(vk::context.device, readbackCommandPool, vk::context.allocator);
+        readbackCommandPool = VK_NULL_HANDLE;
+    }
+    for (int i = 0; i < STAGING_COUNT; i++)
+        readbackCommandBuffers[i] = VK_NULL_HANDLE;
 }
 
 void ScreenCapture_Vulkan::destroyScreenSurface()
 {
+    destroyReadback();
+
     /* Delete the Vulkan image and all associated objects */
     if (vkScreenDescriptorSet != VK_NULL_HANDLE) {
         ImGui_ImplVulkan_RemoveTexture(vkScreenDescriptorSet);
@@ -202,6 +362,8 @@ void ScreenCapture_Vulkan::destroyScreenSurface()
         vkScreenImageView = VK_NULL_HANDLE;
     }    
     if (vkScreenImageMemory != VK_NULL_HANDLE) {
+        orig::vkUnmapMemory(vk::context.device, vkScreenImageMemory);
+        vkScreenImageData = nullptr;
         orig::vkFreeMemory(vk::context.device, vkScreenImageMemory, nullptr);
         vkScreenImageMemory = VK_NULL_HANDLE;
     }
@@ -367,6 +529,7 @@ int ScreenCapture_Vulkan::copyScreenToSurface()
     /* Flush the command buffer */
     if ((res = orig::vkEndCommandBuffer(cmdBuffer)) != VK_SUCCESS) {
         LOG(LL_ERROR, LCF_VULKAN, "vkEndCommandBuffer failed with error %d", res);
+        return -1;
     }
 
     VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
@@ -407,27 +570,29 @@ int ScreenCapture_Vulkan::getPixelsFromSurface(uint8_t **pixels, bool draw)
     if (!draw)
         return size;
 
-    GlobalNative gn;
+    if (!vkScreenImageData)
+        return size;
 
-    VkResult res;
+    GlobalNative gn;
 
     /* Get layout of the image (including row pitch) */
 	VkImageSubresource subResource { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
 	VkSubresourceLayout subResourceLayout;
 	orig::vkGetImageSubresourceLayout(vk::context.device, vkScreenImage, &subResource, &subResourceLayout);
 
-	/* Map image memory so we can start copying from it */
-	const char* data;
-    if ((res = orig::vkMapMemory(vk::context.device, vkScreenImageMemory, 0, VK_WHOLE_SIZE, 0, (void**)&data)) != VK_SUCCESS) {
-        LOG(LL_ERROR, LCF_VULKAN, "vkEndCommandBuffer failed with error %d", res);
+    const uint8_t* data = vkScreenImageData + subResourceLayout.offset;
+
+    /* Copy all rows at once if they are tightly packed */
+    if ((subResourceLayout.rowPitch == static_cast<VkDeviceSize>(pitch)) && (subResourceLayout.size >= size)) {
+        memcpy(winpixels.data(), data, size);
+        return size;
     }
-    
+
     /* Copy image pixels respecting the image layout. */
-    data += subResourceLayout.offset;
     VkDeviceSize s = 0;
     int h = 0;
     while ((s < subResourceLayout.size) && (h < height)) {
-        memcpy(&winpixels[h*width*pixelSize], data, width*pixelSize);
+        memcpy(&winpixels[h*pitch], data, pitch);
         data += subResourceLayout.rowPitch;
         s += subResourceLayout.rowPitch;
         h++;
@@ -435,9 +600,7 @@ int ScreenCapture_Vulkan::getPixelsFromSurface(uint8_t **pixels, bool draw)
 
     if (h != height)
         LOG(LL_ERROR, LCF_VULKAN, "Mismatch between Vulkan internal image height (%d) and registered height (%d)", h, height);
-    
-    orig::vkUnmapMemory(vk::context.device, vkScreenImageMemory);
-    
+
     return size;
 }
 
@@ -684,6 +847,152 @@ void ScreenCapture_Vulkan::clearScreen()
     EndCommandAndSubmitQueue(cmdBuffer, &vk::context.frameSemaphores[vk::context.semaphoreIndex].clearCompleteSemaphore);
 }
 
+int ScreenCapture_Vulkan::readbackLatency()
+{
+    if (stagingBuffers[0] == VK_NULL_HANDLE)
+        return 0;
+    return STAGING_COUNT - 1;
+}
+
+bool ScreenCapture_Vulkan::startReadback()
+{
+    /* Synchronous readback is performed by `finishReadback()` */
+    if (stagingBuffers[0] == VK_NULL_HANDLE)
+        return true;
+
+    if (vk::context.swapchainRebuild)
+        return false;
+
+    /* All buffers are in use, so we must consume the oldest one. This should
+     * not happen if the caller respects the readback latency. */
+    if (staging_pending == STAGING_COUNT)
+        finishReadback(nullptr);
+
+    GlobalNative gn;
+
+    VkResult res;
+
+    int index = (staging_first + staging_pending) % STAGING_COUNT;
+    VkCommandBuffer cmdBuffer = readbackCommandBuffers[index];
+
+    beginCommand(cmdBuffer);
+
+    /* Wait for the copy of the screen into the image, which was submitted
+     * earlier on the same queue. The image stays in general layout. */
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = vkScreenImage;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.layerCount = 1;
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    orig::vkCmdPipelineBarrier(cmdBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &imageBarrier
+    );
+
+    /* Tightly packed rows, so that the buffer is read with a single copy */
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+
+    orig::vkCmdCopyImageToBuffer(cmdBuffer, vkScreenImage, VK_IMAGE_LAYOUT_GENERAL, stagingBuffers[index], 1, &region);
+
+    /* Make the transfer visible to the host */
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = stagingBuffers[index];
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+
+    orig::vkCmdPipelineBarrier(cmdBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, nullptr,
+        1, &bufferBarrier,
+        0, nullptr
+    );
+
+    if ((res = orig::vkEndCommandBuffer(cmdBuffer)) != VK_SUCCESS) {
+        LOG(LL_ERROR, LCF_VULKAN, "vkEndCommandBuffer failed with error %d", res);
+    }
+
+    /* No semaphore here, the transfer is not part of the presentation chain */
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuffer;
+
+    orig::vkResetFences(vk::context.device, 1, &readbackFences[index]);
+    if ((res = orig::vkQueueSubmit(vk::context.graphicsQueue, 1, &submitInfo, readbackFences[index])) != VK_SUCCESS) {
+        LOG(LL_ERROR, LCF_VULKAN, "vkQueueSubmit failed with error %d", res);
+        return false;
+    }
+
+    staging_pending++;
+    return true;
+}
+
+int ScreenCapture_Vulkan::finishReadback(uint8_t **pixels)
+{
+    /* Synchronous readback if staging buffers could not be created */
+    if (stagingBuffers[0] == VK_NULL_HANDLE)
+        return getPixelsFromSurface(pixels, true);
+
+    if (pixels) {
+        *pixels = readbackpixels.data();
+    }
+
+    /* Nothing to read, return the last pixels */
+    if (staging_pending == 0)
+        return size;
+
+    GlobalNative gn;
+
+    int index = staging_first;
+
+    /* Wait for the transfer to complete, which should already be the case
+     * after a few frames */
+    VkResult res = orig::vkWaitForFences(vk::context.device, 1, &readbackFences[index], VK_TRUE, 1000000000);
+    if (res != VK_SUCCESS)
+        LOG(LL_WARN, LCF_VULKAN, "Waiting for screen readback failed with %d", res);
+
+    if (!stagingCoherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = stagingMemory[index];
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        orig::vkInvalidateMappedMemoryRanges(vk::context.device, 1, &range);
+    }
+
+    memcpy(readbackpixels.data(), stagingData[index], size);
+
+    staging_first = (staging_first + 1) % STAGING_COUNT;
+    staging_pending--;
+
+    return size;
+}
+
 uint64_t ScreenCapture_Vulkan::screenTexture()
 {
     /* Lazy-initialized because of init ordering, see `ScreenCapture_Vulkan::initScreenSurface()` */
@@ -24,6 +24,7 @@
 #include "rendering/vulkanwrappers.h"
 
 #include <stdint.h>
+#include <vector>
 
 namespace libtas {
 
@@ -56,6 +57,16 @@ public:
     /* Copy back the stored screen buffer/surface/texture into the screen. */
     int copySurfaceToScreen();
 
+    int readbackLatency();
+
+    /* Copy the screen image into the next staging buffer of the ring, and
+     * submit it with a fence */
+    bool startReadback();
+
+    /* Wait on the fence of the oldest staging buffer, and copy its content
+     * into `readbackpixels` */
+    int finishReadback(uint8_t **pixels);
+
     void clearScreen();
 
     uint64_t screenTexture();
@@ -68,6 +79,38 @@ private:
     VkSampler vkScreenSampler = VK_NULL_HANDLE;
     VkDescriptorSet vkScreenDescriptorSet = VK_NULL_HANDLE;
     VkDeviceMemory vkScreenImageMemory = VK_NULL_HANDLE;
+
+    /* Persistent mapping of the screen image memory */
+    const uint8_t* vkScreenImageData = nullptr;
+
+    /* Create and destroy the staging buffers used for asynchronous readback */
+    void initReadback();
+    void destroyReadback();
+
+    /* Number of staging buffers used for asynchronous readback. A frame
+     * started at frame K is read back at frame K+STAGING_COUNT-1. */
+    static const int STAGING_COUNT = 3;
+
+    /* Host-visible staging buffers, persistently mapped */
+    VkBuffer stagingBuffers[STAGING_COUNT] = {};
+    VkDeviceMemory stagingMemory[STAGING_COUNT] = {};
+    const uint8_t* stagingData[STAGING_COUNT] = {};
+
+    /* Host cached memory may not be coherent, and must be invalidated
+     * before reading */
+    bool stagingCoherent = true;
+
+    /* Command buffers of the transfers, and fences signaled when done */
+    VkCommandPool readbackCommandPool = VK_NULL_HANDLE;
+    VkCommandBuffer readbackCommandBuffers[STAGING_COUNT] = {};
+    VkFence readbackFences[STAGING_COUNT] = {};
+
+    /* Index of the oldest pending readback, and number of pending readbacks */
+    int staging_first = 0;
+    int staging_pending = 0;
+
+    /* Pixel array returned by asynchronous readback */
+    std::vector<uint8_t> readbackpixels;
 }; 
 }
 
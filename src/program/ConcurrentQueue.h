@@ -20,67 +20,246 @@
 #ifndef LIBTAS_CONCURRENTQUEUE_H_INCLUDED
 #define LIBTAS_CONCURRENTQUEUE_H_INCLUDED
 
-#include <list>
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <stdint.h>
+#include <cstring>
+#include <type_traits>
 
-/* Thread-safe queue, will be used for a single producer/single consumer model
- * taken from https://juanchopanzacpp.wordpress.com/2013/02/26/concurrent-queue-c11/
+/* Bounded lock-free queue, for multiple producers and a single consumer.
+ * Items are stored in a ring buffer allocated at construction, so pushing and
+ * popping never allocate. Each cell has a sequence number telling if it is
+ * ready to be written or read for the current lap of the ring.
+ * Based on Dmitry Vyukov's bounded MPMC queue:
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
  */
 template <typename T>
 class ConcurrentQueue {
 public:
 
+    /* Capacity is rounded up to a power of two */
+    explicit ConcurrentQueue(size_t capacity = 256)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        buffer.reset(new Cell[size]);
+        mask = size - 1;
+
+        for (size_t i = 0; i < size; i++)
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
     bool empty() const
     {
-        /* We should not need to protect this function with a mutex */
-        return queue_.empty();
+        size_t pos = dequeue_pos.load(std::memory_order_acquire);
+        const Cell& cell = buffer[pos & mask];
+        return cell.sequence.load(std::memory_order_acquire) != (pos + 1);
     }
 
-    typename std::list<T>::const_iterator begin()
+    bool full() const
     {
-        return queue_.cbegin();
+        size_t pos = enqueue_pos.load(std::memory_order_acquire);
+        const Cell& cell = buffer[pos & mask];
+        return cell.sequence.load(std::memory_order_acquire) != pos;
     }
 
-    typename std::list<T>::const_iterator end()
+    /* Push an item, returns false if the queue is full */
+    bool push(const T& item)
     {
-        return queue_.cend();
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                /* Cell is free, try to reserve it */
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                /* Cell was not popped since the previous lap */
+                return false;
+            }
+            else {
+                /* Another producer reserved this cell */
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->item.store(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
     }
-    
-    void lock()
+
+    /* Push `count` items in consecutive cells, so that the consumer sees all
+     * of them or none. Returns false if the queue does not have room for all
+     * items. */
+    bool push(const T* items, size_t count)
     {
-        mutex_.lock();
+        if ((count == 0) || (count > (mask + 1)))
+            return count == 0;
+
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+            /* Cells are freed in order by the consumer, so all cells are free
+             * if the last one is */
+            const Cell& last = buffer[(pos + count - 1) & mask];
+            size_t seq = last.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + count - 1);
+
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            Cell& cell = buffer[(pos + i) & mask];
+            cell.item.store(items[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
     }
 
-    void unlock()
+    /* Pop an item, returns false if the queue is empty.
+     * Must only be called by the consumer thread. */
+    bool pop(T& item)
     {
-        mutex_.unlock();
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell& cell = buffer[pos & mask];
+
+        if (cell.sequence.load(std::memory_order_acquire) != (pos + 1))
+            return false;
+
+        cell.item.load(item);
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_release);
+        return true;
     }
 
-    void pop(T& item)
+    /* Pop up to `count` items into the array, returns the number of items.
+     * Must only be called by the consumer thread. */
+    size_t pop(T* items, size_t count)
     {
-        std::unique_lock<std::mutex> mlock(mutex_);
-        item = queue_.front();
-        queue_.pop_front();
+        size_t n = 0;
+        while ((n < count) && pop(items[n]))
+            n++;
+        return n;
     }
 
-    void push(const T& item)
+    /* Copy the last pushed item, returns false if the queue is empty */
+    bool back(T& item) const
     {
-        std::unique_lock<std::mutex> mlock(mutex_);
-        queue_.push_back(item);
+        size_t pos = enqueue_pos.load(std::memory_order_acquire);
+        if (pos == dequeue_pos.load(std::memory_order_acquire))
+            return false;
+
+        return peek(pos - 1, item);
     }
 
-    const T& back(void)
+    /* Call a function on a copy of each queued item, without popping them.
+     * Items that are popped during the call may be skipped. */
+    template <typename F>
+    void forEach(F f) const
     {
-        return queue_.back();
+        size_t pos = dequeue_pos.load(std::memory_order_acquire);
+        size_t end = enqueue_pos.load(std::memory_order_acquire);
+
+        for (; pos != end; pos++) {
+            T item;
+            if (peek(pos, item))
+                f(item);
+        }
     }
 
-    ConcurrentQueue()=default;
     ConcurrentQueue(const ConcurrentQueue&) = delete;            // disable copying
     ConcurrentQueue& operator=(const ConcurrentQueue&) = delete; // disable assignment
 
 private:
-    std::list<T> queue_;
-    std::mutex mutex_;
+    /* Storage of an item. Items that are not trivially copyable cannot be
+     * peeked, and are only accessed by their producer and the consumer. */
+    template <typename U, bool Peekable = std::is_trivially_copyable<U>::value>
+    struct Storage {
+        U item;
+
+        void store(const U& value) { item = value; }
+        void load(U& value) const { value = item; }
+    };
+
+    /* Items that can be peeked are stored as atomic words, because a
+     * producer may write the item while another thread copies it. The copy
+     * is then discarded by checking the sequence number again. */
+    template <typename U>
+    struct Storage<U, true> {
+        static const size_t WORDS = (sizeof(U) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+        std::atomic<uintptr_t> words[WORDS];
+
+        void store(const U& value)
+        {
+            uintptr_t w[WORDS] = {};
+            memcpy(w, &value, sizeof(U));
+
+            /* Order the words after the sequence number read by the
+             * producer, for threads peeking the previous item of the cell */
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++)
+                words[i].store(w[i], std::memory_order_relaxed);
+        }
+
+        void load(U& value) const
+        {
+            uintptr_t w[WORDS];
+            for (size_t i = 0; i < WORDS; i++)
+                w[i] = words[i].load(std::memory_order_relaxed);
+            memcpy(&value, w, sizeof(U));
+        }
+    };
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Storage<T> item;
+    };
+
+    /* Copy an item that is still in the queue, without popping it. The cell
+     * may be reused during the copy, in which case the sequence number has
+     * changed and the copy is discarded, which is why only plain types are
+     * allowed. */
+    bool peek(size_t pos, T& item) const
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Queue items must be trivially copyable to be peeked");
+
+        const Cell& cell = buffer[pos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != (pos + 1))
+            return false;
+
+        cell.item.load(item);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return cell.sequence.load(std::memory_order_relaxed) == (pos + 1);
+    }
+
+    std::unique_ptr<Cell[]> buffer;
+    size_t mask;
+
+    /* Producers and consumer positions, on separate cache lines */
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
 };
 
 #endif
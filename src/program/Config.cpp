@@ -106,6 +106,9 @@ void Config::save(const std::string& gamepath) {
     settings.setValue("editor_rewind_seek", editor_rewind_seek);
     settings.setValue("editor_rewind_fastforward", editor_rewind_fastforward);
     settings.setValue("editor_marker_pause", editor_marker_pause);
+    settings.setValue("editor_greenzone", editor_greenzone);
+    settings.setValue("editor_greenzone_interval", editor_greenzone_interval);
+    settings.setValue("editor_undo_memory", editor_undo_memory);
 
     settings.beginGroup("keymapping");
 
@@ -138,6 +141,7 @@ void Config::save(const std::string& gamepath) {
     settings.setValue("fastforward_mode", sc.fastforward_mode);
     settings.setValue("fastforward_render", sc.fastforward_render);
     settings.setValue("logging_status", sc.logging_status);
+    settings.setValue("logging_async", sc.logging_async);
     settings.setValue("logging_level", sc.logging_level);
     settings.setValue("logging_include_flags", sc.logging_include_flags);
     settings.setValue("logging_exclude_flags", sc.logging_exclude_flags);
@@ -153,6 +157,7 @@ void Config::save(const std::string& gamepath) {
     settings.setValue("osd_encode", sc.osd_encode);
     settings.setValue("prevent_savefiles", sc.prevent_savefiles);
     settings.setValue("audio_bitdepth", sc.audio_bitdepth);
+    settings.setValue("audio_float", sc.audio_float);
     settings.setValue("audio_channels", sc.audio_channels);
     settings.setValue("audio_frequency", sc.audio_frequency);
     settings.setValue("audio_gain", sc.audio_gain);
@@ -163,6 +168,9 @@ void Config::save(const std::string& gamepath) {
     settings.setValue("video_framerate", sc.video_framerate);
     settings.setValue("audio_codec", sc.audio_codec);
     settings.setValue("audio_bitrate", sc.audio_bitrate);
+    settings.setValue("encoding_backend", sc.encoding_backend);
+    settings.setValue("encoding_queue_size", sc.encoding_queue_size);
+    settings.setValue("encoding_skip_duplicates", sc.encoding_skip_duplicates);
     settings.setValue("locale", sc.locale);
     settings.setValue("virtual_steam", sc.virtual_steam);
     settings.setValue("openal_soft", sc.openal_soft);
@@ -269,6 +277,9 @@ void Config::load(const std::string& gamepath) {
     editor_rewind_seek = settings.value("editor_rewind_seek", editor_rewind_seek).toBool();
     editor_rewind_fastforward = settings.value("editor_rewind_fastforward", editor_rewind_fastforward).toBool();
     editor_marker_pause = settings.value("editor_marker_pause", editor_marker_pause).toBool();
+    editor_greenzone = settings.value("editor_greenzone", editor_greenzone).toBool();
+    editor_greenzone_interval = settings.value("editor_greenzone_interval", editor_greenzone_interval).toInt();
+    editor_undo_memory = settings.value("editor_undo_memory", editor_undo_memory).toInt();
 
     /* Load key mapping */
 
@@ -304,6 +315,7 @@ void Config::load(const std::string& gamepath) {
     sc.fastforward_mode = settings.value("fastforward_mode", sc.fastforward_mode).toInt();
     sc.fastforward_render = settings.value("fastforward_render", sc.fastforward_render).toInt();
     sc.logging_status = settings.value("logging_status", sc.logging_status).toInt();
+    sc.logging_async = settings.value("logging_async", sc.logging_async).toBool();
     sc.logging_level = settings.value("logging_level", sc.logging_level).toUInt();
     sc.logging_include_flags = settings.value("logging_include_flags", sc.logging_include_flags).toUInt();
     sc.logging_exclude_flags = settings.value("logging_exclude_flags", sc.logging_exclude_flags).toUInt();
@@ -319,6 +331,7 @@ void Config::load(const std::string& gamepath) {
     sc.osd_encode = settings.value("osd_encode", sc.osd_encode).toBool();
     sc.prevent_savefiles = settings.value("prevent_savefiles", sc.prevent_savefiles).toBool();
     sc.audio_bitdepth = settings.value("audio_bitdepth", sc.audio_bitdepth).toInt();
+    sc.audio_float = settings.value("audio_float", sc.audio_float).toBool();
     sc.audio_channels = settings.value("audio_channels", sc.audio_channels).toInt();
     sc.audio_frequency = settings.value("audio_frequency", sc.audio_frequency).toInt();
     sc.audio_gain = settings.value("audio_gain", sc.audio_gain).toFloat();
@@ -339,6 +352,9 @@ void Config::load(const std::string& gamepath) {
     sc.video_framerate = settings.value("video_framerate", sc.video_framerate).toInt();
     sc.audio_codec = settings.value("audio_codec", sc.audio_codec).toInt();
     sc.audio_bitrate = settings.value("audio_bitrate", sc.audio_bitrate).toInt();
+    sc.encoding_backend = settings.value("encoding_backend", sc.encoding_backend).toInt();
+    sc.encoding_queue_size = settings.value("encoding_queue_size", sc.encoding_queue_size).toInt();
+    sc.encoding_skip_duplicates = settings.value("encoding_skip_duplicates", sc.encoding_skip_duplicates).toBool();
     sc.savestate_settings = settings.value("savestate_settings", sc.savestate_settings).toInt();
     sc.opengl_soft = settings.value("opengl_soft", sc.opengl_soft).toBool();
     sc.opengl_performance = settings.value("opengl_performance", sc.opengl_performance).toBool();
@@ -146,6 +146,15 @@ public:
     /* Pause and stop fastforward when reaching an input editor marker */
     bool editor_marker_pause = false;
 
+    /* Automatically save greenzone states to rewind in the input editor */
+    bool editor_greenzone = false;
+
+    /* Number of frames between two greenzone states */
+    int editor_greenzone_interval = 60;
+
+    /* Memory budget of the input editor undo history, in MB */
+    int editor_undo_memory = 256;
+
     /* Proton absolute path */
     std::string proton_path;
 
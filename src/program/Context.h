@@ -29,6 +29,7 @@
 #elif defined(__APPLE__) && defined(__MACH__)
 #endif
 #include <string>
+#include <iostream>
 #include <stdint.h>
 
 struct Context {
@@ -138,6 +139,36 @@ struct Context {
     
     /* Indicate if the current frame is a draw frame */
     bool draw_frame;
+
+    /* Push a pressed hotkey to be processed by the main thread. The hotkey is
+     * dropped if too many hotkeys are pending, because the main thread itself
+     * may be pushing it, so it returns false and prints an error. */
+    bool pushHotkeyPressed(HotKeyType hk)
+    {
+        if (hotkey_pressed_queue.push(hk))
+            return true;
+        std::cerr << "Too many pending hotkeys, dropping pressed hotkey " << hk << std::endl;
+        return false;
+    }
+
+    /* Push several pressed hotkeys so that they are all processed or none of
+     * them is, returns false and prints an error if they don't fit */
+    bool pushHotkeysPressed(const HotKeyType* hks, size_t count)
+    {
+        if (hotkey_pressed_queue.push(hks, count))
+            return true;
+        std::cerr << "Too many pending hotkeys, dropping " << count << " pressed hotkeys" << std::endl;
+        return false;
+    }
+
+    /* Same for a released hotkey */
+    bool pushHotkeyReleased(HotKeyType hk)
+    {
+        if (hotkey_released_queue.push(hk))
+            return true;
+        std::cerr << "Too many pending hotkeys, dropping released hotkey " << hk << std::endl;
+        return false;
+    }
 };
 
 #endif
@@ -21,6 +21,7 @@
 #include "GameEvents.h"
 #include "SaveState.h"
 #include "SaveStateList.h"
+#include "Greenzone.h"
 #include "movie/MovieFile.h"
 
 #include "../shared/sockethelpers.h"
@@ -281,6 +282,34 @@ bool GameEvents::processEvent(GameEvents::EventType type, const HotKey &hk)
             return false;
         }
 
+        case HOTKEY_LOADGREENZONE:
+        {
+            /* Loading is not allowed if currently encoding */
+            if (context->config.sc.av_dumping) {
+                emit alertToShow(QString("Loading is not allowed when in the middle of video encoding"));
+                return false;
+            }
+
+            int message = Greenzone::load(context, *movie);
+
+            if (message == SaveState::ENOLOAD) {
+                if (!context->config.sc.opengl_soft) {
+                    emit alertToShow(QString("Crash after loading the savestate. Savestates are unstable unless you check Video>Force software rendering"));
+                }
+                return false;
+            }
+
+            if (message < 0) {
+                /* The greenzone state was removed since the rewind was
+                 * requested. Seeking from the current frame would never end,
+                 * so pause on the next frame instead */
+                if (context->seek_frame && (context->seek_frame <= context->framecount))
+                    context->seek_frame = context->framecount + 1;
+            }
+
+            return false;
+        }
+
         case HOTKEY_READWRITE:
             /* Switch between movie write and read-only */
             switch (context->config.sc.recording) {
@@ -84,9 +84,9 @@ static CGEventRef eventTapFunction(CGEventTapProxy proxy, CGEventType type, CGEv
         
         if (hk_type != -1) {
             if (type == kCGEventKeyDown)
-                context->hotkey_pressed_queue.push(hk_type);
+                context->pushHotkeyPressed(hk_type);
             else
-                context->hotkey_released_queue.push(hk_type);
+                context->pushHotkeyReleased(hk_type);
         }
     }
     if (type == kCGEventFlagsChanged) {
@@ -35,8 +35,11 @@
 #include "utils.h"
 #include "AutoSave.h"
 #include "SaveStateList.h"
+#include "Greenzone.h"
+#include "SearchPool.h"
 #include "lua/Input.h"
 #include "lua/Callbacks.h"
+#include "lua/Gui.h"
 #include "lua/NamedLuaFunction.h"
 #include "ramsearch/MemAccess.h"
 #include "ramsearch/BaseAddresses.h"
@@ -67,6 +70,15 @@ GameLoop::GameLoop(Context* c) : movie(MovieFile(c)), context(c)
 #elif defined(__APPLE__) && defined(__MACH__)
     gameEvents = new GameEventsQuartz(c, &movie);
 #endif
+
+    /* Invalidate greenzone states when inputs are modified. These can be
+     * emitted from the UI thread, so the connection must be direct */
+    connect(movie.changelog, &MovieFileChangeLog::inputsChanged, [](unsigned long long first_frame) {
+        Greenzone::invalidate(first_frame);
+    });
+    connect(movie.changelog, &MovieFileChangeLog::endResetHistory, []() {
+        Greenzone::validate();
+    });
 }
 
 void GameLoop::start()
@@ -97,6 +109,10 @@ void GameLoop::start()
 
         /* We are at a frame boundary */
         /* If we did not yet receive the game window id, just make the game running */
+        /* Remove invalidated greenzone states and save a new one if needed */
+        if (context->game_window)
+            Greenzone::update(context);
+
         bool endInnerLoop = false;
         if (context->game_window ) do {
 
@@ -147,7 +163,11 @@ void GameLoop::start()
             ((context->config.sc.recording != SharedConfig::NO_RECORDING) &&
             ((context->config.sc.movie_framecount + context->pause_frame) == (context->framecount + 1)))) {
 
-            if (!context->interactive) {
+            if (SearchPool::workerIndex() >= 0) {
+                /* Search workers keep running, because their lua script
+                 * drives the game */
+                context->pause_frame = 0;
+            } else if (!context->interactive) {
                 /* Quit at the end of the movie if non-interactive */
                 shouldQuit = true;
             } else {
@@ -214,7 +234,7 @@ void GameLoop::init()
     /* Remove the file socket */
     int err = removeSocket();
     if (err != 0)
-        emit alertToShow(QString("Could not remove socket file /tmp/libTAS.socket: %2").arg(strerror(err)));
+        emit alertToShow(QString("Could not remove socket file %1: %2").arg(socketPath()).arg(strerror(err)));
 
     /* Clear addresses of loaded files */
     BaseAddresses::clear();
@@ -222,6 +242,9 @@ void GameLoop::init()
     /* Init savestate list */
     SaveStateList::init(context);
 
+    /* Init greenzone states */
+    Greenzone::init(context, &movie);
+
     /* Compute the MD5 hash of the game binary */
     context->md5_game.clear();
     std::ostringstream cmd;
@@ -579,6 +602,23 @@ bool GameLoop::startFrameMessages()
             emit getTimeTrace(type, static_cast<unsigned long long>(hash), trace);
         }
         break;
+        case MSGB_GETTIME_COUNTS:
+        {
+            uint64_t frame;
+            receiveData(&frame, sizeof(uint64_t));
+            int n;
+            receiveData(&n, sizeof(int));
+            for (int i = 0; i < n; i++) {
+                int type;
+                receiveData(&type, sizeof(int));
+                uint64_t hash;
+                receiveData(&hash, sizeof(uint64_t));
+                unsigned int count;
+                receiveData(&count, sizeof(unsigned int));
+                emit getTimeTraceCount(static_cast<unsigned long long>(frame), type, static_cast<unsigned long long>(hash), count);
+            }
+        }
+        break;
         case MSGB_NONDRAW_FRAME:
             context->draw_frame = false;
             break;
@@ -633,6 +673,9 @@ bool GameLoop::startFrameMessages()
     if (context->draw_frame && !skip_draw_frame)
         Lua::Callbacks::call(Lua::NamedLuaFunction::CallbackPaint);
 
+    /* Send all lua drawings at once */
+    Lua::Gui::flush();
+
     sendMessage(MSGN_START_FRAMEBOUNDARY);
 
     return false;
@@ -95,6 +95,8 @@ signals:
     void getMarkerText(std::string &text);
 
     void getTimeTrace(int type, unsigned long long hash, std::string stacktrace);
+
+    void getTimeTraceCount(unsigned long long frame, int type, unsigned long long hash, unsigned int count);
 };
 
 #endif
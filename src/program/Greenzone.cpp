@@ -0,0 +1,287 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Greenzone.h"
+#include "SaveState.h"
+#include "SaveStateList.h"
+#include "Context.h"
+#include "movie/MovieFile.h"
+#include "../shared/SharedConfig.h"
+#include "../shared/messages.h"
+
+#include <mutex>
+#include <stdint.h>
+
+#define NB_STATES (SharedConfig::SS_SLOT_COUNT - SharedConfig::SS_SLOT_GREENZONE)
+
+/* Array of greenzone states. Only accessed by the main thread, except for
+ * reading the movie of a state that is registered in `state_frames` */
+static SaveState states[NB_STATES];
+
+/* Framecount of each available state, or 0. This is the array that other
+ * threads look at */
+static uint64_t state_frames[NB_STATES];
+
+/* States that were invalidated, and must be removed from the game */
+static bool state_invalid[NB_STATES];
+
+/* Earliest frame that was invalidated while saving a state */
+static uint64_t invalidated_frame;
+
+/* Frame that the input editor wants to rewind to */
+static uint64_t requested_frame;
+
+/* Movie that states are checked against */
+static const MovieFile* current_movie;
+
+static std::mutex greenzone_mutex;
+
+void Greenzone::init(Context* context, const MovieFile* movie)
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+    current_movie = movie;
+    for (int i = 0; i < NB_STATES; i++) {
+        states[i].init(context, SharedConfig::SS_SLOT_GREENZONE + i);
+        state_frames[i] = 0;
+        state_invalid[i] = false;
+    }
+    invalidated_frame = UINT64_MAX;
+    requested_frame = 0;
+}
+
+/* Choose a state to overwrite when all slots are used. Removing a state merges
+ * the two gaps around it, so we remove the state leaving the smallest gap
+ * relative to its distance to the current frame. This keeps a roughly
+ * logarithmic distribution of states behind the current frame.
+ * Must be called with the mutex locked. */
+static int thinnedSlot(uint64_t framecount)
+{
+    int best_slot = -1;
+    double best_score = 0;
+
+    for (int i = 0; i < NB_STATES; i++) {
+        uint64_t frame = state_frames[i];
+        if (!frame)
+            continue;
+
+        /* Find neighbour states */
+        uint64_t prev_frame = 0;
+        uint64_t next_frame = (framecount > frame) ? framecount : frame;
+        for (int j = 0; j < NB_STATES; j++) {
+            uint64_t other = state_frames[j];
+            if (!other)
+                continue;
+            if ((other < frame) && (other > prev_frame))
+                prev_frame = other;
+            if ((other > frame) && (other < next_frame))
+                next_frame = other;
+        }
+
+        uint64_t distance = (framecount > frame) ? (framecount - frame) : (frame - framecount);
+        double score = static_cast<double>(next_frame - prev_frame) / (distance + 1);
+
+        if ((best_slot == -1) || (score < best_score)) {
+            best_slot = i;
+            best_score = score;
+        }
+    }
+
+    return best_slot;
+}
+
+void Greenzone::update(Context* context)
+{
+    /* Remove invalidated states. This sends a message to the game, so it can
+     * only be done by the main thread */
+    bool to_remove[NB_STATES];
+    {
+        std::unique_lock<std::mutex> lock(greenzone_mutex);
+        for (int i = 0; i < NB_STATES; i++) {
+            to_remove[i] = state_invalid[i];
+            state_invalid[i] = false;
+        }
+    }
+
+    for (int i = 0; i < NB_STATES; i++) {
+        if (to_remove[i])
+            states[i].remove();
+    }
+
+    if (!context->config.editor_greenzone)
+        return;
+
+    if (context->config.sc.recording == SharedConfig::NO_RECORDING)
+        return;
+
+    /* Greenzone states are only stored in RAM, because removing a state
+     * stored on disk deletes pages that the next incremental state needs */
+    if (!(context->config.sc.savestate_settings & SharedConfig::SS_RAM))
+        return;
+
+    /* Saving is not allowed if currently encoding */
+    if (context->config.sc.av_dumping)
+        return;
+
+    int interval = context->config.editor_greenzone_interval;
+    if ((interval <= 0) || (context->framecount == 0) || (context->framecount % interval))
+        return;
+
+    int slot = -1;
+    {
+        std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+        /* Check if we already have a state for this frame */
+        for (int i = 0; i < NB_STATES; i++) {
+            if (state_frames[i] == context->framecount)
+                return;
+        }
+
+        for (int i = 0; i < NB_STATES; i++) {
+            if (!state_frames[i]) {
+                slot = i;
+                break;
+            }
+        }
+
+        if (slot == -1)
+            slot = thinnedSlot(context->framecount);
+
+        /* The state is not available until saving is done */
+        state_frames[slot] = 0;
+        state_invalid[slot] = false;
+        invalidated_frame = UINT64_MAX;
+    }
+
+    int message = states[slot].save(context, *current_movie);
+
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+    if ((message == MSGB_SAVING_SUCCEEDED) && (invalidated_frame >= context->framecount)) {
+        state_frames[slot] = context->framecount;
+    }
+    else {
+        /* Inputs were modified while saving, or saving failed */
+        state_invalid[slot] = true;
+    }
+}
+
+void Greenzone::invalidate(uint64_t framecount)
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+    for (int i = 0; i < NB_STATES; i++) {
+        if (state_frames[i] > framecount) {
+            state_frames[i] = 0;
+            state_invalid[i] = true;
+        }
+    }
+
+    if (framecount < invalidated_frame)
+        invalidated_frame = framecount;
+}
+
+void Greenzone::validate()
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+    if (!current_movie)
+        return;
+
+    for (int i = 0; i < NB_STATES; i++) {
+        if (state_frames[i] && !states[i].movie->isEqual(*current_movie, 0, state_frames[i])) {
+            state_frames[i] = 0;
+            state_invalid[i] = true;
+        }
+    }
+}
+
+uint64_t Greenzone::nearestFramecount(uint64_t framecount)
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+    uint64_t best_frame = 0;
+    for (int i = 0; i < NB_STATES; i++) {
+        if ((state_frames[i] <= framecount) && (state_frames[i] > best_frame))
+            best_frame = state_frames[i];
+    }
+    return best_frame;
+}
+
+uint64_t Greenzone::rootFramecount()
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+    uint64_t root_frame = 0;
+    for (int i = 0; i < NB_STATES; i++) {
+        if (state_frames[i] && (!root_frame || (state_frames[i] < root_frame)))
+            root_frame = state_frames[i];
+    }
+    return root_frame;
+}
+
+void Greenzone::requestLoad(uint64_t framecount)
+{
+    std::unique_lock<std::mutex> lock(greenzone_mutex);
+    requested_frame = framecount;
+}
+
+int Greenzone::load(Context* context, MovieFile& movie)
+{
+    int slot = -1;
+    {
+        std::unique_lock<std::mutex> lock(greenzone_mutex);
+
+        uint64_t best_frame = 0;
+        for (int i = 0; i < NB_STATES; i++) {
+            if ((state_frames[i] <= requested_frame) && (state_frames[i] > best_frame)) {
+                best_frame = state_frames[i];
+                slot = i;
+            }
+        }
+    }
+
+    if (slot == -1)
+        return SaveState::ENOSTATE;
+
+    SaveState& ss = states[slot];
+
+    /* States should already have been invalidated when inputs changed, but
+     * loading a state with different inputs would desync the movie */
+    if (!ss.movie->isEqual(movie, 0, ss.framecount)) {
+        std::unique_lock<std::mutex> lock(greenzone_mutex);
+        state_frames[slot] = 0;
+        state_invalid[slot] = true;
+        return SaveState::EINPUTMISMATCH;
+    }
+
+    /* Inputs were checked, so we pass the state itself as common relative */
+    int error = ss.load(context, movie, false, true, ss.id, ss.framecount);
+    if (error < 0)
+        return error;
+
+    int message = ss.postLoad(context, movie, false, true);
+
+    if (message == MSGB_LOADING_SUCCEEDED) {
+        /* Update the current state of user savestates, which is used to skip
+         * input checks */
+        SaveStateList::externalStateLoaded(context->framecount, &movie);
+    }
+
+    return message;
+}
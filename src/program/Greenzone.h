@@ -0,0 +1,65 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_GREENZONE_H_INCLUDED
+#define LIBTAS_GREENZONE_H_INCLUDED
+
+#include <stdint.h>
+
+/* Forward declaration */
+class MovieFile;
+struct Context;
+
+/* Greenzone states are savestates automatically performed every few frames
+ * when the input editor option is enabled, so that the input editor can
+ * rewind to any frame with a bounded number of frames to replay. When all
+ * slots are used, states are thinned out so that their density decreases
+ * with the distance to the current frame. */
+namespace Greenzone {
+
+    /* Init greenzone states, and set the movie they are checked against */
+    void init(Context* context, const MovieFile* movie);
+
+    /* Called by the main thread on each frame boundary. Remove invalidated
+     * states and save a new state if needed */
+    void update(Context* context);
+
+    /* Invalidate all states after a frame, because inputs were modified.
+     * Can be called from any thread */
+    void invalidate(uint64_t framecount);
+
+    /* Invalidate all states whose inputs are not a prefix of the movie */
+    void validate();
+
+    /* Returns the framecount of the nearest state before framecount, or 0 */
+    uint64_t nearestFramecount(uint64_t framecount);
+
+    /* Returns the framecount of the earliest state, or 0 */
+    uint64_t rootFramecount();
+
+    /* Set the frame to rewind to, before pushing the load hotkey */
+    void requestLoad(uint64_t framecount);
+
+    /* Load the nearest state before the requested frame. Returns the
+     * received message or error (<0) */
+    int load(Context* context, MovieFile& movie);
+
+}
+
+#endif
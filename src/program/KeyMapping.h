@@ -80,6 +80,7 @@ typedef int HotKeyType; enum
     HOTKEY_LOADBRANCH_BACKTRACK, // Obsolete
     HOTKEY_TOGGLE_FASTFORWARD, // Toggle fastforward
     HOTKEY_SCREENSHOT,
+    HOTKEY_LOADGREENZONE, // Load a greenzone state, only pushed by the input editor
     HOTKEY_LEN
 };
 
@@ -74,6 +74,13 @@ void SaveState::buildMessages()
     loaded_branch_msg += std::to_string(id);
     loaded_branch_msg += " loaded";
 
+    /* Greenzone states are not numbered for the user */
+    if (id >= SharedConfig::SS_SLOT_GREENZONE) {
+        loading_state_msg = "Loading greenzone state";
+        loaded_state_msg = "Greenzone state loaded";
+        return;
+    }
+
     loading_state_msg = "Loading state ";
     loading_state_msg += std::to_string(id);
 
@@ -283,3 +290,15 @@ void SaveState::backupMovie()
     if (framecount) // 0 means no state has been made
         movie->saveMovie(movie_path);
 }
+
+void SaveState::remove()
+{
+    sendMessage(MSGN_REMOVE_SAVESTATE);
+    sendData(&id, sizeof(int));
+
+    unlink(pagemap_path.c_str());
+    unlink(pages_path.c_str());
+
+    framecount = 0;
+    parent = -1;
+}
@@ -75,6 +75,9 @@ public:
     /* Save movie on disk when exiting */
     void backupMovie();
 
+    /* Remove the state from the game and delete its files */
+    void remove();
+
 private:
     /* Savestate path */
     std::string path;
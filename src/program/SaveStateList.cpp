@@ -141,6 +141,14 @@ int SaveStateList::postLoad(int id, Context* context, MovieFile& movie, bool bra
     return message;
 }
 
+void SaveStateList::externalStateLoaded(uint64_t framecount, const MovieFile* movie)
+{
+    old_root_framecount = rootStateFramecount();
+
+    /* The current state is now a descendant of the nearest state */
+    last_state_id = nearestState(framecount, movie);
+}
+
 int SaveStateList::stateAtFrame(uint64_t frame)
 {
     for (int i = 0; i < NB_STATES; i++) {
@@ -49,6 +49,10 @@ namespace SaveStateList {
     /* Process after loading state from its id and handle parent */
     int postLoad(int id, Context* context, MovieFile& movie, bool branch, bool inputEditor);
 
+    /* Update the current state after a state outside of this list was
+     * loaded, such as a greenzone state */
+    void externalStateLoaded(uint64_t framecount, const MovieFile* movie);
+
     /* Returns one state id that was performed on that specific frame, or -1 */
     int stateAtFrame(uint64_t frame);
 
@@ -0,0 +1,455 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchPool.h"
+#include "Context.h"
+#include "ConcurrentQueue.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#if defined(__APPLE__) && defined(__MACH__)
+#include <mach-o/dyld.h> // _NSGetExecutablePath
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+extern char **environ;
+
+namespace SearchPool {
+
+/* Header of each message exchanged with workers, followed by the data */
+struct FrameHeader {
+    int32_t job;
+    uint32_t size;
+};
+
+struct Worker {
+    int index;
+    pid_t pid;
+    int fd;
+    std::string tempmovie;
+    std::thread thread;
+    std::atomic<bool> alive;
+};
+
+struct Job {
+    int id;
+    std::string data;
+};
+
+static std::vector<std::unique_ptr<Worker>> workers;
+
+static std::deque<Job> jobs;
+static std::mutex jobs_mutex;
+static std::condition_variable jobs_cond;
+static std::atomic<bool> stopping(false);
+
+static ConcurrentQueue<Result> results(1024);
+static std::mutex results_mutex;
+static std::condition_variable results_cond;
+
+static std::atomic<int> pending(0);
+static int next_job = 1;
+
+/* Connection with the controller when running as a worker */
+static int worker_index = -1;
+static int controller_fd = -1;
+
+static bool sendAll(int fd, const void* buf, size_t size)
+{
+    const char* ptr = static_cast<const char*>(buf);
+    while (size > 0) {
+        ssize_t ret = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+static bool receiveAll(int fd, void* buf, size_t size)
+{
+    char* ptr = static_cast<char*>(buf);
+    while (size > 0) {
+        ssize_t ret = recv(fd, ptr, size, 0);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (ret == 0)
+            return false;
+        ptr += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+static bool sendFrame(int fd, int job, const std::string& data)
+{
+    FrameHeader header = {job, static_cast<uint32_t>(data.size())};
+    if (!sendAll(fd, &header, sizeof(FrameHeader)))
+        return false;
+    return sendAll(fd, data.data(), data.size());
+}
+
+static bool receiveFrame(int fd, int& job, std::string& data)
+{
+    FrameHeader header;
+    if (!receiveAll(fd, &header, sizeof(FrameHeader)))
+        return false;
+    job = header.job;
+    data.resize(header.size);
+    if (header.size == 0)
+        return true;
+    return receiveAll(fd, &data[0], header.size);
+}
+
+static void pushResult(const Result& result)
+{
+    /* Wait for the consumer if the queue is full */
+    while (!results.push(result)) {
+        if (stopping)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pending--;
+
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results_cond.notify_all();
+}
+
+/* Send jobs to a worker and collect its results, one job at a time */
+static void workerLoop(Worker* worker)
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_cond.wait(lock, []{ return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Result result;
+        result.job = job.id;
+        result.worker = worker->index;
+        result.success = sendFrame(worker->fd, job.id, job.data) &&
+                         receiveFrame(worker->fd, result.job, result.data);
+
+        if (!result.success) {
+            if (!stopping)
+                std::cerr << "Search worker " << worker->index << " stopped responding" << std::endl;
+            worker->alive = false;
+            result.job = job.id;
+            result.data.clear();
+            pushResult(result);
+            return;
+        }
+
+        pushResult(result);
+    }
+}
+
+static std::string executablePath()
+{
+    char buf[PATH_MAX];
+#ifdef __unix__
+    ssize_t count = readlink("/proc/self/exe", buf, PATH_MAX);
+    return std::string(buf, (count > 0) ? count : 0);
+#elif defined(__APPLE__) && defined(__MACH__)
+    uint32_t size = PATH_MAX;
+    if (_NSGetExecutablePath(buf, &size) == 0)
+        return std::string(buf);
+    return std::string();
+#endif
+}
+
+static pid_t spawnWorker(Context* context, int index, int fd, const std::string& exe,
+    const std::string& script, const std::string& moviefile, const std::string& tempmovie)
+{
+    /* Build arguments and environment before forking, because the child
+     * must only call async-signal-safe functions */
+    std::vector<std::string> args;
+    args.push_back(exe);
+    args.push_back("--non-interactive");
+    args.push_back("--lua");
+    args.push_back(script);
+    if (moviefile.empty()) {
+        args.push_back("--write");
+        args.push_back(tempmovie);
+    }
+    else {
+        args.push_back("--read");
+        args.push_back(moviefile);
+    }
+    args.push_back(context->gamepath);
+    if (!context->config.gameargs.empty())
+        args.push_back(context->config.gameargs);
+
+    std::vector<std::string> envs;
+    for (char** env = environ; *env; env++) {
+        if (strncmp(*env, "LIBTAS_SOCKET_PATH=", 19) &&
+            strncmp(*env, "LIBTAS_SEARCH_", 14) &&
+            strncmp(*env, "QT_QPA_PLATFORM=", 16))
+            envs.push_back(*env);
+    }
+    envs.push_back(std::string("LIBTAS_SOCKET_PATH=/tmp/libTAS-") + std::to_string(getpid()) + "-" + std::to_string(index) + ".socket");
+    envs.push_back(std::string("LIBTAS_SEARCH_WORKER=") + std::to_string(index));
+    envs.push_back(std::string("LIBTAS_SEARCH_FD=") + std::to_string(fd));
+    /* Workers don't need to show their user interface */
+    envs.push_back("QT_QPA_PLATFORM=offscreen");
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    std::vector<char*> envp;
+    for (auto& env : envs)
+        envp.push_back(const_cast<char*>(env.c_str()));
+    envp.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* Own process group, so that the worker and its game can be
+         * terminated together */
+        setpgid(0, 0);
+
+        /* Keep the connection with the controller across exec */
+        fcntl(fd, F_SETFD, 0);
+
+        execve(exe.c_str(), argv.data(), envp.data());
+        _exit(1);
+    }
+
+    /* Also set the process group from the parent, so that it exists when
+     * stopping the worker even if the child was not scheduled yet. This
+     * fails harmlessly if the child already called exec. */
+    if (pid > 0)
+        setpgid(pid, pid);
+
+    return pid;
+}
+
+int start(Context* context, int count, const std::string& script, const std::string& moviefile)
+{
+    if (!workers.empty()) {
+        std::cerr << "Search workers are already running" << std::endl;
+        return 0;
+    }
+
+    std::string exe = executablePath();
+    if (exe.empty()) {
+        std::cerr << "Could not get path of libTAS executable" << std::endl;
+        return 0;
+    }
+
+    stopping = false;
+
+    for (int i = 0; i < count; i++) {
+        int fds[2];
+#ifdef SOCK_CLOEXEC
+        int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+#else
+        int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        if (ret == 0) {
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        }
+#endif
+        if (ret < 0) {
+            std::cerr << "Could not create search worker connection: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        std::string tempmovie;
+        if (moviefile.empty())
+            tempmovie = std::string("/tmp/libTAS-search-") + std::to_string(getpid()) + "-" + std::to_string(i) + ".ltm";
+
+        pid_t pid = spawnWorker(context, i, fds[1], exe, script, moviefile, tempmovie);
+        close(fds[1]);
+
+        if (pid < 0) {
+            std::cerr << "Could not spawn search worker: " << strerror(errno) << std::endl;
+            close(fds[0]);
+            break;
+        }
+
+        std::unique_ptr<Worker> worker(new Worker);
+        worker->index = i;
+        worker->pid = pid;
+        worker->fd = fds[0];
+        worker->tempmovie = tempmovie;
+        worker->alive = true;
+        worker->thread = std::thread(workerLoop, worker.get());
+        workers.push_back(std::move(worker));
+    }
+
+    return workers.size();
+}
+
+void stop()
+{
+    if (workers.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobs_cond.notify_all();
+
+    for (auto& worker : workers) {
+        /* Unblock the thread if it is waiting for a result */
+        shutdown(worker->fd, SHUT_RDWR);
+        worker->thread.join();
+        close(worker->fd);
+
+        /* Signal the worker alone if its process group does not exist */
+        if (kill(-worker->pid, SIGTERM) < 0)
+            kill(worker->pid, SIGTERM);
+        waitpid(worker->pid, nullptr, 0);
+
+        if (!worker->tempmovie.empty())
+            unlink(worker->tempmovie.c_str());
+    }
+    workers.clear();
+
+    Result result;
+    while (results.pop(result)) {}
+    pending = 0;
+}
+
+int submit(const std::string& data)
+{
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        id = next_job++;
+        jobs.push_back({id, data});
+    }
+    pending++;
+    jobs_cond.notify_one();
+    return id;
+}
+
+bool poll(Result& result)
+{
+    return results.pop(result);
+}
+
+bool wait(Result& result, int timeout_ms)
+{
+    if (results.pop(result))
+        return true;
+
+    /* `pending` is decremented after the result is pushed, so no result can
+     * arrive once it reaches zero */
+    std::unique_lock<std::mutex> lock(results_mutex);
+    auto ready = []{ return !results.empty() || (pending == 0) || (workerCount() == 0); };
+    if (timeout_ms < 0)
+        results_cond.wait(lock, ready);
+    else
+        results_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+
+    return results.pop(result);
+}
+
+int workerCount()
+{
+    int count = 0;
+    for (auto& worker : workers)
+        if (worker->alive)
+            count++;
+    return count;
+}
+
+int pendingCount()
+{
+    return pending;
+}
+
+int initWorker()
+{
+    const char* index_str = getenv("LIBTAS_SEARCH_WORKER");
+    const char* fd_str = getenv("LIBTAS_SEARCH_FD");
+    if (!index_str || !fd_str)
+        return -1;
+
+    worker_index = atoi(index_str);
+    controller_fd = atoi(fd_str);
+
+    /* Don't pass the connection to the game */
+    fcntl(controller_fd, F_SETFD, FD_CLOEXEC);
+    unsetenv("LIBTAS_SEARCH_WORKER");
+    unsetenv("LIBTAS_SEARCH_FD");
+
+    return worker_index;
+}
+
+int workerIndex()
+{
+    return worker_index;
+}
+
+bool nextJob(int& job, std::string& data)
+{
+    if (controller_fd < 0)
+        return false;
+
+    return receiveFrame(controller_fd, job, data);
+}
+
+bool reply(int job, const std::string& data)
+{
+    if (controller_fd < 0)
+        return false;
+
+    return sendFrame(controller_fd, job, data);
+}
+
+}
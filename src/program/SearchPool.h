@@ -0,0 +1,81 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_SEARCHPOOL_H_INCLUDED
+#define LIBTAS_SEARCHPOOL_H_INCLUDED
+
+#include <string>
+
+/* Forward declaration */
+struct Context;
+
+/* Pool of libTAS instances running the same game, used by lua scripts to
+ * evaluate candidate input sequences in parallel. Each worker is a
+ * non-interactive libTAS process that runs a worker lua script, and has its
+ * own game socket and savestate directory. The controller sends jobs as
+ * opaque strings, and each job is answered by exactly one result. */
+namespace SearchPool {
+
+    struct Result {
+        int job;
+        int worker;
+        bool success; // false if the worker died while processing the job
+        std::string data;
+    };
+
+    /* Spawn `count` workers running lua file `script`. If `moviefile` is
+     * not empty, workers play it back, otherwise they record into a
+     * temporary movie. Returns the number of started workers */
+    int start(Context* context, int count, const std::string& script, const std::string& moviefile);
+
+    /* Terminate all workers and drop pending jobs and results */
+    void stop();
+
+    /* Queue a job, returns its id */
+    int submit(const std::string& data);
+
+    /* Get the next result if there is one */
+    bool poll(Result& result);
+
+    /* Wait for the next result, up to `timeout_ms` milliseconds (or forever
+     * if negative). Returns false right away if no job is pending */
+    bool wait(Result& result, int timeout_ms);
+
+    /* Number of workers still running */
+    int workerCount();
+
+    /* Number of submitted jobs without a result yet */
+    int pendingCount();
+
+    /* Check if this libTAS instance was spawned as a worker, and setup the
+     * connection with the controller. Returns the worker index or -1 */
+    int initWorker();
+
+    /* Return the worker index, or -1 if not a worker */
+    int workerIndex();
+
+    /* Wait for the next job sent by the controller. Returns false if the
+     * controller closed the connection */
+    bool nextJob(int& job, std::string& data);
+
+    /* Send the result of a job to the controller */
+    bool reply(int job, const std::string& data);
+}
+
+#endif
@@ -25,10 +25,7 @@
 #include "Context.h"
 
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 namespace Lua {
 
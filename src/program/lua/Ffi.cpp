@@ -0,0 +1,175 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Ffi.h"
+#include "Input.h"
+
+#include "../shared/inputs/SingleInput.h"
+
+#include "ramsearch/MemAccess.h"
+
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include "LuaCompat.h"
+
+#ifdef LIBTAS_HAS_LUAJIT
+
+/* Functions called from lua code through FFI. They only take and return
+ * plain C types so that the JIT can call them directly. */
+extern "C" {
+
+static int ffi_memory_read(uintptr_t addr, void* value, size_t size)
+{
+    return MemAccess::read(value, reinterpret_cast<void*>(addr), size) == size;
+}
+
+static void ffi_memory_write(uintptr_t addr, const void* value, size_t size)
+{
+    MemAccess::write(const_cast<void*>(value), reinterpret_cast<void*>(addr), size);
+}
+
+static int ffi_input_get(int type, unsigned int which)
+{
+    return Lua::Input::getInput(type, which);
+}
+
+static void ffi_input_set(int type, unsigned int which, int value)
+{
+    Lua::Input::setInput(type, which, value);
+}
+
+}
+
+/* Lua code that builds the FFI functions from the pointers above, and
+ * replaces the matching functions in the `memory` and `input` tables. 64-bit
+ * integer reads are kept on the C API, because FFI would return them as
+ * cdata instead of numbers. */
+static const char ffi_bindings[] = R"(
+local ptrs, types = ...
+local ffi = require("ffi")
+
+ffi.cdef[[
+typedef int (*libtas_memory_read_t)(uintptr_t addr, void* value, size_t size);
+typedef void (*libtas_memory_write_t)(uintptr_t addr, const void* value, size_t size);
+typedef int (*libtas_input_get_t)(int type, unsigned int which);
+typedef void (*libtas_input_set_t)(int type, unsigned int which, int value);
+typedef union {
+    uint8_t u8; uint16_t u16; uint32_t u32;
+    int8_t s8; int16_t s16; int32_t s32; int64_t s64;
+    float f; double d;
+} libtas_scalar_t;
+]]
+
+local mread = ffi.cast("libtas_memory_read_t", ptrs.memory_read)
+local mwrite = ffi.cast("libtas_memory_write_t", ptrs.memory_write)
+local iget = ffi.cast("libtas_input_get_t", ptrs.input_get)
+local iset = ffi.cast("libtas_input_set_t", ptrs.input_set)
+local scalar = ffi.new("libtas_scalar_t")
+
+local function reader(field, size)
+    return function(addr)
+        if mread(addr, scalar, size) ~= 0 then
+            return scalar[field]
+        end
+        return 0
+    end
+end
+
+memory.readu8 = reader("u8", 1)
+memory.readu16 = reader("u16", 2)
+memory.readu32 = reader("u32", 4)
+memory.reads8 = reader("s8", 1)
+memory.reads16 = reader("s16", 2)
+memory.reads32 = reader("s32", 4)
+memory.readf = reader("f", 4)
+memory.readd = reader("d", 8)
+
+local function intwriter(size)
+    return function(addr, value)
+        scalar.s64 = value
+        mwrite(addr, scalar, size)
+    end
+end
+
+memory.write8 = intwriter(1)
+memory.write16 = intwriter(2)
+memory.write32 = intwriter(4)
+memory.writef = function(addr, value) scalar.f = value; mwrite(addr, scalar, 4) end
+memory.writed = function(addr, value) scalar.d = value; mwrite(addr, scalar, 8) end
+
+local KEYBOARD, BUTTON, FLAG, CONTROLLER_BUTTON, CONTROLLER_AXIS =
+    types.keyboard, types.button, types.flag, types.controller_button, types.controller_axis
+
+input.getKey = function(key) return iget(KEYBOARD, key) end
+input.setKey = function(key, state) iset(KEYBOARD, key, state) end
+input.getMouseButtons = function(button) return iget(BUTTON, button) end
+input.setMouseButtons = function(button, state) iset(BUTTON, button, state) end
+input.getFlag = function(flag) return iget(FLAG, flag) end
+input.setFlag = function(flag, state) iset(FLAG, flag, state) end
+input.getControllerButton = function(c, button) return iget(2*(c-1)+CONTROLLER_BUTTON, button) end
+input.setControllerButton = function(c, button, state) iset(2*(c-1)+CONTROLLER_BUTTON, button, state) end
+input.getControllerAxis = function(c, axis) return iget(2*(c-1)+CONTROLLER_AXIS, axis) end
+input.setControllerAxis = function(c, axis, value) iset(2*(c-1)+CONTROLLER_AXIS, axis, value) end
+)";
+
+static void setPointer(lua_State *L, const char* name, void* ptr)
+{
+    lua_pushlightuserdata(L, ptr);
+    lua_setfield(L, -2, name);
+}
+
+static void setInteger(lua_State *L, const char* name, int value)
+{
+    lua_pushinteger(L, value);
+    lua_setfield(L, -2, name);
+}
+
+void Lua::Ffi::registerFunctions(lua_State *L)
+{
+    if (luaL_loadbuffer(L, ffi_bindings, sizeof(ffi_bindings) - 1, "=ffi_bindings") != 0) {
+        std::cerr << "Could not load FFI bindings: " << lua_tostring(L, -1) << std::endl;
+        lua_pop(L, 1);
+        return;
+    }
+
+    lua_newtable(L);
+    setPointer(L, "memory_read", reinterpret_cast<void*>(ffi_memory_read));
+    setPointer(L, "memory_write", reinterpret_cast<void*>(ffi_memory_write));
+    setPointer(L, "input_get", reinterpret_cast<void*>(ffi_input_get));
+    setPointer(L, "input_set", reinterpret_cast<void*>(ffi_input_set));
+
+    lua_newtable(L);
+    setInteger(L, "keyboard", SingleInput::IT_KEYBOARD);
+    setInteger(L, "button", SingleInput::IT_POINTER_BUTTON);
+    setInteger(L, "flag", SingleInput::IT_FLAG);
+    setInteger(L, "controller_button", SingleInput::IT_CONTROLLER1_BUTTON);
+    setInteger(L, "controller_axis", SingleInput::IT_CONTROLLER1_AXIS);
+
+    if (lua_pcall(L, 2, 0, 0) != 0) {
+        std::cerr << "Could not register FFI bindings: " << lua_tostring(L, -1) << std::endl;
+        lua_pop(L, 1);
+    }
+}
+
+#else
+
+void Lua::Ffi::registerFunctions(lua_State *L) {}
+
+#endif
@@ -21,13 +21,13 @@
 
 #include "../shared/sockethelpers.h"
 #include "../shared/messages.h"
+#include "../shared/LuaDrawCommands.h"
 
 #include <iostream>
 #include <string>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include <vector>
+#include <cstring>
+#include "LuaCompat.h"
 
 /* List of functions to register */
 static const luaL_Reg gui_functions[] =
@@ -43,6 +43,40 @@ static const luaL_Reg gui_functions[] =
     { NULL, NULL }
 };
 
+/* Draw commands of the current frame, sent all at once by flush() */
+static std::vector<uint8_t> drawlist;
+
+static void pushCommand(LuaDrawCommand command)
+{
+    drawlist.push_back(static_cast<uint8_t>(command));
+}
+
+static void pushData(const void* elem, size_t size)
+{
+    size_t offset = drawlist.size();
+    drawlist.resize(offset + size);
+    memcpy(&drawlist[offset], elem, size);
+}
+
+static void pushString(const std::string& str)
+{
+    uint32_t len = str.size();
+    pushData(&len, sizeof(uint32_t));
+    pushData(str.data(), len);
+}
+
+void Lua::Gui::flush()
+{
+    if (drawlist.empty())
+        return;
+
+    uint32_t size = drawlist.size();
+    sendMessage(MSGN_LUA_DRAWLIST);
+    sendData(&size, sizeof(uint32_t));
+    sendData(drawlist.data(), size);
+    drawlist.clear();
+}
+
 void Lua::Gui::registerFunctions(lua_State *L)
 {
     luaL_newlib(L, gui_functions);
@@ -77,17 +111,17 @@ int Lua::Gui::text(lua_State *L)
     float anchor_x = luaL_optnumber(L, 5, 0.0f);
     float anchor_y = luaL_optnumber(L, 6, 0.0f);
     float font_size = static_cast<float>(luaL_optnumber(L, 7, 16.0f));
-    bool monospace = static_cast<bool>(luaL_optinteger(L, 8, 0));
+    uint8_t monospace = static_cast<bool>(luaL_optinteger(L, 8, 0));
     
-    sendMessage(MSGN_LUA_TEXT);
-    sendData(&x, sizeof(float));
-    sendData(&y, sizeof(float));
-    sendString(text);
-    sendData(&color, sizeof(uint32_t));
-    sendData(&anchor_x, sizeof(float));
-    sendData(&anchor_y, sizeof(float));
-    sendData(&font_size, sizeof(float));
-    sendData(&monospace, sizeof(bool));
+    pushCommand(LUA_DRAW_TEXT);
+    pushData(&x, sizeof(float));
+    pushData(&y, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
+    pushData(&anchor_x, sizeof(float));
+    pushData(&anchor_y, sizeof(float));
+    pushData(&font_size, sizeof(float));
+    pushData(&monospace, sizeof(uint8_t));
+    pushString(text);
     
     return 0;
 }
@@ -99,11 +133,11 @@ int Lua::Gui::window(lua_State *L)
     std::string id = luaL_checklstring(L, 3, nullptr);
     std::string text = luaL_checklstring(L, 4, nullptr);
     
-    sendMessage(MSGN_LUA_WINDOW);
-    sendData(&x, sizeof(float));
-    sendData(&y, sizeof(float));
-    sendString(id);
-    sendString(text);
+    pushCommand(LUA_DRAW_WINDOW);
+    pushData(&x, sizeof(float));
+    pushData(&y, sizeof(float));
+    pushString(id);
+    pushString(text);
     
     return 0;
 }
@@ -114,10 +148,10 @@ int Lua::Gui::pixel(lua_State *L)
     float y = lua_tonumber(L, 2);
     uint32_t color = luaL_optnumber (L, 3, 0xffffffff);
     
-    sendMessage(MSGN_LUA_PIXEL);
-    sendData(&x, sizeof(float));
-    sendData(&y, sizeof(float));
-    sendData(&color, sizeof(uint32_t));
+    pushCommand(LUA_DRAW_PIXEL);
+    pushData(&x, sizeof(float));
+    pushData(&y, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
     
     return 0;
 }
@@ -130,16 +164,16 @@ int Lua::Gui::rectangle(lua_State *L)
     float h = lua_tonumber(L, 4);
     float thickness = luaL_optnumber (L, 5, 1);
     uint32_t color = luaL_optnumber (L, 6, 0xffffffff);
-    int filled = luaL_optnumber (L, 7, 0);
+    uint8_t filled = luaL_optnumber (L, 7, 0) != 0;
     
-    sendMessage(MSGN_LUA_RECT);
-    sendData(&x, sizeof(float));
-    sendData(&y, sizeof(float));
-    sendData(&w, sizeof(float));
-    sendData(&h, sizeof(float));
-    sendData(&thickness, sizeof(float));
-    sendData(&color, sizeof(uint32_t));
-    sendData(&filled, sizeof(int));
+    pushCommand(LUA_DRAW_RECT);
+    pushData(&x, sizeof(float));
+    pushData(&y, sizeof(float));
+    pushData(&w, sizeof(float));
+    pushData(&h, sizeof(float));
+    pushData(&thickness, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
+    pushData(&filled, sizeof(uint8_t));
     
     return 0;
 }
@@ -152,12 +186,12 @@ int Lua::Gui::line(lua_State *L)
     float y1 = lua_tonumber(L, 4);
     uint32_t color = luaL_optnumber (L, 5, 0xffffffff);
     
-    sendMessage(MSGN_LUA_LINE);
-    sendData(&x0, sizeof(float));
-    sendData(&y0, sizeof(float));
-    sendData(&x1, sizeof(float));
-    sendData(&y1, sizeof(float));
-    sendData(&color, sizeof(uint32_t));
+    pushCommand(LUA_DRAW_LINE);
+    pushData(&x0, sizeof(float));
+    pushData(&y0, sizeof(float));
+    pushData(&x1, sizeof(float));
+    pushData(&y1, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
     
     return 0;
 }
@@ -174,20 +208,20 @@ int Lua::Gui::quad(lua_State *L)
     float y3 = lua_tonumber(L, 8);
     float thickness = luaL_optnumber (L, 9, 1);
     uint32_t color = luaL_optnumber (L, 10, 0xffffffff);
-    int filled = luaL_optnumber (L, 11, 0);
+    uint8_t filled = luaL_optnumber (L, 11, 0) != 0;
     
-    sendMessage(MSGN_LUA_QUAD);
-    sendData(&x0, sizeof(float));
-    sendData(&y0, sizeof(float));
-    sendData(&x1, sizeof(float));
-    sendData(&y1, sizeof(float));
-    sendData(&x2, sizeof(float));
-    sendData(&y2, sizeof(float));
-    sendData(&x3, sizeof(float));
-    sendData(&y3, sizeof(float));
-    sendData(&thickness, sizeof(float));
-    sendData(&color, sizeof(uint32_t));
-    sendData(&filled, sizeof(int));
+    pushCommand(LUA_DRAW_QUAD);
+    pushData(&x0, sizeof(float));
+    pushData(&y0, sizeof(float));
+    pushData(&x1, sizeof(float));
+    pushData(&y1, sizeof(float));
+    pushData(&x2, sizeof(float));
+    pushData(&y2, sizeof(float));
+    pushData(&x3, sizeof(float));
+    pushData(&y3, sizeof(float));
+    pushData(&thickness, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
+    pushData(&filled, sizeof(uint8_t));
     
     return 0;
 }
@@ -200,16 +234,16 @@ int Lua::Gui::ellipse(lua_State *L)
     float radius_y = lua_tonumber(L, 4);
     float thickness = luaL_optnumber (L, 5, 1);
     uint32_t color = luaL_optnumber (L, 6, 0xffffffff);
-    int filled = luaL_optnumber (L, 7, 0);
+    uint8_t filled = luaL_optnumber (L, 7, 0) != 0;
     
-    sendMessage(MSGN_LUA_ELLIPSE);
-    sendData(&center_x, sizeof(float));
-    sendData(&center_y, sizeof(float));
-    sendData(&radius_x, sizeof(float));
-    sendData(&radius_y, sizeof(float));
-    sendData(&thickness, sizeof(float));
-    sendData(&color, sizeof(uint32_t));
-    sendData(&filled, sizeof(int));
+    pushCommand(LUA_DRAW_ELLIPSE);
+    pushData(&center_x, sizeof(float));
+    pushData(&center_y, sizeof(float));
+    pushData(&radius_x, sizeof(float));
+    pushData(&radius_y, sizeof(float));
+    pushData(&thickness, sizeof(float));
+    pushData(&color, sizeof(uint32_t));
+    pushData(&filled, sizeof(uint8_t));
     
     return 0;
 }
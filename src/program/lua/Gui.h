@@ -32,6 +32,9 @@ namespace Gui {
     /* Register all functions */
     void registerFunctions(lua_State *L);
 
+    /* Send all draw commands of the frame to the game */
+    void flush();
+
     /* Get the window resolution */
     int resolution(lua_State *L);
 
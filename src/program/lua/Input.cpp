@@ -23,10 +23,7 @@
 #include "../shared/inputs/AllInputs.h"
 
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 static AllInputs* ai;
 
@@ -64,6 +61,18 @@ void Lua::Input::registerInputs(AllInputs* frame_ai)
     ai = frame_ai;
 }
 
+int Lua::Input::getInput(int type, unsigned int which)
+{
+    SingleInput si = {type, which, ""};
+    return ai->getInput(si);
+}
+
+void Lua::Input::setInput(int type, unsigned int which, int value)
+{
+    SingleInput si = {type, which, ""};
+    ai->setInput(si, value);
+}
+
 int Lua::Input::clear(lua_State *L)
 {
     ai->clear();
@@ -36,6 +36,10 @@ namespace Input {
     /* Pass the current AllInputs object to be used by lua functions */
     void registerInputs(AllInputs* ai);
 
+    /* Helper functions for getting and setting a single input */
+    int getInput(int type, unsigned int which);
+    void setInput(int type, unsigned int which, int value);
+
     /* Clear the input state */
     int clear(lua_State *L);
 
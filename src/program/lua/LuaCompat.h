@@ -0,0 +1,59 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LUACOMPAT_H_INCLUDED
+#define LIBTAS_LUACOMPAT_H_INCLUDED
+
+#include "config.h"
+
+#include <stddef.h>
+extern "C" {
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#ifdef LIBTAS_HAS_LUAJIT
+#include <luajit.h>
+#endif
+}
+
+#ifdef LIBTAS_HAS_LUAJIT
+/* LuaJIT implements the Lua 5.1 API. Define the few functions from later
+ * versions that we use. */
+
+#ifndef luaL_newlib
+#define luaL_newlib(L, l) (lua_newtable(L), luaL_register(L, NULL, l))
+#endif
+
+#ifndef lua_rawlen
+#define lua_rawlen(L, i) lua_objlen(L, (i))
+#endif
+
+/* Convert any value to a string using `tostring`, and push it */
+static inline const char* luaL_tolstring(lua_State *L, int idx, size_t *len)
+{
+    if ((idx < 0) && (idx > LUA_REGISTRYINDEX))
+        idx = lua_gettop(L) + idx + 1;
+    lua_getglobal(L, "tostring");
+    lua_pushvalue(L, idx);
+    lua_call(L, 1, 1);
+    return lua_tolstring(L, -1, len);
+}
+#endif
+
+#endif
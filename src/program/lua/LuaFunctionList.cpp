@@ -19,17 +19,20 @@
 
 #include "LuaFunctionList.h"
 #include "Main.h"
+#include "Search.h"
 
 #include "utils.h"
 
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <unistd.h>
 #include <sys/inotify.h>
 #include <cerrno>
 
 namespace Lua {
 
-LuaFunctionList::LuaFunctionList() {
+LuaFunctionList::LuaFunctionList() : profile_reset(false) {
     inotifyfd = inotify_init1(IN_NONBLOCK);
     if (inotifyfd < 0)
         std::cerr << "inotify_init() failed with error " << errno << std::endl;
@@ -77,10 +80,14 @@ void LuaFunctionList::removeForFile(int row)
     functions.remove_if([&file](const NamedLuaFunction& nlf){ return 0 == file.compare(nlf.file); });
 
     inotify_rm_watch(inotifyfd, fileList[row].wd);
-    if (fileList[row].lua_state)
+    if (fileList[row].lua_state) {
+        Search::stopForState(fileList[row].lua_state);
         lua_close(fileList[row].lua_state);
+    }
     fileSet.erase(file);
     fileList.erase(fileList.begin() + row);
+
+    updateProfile();
 }
 
 void LuaFunctionList::watchChanges()
@@ -102,10 +109,14 @@ void LuaFunctionList::watchChanges()
                     functions.remove_if([&file](const NamedLuaFunction& nlf){ return 0 == file.compare(nlf.file); });
 
                     /* Create a new lua state */
-                    if (lf.lua_state)
+                    if (lf.lua_state) {
+                        Search::stopForState(lf.lua_state);
                         lua_close(lf.lua_state);
+                    }
                     lf.lua_state = Main::new_state();
                     Main::run(lf.lua_state, file);
+
+                    updateProfile();
                 }
                 return;
             }
@@ -131,6 +142,11 @@ void LuaFunctionList::switchForFile(int row, bool active)
 
 bool LuaFunctionList::call(NamedLuaFunction::CallbackType c)
 {
+    if (profile_reset.exchange(false)) {
+        for (auto& nlf : functions)
+            nlf.resetProfile();
+    }
+
     bool wasCalled = false;
     for (auto& nlf : functions) {
         if (nlf.active && nlf.type == c) {
@@ -138,6 +154,10 @@ bool LuaFunctionList::call(NamedLuaFunction::CallbackType c)
             wasCalled = true;
         }
     }
+
+    if (wasCalled)
+        updateProfile();
+
     return wasCalled;
 }
 
@@ -146,11 +166,77 @@ int LuaFunctionList::fileCount() const
     return fileSet.size();
 }
 
+void LuaFunctionList::updateProfile()
+{
+    std::lock_guard<std::mutex> lock(profile_mutex);
+
+    /* Reuse the entries, so that nothing is allocated on each frame */
+    profiles.resize(functions.size());
+    size_t i = 0;
+    for (const auto& nlf : functions) {
+        FunctionProfile& fp = profiles[i++];
+        fp.file = nlf.file;
+        fp.type = nlf.type;
+        fp.calls = nlf.calls;
+        fp.total_us = nlf.total_us;
+        fp.max_us = nlf.max_us;
+    }
+}
+
+void LuaFunctionList::fileProfile(int row, uint64_t& calls, uint64_t& total_us, uint64_t& max_us) const
+{
+    calls = 0;
+    total_us = 0;
+    max_us = 0;
+
+    const std::string& file = fileList[row].file;
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (const auto& fp : profiles) {
+        if (0 == file.compare(fp.file)) {
+            calls += fp.calls;
+            total_us += fp.total_us;
+            if (fp.max_us > max_us)
+                max_us = fp.max_us;
+        }
+    }
+}
+
+std::string LuaFunctionList::profileReport() const
+{
+    static const char* typeNames[] = {"onStartup", "onInput", "onFrame", "onPaint"};
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (const auto& fp : profiles) {
+        oss << fileFromPath(fp.file) << " " << typeNames[fp.type] << ": ";
+        oss << fp.calls << " calls, " << (fp.total_us / 1000.0) << " ms total, ";
+        oss << (fp.calls ? (static_cast<double>(fp.total_us) / fp.calls) : 0.0) << " us avg, ";
+        oss << fp.max_us << " us max" << std::endl;
+    }
+    return oss.str();
+}
+
+void LuaFunctionList::resetProfile()
+{
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (auto& fp : profiles) {
+        fp.calls = 0;
+        fp.total_us = 0;
+        fp.max_us = 0;
+    }
+    profile_reset = true;
+}
+
 void LuaFunctionList::clear()
 {
     functions.clear();
     fileList.clear();
     fileSet.clear();
+
+    updateProfile();
 }
 
 }
@@ -29,6 +29,8 @@ extern "C" {
 #include <vector>
 #include <set>
 #include <string>
+#include <mutex>
+#include <atomic>
 
 namespace Lua {
 
@@ -70,6 +72,18 @@ public:
     
     /* Returns the number of registered lua files */
     int fileCount() const;
+
+    /* Sum the timing counters of all callbacks from a file. Can be called
+     * from any thread */
+    void fileProfile(int row, uint64_t& calls, uint64_t& total_us, uint64_t& max_us) const;
+
+    /* Returns a text report of the timing counters of each callback. Can be
+     * called from any thread */
+    std::string profileReport() const;
+
+    /* Reset the timing counters of all callbacks. Can be called from any
+     * thread, counters are reset before the next callbacks are called */
+    void resetProfile();
     
     /* Clear all callbacks */
     void clear();
@@ -81,6 +95,26 @@ private:
     std::list<NamedLuaFunction> functions;
     int inotifyfd;
 
+    /* Copy of the timing counters of a callback */
+    struct FunctionProfile {
+        std::string file;
+        NamedLuaFunction::CallbackType type;
+        uint64_t calls;
+        uint64_t total_us;
+        uint64_t max_us;
+    };
+
+    /* Timing counters copied by the thread running callbacks, because other
+     * threads cannot iterate the callback list while it is modified */
+    std::vector<FunctionProfile> profiles;
+    mutable std::mutex profile_mutex;
+
+    /* Counters must be reset before calling callbacks */
+    std::atomic<bool> profile_reset;
+
+    /* Copy the timing counters of all callbacks */
+    void updateProfile();
+
 };
 }
 
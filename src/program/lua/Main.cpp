@@ -26,13 +26,12 @@
 #include "Print.h"
 #include "Runtime.h"
 #include "Callbacks.h"
+#include "Search.h"
+#include "Ffi.h"
+#include "SearchPool.h"
 
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 /* Lua state */
 // static lua_State *lua_state = nullptr;
@@ -56,12 +55,17 @@ lua_State* Lua::Main::new_state()
     Lua::Callbacks::registerFunctions(lua_state);
     Lua::Print::init(lua_state);
     Lua::Runtime::registerFunctions(lua_state, context);
+    Lua::Search::registerFunctions(lua_state, context);
+
+    /* Must be called after registering the memory and input functions */
+    Lua::Ffi::registerFunctions(lua_state);
     
     return lua_state;
 }
 
 void Lua::Main::exit()
 {
+    SearchPool::stop();
     Lua::Callbacks::clear();
 }
 
@@ -23,10 +23,14 @@
 #include "ramsearch/BaseAddresses.h"
 
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include "LuaCompat.h"
+
+/* Maximum number of bytes read at once by block and struct readers */
+static const lua_Integer MAX_READ_SIZE = 64 * 1024 * 1024;
 
 /* List of functions to register */
 static const luaL_Reg memory_functions[] =
@@ -42,6 +46,9 @@ static const luaL_Reg memory_functions[] =
     { "readf", Lua::Memory::readf},
     { "readd", Lua::Memory::readd},
     { "readcstring", Lua::Memory::readcstring},
+    { "readBlock", Lua::Memory::readBlock},
+    { "readMulti", Lua::Memory::readMulti},
+    { "readStructs", Lua::Memory::readStructs},
     { "write8", Lua::Memory::write8},
     { "write16", Lua::Memory::write16},
     { "write32", Lua::Memory::write32},
@@ -58,7 +65,7 @@ void Lua::Memory::registerFunctions(lua_State *L)
     lua_setglobal(L, "memory");
 }
 
-bool Lua::Memory::read(uintptr_t addr, void* return_value, int size)
+bool Lua::Memory::read(uintptr_t addr, void* return_value, size_t size)
 {
     return MemAccess::read(return_value, reinterpret_cast<void*>(addr), size) == size;
 }
@@ -115,6 +122,173 @@ int Lua::Memory::readcstring(lua_State *L)
     return 1;
 }
 
+/* Types of values for the bulk read functions */
+enum ValueType {
+    TYPE_U8, TYPE_U16, TYPE_U32, TYPE_U64,
+    TYPE_S8, TYPE_S16, TYPE_S32, TYPE_S64,
+    TYPE_F, TYPE_D,
+};
+
+static const struct {
+    const char* name;
+    ValueType type;
+    int size;
+} value_types[] = {
+    {"u8", TYPE_U8, 1}, {"u16", TYPE_U16, 2}, {"u32", TYPE_U32, 4}, {"u64", TYPE_U64, 8},
+    {"s8", TYPE_S8, 1}, {"s16", TYPE_S16, 2}, {"s32", TYPE_S32, 4}, {"s64", TYPE_S64, 8},
+    {"f", TYPE_F, 4}, {"d", TYPE_D, 8},
+};
+
+/* Get the type of value from a type name at stack index `arg`, and its size */
+static ValueType checkValueType(lua_State *L, int arg, int* size)
+{
+    const char* name = luaL_checkstring(L, arg);
+    for (const auto& vt : value_types) {
+        if (strcmp(name, vt.name) == 0) {
+            *size = vt.size;
+            return vt.type;
+        }
+    }
+    luaL_error(L, "unknown value type '%s'", name);
+    return TYPE_U8;
+}
+
+/* Push the value of type `type` stored at `ptr` */
+static void pushValue(lua_State *L, ValueType type, const uint8_t* ptr)
+{
+#define PUSHINT(TYPE) { TYPE v; memcpy(&v, ptr, sizeof(TYPE)); lua_pushinteger(L, static_cast<lua_Integer>(v)); break; }
+#define PUSHNUMBER(TYPE) { TYPE v; memcpy(&v, ptr, sizeof(TYPE)); lua_pushnumber(L, static_cast<lua_Number>(v)); break; }
+    switch (type) {
+        case TYPE_U8: PUSHINT(uint8_t)
+        case TYPE_U16: PUSHINT(uint16_t)
+        case TYPE_U32: PUSHINT(uint32_t)
+        case TYPE_U64: PUSHINT(uint64_t)
+        case TYPE_S8: PUSHINT(int8_t)
+        case TYPE_S16: PUSHINT(int16_t)
+        case TYPE_S32: PUSHINT(int32_t)
+        case TYPE_S64: PUSHINT(int64_t)
+        case TYPE_F: PUSHNUMBER(float)
+        case TYPE_D: PUSHNUMBER(double)
+    }
+#undef PUSHINT
+#undef PUSHNUMBER
+}
+
+int Lua::Memory::readBlock(lua_State *L)
+{
+    uintptr_t addr = static_cast<uintptr_t>(lua_tointeger(L, 1));
+    lua_Integer size = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, size >= 0, 2, "size must be positive");
+    luaL_argcheck(L, size <= MAX_READ_SIZE, 2, "size too large");
+
+    /* Unreadable memory is returned as zeros, like the scalar readers */
+    std::vector<char> buf(size);
+    if (size > 0 && !read(addr, buf.data(), size))
+        std::fill(buf.begin(), buf.end(), 0);
+    lua_pushlstring(L, buf.data(), size);
+    return 1;
+}
+
+int Lua::Memory::readMulti(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    int size;
+    ValueType type = checkValueType(L, 2, &size);
+
+    size_t count = lua_rawlen(L, 1);
+    std::vector<uintptr_t> addrs(count);
+    for (size_t i = 0; i < count; i++) {
+        lua_rawgeti(L, 1, i+1);
+        addrs[i] = static_cast<uintptr_t>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+    }
+
+    std::vector<uint8_t> values(count * size);
+    if (count > 0)
+        MemAccess::readv(values.data(), addrs.data(), count, size, nullptr);
+
+    lua_createtable(L, count, 0);
+    for (size_t i = 0; i < count; i++) {
+        pushValue(L, type, &values[i * size]);
+        lua_rawseti(L, -2, i+1);
+    }
+    return 1;
+}
+
+int Lua::Memory::readStructs(lua_State *L)
+{
+    /* Parse the layout, as a list of {name, offset, type} */
+    luaL_checktype(L, 4, LUA_TTABLE);
+    struct Field {
+        std::string name;
+        lua_Integer offset;
+        ValueType type;
+        int size;
+    };
+    std::vector<Field> fields;
+    size_t nb_fields = lua_rawlen(L, 4);
+    for (size_t f = 0; f < nb_fields; f++) {
+        lua_rawgeti(L, 4, f+1);
+        luaL_argcheck(L, lua_istable(L, -1), 4, "fields must be {name, offset, type}");
+        Field field;
+        lua_rawgeti(L, -1, 1);
+        field.name = luaL_checkstring(L, -1);
+        lua_rawgeti(L, -2, 2);
+        field.offset = luaL_checkinteger(L, -1);
+        lua_rawgeti(L, -3, 3);
+        field.type = checkValueType(L, -1, &field.size);
+        lua_pop(L, 4);
+        fields.push_back(field);
+    }
+
+    lua_Integer stride = luaL_checkinteger(L, 3);
+    luaL_argcheck(L, stride > 0, 3, "record size must be positive");
+    luaL_argcheck(L, stride <= MAX_READ_SIZE, 3, "record size too large");
+    for (const Field& field : fields)
+        luaL_argcheck(L, (field.offset >= 0) && (field.offset + field.size <= stride), 4, "field outside of the record");
+
+    /* Read all records at once: either a contiguous array starting at an
+     * address, or records pointed by a list of addresses */
+    size_t count;
+    std::vector<uint8_t> records;
+    if (lua_istable(L, 1)) {
+        count = lua_rawlen(L, 1);
+        luaL_argcheck(L, count <= static_cast<size_t>(MAX_READ_SIZE / stride), 1, "too many records");
+        std::vector<uintptr_t> addrs(count);
+        for (size_t i = 0; i < count; i++) {
+            lua_rawgeti(L, 1, i+1);
+            addrs[i] = static_cast<uintptr_t>(lua_tointeger(L, -1));
+            lua_pop(L, 1);
+        }
+        records.resize(count * stride);
+        if (count > 0)
+            MemAccess::readv(records.data(), addrs.data(), count, stride, nullptr);
+    }
+    else {
+        uintptr_t addr = static_cast<uintptr_t>(lua_tointeger(L, 1));
+        lua_Integer nb = luaL_checkinteger(L, 2);
+        luaL_argcheck(L, nb >= 0, 2, "count must be positive");
+        luaL_argcheck(L, nb <= MAX_READ_SIZE / stride, 2, "too many records");
+        count = nb;
+        records.resize(count * stride);
+        if (count > 0 && !read(addr, records.data(), records.size()))
+            std::fill(records.begin(), records.end(), 0);
+    }
+
+    /* Decode each record into a table */
+    lua_createtable(L, count, 0);
+    for (size_t i = 0; i < count; i++) {
+        lua_createtable(L, 0, fields.size());
+        const uint8_t* record = &records[i * stride];
+        for (const Field& field : fields) {
+            pushValue(L, field.type, record + field.offset);
+            lua_setfield(L, -2, field.name.c_str());
+        }
+        lua_rawseti(L, -2, i+1);
+    }
+    return 1;
+}
+
 void Lua::Memory::write(uintptr_t addr, void* value, int size)
 {
     MemAccess::write(value, reinterpret_cast<void*>(addr), size);
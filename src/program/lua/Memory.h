@@ -21,6 +21,7 @@
 #define LIBTAS_LUAMEMORY_H_INCLUDED
 
 #include <stdint.h>
+#include <stddef.h>
 extern "C" {
 #include <lua.h>
 }
@@ -33,7 +34,7 @@ namespace Memory {
     void registerFunctions(lua_State *L);
 
     /* Helper function for reading an integer */
-    bool read(uintptr_t addr, void* return_value, int size);
+    bool read(uintptr_t addr, void* return_value, size_t size);
 
     /* Read an unsigned 8-bit integer */
     int readu8(lua_State *L);
@@ -68,6 +69,15 @@ namespace Memory {
     /* Read a null-terminating string */
     int readcstring(lua_State *L);
 
+    /* Read a block of memory into a byte string */
+    int readBlock(lua_State *L);
+
+    /* Read values of the same type from a list of addresses */
+    int readMulti(lua_State *L);
+
+    /* Read an array of records and decode their fields into tables */
+    int readStructs(lua_State *L);
+
     /* Helper function for reading an integer */
     void write(uintptr_t addr, void* value, int size);
 
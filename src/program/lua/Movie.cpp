@@ -22,10 +22,7 @@
 #include "Context.h"
 
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 static Context* context;
 
@@ -20,14 +20,13 @@
 #include "NamedLuaFunction.h"
 #include "Main.h"
 
-extern "C" {
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 #include <iostream>
+#include <time.h>
 
 namespace Lua {
 
-NamedLuaFunction::NamedLuaFunction(lua_State *L, CallbackType t) : type(t), file(Main::currentFile()), active(true), lua_state(L)
+NamedLuaFunction::NamedLuaFunction(lua_State *L, CallbackType t) : type(t), file(Main::currentFile()), active(true), calls(0), total_us(0), max_us(0), lua_state(L)
 {
     function_ref = luaL_ref(lua_state, LUA_REGISTRYINDEX);
 }
@@ -42,6 +41,9 @@ NamedLuaFunction::~NamedLuaFunction()
 /* Taken from https://stackoverflow.com/a/21947358 */
 void NamedLuaFunction::call()
 {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     /* push the callback onto the stack using the Lua reference we */
     /* stored in the registry */
     lua_rawgeti( lua_state, LUA_REGISTRYINDEX, function_ref );
@@ -50,8 +52,22 @@ void NamedLuaFunction::call()
     if ( 0 != lua_pcall( lua_state, 0, 0, 0 ) ) {
         std::cerr << "Failed to call the callback: " << lua_tostring( lua_state, -1 ) << std::endl;
         lua_pop(lua_state, 1);
-        return;
     }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t elapsed_us = (end.tv_sec - start.tv_sec) * 1000000ULL + (end.tv_nsec - start.tv_nsec) / 1000;
+
+    calls++;
+    total_us += elapsed_us;
+    if (elapsed_us > max_us)
+        max_us = elapsed_us;
+}
+
+void NamedLuaFunction::resetProfile()
+{
+    calls = 0;
+    total_us = 0;
+    max_us = 0;
 }
 
 }
@@ -21,6 +21,8 @@
 #define LIBTAS_NAMEDLUAFUNCTION_H_INCLUDED
 
 #include <string>
+#include <atomic>
+#include <stdint.h>
 
 extern "C" {
 #include <lua.h>
@@ -45,10 +47,18 @@ public:
     NamedLuaFunction(const NamedLuaFunction&) = delete;
 
     void call();
+
+    /* Reset the timing counters */
+    void resetProfile();
     
     CallbackType type;
     const std::string file;
     bool active;
+
+    /* Timing counters, updated by the game loop thread and read by the UI */
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> total_us;
+    std::atomic<uint64_t> max_us;
     
 private:
     lua_State *lua_state;
@@ -20,10 +20,7 @@
 #include "Print.h"
 
 #include <sstream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 void Lua::Print::init(lua_State *L) {
     lua_pushcfunction(L, print);
@@ -23,10 +23,7 @@
 
 #include <unistd.h>
 #include <iostream>
-extern "C" {
-#include <lua.h>
-#include <lauxlib.h>
-}
+#include "LuaCompat.h"
 
 static Context* context;
 
@@ -51,17 +48,21 @@ void Lua::Runtime::registerFunctions(lua_State *L, Context* c)
 int Lua::Runtime::saveState(lua_State *L)
 {
     int slot = static_cast<int>(lua_tointeger(L, 1));
+    bool pushed = false;
     if (slot >= 1 && slot <= 10)
-        context->hotkey_pressed_queue.push(HOTKEY_SAVESTATE1 + (slot-1));
-    return 0;
+        pushed = context->pushHotkeyPressed(HOTKEY_SAVESTATE1 + (slot-1));
+    lua_pushboolean(L, pushed);
+    return 1;
 }
 
 int Lua::Runtime::loadState(lua_State *L)
 {
     int slot = static_cast<int>(lua_tointeger(L, 1));
+    bool pushed = false;
     if (slot >= 1 && slot <= 10)
-        context->hotkey_pressed_queue.push(HOTKEY_LOADSTATE1 + (slot-1));
-    return 0;
+        pushed = context->pushHotkeyPressed(HOTKEY_LOADSTATE1 + (slot-1));
+    lua_pushboolean(L, pushed);
+    return 1;
 }
 
 int Lua::Runtime::isFastForward(lua_State *L)
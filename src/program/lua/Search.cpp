@@ -0,0 +1,181 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Search.h"
+
+#include "SearchPool.h"
+#include "utils.h"
+
+#include <string>
+#include "LuaCompat.h"
+
+static Context* context;
+
+/* Last job received by this worker */
+static int current_job = 0;
+
+/* Lua state of the file that started the workers */
+static lua_State* owner_state = nullptr;
+
+/* Registry key of the main lua state, so that it is known from coroutines */
+static const char* main_state_key = "libtas_search_main_state";
+
+/* List of functions to register */
+static const luaL_Reg search_functions[] =
+{
+    { "start", Lua::Search::start},
+    { "stop", Lua::Search::stop},
+    { "submit", Lua::Search::submit},
+    { "poll", Lua::Search::poll},
+    { "wait", Lua::Search::wait},
+    { "pending", Lua::Search::pending},
+    { "workers", Lua::Search::workers},
+    { "worker", Lua::Search::worker},
+    { "nextJob", Lua::Search::nextJob},
+    { "reply", Lua::Search::reply},
+    { NULL, NULL }
+};
+
+void Lua::Search::registerFunctions(lua_State *L, Context* c)
+{
+    context = c;
+    luaL_newlib(L, search_functions);
+    lua_setglobal(L, "search");
+
+    lua_pushlightuserdata(L, L);
+    lua_setfield(L, LUA_REGISTRYINDEX, main_state_key);
+}
+
+void Lua::Search::stopForState(lua_State *L)
+{
+    if (owner_state == L) {
+        SearchPool::stop();
+        owner_state = nullptr;
+    }
+}
+
+int Lua::Search::start(lua_State *L)
+{
+    int count = static_cast<int>(luaL_checkinteger(L, 1));
+    std::string script = realpath_nonexist(luaL_checkstring(L, 2));
+    std::string movie;
+    if (lua_isstring(L, 3))
+        movie = realpath_nonexist(lua_tostring(L, 3));
+
+    int started = SearchPool::start(context, count, script, movie);
+    if (started > 0) {
+        lua_getfield(L, LUA_REGISTRYINDEX, main_state_key);
+        owner_state = static_cast<lua_State*>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+    }
+    lua_pushinteger(L, static_cast<lua_Integer>(started));
+    return 1;
+}
+
+int Lua::Search::stop(lua_State *L)
+{
+    SearchPool::stop();
+    owner_state = nullptr;
+    return 0;
+}
+
+int Lua::Search::submit(lua_State *L)
+{
+    size_t len;
+    const char* data = luaL_checklstring(L, 1, &len);
+    int id = SearchPool::submit(std::string(data, len));
+    lua_pushinteger(L, static_cast<lua_Integer>(id));
+    return 1;
+}
+
+static int pushResult(lua_State *L, const SearchPool::Result& result)
+{
+    lua_pushinteger(L, static_cast<lua_Integer>(result.job));
+    if (result.success)
+        lua_pushlstring(L, result.data.data(), result.data.size());
+    else
+        lua_pushnil(L);
+    lua_pushinteger(L, static_cast<lua_Integer>(result.worker));
+    return 3;
+}
+
+int Lua::Search::poll(lua_State *L)
+{
+    SearchPool::Result result;
+    if (!SearchPool::poll(result)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    return pushResult(L, result);
+}
+
+int Lua::Search::wait(lua_State *L)
+{
+    int timeout = static_cast<int>(luaL_optinteger(L, 1, -1));
+
+    SearchPool::Result result;
+    if (!SearchPool::wait(result, timeout)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    return pushResult(L, result);
+}
+
+int Lua::Search::pending(lua_State *L)
+{
+    lua_pushinteger(L, static_cast<lua_Integer>(SearchPool::pendingCount()));
+    return 1;
+}
+
+int Lua::Search::workers(lua_State *L)
+{
+    lua_pushinteger(L, static_cast<lua_Integer>(SearchPool::workerCount()));
+    return 1;
+}
+
+int Lua::Search::worker(lua_State *L)
+{
+    int index = SearchPool::workerIndex();
+    if (index < 0)
+        lua_pushnil(L);
+    else
+        lua_pushinteger(L, static_cast<lua_Integer>(index));
+    return 1;
+}
+
+int Lua::Search::nextJob(lua_State *L)
+{
+    std::string data;
+    if (!SearchPool::nextJob(current_job, data)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushlstring(L, data.data(), data.size());
+    lua_pushinteger(L, static_cast<lua_Integer>(current_job));
+    return 2;
+}
+
+int Lua::Search::reply(lua_State *L)
+{
+    size_t len;
+    const char* data = luaL_checklstring(L, 1, &len);
+    int job = static_cast<int>(luaL_optinteger(L, 2, current_job));
+    lua_pushboolean(L, SearchPool::reply(job, std::string(data, len)));
+    return 1;
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LUASEARCH_H_INCLUDED
+#define LIBTAS_LUASEARCH_H_INCLUDED
+
+extern "C" {
+#include <lua.h>
+}
+
+struct Context;
+
+namespace Lua {
+
+namespace Search {
+
+    /* Register all functions */
+    void registerFunctions(lua_State *L, Context* c);
+
+    /* Stop the workers if they were started by this lua state, which is
+     * about to be closed */
+    void stopForState(lua_State *L);
+
+    /* Start workers (number count, string script, [string movie]) -> number workers */
+    int start(lua_State *L);
+
+    /* Stop all workers */
+    int stop(lua_State *L);
+
+    /* Queue a job for workers (string data) -> number id */
+    int submit(lua_State *L);
+
+    /* Get a result if available () -> number id, string result, number worker */
+    int poll(lua_State *L);
+
+    /* Wait for a result ([number timeout_ms]) -> number id, string result, number worker */
+    int wait(lua_State *L);
+
+    /* Number of jobs without result () -> number */
+    int pending(lua_State *L);
+
+    /* Number of running workers () -> number */
+    int workers(lua_State *L);
+
+    /* Index of this worker, or nil if not a worker () -> number index */
+    int worker(lua_State *L);
+
+    /* Wait for the next job (worker only) () -> string data, number id */
+    int nextJob(lua_State *L);
+
+    /* Send the result of a job (worker only) (string result, [number id]) */
+    int reply(lua_State *L);
+
+}
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include "utils.h" // create_dir
 #include "lua/Main.h"
 #include "lua/Callbacks.h"
+#include "SearchPool.h"
 #include "KeyMapping.h"
 #include "ramsearch/MemScanner.h"
 #ifdef __unix__
@@ -348,6 +349,17 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    /* Search workers spawned by another libTAS instance use their own
+     * savestate directory */
+    int search_worker = SearchPool::initWorker();
+    if (search_worker >= 0) {
+        context.config.savestatedir += "/search" + std::to_string(search_worker);
+        if (create_dir(context.config.savestatedir) < 0) {
+            std::cerr << "Cannot create dir " << context.config.savestatedir << std::endl;
+            return -1;
+        }
+    }
+
     if (context.config.ramsearchdir.empty()) {
         context.config.ramsearchdir = data_dir + "/ramsearch";
     }
@@ -416,7 +428,9 @@ int main(int argc, char **argv)
 
     app.exec();
 
-    context.config.save(context.gamepath);
+    /* Search workers must not overwrite the config of the controller */
+    if (search_worker < 0)
+        context.config.save(context.gamepath);
 
     /* Stop the lua VM */
     Lua::Main::exit();
@@ -21,14 +21,24 @@
 #define LIBTAS_IMOVIEACTION_H_INCLUDED
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
 
 class MovieFileInputs;
 
 class IMovieAction {
 public:
+    virtual ~IMovieAction() {}
+
     virtual void undo(MovieFileInputs* movie_inputs) = 0;
     virtual void redo(MovieFileInputs* movie_inputs) = 0;
+
+    /* Approximate memory used by the action */
+    virtual size_t memorySize() const = 0;
+
+    /* Store the frames written by the action once they are in the movie, so
+     * that they share the input chunks of the movie */
+    virtual void storeNewFrames(MovieFileInputs* movie_inputs) {}
     
     uint64_t first_frame;
     uint64_t last_frame;
@@ -0,0 +1,212 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InputChunkList.h"
+
+/* Memory used by a frame, including its heap allocations */
+static size_t frameMemorySize(const AllInputs& ai)
+{
+    size_t size = sizeof(AllInputs);
+    if (ai.pointer)
+        size += sizeof(MouseInputs);
+    for (const auto& controller : ai.controllers)
+        if (controller)
+            size += sizeof(ControllerInputs);
+    if (ai.misc)
+        size += sizeof(MiscInputs);
+    size += ai.events.capacity() * sizeof(InputEvent);
+    return size;
+}
+
+uint64_t InputChunkList::size() const
+{
+    return frame_count;
+}
+
+void InputChunkList::clear()
+{
+    chunks.clear();
+    frame_count = 0;
+}
+
+const AllInputs& InputChunkList::operator[](uint64_t pos) const
+{
+    return (*chunks[pos / CHUNK_SIZE])[pos % CHUNK_SIZE];
+}
+
+AllInputs& InputChunkList::edit(uint64_t pos)
+{
+    return editChunk(pos / CHUNK_SIZE)[pos % CHUNK_SIZE];
+}
+
+InputChunkList::Chunk& InputChunkList::editChunk(uint64_t c)
+{
+    /* Other lists are still referencing this chunk, duplicate it */
+    if (chunks[c].use_count() > 1) {
+        Chunk* chunk = new Chunk();
+        chunk->reserve(CHUNK_SIZE);
+        chunk->insert(chunk->end(), chunks[c]->begin(), chunks[c]->end());
+        chunks[c].reset(chunk);
+    }
+    return *chunks[c];
+}
+
+void InputChunkList::push_back(const AllInputs& ai)
+{
+    if ((frame_count % CHUNK_SIZE) == 0) {
+        Chunk* chunk = new Chunk();
+        chunk->reserve(CHUNK_SIZE);
+        chunks.emplace_back(chunk);
+    }
+
+    editChunk(chunks.size() - 1).push_back(ai);
+    frame_count++;
+}
+
+void InputChunkList::truncate(uint64_t pos)
+{
+    if (pos >= frame_count)
+        return;
+
+    chunks.resize((pos + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    frame_count = pos;
+
+    uint64_t last_size = pos % CHUNK_SIZE;
+    if (last_size != 0) {
+        Chunk& chunk = editChunk(chunks.size() - 1);
+        chunk.erase(chunk.begin() + last_size, chunk.end());
+    }
+}
+
+void InputChunkList::cutTail(uint64_t pos, std::vector<AllInputs>& tail)
+{
+    tail.reserve(frame_count - pos);
+    for (uint64_t f = pos; f < frame_count; f++)
+        tail.push_back((*this)[f]);
+    truncate(pos);
+}
+
+void InputChunkList::insert(uint64_t pos, uint64_t count, const AllInputs& ai)
+{
+    /* Frames after pos are shifted, so their chunks cannot be shared anymore */
+    std::vector<AllInputs> tail;
+    cutTail(pos, tail);
+
+    for (uint64_t i = 0; i < count; i++)
+        push_back(ai);
+    for (const AllInputs& t : tail)
+        push_back(t);
+}
+
+void InputChunkList::insert(uint64_t pos, const std::vector<AllInputs>& inputs)
+{
+    std::vector<AllInputs> tail;
+    cutTail(pos, tail);
+
+    for (const AllInputs& i : inputs)
+        push_back(i);
+    for (const AllInputs& t : tail)
+        push_back(t);
+}
+
+void InputChunkList::erase(uint64_t pos, uint64_t count)
+{
+    std::vector<AllInputs> tail;
+    cutTail(pos + count, tail);
+    truncate(pos);
+
+    for (const AllInputs& t : tail)
+        push_back(t);
+}
+
+bool InputChunkList::isEqual(const InputChunkList& other, uint64_t start_frame, uint64_t end_frame) const
+{
+    uint64_t f = start_frame;
+    while (f < end_frame) {
+        uint64_t c = f / CHUNK_SIZE;
+        uint64_t chunk_end = (c + 1) * CHUNK_SIZE;
+        if (chunk_end > end_frame)
+            chunk_end = end_frame;
+
+        /* Same chunk means same inputs, no need to compare */
+        if (chunks[c] != other.chunks[c]) {
+            for (; f < chunk_end; f++) {
+                if (!((*other.chunks[c])[f % CHUNK_SIZE] == (*chunks[c])[f % CHUNK_SIZE]))
+                    return false;
+            }
+        }
+        f = chunk_end;
+    }
+    return true;
+}
+
+InputChunkRange::InputChunkRange(const InputChunkList& list, uint64_t first, uint64_t count) : frames_size(0), first_frame(first), frame_count(count)
+{
+    if (count < InputChunkList::CHUNK_SIZE) {
+        frames.reserve(count);
+        for (uint64_t f = first; f < first + count; f++) {
+            frames.push_back(list[f]);
+            frames_size += frameMemorySize(frames.back());
+        }
+        return;
+    }
+
+    uint64_t first_chunk = first / InputChunkList::CHUNK_SIZE;
+    uint64_t last_chunk = (first + count - 1) / InputChunkList::CHUNK_SIZE;
+    chunks.assign(list.chunks.begin() + first_chunk, list.chunks.begin() + last_chunk + 1);
+
+    /* Shared chunks are never modified, so their size can be computed once */
+    chunk_sizes.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+        size_t size = 0;
+        for (const AllInputs& ai : *chunk)
+            size += frameMemorySize(ai);
+        chunk_sizes.push_back(size);
+    }
+}
+
+uint64_t InputChunkRange::size() const
+{
+    return frame_count;
+}
+
+const AllInputs& InputChunkRange::operator[](uint64_t pos) const
+{
+    if (chunks.empty())
+        return frames[pos];
+
+    uint64_t f = first_frame + pos;
+    uint64_t c = (f / InputChunkList::CHUNK_SIZE) - (first_frame / InputChunkList::CHUNK_SIZE);
+    return (*chunks[c])[f % InputChunkList::CHUNK_SIZE];
+}
+
+void InputChunkRange::copyTo(std::vector<AllInputs>& inputs) const
+{
+    inputs.reserve(inputs.size() + frame_count);
+    for (uint64_t f = 0; f < frame_count; f++)
+        inputs.push_back((*this)[f]);
+}
+
+size_t InputChunkRange::memorySize() const
+{
+    size_t size = frames_size;
+    for (size_t c = 0; c < chunks.size(); c++)
+        size += chunk_sizes[c] / chunks[c].use_count();
+    return size;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_INPUTCHUNKLIST_H_INCLUDED
+#define LIBTAS_INPUTCHUNKLIST_H_INCLUDED
+
+#include "../shared/inputs/AllInputs.h"
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+/* List of frame inputs, stored as fixed-size chunks that are shared between
+ * copies of the list. Copying the list only copies the chunk pointers, and a
+ * chunk is duplicated the first time it is modified while being shared
+ * (copy-on-write). This is used so that savestate movies share most of their
+ * inputs with the current movie. */
+class InputChunkList {
+public:
+    /* Number of frames in each chunk. All chunks are full except the last one,
+     * so that the same frame is always at the same position in any copy */
+    static const uint64_t CHUNK_SIZE = 1024;
+
+    InputChunkList() : frame_count(0) {}
+
+    /* Get the number of frames */
+    uint64_t size() const;
+
+    /* Remove all frames */
+    void clear();
+
+    /* Read access to a frame */
+    const AllInputs& operator[](uint64_t pos) const;
+
+    /* Write access to a frame, unsharing its chunk if needed */
+    AllInputs& edit(uint64_t pos);
+
+    /* Append a frame */
+    void push_back(const AllInputs& ai);
+
+    /* Remove all frames starting from pos */
+    void truncate(uint64_t pos);
+
+    /* Insert count copies of a frame before pos */
+    void insert(uint64_t pos, uint64_t count, const AllInputs& ai);
+
+    /* Insert a list of frames before pos */
+    void insert(uint64_t pos, const std::vector<AllInputs>& inputs);
+
+    /* Remove count frames starting from pos */
+    void erase(uint64_t pos, uint64_t count);
+
+    /* Check if another list has the same inputs inside the range
+     * [start_frame, end_frame[. Shared chunks are skipped without comparing
+     * their frames. Both lists must contain end_frame frames. */
+    bool isEqual(const InputChunkList& other, uint64_t start_frame, uint64_t end_frame) const;
+
+private:
+    friend class InputChunkRange;
+
+    typedef std::vector<AllInputs> Chunk;
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+
+    uint64_t frame_count;
+
+    /* Return a chunk that can be modified, duplicating it if shared */
+    Chunk& editChunk(uint64_t c);
+
+    /* Copy all frames starting from pos into the vector, and truncate */
+    void cutTail(uint64_t pos, std::vector<AllInputs>& tail);
+};
+
+/* Copy of a range of frames from an input chunk list, used by the undo
+ * history. Large ranges only keep references to the chunks, which are shared
+ * with the list until it modifies them. Small ranges are copied, so that a
+ * few frames don't keep a whole chunk alive. */
+class InputChunkRange {
+public:
+    InputChunkRange() : frames_size(0), first_frame(0), frame_count(0) {}
+
+    /* Get count frames of the list starting from first */
+    InputChunkRange(const InputChunkList& list, uint64_t first, uint64_t count);
+
+    /* Get the number of frames */
+    uint64_t size() const;
+
+    /* Read access to a frame, relative to the first frame of the range */
+    const AllInputs& operator[](uint64_t pos) const;
+
+    /* Copy all frames into the vector */
+    void copyTo(std::vector<AllInputs>& inputs) const;
+
+    /* Approximate memory size, including the heap allocations of frames.
+     * Each referenced chunk is divided between all its owners. */
+    size_t memorySize() const;
+
+private:
+    std::vector<std::shared_ptr<InputChunkList::Chunk>> chunks;
+
+    /* Memory size of each referenced chunk */
+    std::vector<size_t> chunk_sizes;
+
+    /* Frames of small ranges */
+    std::vector<AllInputs> frames;
+
+    /* Memory size of the copied frames */
+    size_t frames_size;
+
+    uint64_t first_frame;
+    uint64_t frame_count;
+};
+
+#endif
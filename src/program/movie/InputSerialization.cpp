@@ -42,13 +42,6 @@ void InputSerialization::setFramerate(unsigned int num, unsigned int den)
     framerate_den = den;
 }
 
-void InputSerialization::writeInputs(std::ostream& stream, const std::vector<AllInputs>& input_list)
-{
-    for (auto it = input_list.begin(); it != input_list.end(); ++it) {
-        writeFrame(stream, *it);
-    }
-}
-
 void InputSerialization::readInputs(std::istream& stream, std::vector<AllInputs>& input_list)
 {
     std::string line;
@@ -35,9 +35,6 @@ void setContext(Context* c);
 /* Set framerate initial values */
 void setFramerate(unsigned int num, unsigned int den);
 
-/* Write a list of inputs into the stream */
-void writeInputs(std::ostream& stream, const std::vector<AllInputs>& input_list);
-
 /* Read a list of inputs from a stream */
 void readInputs(std::istream& stream, std::vector<AllInputs>& input_list);
 
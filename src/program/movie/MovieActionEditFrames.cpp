@@ -20,87 +20,47 @@
 #include "MovieActionEditFrames.h"
 #include "MovieFileInputs.h"
 
-MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, const std::vector<AllInputs>& edited_frames, MovieFileInputs* movie_inputs)
-{
-    first_frame = edit_from;
-    last_frame = first_frame + edited_frames.size() - 1;
-    
-    for (uint64_t frame = first_frame; frame <= last_frame; frame++) {
-        const AllInputs& ai = movie_inputs->getInputs(frame);
-        old_frames.push_back(ai);
-    }
-
-    new_frames = edited_frames;
-    description = "Edit frames ";
-    description += std::to_string(first_frame);
-    description += " - ";
-    description += std::to_string(last_frame);
-}
-
-MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, const std::vector<AllInputs>& edited_frames, MovieFileInputs* movie_inputs)
+MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, bool c, MovieFileInputs* movie_inputs)
 {
     first_frame = edit_from;
     last_frame = edit_to;
-    
-    for (uint64_t frame = first_frame; frame <= last_frame; frame++) {
-        const AllInputs& ai = movie_inputs->getInputs(frame);
-        old_frames.push_back(ai);
-    }
-
-    new_frames.assign(edited_frames.begin(), edited_frames.begin()+(edit_to-edit_from+1));
-    description = "Edit frames ";
-    description += std::to_string(first_frame);
-    description += " - ";
-    description += std::to_string(last_frame);
-}
+    clear = c;
+    old_frames = movie_inputs->getInputRange(first_frame, last_frame - first_frame + 1);
 
-MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, const AllInputs& edited_frame, MovieFileInputs* movie_inputs)
-{
-    first_frame = edit_from;
-    last_frame = edit_from;
-    const AllInputs& ai = movie_inputs->getInputs(edit_from);
-    old_frames.push_back(ai);
-    new_frames.push_back(edited_frame);
-    description = "Edit frame ";
-    description += std::to_string(edit_from);
+    description = clear ? "Clear frame" : "Edit frame";
+    if (first_frame == last_frame) {
+        description += " ";
+        description += std::to_string(first_frame);
+    }
+    else {
+        description += "s ";
+        description += std::to_string(first_frame);
+        description += " - ";
+        description += std::to_string(last_frame);
+    }
 }
 
-MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, MovieFileInputs* movie_inputs)
-{
-    first_frame = edit_from;
-    last_frame = edit_from;
-    const AllInputs& ai = movie_inputs->getInputs(edit_from);
-    old_frames.push_back(ai);
-    AllInputs clear_ai;
-    clear_ai.clear();
-    new_frames.push_back(clear_ai);
-    description = "Clear frame ";
-    description += std::to_string(edit_from);
+void MovieActionEditFrames::undo(MovieFileInputs* movie_inputs) {
+    std::vector<AllInputs> frames;
+    old_frames.copyTo(frames);
+    movie_inputs->editInputs(frames, first_frame);
 }
 
-MovieActionEditFrames::MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, MovieFileInputs* movie_inputs)
-{
-    first_frame = edit_from;
-    last_frame = edit_to;
-    
-    for (uint64_t frame = first_frame; frame <= last_frame; frame++) {
-        const AllInputs& ai = movie_inputs->getInputs(frame);
-        old_frames.push_back(ai);
+void MovieActionEditFrames::redo(MovieFileInputs* movie_inputs) {
+    if (clear)
+        movie_inputs->clearInputs(first_frame, last_frame);
+    else {
+        std::vector<AllInputs> frames;
+        new_frames.copyTo(frames);
+        movie_inputs->editInputs(frames, first_frame);
     }
-    
-    description = "Clear frames ";
-    description += std::to_string(first_frame);
-    description += " - ";
-    description += std::to_string(last_frame);
 }
 
-void MovieActionEditFrames::undo(MovieFileInputs* movie_inputs) {
-    movie_inputs->editInputs(old_frames, first_frame);
+size_t MovieActionEditFrames::memorySize() const {
+    return old_frames.memorySize() + new_frames.memorySize();
 }
 
-void MovieActionEditFrames::redo(MovieFileInputs* movie_inputs) {
-    if (new_frames.empty()) // clear
-        movie_inputs->clearInputs(first_frame, last_frame);
-    else
-        movie_inputs->editInputs(new_frames, first_frame);
+void MovieActionEditFrames::storeNewFrames(MovieFileInputs* movie_inputs) {
+    if (!clear)
+        new_frames = movie_inputs->getInputRange(first_frame, last_frame - first_frame + 1);
 }
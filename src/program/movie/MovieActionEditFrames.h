@@ -21,6 +21,7 @@
 #define LIBTAS_MOVIEACTIONEDITFRAMES_H_INCLUDED
 
 #include "IMovieAction.h"
+#include "InputChunkList.h"
 #include "../shared/inputs/AllInputs.h"
 
 #include <vector>
@@ -30,18 +31,18 @@ class MovieFileInputs;
 
 class MovieActionEditFrames : public IMovieAction {
 public:
-    MovieActionEditFrames(uint64_t edit_from, const std::vector<AllInputs>& edited_frames, MovieFileInputs* movie_inputs);
-    MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, const std::vector<AllInputs>& edited_frames, MovieFileInputs* movie_inputs);
-    MovieActionEditFrames(uint64_t edit_from, const AllInputs& edited_frame, MovieFileInputs* movie_inputs);
-    MovieActionEditFrames(uint64_t edit_from, MovieFileInputs* movie_inputs);
-    MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, MovieFileInputs* movie_inputs);
+    /* Edit or clear frames. Must be called before the movie is modified */
+    MovieActionEditFrames(uint64_t edit_from, uint64_t edit_to, bool clear, MovieFileInputs* movie_inputs);
 
     void undo(MovieFileInputs* movie_inputs);
     void redo(MovieFileInputs* movie_inputs);
+    size_t memorySize() const;
+    void storeNewFrames(MovieFileInputs* movie_inputs);
     
 private:
-    std::vector<AllInputs> old_frames;
-    std::vector<AllInputs> new_frames;
+    bool clear;
+    InputChunkRange old_frames;
+    InputChunkRange new_frames;
 };
 
 #endif
@@ -20,35 +20,21 @@
 #include "MovieActionInsertFrames.h"
 #include "MovieFileInputs.h"
 
-MovieActionInsertFrames::MovieActionInsertFrames(uint64_t insert_from, const std::vector<AllInputs>& inserted_frames)
-{
-    first_frame = insert_from;
-    last_frame = first_frame + inserted_frames.size() - 1;
-    new_frames = inserted_frames;
-    description = "Insert frames ";
-    description += std::to_string(first_frame);
-    description += " - ";
-    description += std::to_string(last_frame);
-}
-
-MovieActionInsertFrames::MovieActionInsertFrames(uint64_t insert_from, int count)
+MovieActionInsertFrames::MovieActionInsertFrames(uint64_t insert_from, int count, bool b)
 {
     first_frame = insert_from;
     last_frame = first_frame + count - 1;
-    new_frames.clear();
-    description = "Insert frames ";
-    description += std::to_string(first_frame);
-    description += " - ";
-    description += std::to_string(last_frame);
-}
-
-MovieActionInsertFrames::MovieActionInsertFrames(uint64_t insert_from, const AllInputs& inserted_frame)
-{
-    first_frame = insert_from;
-    last_frame = insert_from;
-    new_frames.push_back(inserted_frame);
-    description = "Insert at frame ";
-    description += std::to_string(insert_from);
+    blank = b;
+    if (first_frame == last_frame) {
+        description = "Insert at frame ";
+        description += std::to_string(first_frame);
+    }
+    else {
+        description = "Insert frames ";
+        description += std::to_string(first_frame);
+        description += " - ";
+        description += std::to_string(last_frame);
+    }
 }
 
 void MovieActionInsertFrames::undo(MovieFileInputs* movie_inputs) {
@@ -56,8 +42,20 @@ void MovieActionInsertFrames::undo(MovieFileInputs* movie_inputs) {
 }
 
 void MovieActionInsertFrames::redo(MovieFileInputs* movie_inputs) {
-    if (new_frames.empty())
+    if (blank)
         movie_inputs->insertInputsBefore(first_frame, last_frame-first_frame+1);
-    else
-        movie_inputs->insertInputsBefore(new_frames, first_frame);
+    else {
+        std::vector<AllInputs> frames;
+        new_frames.copyTo(frames);
+        movie_inputs->insertInputsBefore(frames, first_frame);
+    }
+}
+
+size_t MovieActionInsertFrames::memorySize() const {
+    return new_frames.memorySize();
+}
+
+void MovieActionInsertFrames::storeNewFrames(MovieFileInputs* movie_inputs) {
+    if (!blank)
+        new_frames = movie_inputs->getInputRange(first_frame, last_frame - first_frame + 1);
 }
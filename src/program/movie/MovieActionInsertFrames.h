@@ -21,6 +21,7 @@
 #define LIBTAS_MOVIEACTIONINSERTFRAMES_H_INCLUDED
 
 #include "IMovieAction.h"
+#include "InputChunkList.h"
 #include "../shared/inputs/AllInputs.h"
 
 #include <vector>
@@ -30,15 +31,17 @@ class MovieFileInputs;
 
 class MovieActionInsertFrames : public IMovieAction {
 public:
-    MovieActionInsertFrames(uint64_t insert_from, const std::vector<AllInputs>& inserted_frames);
-    MovieActionInsertFrames(uint64_t insert_from, int count);
-    MovieActionInsertFrames(uint64_t insert_from, const AllInputs& inserted_frame);
+    /* Insert count blank or given frames */
+    MovieActionInsertFrames(uint64_t insert_from, int count, bool blank);
 
     void undo(MovieFileInputs* movie_inputs);
     void redo(MovieFileInputs* movie_inputs);
+    size_t memorySize() const;
+    void storeNewFrames(MovieFileInputs* movie_inputs);
     
 private:
-    std::vector<AllInputs> new_frames;
+    bool blank;
+    InputChunkRange new_frames;
 };
 
 #endif
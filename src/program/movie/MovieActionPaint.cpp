@@ -77,3 +77,7 @@ void MovieActionPaint::redo(MovieFileInputs* movie_inputs) {
     else
         movie_inputs->paintInput(input, new_values, first_frame);
 }
+
+size_t MovieActionPaint::memorySize() const {
+    return (old_values.size() + new_values.size()) * sizeof(int);
+}
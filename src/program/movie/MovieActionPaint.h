@@ -35,6 +35,7 @@ public:
 
     void undo(MovieFileInputs* movie_inputs);
     void redo(MovieFileInputs* movie_inputs);
+    size_t memorySize() const;
     
 private:
     SingleInput input;
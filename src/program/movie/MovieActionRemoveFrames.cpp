@@ -24,10 +24,7 @@ MovieActionRemoveFrames::MovieActionRemoveFrames(uint64_t remove_from, uint64_t
     first_frame = remove_from;
     last_frame = remove_to;
     
-    for (uint64_t frame = first_frame; frame <= last_frame; frame++) {
-        const AllInputs& ai = movie_inputs->getInputs(frame);
-        old_frames.push_back(ai);
-    }
+    old_frames = movie_inputs->getInputRange(first_frame, last_frame - first_frame + 1);
     
     description = "Remove frames ";
     description += std::to_string(first_frame);
@@ -36,9 +33,15 @@ MovieActionRemoveFrames::MovieActionRemoveFrames(uint64_t remove_from, uint64_t
 }
 
 void MovieActionRemoveFrames::undo(MovieFileInputs* movie_inputs) {
-    movie_inputs->insertInputsBefore(old_frames, first_frame);
+    std::vector<AllInputs> frames;
+    old_frames.copyTo(frames);
+    movie_inputs->insertInputsBefore(frames, first_frame);
 }
 
 void MovieActionRemoveFrames::redo(MovieFileInputs* movie_inputs) {
     movie_inputs->deleteInputs(first_frame, last_frame-first_frame+1);
 }
+
+size_t MovieActionRemoveFrames::memorySize() const {
+    return old_frames.memorySize();
+}
@@ -21,6 +21,7 @@
 #define LIBTAS_MOVIEACTIONREMOVEFRAMES_H_INCLUDED
 
 #include "IMovieAction.h"
+#include "InputChunkList.h"
 #include "../shared/inputs/AllInputs.h"
 
 #include <vector>
@@ -34,9 +35,10 @@ public:
 
     void undo(MovieFileInputs* movie_inputs);
     void redo(MovieFileInputs* movie_inputs);
+    size_t memorySize() const;
     
 private:
-    std::vector<AllInputs> old_frames;
+    InputChunkRange old_frames;
 };
 
 #endif
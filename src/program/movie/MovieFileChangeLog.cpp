@@ -32,6 +32,7 @@ MovieFileChangeLog::MovieFileChangeLog(Context* c, MovieFileInputs* mi) : contex
     max_steps = 100;
     is_recording = true;
     history_index = 0;
+    new_frames_action = nullptr;
 }
 
 void MovieFileChangeLog::clear()
@@ -39,6 +40,7 @@ void MovieFileChangeLog::clear()
     emit beginResetHistory();
     history.clear();
     history_index = 0;
+    new_frames_action = nullptr;
     emit endResetHistory();
 }
 
@@ -61,7 +63,7 @@ bool MovieFileChangeLog::undo()
     if (!canUndo())
         return false;
     
-    IMovieAction* action = (*std::next(history.begin(), history_index-1));
+    IMovieAction* action = std::next(history.begin(), history_index-1)->get();
     if (action->first_frame < context->framecount)
         return false;
     
@@ -87,7 +89,7 @@ bool MovieFileChangeLog::redo()
     if (!canRedo())
         return false;
     
-    IMovieAction* action = (*std::next(history.begin(), history_index));
+    IMovieAction* action = std::next(history.begin(), history_index)->get();
     if (action->first_frame < context->framecount)
         return false;
 
@@ -117,104 +119,124 @@ void MovieFileChangeLog::registerAction()
 
 void MovieFileChangeLog::registerPaint(uint64_t start_frame, uint64_t end_frame, SingleInput si, int newV)
 {
+    emit inputsChanged(start_frame);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionPaint(start_frame, end_frame, si, newV, movie_inputs));
-    emit endAddHistory();
+    pushAction(new MovieActionPaint(start_frame, end_frame, si, newV, movie_inputs));
 }
 
 void MovieFileChangeLog::registerPaint(uint64_t start_frame, SingleInput si, const std::vector<int>& newV)
 {
+    emit inputsChanged(start_frame);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionPaint(start_frame, si, newV, movie_inputs));
-    emit endAddHistory();
+    pushAction(new MovieActionPaint(start_frame, si, newV, movie_inputs));
 }
 
 void MovieFileChangeLog::registerClearFrames(uint64_t start_frame, uint64_t end_frame)
 {
+    emit inputsChanged(start_frame);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionEditFrames(start_frame, end_frame, movie_inputs));
-    emit endAddHistory();
+    pushAction(new MovieActionEditFrames(start_frame, end_frame, true, movie_inputs));
 }
 
-void MovieFileChangeLog::registerEditFrame(uint64_t edit_from, const AllInputs& edited_frame)
+void MovieFileChangeLog::registerEditFrame(uint64_t edit_from)
 {
-    if (!is_recording) return;
-    
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionEditFrames(edit_from, edited_frame, movie_inputs));
-    emit endAddHistory();
+    registerEditFrames(edit_from, edit_from);
 }
 
-void MovieFileChangeLog::registerEditFrames(uint64_t edit_from, const std::vector<AllInputs>& edited_frames)
+void MovieFileChangeLog::registerEditFrames(uint64_t edit_from, uint64_t edit_to)
 {
+    emit inputsChanged(edit_from);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionEditFrames(edit_from, edited_frames, movie_inputs));
-    emit endAddHistory();
+    new_frames_action = new MovieActionEditFrames(edit_from, edit_to, false, movie_inputs);
+    pushAction(new_frames_action);
 }
 
-void MovieFileChangeLog::registerEditFrames(uint64_t edit_from, uint64_t edit_to, const std::vector<AllInputs>& edited_frames)
+void MovieFileChangeLog::registerInsertFrame(uint64_t insert_from)
 {
-    if (!is_recording) return;
-    
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionEditFrames(edit_from, edit_to, edited_frames, movie_inputs));
-    emit endAddHistory();
+    registerInsertFrames(insert_from, 1, false);
 }
 
-void MovieFileChangeLog::registerInsertFrame(uint64_t insert_from, const AllInputs& inserted_frame)
+void MovieFileChangeLog::registerInsertFrames(uint64_t insert_from, int count, bool blank)
 {
+    emit inputsChanged(insert_from);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionInsertFrames(insert_from, inserted_frame));
-    emit endAddHistory();
+    if (count <= 0)
+        return;
+
+    IMovieAction* action = new MovieActionInsertFrames(insert_from, count, blank);
+    if (!blank)
+        new_frames_action = action;
+    pushAction(action);
 }
 
-void MovieFileChangeLog::registerInsertFrames(uint64_t insert_from, const std::vector<AllInputs>& inserted_frames)
+void MovieFileChangeLog::registerRemoveFrames(uint64_t remove_from, uint64_t remove_to)
 {
+    emit inputsChanged(remove_from);
+
     if (!is_recording) return;
     
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionInsertFrames(insert_from, inserted_frames));
-    emit endAddHistory();
+    if (remove_to < remove_from)
+        return;
+    pushAction(new MovieActionRemoveFrames(remove_from, remove_to, movie_inputs));
 }
 
-void MovieFileChangeLog::registerInsertFrames(uint64_t insert_from, int count)
+void MovieFileChangeLog::storeNewFrames()
 {
-    if (!is_recording) return;
-    
-    if (count <= 0)
+    if (!new_frames_action)
         return;
+
+    new_frames_action->storeNewFrames(movie_inputs);
+    new_frames_action = nullptr;
+
+    /* The action is larger now */
+    trimHistory();
+}
+
+void MovieFileChangeLog::pushAction(IMovieAction* action)
+{
     registerAction();
     emit beginAddHistory(history.size());
-    history.push_back(new MovieActionInsertFrames(insert_from, count));
+    history.emplace_back(action);
     emit endAddHistory();
+
+    trimHistory();
 }
 
-void MovieFileChangeLog::registerRemoveFrames(uint64_t remove_from, uint64_t remove_to)
+void MovieFileChangeLog::trimHistory()
 {
-    if (!is_recording) return;
-    
-    if (remove_to < remove_from)
+    size_t max_memory = static_cast<size_t>(context->config.editor_undo_memory) * 1024 * 1024;
+
+    size_t memory = 0;
+    for (const auto& action : history)
+        memory += action->memorySize();
+
+    /* Count the oldest actions to remove */
+    unsigned int count = 0;
+    for (auto it = history.begin(); (memory > max_memory) && (count < history.size() - 1); it++) {
+        memory -= (*it)->memorySize();
+        count++;
+    }
+
+    if (count == 0)
         return;
-    registerAction();
-    emit beginAddHistory(history.size());
-    history.push_back(new MovieActionRemoveFrames(remove_from, remove_to, movie_inputs));
-    emit endAddHistory();
+
+    emit beginRemoveHistory(0, count-1);
+    for (unsigned int i = 0; i < count; i++)
+        history.pop_front();
+    emit endRemoveHistory();
+
+    if (history_index > count)
+        history_index -= count;
+    else
+        history_index = 0;
 }
@@ -26,6 +26,7 @@
 
 #include <QtCore/QObject>
 #include <list>
+#include <memory>
 #include <vector>
 #include <cstdint>
 
@@ -48,15 +49,17 @@ public:
     void registerPaint(uint64_t start_frame, uint64_t end_frame, SingleInput si, int newV);
     void registerPaint(uint64_t start_frame, SingleInput si, const std::vector<int>& newV);
     void registerClearFrames(uint64_t start_frame, uint64_t end_frame);
-    void registerEditFrame(uint64_t edit_from, const AllInputs& edited_frame);
-    void registerEditFrames(uint64_t edit_from, const std::vector<AllInputs>& edited_frames);
-    void registerEditFrames(uint64_t edit_from, uint64_t edit_to, const std::vector<AllInputs>& edited_frames);
-    void registerInsertFrame(uint64_t insert_from, const AllInputs& inserted_frame);
-    void registerInsertFrames(uint64_t insert_from, const std::vector<AllInputs>& inserted_frames);
-    void registerInsertFrames(uint64_t insert_from, int count);
+    void registerEditFrame(uint64_t edit_from);
+    void registerEditFrames(uint64_t edit_from, uint64_t edit_to);
+    void registerInsertFrame(uint64_t insert_from);
+    void registerInsertFrames(uint64_t insert_from, int count, bool blank);
     void registerRemoveFrames(uint64_t remove_from, uint64_t remove_to);
+
+    /* Store the new frames of the last registered edit or insertion, which
+     * must be called after the frames are written in the movie */
+    void storeNewFrames();
     
-    std::list<IMovieAction*> history;
+    std::list<std::unique_ptr<IMovieAction>> history;
     
     /* Index to the next inserted action */
     unsigned int history_index;
@@ -69,6 +72,16 @@ private:
 
     MovieFileInputs* movie_inputs;
 
+    /* Registered action waiting for its new frames to be written */
+    IMovieAction* new_frames_action;
+
+    /* Add an action to the history */
+    void pushAction(IMovieAction* action);
+
+    /* Remove the oldest actions while the history is larger than the memory
+     * budget, keeping at least the last action */
+    void trimHistory();
+
 signals:
     void beginResetHistory();
     void endResetHistory();
@@ -78,6 +91,10 @@ signals:
     void endRemoveHistory();
     void changeHistory(int frame);
 
+    /* Inputs are about to be modified starting from this frame, including
+     * from undo/redo actions */
+    void inputsChanged(unsigned long long first_frame);
+
 };
 
 #endif
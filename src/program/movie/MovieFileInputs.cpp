@@ -34,7 +34,7 @@
 #include <sstream>
 #include <algorithm>
 
-MovieFileInputs::MovieFileInputs(Context* c) : context(c)
+MovieFileInputs::MovieFileInputs(Context* c) : input_queue(INPUT_QUEUE_SIZE), context(c)
 {
     InputSerialization::setContext(c);
     modifiedSinceLastSave = false;
@@ -76,7 +76,9 @@ void MovieFileInputs::load()
     std::string input_file = context->config.tempmoviedir + "/inputs";
     std::ifstream input_stream(input_file);
     
-    InputSerialization::readInputs(input_stream, input_list);
+    std::vector<AllInputs> new_list;
+    InputSerialization::readInputs(input_stream, new_list);
+    input_list.insert(0, new_list);
 
     input_stream.close();
 
@@ -91,7 +93,8 @@ void MovieFileInputs::save()
     std::string input_file = context->config.tempmoviedir + "/inputs";
     std::ofstream input_stream(input_file, std::ofstream::trunc);
 
-    InputSerialization::writeInputs(input_stream, input_list);
+    for (uint64_t f = 0; f < input_list.size(); f++)
+        InputSerialization::writeFrame(input_stream, input_list[f]);
 
     input_stream.close();
 }
@@ -125,9 +128,10 @@ int MovieFileInputs::setInputs(const AllInputs& inputs, uint64_t pos, bool keep_
         
     /* Check that we are writing to the next frame */
     if (pos == input_list.size()) {
-        movie_changelog->registerInsertFrame(pos, inputs);
+        movie_changelog->registerInsertFrame(pos);
         emit inputsToBeInserted(pos, pos);
         input_list.push_back(inputs);
+        movie_changelog->storeNewFrames();
         emit inputsInserted(pos, pos);
         wasModified();
         return 0;
@@ -138,21 +142,23 @@ int MovieFileInputs::setInputs(const AllInputs& inputs, uint64_t pos, bool keep_
          * the end.
          */
         if (keep_inputs) {
-            movie_changelog->registerEditFrame(pos, inputs);
+            movie_changelog->registerEditFrame(pos);
             emit inputsToBeEdited(pos, pos);
-            input_list[pos] = inputs;
+            input_list.edit(pos) = inputs;
+            movie_changelog->storeNewFrames();
             emit inputsEdited(pos, pos);
         }
         else {
             movie_changelog->registerRemoveFrames(pos+1, input_list.size()-1);
-            movie_changelog->registerEditFrame(pos, inputs);
+            movie_changelog->registerEditFrame(pos);
 
             emit inputsToBeRemoved(pos, input_list.size()-1);
-            input_list.resize(pos);
+            input_list.truncate(pos);
             emit inputsRemoved(pos, input_list.size()-1);
 
             emit inputsToBeInserted(pos, pos);
             input_list.push_back(inputs);
+            movie_changelog->storeNewFrames();
             emit inputsInserted(pos, pos);
         }
         wasModified();
@@ -177,17 +183,27 @@ const AllInputs& MovieFileInputs::getInputs(uint64_t pos)
         pos = input_list.size() - 1;
     }
 
-    /* Special case for zero framerate */
-    if (input_list[pos].misc) {
-        if (!input_list[pos].misc->framerate_num)
-            input_list[pos].misc->framerate_num = framerate_num;
-        if (!input_list[pos].misc->framerate_den)
-            input_list[pos].misc->framerate_den = framerate_den;
+    /* Special case for zero framerate. Only get write access when needed,
+     * so that we don't unshare the inputs with savestate movies */
+    const AllInputs& ai = input_list[pos];
+    if (ai.misc && (!ai.misc->framerate_num || !ai.misc->framerate_den)) {
+        AllInputs& edit_ai = input_list.edit(pos);
+        if (!edit_ai.misc->framerate_num)
+            edit_ai.misc->framerate_num = framerate_num;
+        if (!edit_ai.misc->framerate_den)
+            edit_ai.misc->framerate_den = framerate_den;
     }
 
     return input_list[pos];
 }
 
+InputChunkRange MovieFileInputs::getInputRange(uint64_t pos, uint64_t count)
+{
+    /* Like getInputs(), this does not lock the input list, because the
+     * changelog calls it while the list is already locked */
+    return InputChunkRange(input_list, pos, count);
+}
+
 void MovieFileInputs::clearInputs(int minFrame, int maxFrame)
 {
     std::unique_lock<std::mutex> lock(input_list_mutex);
@@ -199,7 +215,7 @@ void MovieFileInputs::clearInputs(int minFrame, int maxFrame)
 
     emit inputsToBeEdited(minFrame, maxFrame);
     for (int i = minFrame; i <= maxFrame; i++)
-        input_list[i].clear();
+        input_list.edit(i).clear();
     emit inputsEdited(minFrame, maxFrame);
     wasModified();
 }
@@ -234,9 +250,11 @@ void MovieFileInputs::editInputs(const std::vector<AllInputs>& inputs, uint64_t
     if ((pos + count) > input_list.size())
         return;
 
-    movie_changelog->registerEditFrames(pos, pos+count-1, inputs);
+    movie_changelog->registerEditFrames(pos, pos+count-1);
     emit inputsToBeEdited(pos, pos+count-1);
-    std::copy(inputs.begin(), inputs.begin() + count, input_list.begin() + pos);
+    for (int i = 0; i < count; i++)
+        input_list.edit(pos + i) = inputs[i];
+    movie_changelog->storeNewFrames();
     emit inputsEdited(pos, pos+count-1);
     wasModified();
 }
@@ -251,9 +269,9 @@ void MovieFileInputs::insertInputsBefore(uint64_t pos, int count)
     AllInputs ai;
     ai.clear();
 
-    movie_changelog->registerInsertFrames(pos, count);
+    movie_changelog->registerInsertFrames(pos, count, true);
     emit inputsToBeInserted(pos, pos+count-1);
-    input_list.insert(input_list.begin() + pos, count, ai);
+    input_list.insert(pos, count, ai);
     emit inputsInserted(pos, pos+count-1);
     wasModified();
 }
@@ -265,9 +283,10 @@ void MovieFileInputs::insertInputsBefore(const std::vector<AllInputs>& inputs, u
     if (pos > input_list.size())
         return;
 
-    movie_changelog->registerInsertFrames(pos, inputs);
+    movie_changelog->registerInsertFrames(pos, inputs.size(), false);
     emit inputsToBeInserted(pos, pos+inputs.size()-1);
-    input_list.insert(input_list.begin() + pos, inputs.begin(), inputs.end());
+    input_list.insert(pos, inputs);
+    movie_changelog->storeNewFrames();
     emit inputsInserted(pos, pos+inputs.size()-1);
     wasModified();
 }
@@ -281,10 +300,7 @@ void MovieFileInputs::deleteInputs(uint64_t pos, int count)
 
     movie_changelog->registerRemoveFrames(pos, pos+count-1);
     emit inputsToBeRemoved(pos, pos+count-1);
-    if ((pos + count) == input_list.size())
-        input_list.resize(pos);
-    else
-        input_list.erase(input_list.begin() + pos, input_list.begin() + pos + count);
+    input_list.erase(pos, count);
     emit inputsRemoved(pos, pos+count-1);
     wasModified();
 }
@@ -293,16 +309,19 @@ void MovieFileInputs::extractInputs(std::set<SingleInput> &set)
 {
     std::unique_lock<std::mutex> lock(input_list_mutex);
 
-    for (const AllInputs &ai : input_list) {
-        ai.extractInputs(set);
+    for (uint64_t f = 0; f < input_list.size(); f++) {
+        input_list[f].extractInputs(set);
     }
 }
 
 void MovieFileInputs::copyFrom(const MovieFileInputs* movie_inputs)
 {
     emit inputsToBeReset();
-    input_list.resize(movie_inputs->input_list.size());
-    std::copy(movie_inputs->input_list.begin(), movie_inputs->input_list.end(), input_list.begin());
+    {
+        /* Only the chunk pointers are copied here */
+        std::unique_lock<std::mutex> lock(movie_inputs->input_list_mutex);
+        input_list = movie_inputs->input_list;
+    }
     emit inputsReset();
     movie_changelog->clear();
 }
@@ -321,7 +340,7 @@ bool MovieFileInputs::isEqual(const MovieFileInputs* movie, unsigned int start_f
     if (end_frame > movie->input_list.size())
         return false;
 
-    return std::equal(movie->input_list.begin() + start_frame, movie->input_list.begin() + end_frame, input_list.begin() + start_frame);
+    return input_list.isEqual(movie->input_list, start_frame, end_frame);
 }
 
 void MovieFileInputs::wasModified()
@@ -335,42 +354,64 @@ void MovieFileInputs::queueInput(uint64_t pos, SingleInput si, int value, bool i
 {
     InputPending ie;
     ie.framecount = pos;
-    ie.si = si;
+    ie.type = si.type;
+    ie.which = si.which;
     ie.value = value;
     ie.isEvent = isEvent;
-    input_queue.push(ie);
+
+    /* If the queue is full, process pending inputs ourselves instead of
+     * waiting for the main thread, which may not process them until the next
+     * frame */
+    while (!input_queue.push(ie)) {
+        while (processPendingInputs() != UINT64_MAX) {}
+    }
 }
 
 uint64_t MovieFileInputs::processPendingInputs()
 {
-    /* Process input events */
-    while (!input_queue.empty()) {
-        InputPending ie;
-        input_queue.pop(ie);
-        
-        /* Check for setting inputs before current framecount */
-        if (ie.framecount < context->framecount)
-            continue;
-        
-        std::unique_lock<std::mutex> lock(input_list_mutex);
+    std::lock_guard<std::mutex> consumer_lock(consumer_mutex);
 
-        if (ie.framecount >= input_list.size())
-            continue;
+    /* Process input events by batches, so that the input list is locked once
+     * for each batch */
+    InputPending batch[64];
+    size_t count;
+    while ((count = input_queue.pop(batch, 64)) > 0) {
+        uint64_t last_framecount = UINT64_MAX;
 
-        AllInputs& ai = input_list[ie.framecount];
-        if ((ie.si.type == SingleInput::IT_NONE) && ie.isEvent)
-            ai.clear();
-        else if (ie.isEvent) {
-            ai.events.push_back({ie.si.type, ie.si.which, ie.value});
-            ai.processEvents(); // TODO: Unoptimal to call it everytime
-        }
-        else {
-            emit inputsToBeEdited(ie.framecount, ie.framecount);
-            ai.setInput(ie.si, ie.value);
-            emit inputsEdited(ie.framecount, ie.framecount);
+        std::unique_lock<std::mutex> lock(input_list_mutex);
+
+        for (size_t i = 0; i < count; i++) {
+            const InputPending& ie = batch[i];
+
+            /* Check for setting inputs before current framecount */
+            if (ie.framecount < context->framecount)
+                continue;
+
+            if (ie.framecount >= input_list.size())
+                continue;
+
+            SingleInput si;
+            si.type = ie.type;
+            si.which = ie.which;
+
+            AllInputs& ai = input_list.edit(ie.framecount);
+            if ((si.type == SingleInput::IT_NONE) && ie.isEvent)
+                ai.clear();
+            else if (ie.isEvent) {
+                ai.events.push_back({si.type, si.which, ie.value});
+                ai.processEvents(); // TODO: Unoptimal to call it everytime
+            }
+            else {
+                emit inputsToBeEdited(ie.framecount, ie.framecount);
+                ai.setInput(si, ie.value);
+                emit inputsEdited(ie.framecount, ie.framecount);
+            }
+            wasModified();
+            last_framecount = ie.framecount;
         }
-        wasModified();
-        return ie.framecount;
+
+        if (last_framecount != UINT64_MAX)
+            return last_framecount;
     }
     return UINT64_MAX;
 }
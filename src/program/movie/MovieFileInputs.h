@@ -20,6 +20,7 @@
 #ifndef LIBTAS_MOVIEFILEINPUTS_H_INCLUDED
 #define LIBTAS_MOVIEFILEINPUTS_H_INCLUDED
 
+#include "InputChunkList.h"
 #include "ConcurrentQueue.h"
 #include "../shared/inputs/AllInputs.h"
 
@@ -35,10 +36,12 @@ struct Context;
 class MovieFileChangeLog;
 
 /* Struct to push movie changes from the UI to the main thread. UI thread should
- * never modify the movie */
+ * never modify the movie. Only the input type is stored and not the whole
+ * SingleInput, so that it can be copied in the lock-free queue */
 struct InputPending {
     uint64_t framecount;
-    SingleInput si;
+    int type;
+    unsigned int which;
     int value;
     bool isEvent;
 };
@@ -60,6 +63,10 @@ public:
      * Used to determine when a state loading increments the rerecord count. */
     bool modifiedSinceLastStateLoad;
 
+    enum {
+        INPUT_QUEUE_SIZE = 4096,
+    };
+
     /* Queue of movie input changes that where pushed by the UI, to process by the main thread */
     ConcurrentQueue<InputPending> input_queue;
 
@@ -98,6 +105,10 @@ public:
     /* Load inputs from the current frame */
     const AllInputs& getInputs();
 
+    /* Get a range of frames, that shares the chunks of the input list when
+     * possible. Used by the undo history */
+    InputChunkRange getInputRange(uint64_t pos, uint64_t count);
+
     /* Clear a range of frame inputs */
     void clearInputs(int minFrame, int maxFrame);
 
@@ -123,7 +134,8 @@ public:
     /* Extract all single inputs of all frames and insert them in the set */
     void extractInputs(std::set<SingleInput> &set);
 
-    /* Copy inputs to another one */
+    /* Copy inputs to another one. Inputs are shared between both movies
+     * until one of them is modified */
     void copyFrom(const MovieFileInputs* movie_inputs);
 
     /* Close the moviefile */
@@ -140,8 +152,8 @@ public:
      * so that it can applied by main thread */
     void queueInput(uint64_t pos, SingleInput si, int value, bool isEvent);
     
-    /* Process an input event pushed by the UI thread, and returns the modified
-     * framecount, so that the UI can be updated accordingly.
+    /* Process a batch of input events pushed by the UI thread, and returns the
+     * last modified framecount, so that the UI can be updated accordingly.
      * If no event left, returns UINT64_MAX */
     uint64_t processPendingInputs();
     
@@ -157,11 +169,15 @@ private:
     unsigned int framerate_num, framerate_den;
 
     /* The list of inputs */
-    std::vector<AllInputs> input_list;
+    InputChunkList input_list;
 
     /* We need to protect the input list access, because both the main and UI
      * threads can read and write to the list */
-    std::mutex input_list_mutex;
+    mutable std::mutex input_list_mutex;
+
+    /* Only one thread at a time can pop pending inputs, which is usually the
+     * main thread, or a producer that found the queue full */
+    std::mutex consumer_mutex;
     
 signals:
     void inputsToBeRemoved(int min_frame, int max_frame);
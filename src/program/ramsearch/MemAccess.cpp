@@ -20,9 +20,13 @@
 #include "MemAccess.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #ifdef __unix__
 #include <sys/uio.h>
+#include <limits.h> // IOV_MAX
 #elif defined(__APPLE__) && defined(__MACH__)
 #include <mach/vm_map.h>
 #include <mach/mach_traps.h>
@@ -82,6 +86,65 @@ size_t MemAccess::read(void* local_addr, void* remote_addr, size_t size)
 #endif
 }
 
+size_t MemAccess::readv(void* local_addr, const uintptr_t* remote_addrs, size_t count, size_t size, bool* valid)
+{
+    uint8_t* local = static_cast<uint8_t*>(local_addr);
+    size_t nb_read = 0;
+
+    if (!game_pid) {
+        memset(local, 0, count * size);
+        if (valid)
+            std::fill(valid, valid + count, false);
+        return 0;
+    }
+
+#ifdef __unix__
+    std::vector<struct iovec> local_iov(std::min(count, static_cast<size_t>(IOV_MAX)));
+    std::vector<struct iovec> remote_iov(local_iov.size());
+
+    size_t done = 0;
+    while (done < count) {
+        size_t batch = std::min(count - done, local_iov.size());
+        for (size_t i = 0; i < batch; i++) {
+            local_iov[i].iov_base = local + (done + i) * size;
+            local_iov[i].iov_len = size;
+            remote_iov[i].iov_base = reinterpret_cast<void*>(remote_addrs[done + i]);
+            remote_iov[i].iov_len = size;
+        }
+
+        /* The transfer stops at the first element that cannot be read, and
+         * never splits an element */
+        ssize_t ret = process_vm_readv(game_pid, local_iov.data(), batch, remote_iov.data(), batch, 0);
+        size_t full = (ret > 0) ? (static_cast<size_t>(ret) / size) : 0;
+
+        if (valid)
+            std::fill(valid + done, valid + done + full, true);
+        nb_read += full;
+        done += full;
+
+        if (full < batch) {
+            /* Skip the failing element */
+            memset(local + done * size, 0, size);
+            if (valid)
+                valid[done] = false;
+            done++;
+        }
+    }
+#elif defined(__APPLE__) && defined(__MACH__)
+    for (size_t i = 0; i < count; i++) {
+        bool ok = (read(local + i * size, reinterpret_cast<void*>(remote_addrs[i]), size) == size);
+        if (!ok)
+            memset(local + i * size, 0, size);
+        if (valid)
+            valid[i] = ok;
+        if (ok)
+            nb_read++;
+    }
+#endif
+
+    return nb_read;
+}
+
 uintptr_t MemAccess::readAddr(void* remote_addr, bool* valid)
 {
     if (game_addr_size == 4) {
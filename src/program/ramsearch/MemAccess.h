@@ -21,6 +21,7 @@
 #define LIBTAS_MEMACCESS_H_INCLUDED
 
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 /* Functions to read/write into game memroy */
@@ -35,6 +36,13 @@ namespace MemAccess {
     size_t read(void* local_addr, void* remote_addr, size_t size);
     size_t readAddr(void* local_addr, bool* valid);
 
+    /* Read `count` elements of `size` bytes from each address of
+     * `remote_addrs`, stored contiguously in `local_addr`, using as few
+     * syscalls as possible. Elements that could not be read are zeroed, and
+     * `valid` (if not null) gets the validity of each element.
+     * Returns the number of elements read. */
+    size_t readv(void* local_addr, const uintptr_t* remote_addrs, size_t count, size_t size, bool* valid);
+
     size_t write(void* local_addr, void* remote_addr, size_t size);    
 }
 
@@ -186,12 +186,12 @@ void ControllerTabWindow::keyPressEvent(QKeyEvent *e)
 
     if (context->config.km->hotkey_mapping.find(ks | mod) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks | mod];
-        context->hotkey_pressed_queue.push(hk.type);
+        context->pushHotkeyPressed(hk.type);
         return;
     }
     if (context->config.km->hotkey_mapping.find(ks) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks];
-        context->hotkey_pressed_queue.push(hk.type);
+        context->pushHotkeyPressed(hk.type);
         return;
     }
     if (context->config.km->input_mapping.find(ks) != context->config.km->input_mapping.end()) {
@@ -210,12 +210,12 @@ void ControllerTabWindow::keyReleaseEvent(QKeyEvent *e)
 
     if (context->config.km->hotkey_mapping.find(ks | mod) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks | mod];
-        context->hotkey_released_queue.push(hk.type);
+        context->pushHotkeyReleased(hk.type);
         return;
     }
     if (context->config.km->hotkey_mapping.find(ks) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks];
-        context->hotkey_released_queue.push(hk.type);
+        context->pushHotkeyReleased(hk.type);
         return;
     }
     if (context->config.km->input_mapping.find(ks) != context->config.km->input_mapping.end()) {
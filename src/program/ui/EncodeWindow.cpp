@@ -76,6 +76,19 @@ EncodeWindow::EncodeWindow(Context* c, QWidget *parent) : QDialog(parent), conte
 
     ffmpegOptions = new QLineEdit();
 
+    backendChoice = new QComboBox();
+    backendChoice->addItem(tr("ffmpeg process"), SharedConfig::ENCODER_FFMPEG_PIPE);
+    backendChoice->addItem(tr("In-process (libavcodec)"), SharedConfig::ENCODER_LIBAV);
+    backendChoice->setToolTip(tr("Encode inside the game process to avoid piping raw frames to ffmpeg. Only a subset of ffmpeg options is supported, and ffmpeg is used if the libraries are not available."));
+
+    queueSize = new QSpinBox();
+    queueSize->setMaximum(64);
+    queueSize->setSpecialValueText(tr("Disabled"));
+    queueSize->setToolTip(tr("Number of frames that can be waiting for the encoder thread before the game is paused. Disabled to encode on the game thread."));
+
+    skipDuplicates = new QCheckBox(tr("Skip duplicate frames"));
+    skipDuplicates->setToolTip(tr("Do not send frames identical to the previous one to ffmpeg. Variable framerate containers like mkv will store them as longer frames."));
+
     QGroupBox *codecGroupBox = new QGroupBox(tr("Encode codec settings"));
     QGridLayout *encodeCodecLayout = new QGridLayout;
     encodeCodecLayout->addWidget(new QLabel(tr("Video codec:")), 0, 0);
@@ -94,6 +107,14 @@ EncodeWindow::EncodeWindow(Context* c, QWidget *parent) : QDialog(parent), conte
     encodeCodecLayout->addWidget(new QLabel(tr("Video framerate:")), 3, 0);
     encodeCodecLayout->addWidget(videoFramerate, 3, 1, 1, 4);
 
+    encodeCodecLayout->addWidget(new QLabel(tr("Encoder queue (frames):")), 4, 0);
+    encodeCodecLayout->addWidget(queueSize, 4, 1, 1, 4);
+
+    encodeCodecLayout->addWidget(skipDuplicates, 5, 0, 1, 5);
+
+    encodeCodecLayout->addWidget(new QLabel(tr("Encoder:")), 6, 0);
+    encodeCodecLayout->addWidget(backendChoice, 6, 1, 1, 4);
+
     encodeCodecLayout->setColumnMinimumWidth(2, 50);
     encodeCodecLayout->setColumnStretch(2, 1);
     codecGroupBox->setLayout(encodeCodecLayout);
@@ -147,6 +168,15 @@ void EncodeWindow::update_config()
     else
         videoFramerate->setValue(context->config.sc.initial_framerate_num / context->config.sc.initial_framerate_den);
 
+    /* Set encoder backend */
+    int backendIndex = backendChoice->findData(context->config.sc.encoding_backend);
+    if (backendIndex >= 0)
+        backendChoice->setCurrentIndex(backendIndex);
+
+    /* Set encoder queue size */
+    queueSize->setValue(context->config.sc.encoding_queue_size);
+    skipDuplicates->setChecked(context->config.sc.encoding_skip_duplicates);
+
     if (context->config.ffmpegoptions.empty()) {
         slotUpdate();
     }
@@ -216,6 +246,9 @@ void EncodeWindow::slotOk()
     context->config.ffmpegoptions = ffmpegOptions->text().toStdString();
 
     context->config.sc.video_framerate = videoFramerate->value();
+    context->config.sc.encoding_backend = backendChoice->currentData().toInt();
+    context->config.sc.encoding_queue_size = queueSize->value();
+    context->config.sc.encoding_skip_duplicates = skipDuplicates->isChecked();
 
     context->config.sc_modified = true;
 
@@ -24,6 +24,7 @@
 #include "movie/MovieFile.h"
 #include "movie/InputSerialization.h"
 #include "SaveStateList.h"
+#include "Greenzone.h"
 #include "SaveState.h"
 #include "../shared/inputs/SingleInput.h"
 #include "../shared/inputs/AllInputs.h"
@@ -49,6 +50,14 @@ InputEditorModel::InputEditorModel(Context* c, MovieFile* m, QObject *parent) :
 
     paintMinRow = -1;
     undoTimeoutSec = 0;
+
+    row_cache.resize(ROW_CACHE_SIZE);
+
+    savestateFont.setBold(true);
+    markerFont.setStretch(QFont::ExtraExpanded);
+    markerFont.setBold(true);
+    updatePalette();
+
     undoTimer = new QTimer(this);
     connect(undoTimer, &QTimer::timeout, this, &InputEditorModel::highlightUndo);
 }
@@ -77,7 +86,7 @@ Qt::ItemFlags InputEditorModel::flags(const QModelIndex &index) const
         return QAbstractItemModel::flags(index);
 
     /* Don't toggle past inputs before root savestate */
-    uint64_t root_frame = SaveStateList::rootStateFramecount();
+    uint64_t root_frame = rootFramecount();
     if (!root_frame) {
         if (index.row() < static_cast<int>(context->framecount))
             return QAbstractItemModel::flags(index);
@@ -90,7 +99,6 @@ Qt::ItemFlags InputEditorModel::flags(const QModelIndex &index) const
     if (index.row() >= frameCount())
         return QAbstractItemModel::flags(index);
 
-    const AllInputs& ai = movie->inputs->getInputs(index.row());
     const SingleInput si = movie->editor->input_set[index.column()-COLUMN_SPECIAL_SIZE];
 
     /* Don't edit locked input */
@@ -98,7 +106,7 @@ Qt::ItemFlags InputEditorModel::flags(const QModelIndex &index) const
         return QAbstractItemModel::flags(index);
 
     /* Don't edit inputs that have events */
-    if (!ai.events.empty())
+    if (cachedRow(index.row()).has_events)
         return QAbstractItemModel::flags(index);
 
     if (si.isAnalog())
@@ -174,38 +182,32 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
     }
 
     if (role == Qt::FontRole) {
-        QFont font;
-        if (col == COLUMN_SAVESTATE && row == last_savestate) {
-            font.setBold(true);
-        }
-        else if (col == COLUMN_FRAME && movie->editor->markers.count(row)) {
-            font.setStretch(QFont::ExtraExpanded);
-            font.setBold(true);
-        }
-        return font;
+        if (col == COLUMN_SAVESTATE && row == last_savestate)
+            return savestateFont;
+        if (col == COLUMN_FRAME && movie->editor->markers.count(row))
+            return markerFont;
+        return defaultFont;
     }
 
     if (role == Qt::ForegroundRole) {
         if (row >= frameCount()) {
-            return QGuiApplication::palette().text();
+            return QBrush(textColor);
         }
         if (col < COLUMN_SPECIAL_SIZE) {
-            return QGuiApplication::palette().text();
+            return QBrush(textColor);
         }
 
-        QColor color = QGuiApplication::palette().text().color();
+        QColor color = textColor;
         const SingleInput si = movie->editor->input_set[col-COLUMN_SPECIAL_SIZE];
-        const AllInputs& ai = movie->inputs->getInputs(row);
-        int current_value = ai.getInput(si);
+        int current_value = cachedRow(row).values[col-COLUMN_SPECIAL_SIZE];
 
         /* Show inputs with transparancy when they are pending due to rewind */
         bool pending_input = false;
-        movie->inputs->input_queue.lock();
-        for (auto it = movie->inputs->input_queue.begin(); it != movie->inputs->input_queue.end(); it++) {
-            if (it->framecount != row)
-                continue;
+        movie->inputs->input_queue.forEach([&](const InputPending& ip) {
+            if (ip.framecount != row)
+                return;
 
-            if (si == it->si) {
+            if ((si.type == ip.type) && (si.which == ip.which)) {
                 pending_input = true;
                 /* For analog, use half-transparancy. Otherwise,
                  * use strong/weak transparancy of set/clear input */
@@ -214,15 +216,14 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
                 }
                 else {
                     int alpha = 0;
-                    if (it->value) alpha += 192;
+                    if (ip.value) alpha += 192;
                     if (current_value) alpha += 63;
                     color.setAlpha(alpha);
                 }
                 /* We don't return the brush immediatly, because users may change
                  * multiple times the same input. */
             }
-        }
-        movie->inputs->input_queue.unlock();
+        });
 
         /* Show the current paint operation */
         if (paintMinRow != -1) {
@@ -252,9 +253,7 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
                 col == hoveredIndex.column() &&
                 row == hoveredIndex.row() &&
                 !si.isAnalog()) {
-            const AllInputs& ai = movie->inputs->getInputs(row);
-            int value = ai.getInput(si);
-            if (!value) {
+            if (!current_value) {
                 color.setAlpha(128);
             }
         }
@@ -264,18 +263,16 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
 
     if (role == Qt::BackgroundRole) {
         /* Main color */
-        QColor color = QGuiApplication::palette().window().color();
+        QColor color = windowColor;
         
         if (row >= frameCount())
             return QBrush(color);
             
-        bool lightTheme = isLightTheme();
         int r, g, b;
         color.getRgb(&r, &g, &b, nullptr);
         
         /* Greenzone */
-        uint64_t root_frame = SaveStateList::rootStateFramecount();
-        bool greenzone = (row < context->framecount) && root_frame && (row >= root_frame);
+        bool greenzone = (row < context->framecount) && cached_root_frame && (row >= cached_root_frame);
 
         if (lightTheme) {
             /* Light theme */
@@ -375,7 +372,7 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
                 int r, g, b;
                 color.getRgb(&r, &g, &b, nullptr);
 
-                if (isLightTheme) {
+                if (lightTheme) {
                     color.setRgb(r-60.0f*undoTimeoutSec, g-60.0f*undoTimeoutSec, b);
                 }
                 else {
@@ -384,9 +381,7 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
             }
         }
 
-        const AllInputs& ai = movie->inputs->getInputs(row);
-//        return QBrush(color, ai.events.empty()?Qt::SolidPattern:Qt::Dense3Pattern);
-        return QBrush(color, ai.events.empty()?Qt::SolidPattern:Qt::BDiagPattern);
+        return QBrush(color, cachedRow(row).has_events?Qt::BDiagPattern:Qt::SolidPattern);
     }
 
     if (role == Qt::DisplayRole) {
@@ -430,11 +425,11 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
             return row;
         }
 
-        const AllInputs& ai = movie->inputs->getInputs(row);
+        const RowCache& rc = cachedRow(row);
         const SingleInput si = movie->editor->input_set[col-COLUMN_SPECIAL_SIZE];
 
         /* Get the value of the single input in movie inputs */
-        int value = ai.getInput(si);
+        int value = rc.values[col-COLUMN_SPECIAL_SIZE];
         
         /* If hovering on the cell, show a preview of the input */
         if (col == hoveredIndex.column() &&
@@ -444,13 +439,12 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
         }
 
         /* If the value is currently being modified, load the new value */
-        movie->inputs->input_queue.lock();
-        for (auto it = movie->inputs->input_queue.begin(); it != movie->inputs->input_queue.end(); it++) {
-            if (it->framecount != row)
-                continue;
-            if (si == it->si) {
+        movie->inputs->input_queue.forEach([&](const InputPending& ip) {
+            if (ip.framecount != row)
+                return;
+            if ((si.type == ip.type) && (si.which == ip.which)) {
                 if (si.isAnalog()) {
-                    value = it->value;
+                    value = ip.value;
                 }
                 else {
                     /* For non-analog values, always print the value, and the
@@ -459,8 +453,7 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
                     value = 1;
                 }
             }
-        }
-        movie->inputs->input_queue.unlock();
+        });
 
         /* If the current value is being painted, load the new value */
         if (paintMinRow != -1) {
@@ -481,10 +474,7 @@ QVariant InputEditorModel::data(const QModelIndex &index, int role) const
             /* Default framerate has a value of 0, which may be confusing,
              * so we just print `-` in place. */
             if ((si.type == SingleInput::IT_FRAMERATE_NUM) || (si.type == SingleInput::IT_FRAMERATE_DEN)) {
-                if (!ai.misc)
-                    return QVariant();
-                if ((ai.misc->framerate_num == movie->header->framerate_num) && 
-                    (ai.misc->framerate_den == movie->header->framerate_den))
+                if (rc.default_framerate)
                     return QVariant();
             }
             if ((si.type == SingleInput::IT_REALTIME_SEC) && (value == 0))
@@ -630,7 +620,7 @@ void InputEditorModel::endPaint()
         bool ret = rewind(paintMinRow, true);
         if (!ret) {
             /* Try rewinding to the earliest frame possible and paint what is possible */
-            uint64_t root_frame = SaveStateList::rootStateFramecount();
+            uint64_t root_frame = rootFramecount();
             if (root_frame > paintMaxRow) {
                 paintMinRow = -1;
                 return;
@@ -953,6 +943,7 @@ bool InputEditorModel::removeUniqueInput(int column)
     /* Remove the column */
     beginRemoveColumns(QModelIndex(), column, column);
     movie->editor->input_set.erase(movie->editor->input_set.begin() + (column-COLUMN_SPECIAL_SIZE));
+    invalidateRowCache();
     endRemoveColumns();
     
     return true;
@@ -1003,6 +994,7 @@ void InputEditorModel::beginResetInputs()
 
 void InputEditorModel::endResetInputs()
 {
+    invalidateRowCache();
     buildInputSet();
     last_savestate = 0;
     endResetModel();
@@ -1016,6 +1008,8 @@ void InputEditorModel::beginInsertInputs(int minRow, int maxRow)
 
 void InputEditorModel::endInsertInputs(int minRow, int maxRow)
 {
+    /* Following rows were shifted */
+    invalidateRowCache();
     endInsertRows();
 
     /* We have to check if new inputs were added */
@@ -1039,6 +1033,7 @@ void InputEditorModel::beginEditInputs(int minRow, int maxRow)
 
 void InputEditorModel::endEditInputs(int minRow, int maxRow)
 {
+    invalidateRowCache(minRow, maxRow);
     emit dataChanged(index(minRow,0), index(maxRow,columnCount()-1));
 
     /* We have to check if new inputs were added */
@@ -1063,6 +1058,8 @@ void InputEditorModel::beginRemoveInputs(int minRow, int maxRow)
 
 void InputEditorModel::endRemoveInputs(int minRow, int maxRow)
 {
+    /* Following rows were shifted */
+    invalidateRowCache();
     endRemoveRows();
 
     /* Detect undo/redo operation */
@@ -1079,6 +1076,9 @@ void InputEditorModel::endRemoveInputs(int minRow, int maxRow)
 
 void InputEditorModel::update()
 {
+    cached_root_frame = rootFramecount();
+    updatePalette();
+
     static uint64_t current_framecount = 0;
     if (context->framecount != current_framecount) {
         emit dataChanged(index(context->framecount,0), index(context->framecount,columnCount()-1));
@@ -1118,6 +1118,8 @@ void InputEditorModel::registerSavestate(int slot, unsigned long long frame)
     else
         last_savestate = frame;
     
+    cached_root_frame = rootFramecount();
+
     /* Update greenzone between old and new root savestate */
     uint64_t oldRoot = SaveStateList::oldRootStateFramecount();
     uint64_t newRoot = SaveStateList::rootStateFramecount();
@@ -1136,6 +1138,7 @@ void InputEditorModel::moveInputs(int oldIndex, int newIndex)
     SingleInput si = movie->editor->input_set[oldIndex];
     movie->editor->input_set.erase(movie->editor->input_set.begin() + oldIndex);
     movie->editor->input_set.insert(movie->editor->input_set.begin() + newIndex, si);
+    invalidateRowCache();
 }
 
 bool InputEditorModel::rewind(uint64_t framecount, bool toggle)
@@ -1153,29 +1156,49 @@ bool InputEditorModel::rewind(uint64_t framecount, bool toggle)
         return true;
 
     int state = 0;
+    uint64_t greenzone_framecount = 0;
     if (framecount < context->framecount) {
         state = SaveStateList::nearestState(framecount, movie);
-        if (state == -1)
+
+        /* Use a greenzone state if it is closer than any savestate */
+        greenzone_framecount = Greenzone::nearestFramecount(framecount);
+        if ((state != -1) && (SaveStateList::get(state).framecount >= greenzone_framecount))
+            greenzone_framecount = 0;
+
+        if ((state == -1) && !greenzone_framecount)
             /* No available savestate before the given framecount */
             return false;
     }
         
+    /* Gather all hotkeys, so that they are pushed together or not at all */
+    HotKeyType hotkeys[4];
+    size_t hotkey_count = 0;
+
     /* Switch to playback if needed */
     int recording = context->config.sc.recording;
-    if (recording == SharedConfig::RECORDING_WRITE) {
-        context->hotkey_pressed_queue.push(HOTKEY_READWRITE);
-    }
+    if (recording == SharedConfig::RECORDING_WRITE)
+        hotkeys[hotkey_count++] = HOTKEY_READWRITE;
 
     /* Save current framecount because it will be replaced by state loading */
     uint64_t current_framecount = context->framecount;
 
     /* Load state */
+    uint64_t state_framecount = current_framecount;
     if (framecount < current_framecount) {
-        context->hotkey_pressed_queue.push(HOTKEY_LOADSTATE1 + (state-1));
+        if (greenzone_framecount) {
+            Greenzone::requestLoad(framecount);
+            hotkeys[hotkey_count++] = HOTKEY_LOADGREENZONE;
+            state_framecount = greenzone_framecount;
+        }
+        else {
+            hotkeys[hotkey_count++] = HOTKEY_LOADSTATE1 + (state-1);
+            state_framecount = SaveStateList::get(state).framecount;
+        }
     }
 
     /* Fast-forward to frame if further than state/current framecount */
-    uint64_t state_framecount = (framecount < current_framecount)?(SaveStateList::get(state).framecount):current_framecount;
+    uint64_t old_seek_frame = context->seek_frame;
+    bool old_freeze_scroll = freeze_scroll;
     
     if (framecount > state_framecount) {
         /* Seek to either the modified frame or the current frame */
@@ -1188,15 +1211,21 @@ bool InputEditorModel::rewind(uint64_t framecount, bool toggle)
         freeze_scroll = true;
 
         if (context->config.editor_rewind_fastforward)
-            context->hotkey_pressed_queue.push(HOTKEY_FASTFORWARD);
+            hotkeys[hotkey_count++] = HOTKEY_FASTFORWARD;
 
         if (!context->config.sc.running)
-            context->hotkey_pressed_queue.push(HOTKEY_PLAYPAUSE);
+            hotkeys[hotkey_count++] = HOTKEY_PLAYPAUSE;
     }
     else {
         /* Just pause */
         if (context->config.sc.running)
-            context->hotkey_pressed_queue.push(HOTKEY_PLAYPAUSE);
+            hotkeys[hotkey_count++] = HOTKEY_PLAYPAUSE;
+    }
+
+    if (!context->pushHotkeysPressed(hotkeys, hotkey_count)) {
+        context->seek_frame = old_seek_frame;
+        freeze_scroll = old_freeze_scroll;
+        return false;
     }
     
     /* To display a progress bar showing that a state is loading, we must
@@ -1207,6 +1236,68 @@ bool InputEditorModel::rewind(uint64_t framecount, bool toggle)
     return true;
 }
 
+uint64_t InputEditorModel::rootFramecount() const
+{
+    uint64_t root_frame = SaveStateList::rootStateFramecount();
+    uint64_t greenzone_frame = Greenzone::rootFramecount();
+
+    if (!root_frame || (greenzone_frame && (greenzone_frame < root_frame)))
+        return greenzone_frame;
+    return root_frame;
+}
+
+const InputEditorModel::RowCache& InputEditorModel::cachedRow(int row) const
+{
+    RowCache& rc = row_cache[row % ROW_CACHE_SIZE];
+    const std::vector<SingleInput>& input_set = movie->editor->input_set;
+
+    /* New input columns may have been added */
+    if ((rc.row == row) && (rc.values.size() == input_set.size()))
+        return rc;
+
+    const AllInputs& ai = movie->inputs->getInputs(row);
+
+    rc.values.resize(input_set.size());
+    for (unsigned int i = 0; i < input_set.size(); i++)
+        rc.values[i] = ai.getInput(input_set[i]);
+
+    rc.has_events = !ai.events.empty();
+    rc.default_framerate = !ai.misc ||
+        ((ai.misc->framerate_num == movie->header->framerate_num) &&
+         (ai.misc->framerate_den == movie->header->framerate_den));
+    rc.row = row;
+
+    return rc;
+}
+
+void InputEditorModel::invalidateRowCache()
+{
+    for (RowCache& rc : row_cache)
+        rc.row = -1;
+}
+
+void InputEditorModel::invalidateRowCache(int minRow, int maxRow)
+{
+    if ((maxRow - minRow) >= ROW_CACHE_SIZE) {
+        invalidateRowCache();
+        return;
+    }
+
+    for (int row = minRow; row <= maxRow; row++) {
+        RowCache& rc = row_cache[row % ROW_CACHE_SIZE];
+        if (rc.row == row)
+            rc.row = -1;
+    }
+}
+
+void InputEditorModel::updatePalette()
+{
+    const QPalette palette = QGuiApplication::palette();
+    textColor = palette.text().color();
+    windowColor = palette.window().color();
+    lightTheme = isLightTheme();
+}
+
 bool InputEditorModel::isScrollFreeze()
 {
     return freeze_scroll;
@@ -1224,8 +1315,12 @@ void InputEditorModel::setHoveredCell(const QModelIndex &i)
     
     const QModelIndex old = hoveredIndex;
     hoveredIndex = i;
-    emit dataChanged(index(0,old.column()), index(rowCount(),old.column()), roles);
-    emit dataChanged(index(0,hoveredIndex.column()), index(rowCount(),hoveredIndex.column()), QVector<int>(1, Qt::BackgroundRole));
+
+    /* Only the previous and new hovered cells show an input preview */
+    if (old.isValid())
+        emit dataChanged(old, old, roles);
+    if (hoveredIndex.isValid())
+        emit dataChanged(hoveredIndex, hoveredIndex, roles);
     emit headerDataChanged(Qt::Horizontal, old.column(), old.column());
     emit headerDataChanged(Qt::Horizontal, hoveredIndex.column(), hoveredIndex.column());
 }
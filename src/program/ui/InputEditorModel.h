@@ -24,6 +24,8 @@
 
 #include <QtCore/QAbstractTableModel>
 #include <QtCore/QTimer>
+#include <QtGui/QFont>
+#include <QtGui/QColor>
 #include <vector>
 #include <sstream>
 #include <stdint.h>
@@ -209,6 +211,48 @@ private:
 
     /* Current hovered cell */
     QModelIndex hoveredIndex;
+
+    /* Returns the earliest frame that can be rewinded to, from either
+     * savestates or greenzone states, or 0 */
+    uint64_t rootFramecount() const;
+
+    /* Decoded values of a movie row, so that each cell and role does not
+     * have to lock and decode the movie inputs */
+    struct RowCache {
+        int row = -1;
+        std::vector<int> values;
+        bool has_events;
+        bool default_framerate;
+    };
+
+    enum {
+        ROW_CACHE_SIZE = 256,
+    };
+
+    /* Direct-mapped cache of rows, indexed by row modulo the cache size, which
+     * is larger than any visible window of rows */
+    mutable std::vector<RowCache> row_cache;
+
+    /* Return the cached values of a movie row, decoding the row if needed */
+    const RowCache& cachedRow(int row) const;
+
+    /* Invalidate all cached rows, or a range of rows */
+    void invalidateRowCache();
+    void invalidateRowCache(int minRow, int maxRow);
+
+    /* Fonts and colors, computed once instead of for each cell */
+    QFont defaultFont;
+    QFont savestateFont;
+    QFont markerFont;
+    QColor textColor;
+    QColor windowColor;
+    bool lightTheme;
+
+    /* Root frame, updated on each UI update */
+    uint64_t cached_root_frame = 0;
+
+    /* Compute colors from the current palette */
+    void updatePalette();
     
     /* Parameters of the current range being painted */
     SingleInput paintInput;
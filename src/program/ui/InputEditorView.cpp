@@ -410,9 +410,10 @@ void InputEditorView::wheelEvent(QWheelEvent *event)
 
     if (event->angleDelta().y() < 0) {
         /* Push a single frame advance event */
-        if (context->hotkey_pressed_queue.empty() || context->hotkey_pressed_queue.back() != HOTKEY_FRAMEADVANCE) {
-            context->hotkey_pressed_queue.push(HOTKEY_FRAMEADVANCE);
-            context->hotkey_released_queue.push(HOTKEY_FRAMEADVANCE);
+        HotKeyType last_hotkey;
+        if (!context->hotkey_pressed_queue.back(last_hotkey) || (last_hotkey != HOTKEY_FRAMEADVANCE)) {
+            if (context->pushHotkeyPressed(HOTKEY_FRAMEADVANCE))
+                context->pushHotkeyReleased(HOTKEY_FRAMEADVANCE);
         }
     }
     else if (event->angleDelta().y() > 0) {
@@ -544,12 +545,12 @@ void InputEditorView::keyPressEvent(QKeyEvent *event)
 
     if (context->config.km->hotkey_mapping.find(ks | mod) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks | mod];
-        context->hotkey_pressed_queue.push(hk.type);
+        context->pushHotkeyPressed(hk.type);
         return;
     }
     if (context->config.km->hotkey_mapping.find(ks) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks];
-        context->hotkey_pressed_queue.push(hk.type);
+        context->pushHotkeyPressed(hk.type);
         return;
     }
 
@@ -568,12 +569,12 @@ void InputEditorView::keyReleaseEvent(QKeyEvent *event)
 
     if (context->config.km->hotkey_mapping.find(ks | mod) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks | mod];
-        context->hotkey_released_queue.push(hk.type);
+        context->pushHotkeyReleased(hk.type);
         return;
     }
     if (context->config.km->hotkey_mapping.find(ks) != context->config.km->hotkey_mapping.end()) {
         HotKey hk = context->config.km->hotkey_mapping[ks];
-        context->hotkey_released_queue.push(hk.type);
+        context->pushHotkeyReleased(hk.type);
         return;
     }
 
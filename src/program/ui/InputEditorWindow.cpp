@@ -97,6 +97,26 @@ InputEditorWindow::InputEditorWindow(Context* c, MovieFile *movie, QWidget *pare
 
     markerPauseAct->setCheckable(true);
 
+    optionMenu->addSeparator();
+
+    greenzoneAct = optionMenu->addAction(tr("Automatic greenzone states"), this,
+        [=](bool checked){context->config.editor_greenzone = checked;});
+
+    greenzoneAct->setCheckable(true);
+
+    QMenu* greenzoneIntervalMenu = optionMenu->addMenu(tr("Greenzone state interval"));
+    greenzoneIntervalGroup = new QActionGroup(this);
+    connect(greenzoneIntervalGroup, &QActionGroup::triggered, this,
+        [=](QAction* action){context->config.editor_greenzone_interval = action->data().toInt();});
+
+    const int intervals[] = {10, 30, 60, 120, 300};
+    for (int interval : intervals) {
+        QAction* action = greenzoneIntervalMenu->addAction(QString(tr("%1 frames")).arg(interval));
+        action->setCheckable(true);
+        action->setData(interval);
+        greenzoneIntervalGroup->addAction(action);
+    }
+
     /* Status bar */
     statusFrame = new QLabel(tr("No frame selected"));
     statusBar()->addWidget(statusFrame);
@@ -131,6 +151,13 @@ void InputEditorWindow::update_config()
     rewindAct->setChecked(context->config.editor_rewind_seek);
     fastforwardAct->setChecked(!context->config.editor_rewind_fastforward);
     markerPauseAct->setChecked(context->config.editor_marker_pause);
+    greenzoneAct->setChecked(context->config.editor_greenzone);
+    for (auto& action : greenzoneIntervalGroup->actions()) {
+        if (action->data().toInt() == context->config.editor_greenzone_interval) {
+            action->setChecked(true);
+            break;
+        }
+    }
 }
 
 QSize InputEditorWindow::sizeHint() const
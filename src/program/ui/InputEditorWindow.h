@@ -25,6 +25,7 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QProgressBar>
 #include <QtWidgets/QGroupBox>
+#include <QtWidgets/QActionGroup>
 
 /* Forward declaration */
 struct Context;
@@ -62,6 +63,8 @@ private:
     QAction* rewindAct;
     QAction* fastforwardAct;
     QAction* markerPauseAct;
+    QAction* greenzoneAct;
+    QActionGroup* greenzoneIntervalGroup;
     QLabel* statusFrame;
     QProgressBar* statusSeek;
 };
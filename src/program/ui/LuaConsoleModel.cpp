@@ -35,7 +35,7 @@ int LuaConsoleModel::rowCount(const QModelIndex & /*parent*/) const
 
 int LuaConsoleModel::columnCount(const QModelIndex & /*parent*/) const
 {
-    return 3;
+    return 6;
 }
 
 Qt::ItemFlags LuaConsoleModel::flags(const QModelIndex &index) const
@@ -56,6 +56,12 @@ QVariant LuaConsoleModel::headerData(int section, Qt::Orientation orientation, i
                 return QString("Name");
             case 2:
                 return QString("Path");
+            case 3:
+                return QString("Calls");
+            case 4:
+                return QString("Total (ms)");
+            case 5:
+                return QString("Max (µs)");
             }
         }
     }
@@ -72,7 +78,14 @@ QVariant LuaConsoleModel::data(const QModelIndex &index, int role) const
         return Qt::Unchecked;        
     }
 
+    if (role == Qt::TextAlignmentRole && index.column() >= 3)
+        return QVariant(Qt::AlignRight | Qt::AlignVCenter);
+
     if (role == Qt::DisplayRole) {
+        uint64_t calls, total_us, max_us;
+        if (index.column() >= 3)
+            lfl.fileProfile(index.row(), calls, total_us, max_us);
+
         switch(index.column()) {
             case 0:
                 return QString("");
@@ -80,6 +93,12 @@ QVariant LuaConsoleModel::data(const QModelIndex &index, int role) const
                 return QString(lfl.fileList[index.row()].filename.c_str());
             case 2:
                 return QString(lfl.fileList[index.row()].file.c_str());
+            case 3:
+                return QString::number(calls);
+            case 4:
+                return QString::number(total_us / 1000.0, 'f', 1);
+            case 5:
+                return QString::number(max_us);
             default:
                 return QString();
         }
@@ -130,5 +149,11 @@ void LuaConsoleModel::clear()
 
 void LuaConsoleModel::update()
 {
-    Lua::Callbacks::getList().watchChanges();
+    Lua::LuaFunctionList& lfl = Lua::Callbacks::getList();
+
+    lfl.watchChanges();
+
+    /* Refresh the timing columns */
+    if (lfl.fileCount() > 0)
+        emit dataChanged(index(0, 3), index(lfl.fileCount() - 1, 5));
 }
@@ -22,6 +22,8 @@
 
 #include "Context.h"
 #include "lua/Print.h"
+#include "lua/Callbacks.h"
+#include "lua/LuaFunctionList.h"
  
 #include <QtWidgets/QTableView>
 #include <QtWidgets/QPushButton>
@@ -44,6 +46,9 @@ LuaConsoleWindow::LuaConsoleWindow(Context *c, QWidget *parent) : QMainWindow(pa
     scriptMenu->addAction(tr("Remove script file"), this, &LuaConsoleWindow::removeScript);
     scriptMenu->addAction(tr("Clear all script files"), this, &LuaConsoleWindow::clearScripts);
     scriptMenu->addAction(tr("Clear output window"), this, &LuaConsoleWindow::slotClear);
+    scriptMenu->addSeparator();
+    scriptMenu->addAction(tr("Show callback timings"), this, &LuaConsoleWindow::showTimings);
+    scriptMenu->addAction(tr("Reset callback timings"), this, &LuaConsoleWindow::resetTimings);
 
     /* Table */
     luaView = new QTableView(this);
@@ -62,6 +67,9 @@ LuaConsoleWindow::LuaConsoleWindow(Context *c, QWidget *parent) : QMainWindow(pa
     luaView->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Interactive);
     luaView->horizontalHeader()->resizeSection(1, 80);
     luaView->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
+    luaView->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
+    luaView->horizontalHeader()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
+    luaView->horizontalHeader()->setSectionResizeMode(5, QHeaderView::ResizeToContents);
 
     /* Text Edit */
     consoleText = new QPlainTextEdit();
@@ -121,3 +129,18 @@ void LuaConsoleWindow::clearScripts()
 {
     luaModel->clear();
 }
+
+void LuaConsoleWindow::showTimings()
+{
+    std::string report = Lua::Callbacks::getList().profileReport();
+    if (report.empty())
+        consoleText->appendPlainText(tr("No registered callback"));
+    else
+        consoleText->appendPlainText(QString::fromStdString(report).trimmed());
+}
+
+void LuaConsoleWindow::resetTimings()
+{
+    Lua::Callbacks::getList().resetProfile();
+    luaModel->update();
+}
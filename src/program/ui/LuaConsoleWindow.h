@@ -50,6 +50,8 @@ private slots:
     void addScript();
     void removeScript();
     void clearScripts();
+    void showTimings();
+    void resetTimings();
 };
 
 #endif
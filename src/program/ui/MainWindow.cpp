@@ -183,6 +183,7 @@ MainWindow::MainWindow(Context* c) : QMainWindow(), context(c)
     connect(gameLoop, &GameLoop::getMarkerText, inputEditorWindow->inputEditorView, &InputEditorView::getCurrentMarkerText, Qt::DirectConnection);
     connect(gameLoop->gameEvents, &GameEvents::savestatePerformed, inputEditorWindow->inputEditorView->inputEditorModel, &InputEditorModel::registerSavestate);
     connect(gameLoop, &GameLoop::getTimeTrace, timeTraceWindow->timeTraceModel, &TimeTraceModel::addCall);
+    connect(gameLoop, &GameLoop::getTimeTraceCount, timeTraceWindow->timeTraceModel, &TimeTraceModel::addCount);
     connect(gameLoop, &GameLoop::statusChanged, settingsWindow, &SettingsWindow::update);
 
     /* Menu */
@@ -1280,7 +1281,7 @@ void MainWindow::slotPause(bool checked)
     }
     else {
         /* Else, let the game thread set the value */
-        context->hotkey_pressed_queue.push(HOTKEY_PLAYPAUSE);
+        context->pushHotkeyPressed(HOTKEY_PLAYPAUSE);
     }
 }
 
@@ -1292,7 +1293,7 @@ void MainWindow::slotFastForward(bool checked)
     }
     else {
         /* Else, let the game thread set the value */
-        context->hotkey_pressed_queue.push(HOTKEY_TOGGLE_FASTFORWARD);
+        context->pushHotkeyPressed(HOTKEY_TOGGLE_FASTFORWARD);
     }
 }
 
@@ -1331,7 +1332,7 @@ void MainWindow::slotMovieRecording()
         }
     }
     else {
-        context->hotkey_pressed_queue.push(HOTKEY_READWRITE);
+        context->pushHotkeyPressed(HOTKEY_READWRITE);
     }
     context->config.sc_modified = true;
 }
@@ -1363,7 +1364,7 @@ void MainWindow::slotToggleEncode()
     }
     else {
         /* TODO: Using directly the hotkey does not check for existing file */
-        context->hotkey_pressed_queue.push(HOTKEY_TOGGLE_ENCODE);
+        context->pushHotkeyPressed(HOTKEY_TOGGLE_ENCODE);
     }
 }
 
@@ -1383,7 +1384,7 @@ void MainWindow::slotScreenshot()
             return;
     }
     
-    context->hotkey_pressed_queue.push(HOTKEY_SCREENSHOT);
+    context->pushHotkeyPressed(HOTKEY_SCREENSHOT);
 }
 
 void MainWindow::slotVariableFramerate(bool checked)
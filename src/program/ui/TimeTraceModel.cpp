@@ -26,6 +26,8 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <iomanip>
+#include <algorithm>
 #include <QtGui/QColor>
 #include <QtGui/QPalette>
 #include <QtGui/QBrush>
@@ -35,22 +37,34 @@ TimeTraceModel::TimeTraceModel(Context* c, QObject *parent) : QAbstractTableMode
 
 void TimeTraceModel::addCall(int type, unsigned long long hash, std::string stacktrace)
 {
-    auto it = time_calls_map.find(hash);
-    if (it != time_calls_map.end()) {
-        if ((!stacktrace.empty()) && stacktrace.compare(it->second.stacktrace) != 0) {
+    auto it = stacktraces.find(hash);
+    if (it != stacktraces.end()) {
+        if ((!stacktrace.empty()) && stacktrace.compare(it->second) != 0) {
             std::cerr << "Same hash but stack trace differ!" << std::endl;
             std::cerr << "Stored trace:" << std::endl;
-            std::cerr << it->second.stacktrace << std::endl;
+            std::cerr << it->second << std::endl;
             std::cerr << "New trace:" << std::endl;
             std::cerr << stacktrace << std::endl;
         }
-        it->second.count++;
-        /* TODO: Get the row index? */
-        emit dataChanged(index(0,1), index(rowCount()-1,1));
     }
     else {
-        beginInsertRows(QModelIndex(), time_calls_map.size(), time_calls_map.size());
-        time_calls_map[hash] = {type, 1, stacktrace};
+        stacktraces[hash] = stacktrace;
+    }
+}
+
+void TimeTraceModel::addCount(unsigned long long frame, int type, unsigned long long hash, unsigned int count)
+{
+    samples.push_back({frame, type, hash, count});
+
+    auto it = time_calls_map.lower_bound(hash);
+    int row = std::distance(time_calls_map.begin(), it);
+    if ((it != time_calls_map.end()) && (it->first == hash)) {
+        it->second.count += count;
+        emit dataChanged(index(row,2), index(row,2));
+    }
+    else {
+        beginInsertRows(QModelIndex(), row, row);
+        time_calls_map.insert(it, {hash, {type, count}});
         endInsertRows();
     }
 }
@@ -108,30 +122,7 @@ QVariant TimeTraceModel::data(const QModelIndex &index, int role) const
     }
     else if (role == Qt::DisplayRole) {
         if (index.column() == 0) {
-            switch (it->second.type) {
-                case SharedConfig::TIMETYPE_TIME:
-                    return tr("time()");
-                case SharedConfig::TIMETYPE_GETTIMEOFDAY:
-                    return tr("gettimeofday()");
-                case SharedConfig::TIMETYPE_CLOCK:
-                    return tr("clock()");
-                case SharedConfig::TIMETYPE_CLOCKGETTIME_REALTIME:
-                    return tr("clock_gettime() realtime");
-                case SharedConfig::TIMETYPE_CLOCKGETTIME_MONOTONIC:
-                    return tr("clock_gettime() monotonic");
-                case SharedConfig::TIMETYPE_SDLGETTICKS:
-                    return tr("SDL_GetTicks()");
-                case SharedConfig::TIMETYPE_SDLGETPERFORMANCECOUNTER:
-                    return tr("SDL_GetPerformanceCounter()");
-                case SharedConfig::TIMETYPE_GETTICKCOUNT:
-                    return tr("GetTickCount()");
-                case SharedConfig::TIMETYPE_GETTICKCOUNT64:
-                    return tr("GetTickCount64()");
-                case SharedConfig::TIMETYPE_QUERYPERFORMANCECOUNTER:
-                    return tr("QueryPerformanceCounter()");
-                default:
-                    return tr("Unknown");
-            }
+            return tr(typeName(it->second.type));
         }
         else if (index.column() == 1) {
             return QString("%1").arg(it->first, 0, 16);
@@ -143,6 +134,34 @@ QVariant TimeTraceModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
+const char* TimeTraceModel::typeName(int type)
+{
+    switch (type) {
+        case SharedConfig::TIMETYPE_TIME:
+            return "time()";
+        case SharedConfig::TIMETYPE_GETTIMEOFDAY:
+            return "gettimeofday()";
+        case SharedConfig::TIMETYPE_CLOCK:
+            return "clock()";
+        case SharedConfig::TIMETYPE_CLOCKGETTIME_REALTIME:
+            return "clock_gettime() realtime";
+        case SharedConfig::TIMETYPE_CLOCKGETTIME_MONOTONIC:
+            return "clock_gettime() monotonic";
+        case SharedConfig::TIMETYPE_SDLGETTICKS:
+            return "SDL_GetTicks()";
+        case SharedConfig::TIMETYPE_SDLGETPERFORMANCECOUNTER:
+            return "SDL_GetPerformanceCounter()";
+        case SharedConfig::TIMETYPE_GETTICKCOUNT:
+            return "GetTickCount()";
+        case SharedConfig::TIMETYPE_GETTICKCOUNT64:
+            return "GetTickCount64()";
+        case SharedConfig::TIMETYPE_QUERYPERFORMANCECOUNTER:
+            return "QueryPerformanceCounter()";
+        default:
+            return "Unknown";
+    }
+}
+
 std::string TimeTraceModel::getStacktrace(int index)
 {
     auto it = time_calls_map.begin();
@@ -150,12 +169,194 @@ std::string TimeTraceModel::getStacktrace(int index)
     if (it == time_calls_map.end())
         return std::string("");
 
-    return it->second.stacktrace;
+    auto st = stacktraces.find(it->first);
+    if (st == stacktraces.end())
+        return std::string("");
+
+    return st->second;
 }
 
 void TimeTraceModel::clearData()
 {
     beginResetModel();
     time_calls_map.clear();
+    samples.clear();
     endResetModel();
 }
+
+std::vector<std::string> TimeTraceModel::foldedFrames(uint64_t hash) const
+{
+    std::vector<std::string> frames;
+
+    auto st = stacktraces.find(hash);
+    if (st == stacktraces.end())
+        return frames;
+
+    /* Each line is `file(symbol+offset) [address]`, or only `[address]` for
+     * anonymous code, from the innermost frame */
+    std::istringstream iss(st->second);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (line.empty())
+            continue;
+
+        std::string name;
+        size_t addr_pos = line.rfind(" [");
+        if ((addr_pos == std::string::npos) || (addr_pos == 0)) {
+            /* Group all anonymous code together */
+            name = "[anonymous]";
+        }
+        else {
+            std::string location = line.substr(0, addr_pos);
+            std::string file = location;
+            std::string symbol;
+            size_t paren = location.find('(');
+            if (paren != std::string::npos) {
+                file = location.substr(0, paren);
+                symbol = location.substr(paren + 1, location.size() - paren - 2);
+            }
+
+            size_t slash = file.rfind('/');
+            if (slash != std::string::npos)
+                file = file.substr(slash + 1);
+
+            /* Drop the offset inside a named function, keep it otherwise */
+            size_t sign = symbol.find_last_of("+-");
+            if ((sign != std::string::npos) && (sign > 0))
+                symbol = symbol.substr(0, sign);
+
+            if (symbol.empty())
+                name = file;
+            else if ((symbol[0] == '+') || (symbol[0] == '-'))
+                name = file + symbol;
+            else
+                name = file + "`" + symbol;
+        }
+
+        /* Semicolons separate frames in the folded format */
+        std::replace(name.begin(), name.end(), ';', ':');
+        frames.push_back(name);
+    }
+
+    std::reverse(frames.begin(), frames.end());
+    return frames;
+}
+
+bool TimeTraceModel::exportFolded(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file)
+        return false;
+
+    for (const auto& call : time_calls_map) {
+        std::vector<std::string> frames = foldedFrames(call.first);
+        for (const std::string& frame : frames)
+            file << frame << ';';
+        file << typeName(call.second.type) << ' ' << call.second.count << '\n';
+    }
+
+    return static_cast<bool>(file);
+}
+
+/* Escape a string for a JSON document */
+static std::string jsonEscape(const std::string& str)
+{
+    std::ostringstream oss;
+    for (char c : str) {
+        switch (c) {
+            case '"': oss << "\\\""; break;
+            case '\\': oss << "\\\\"; break;
+            case '\n': oss << "\\n"; break;
+            case '\t': oss << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else
+                    oss << c;
+        }
+    }
+    return oss.str();
+}
+
+bool TimeTraceModel::exportChromeTrace(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file)
+        return false;
+
+    /* Build the tree of stack frames, with one node for each distinct path
+     * from the outermost frame, and get the leaf node of each hash */
+    std::map<std::pair<int, std::string>, int> nodes;
+    std::vector<std::pair<int, std::string>> node_list;
+    std::map<uint64_t, int> leaves;
+
+    for (const auto& call : time_calls_map) {
+        std::vector<std::string> frames = foldedFrames(call.first);
+        frames.push_back(typeName(call.second.type));
+
+        int parent = -1;
+        for (const std::string& frame : frames) {
+            auto key = std::make_pair(parent, frame);
+            auto it = nodes.find(key);
+            if (it == nodes.end()) {
+                it = nodes.emplace(key, node_list.size()).first;
+                node_list.push_back(key);
+            }
+            parent = it->second;
+        }
+        leaves[call.first] = parent;
+    }
+
+    /* Timestamps are in microseconds, from the movie framerate */
+    double frame_us = 1000000.0 * context->config.sc.initial_framerate_den / context->config.sc.initial_framerate_num;
+
+    file << "{\"displayTimeUnit\":\"ms\",\n\"stackFrames\":{";
+    for (size_t i = 0; i < node_list.size(); i++) {
+        if (i > 0)
+            file << ',';
+        file << "\n\"" << i << "\":{\"name\":\"" << jsonEscape(node_list[i].second) << "\"";
+        if (node_list[i].first >= 0)
+            file << ",\"parent\":\"" << node_list[i].first << "\"";
+        file << '}';
+    }
+    file << "},\n\"traceEvents\":[";
+
+    /* One instant event per stack and frame, attached to its stack, and
+     * one counter event per frame with the number of calls of each type */
+    bool first = true;
+    std::map<int, unsigned int> frame_counts;
+    for (size_t i = 0; i < samples.size(); i++) {
+        const TimeTraceSample& sample = samples[i];
+        uint64_t ts = static_cast<uint64_t>(sample.frame * frame_us);
+
+        if (!first)
+            file << ',';
+        first = false;
+
+        file << "\n{\"name\":\"" << jsonEscape(typeName(sample.type)) << "\",\"cat\":\"time\",\"ph\":\"i\",\"s\":\"t\"";
+        file << ",\"ts\":" << ts << ",\"pid\":1,\"tid\":1";
+        auto leaf = leaves.find(sample.hash);
+        if (leaf != leaves.end())
+            file << ",\"sf\":\"" << leaf->second << "\"";
+        file << ",\"args\":{\"hash\":\"" << std::hex << sample.hash << std::dec << "\",\"count\":" << sample.count << "}}";
+
+        frame_counts[sample.type] += sample.count;
+
+        /* Samples of a frame are received together */
+        if ((i + 1 == samples.size()) || (samples[i+1].frame != sample.frame)) {
+            file << ",\n{\"name\":\"time calls\",\"ph\":\"C\",\"ts\":" << ts << ",\"pid\":1,\"args\":{";
+            bool first_count = true;
+            for (const auto& fc : frame_counts) {
+                if (!first_count)
+                    file << ',';
+                first_count = false;
+                file << '"' << jsonEscape(typeName(fc.first)) << "\":" << fc.second;
+            }
+            file << "}}";
+            frame_counts.clear();
+        }
+    }
+    file << "\n]}\n";
+
+    return static_cast<bool>(file);
+}
@@ -22,6 +22,7 @@
 
 #include <QtCore/QAbstractTableModel>
 #include <vector>
+#include <string>
 #include <map>
 #include <memory>
 #include <sys/types.h>
@@ -33,7 +34,14 @@ struct Context;
 struct TimeCall {
     int type;
     unsigned int count;
-    std::string stacktrace;
+};
+
+/* Number of calls from a stack during a frame */
+struct TimeTraceSample {
+    uint64_t frame;
+    int type;
+    uint64_t hash;
+    unsigned int count;
 };
 
 class TimeTraceModel : public QAbstractTableModel {
@@ -42,7 +50,7 @@ class TimeTraceModel : public QAbstractTableModel {
 public:
     TimeTraceModel(Context* c, QObject *parent = Q_NULLPTR);
 
-    /* Map of pointers (key) and addresses (value) */
+    /* Map of stack hashes (key) and total calls (value) */
     std::map<uint64_t,TimeCall> time_calls_map;
 
     /* Get the full stack trace of a given table index */
@@ -51,12 +59,35 @@ public:
     /* Clear the whole table */
     void clearData();
 
+    /* Export the calls as folded stacks, one line per stack with its count,
+     * which is the input format of flame graph tools */
+    bool exportFolded(const std::string& filename) const;
+
+    /* Export the calls per frame in the Chrome trace event format */
+    bool exportChromeTrace(const std::string& filename) const;
+
 public slots:
+    /* Register the stack trace of a hash */
     void addCall(int type, unsigned long long hash, std::string stacktrace);
 
+    /* Add the calls of a hash during a frame */
+    void addCount(unsigned long long frame, int type, unsigned long long hash, unsigned int count);
+
 private:
     Context *context;
 
+    /* Stack trace of each hash, kept when the table is cleared because the
+     * game only sends each one once */
+    std::map<uint64_t,std::string> stacktraces;
+
+    /* Calls per frame, in the order they were received */
+    std::vector<TimeTraceSample> samples;
+
+    static const char* typeName(int type);
+
+    /* Stack frames of a hash from the outermost one, with a short name */
+    std::vector<std::string> foldedFrames(uint64_t hash) const;
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
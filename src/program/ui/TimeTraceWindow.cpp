@@ -30,6 +30,7 @@
 #include <QtWidgets/QFormLayout>
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QMessageBox>
+#include <QtWidgets/QFileDialog>
 
 TimeTraceWindow::TimeTraceWindow(Context* c, QWidget *parent) : QDialog(parent), context(c)
 {
@@ -72,11 +73,15 @@ TimeTraceWindow::TimeTraceWindow(Context* c, QWidget *parent) : QDialog(parent),
     QPushButton *clearButton = new QPushButton(tr("Clear Trace"));
     connect(clearButton, &QAbstractButton::clicked, this, &TimeTraceWindow::slotClear);
 
+    QPushButton *exportButton = new QPushButton(tr("Export"));
+    connect(exportButton, &QAbstractButton::clicked, this, &TimeTraceWindow::slotExport);
+
     QDialogButtonBox *buttonBox = new QDialogButtonBox();
     buttonBox->addButton(chooseHashButton, QDialogButtonBox::ActionRole);
     buttonBox->addButton(clearHashButton, QDialogButtonBox::ActionRole);
     buttonBox->addButton(startButton, QDialogButtonBox::ActionRole);
     buttonBox->addButton(clearButton, QDialogButtonBox::ActionRole);
+    buttonBox->addButton(exportButton, QDialogButtonBox::ActionRole);
 
     /* Layout */
     QVBoxLayout *mainLayout = new QVBoxLayout;
@@ -114,6 +119,26 @@ void TimeTraceWindow::slotClear()
     stackTraceText->clear();
 }
 
+void TimeTraceWindow::slotExport()
+{
+    const QString foldedFilter = tr("Folded stacks (*.folded)");
+    const QString chromeFilter = tr("Chrome trace (*.json)");
+    QString selectedFilter;
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export time trace"), QString(), foldedFilter + ";;" + chromeFilter, &selectedFilter);
+
+    if (filename.isNull())
+        return;
+
+    bool ret;
+    if ((selectedFilter == chromeFilter) || filename.endsWith(".json"))
+        ret = timeTraceModel->exportChromeTrace(filename.toStdString());
+    else
+        ret = timeTraceModel->exportFolded(filename.toStdString());
+
+    if (!ret)
+        QMessageBox::warning(this, "Warning", QString("Could not write to %1").arg(filename));
+}
+
 void TimeTraceWindow::slotChooseHash()
 {
     const QModelIndex index = timeTraceView->selectionModel()->currentIndex();
@@ -64,6 +64,7 @@ private slots:
     void slotClearHash();
     void slotStart();
     void slotClear();
+    void slotExport();
 };
 
 #endif
@@ -32,6 +32,8 @@
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QSlider>
 
+#include <cstdlib> // std::abs
+
 AudioPane::AudioPane(Context* c) : context(c)
 {
     initLayout();
@@ -65,6 +67,9 @@ void AudioPane::initLayout()
     depthChoice = new QComboBox();
     depthChoice->addItem(tr("8 bit"), 8);
     depthChoice->addItem(tr("16 bit"), 16);
+    depthChoice->addItem(tr("32 bit"), 32);
+    /* Negative value for float samples */
+    depthChoice->addItem(tr("32 bit float"), -32);
 
     formatLayout->addRow(new QLabel(tr("Bit depth:")), depthChoice);
 
@@ -160,7 +165,7 @@ void AudioPane::loadConfig()
     int index = freqChoice->findData(context->config.sc.audio_frequency);
     if (index != -1) freqChoice->setCurrentIndex(index);
 
-    index = depthChoice->findData(context->config.sc.audio_bitdepth);
+    index = depthChoice->findData(context->config.sc.audio_float && (context->config.sc.audio_bitdepth == 32) ? -32 : context->config.sc.audio_bitdepth);
     if (index != -1) depthChoice->setCurrentIndex(index);
 
     index = channelChoice->findData(context->config.sc.audio_channels);
@@ -181,7 +186,9 @@ void AudioPane::loadConfig()
 void AudioPane::saveConfig()
 {
     context->config.sc.audio_frequency = freqChoice->itemData(freqChoice->currentIndex()).toInt();
-    context->config.sc.audio_bitdepth = depthChoice->itemData(depthChoice->currentIndex()).toInt();
+    int depth = depthChoice->itemData(depthChoice->currentIndex()).toInt();
+    context->config.sc.audio_bitdepth = std::abs(depth);
+    context->config.sc.audio_float = (depth < 0);
     context->config.sc.audio_channels = channelChoice->itemData(channelChoice->currentIndex()).toInt();
     context->config.sc.audio_mute = muteBox->isChecked();
     context->config.sc.audio_disabled = disableBox->isChecked();
@@ -71,6 +71,8 @@ void DebugPane::initLayout()
     logToChoice->addItem(tr("Log to console"), SharedConfig::LOGGING_TO_CONSOLE);
     logToChoice->addItem(tr("Log to file"), SharedConfig::LOGGING_TO_FILE);
 
+    logAsyncBox = new ToolTipCheckBox(tr("Asynchronous logging"));
+
     QGroupBox* logLevelBox = new QGroupBox(tr("Level"));
     logLevelSlider = new QSlider(Qt::Horizontal);
     logLevelSlider->setRange(0, 5);
@@ -235,6 +237,7 @@ void DebugPane::initLayout()
     logExcludeLayout->addWidget(logExcludeWineBox, 4, 4);
     
     logLayout->addWidget(logToChoice);
+    logLayout->addWidget(logAsyncBox);
     logLayout->addWidget(logLevelBox);
     logLayout->addWidget(logPrintBox);
     logLayout->addWidget(logExcludeBox);
@@ -257,6 +260,7 @@ void DebugPane::initSignals()
     connect(debugSigIntBox, &QAbstractButton::clicked, this, &DebugPane::saveConfig);
     connect(logToChoice, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated), this, &DebugPane::saveConfig);
     connect(logLevelSlider, &QAbstractSlider::valueChanged, this, &DebugPane::saveConfig);
+    connect(logAsyncBox, &QAbstractButton::clicked, this, &DebugPane::saveConfig);
 
     connect(logPrintAllBox, &QAbstractButton::clicked, this, &DebugPane::saveConfig);
     connect(logPrintNoneBox, &QAbstractButton::clicked, this, &DebugPane::saveConfig);
@@ -333,6 +337,11 @@ void DebugPane::initToolTips()
     "games to access to device files, such as reading joystick events, or the hardware random generator.");
 
     debugInetBox->setDescription("Let the game access the internet, only for debugging purpose.");
+
+    logAsyncBox->setDescription("Game threads only store the raw message arguments, "
+    "and messages are formatted and printed by a separate thread. This makes debug "
+    "and trace levels much faster, but messages may be printed a bit later, and are "
+    "dropped if too many are logged at once. Errors are always printed immediately.");
 }
 
 void DebugPane::showEvent(QShowEvent *event)
@@ -353,6 +362,8 @@ void DebugPane::loadConfig()
     if (index >= 0)
         logToChoice->setCurrentIndex(index);
 
+    logAsyncBox->setChecked(context->config.sc.logging_async);
+
     /* Disconnect to not trigger valueChanged() signal */
     disconnect(logLevelSlider, &QAbstractSlider::valueChanged, this, &DebugPane::saveConfig);
     logLevelSlider->setValue(context->config.sc.logging_level);
@@ -429,6 +440,7 @@ void DebugPane::saveConfig()
     context->config.sc.sigint_upon_launch = debugSigIntBox->isChecked();
 
     context->config.sc.logging_status = logToChoice->currentData().toInt();
+    context->config.sc.logging_async = logAsyncBox->isChecked();
     
     context->config.sc.logging_level = logLevelSlider->value();
     
@@ -57,6 +57,7 @@ private:
     QCheckBox* debugSigIntBox;
 
     QComboBox* logToChoice;
+    ToolTipCheckBox* logAsyncBox;
 
     QSlider* logLevelSlider;
     QCheckBox* logPrintAllBox;
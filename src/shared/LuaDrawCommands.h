@@ -0,0 +1,72 @@
+/*
+    Copyright 2015-2024 Clément Gallet <clement.gallet@ens-lyon.org>
+
+    This file is part of libTAS.
+
+    libTAS is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libTAS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libTAS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBTAS_LUADRAWCOMMANDS_H_INCLUDED
+#define LIBTAS_LUADRAWCOMMANDS_H_INCLUDED
+
+/* Commands of the lua draw list, sent by the program in a single
+ * MSGN_LUA_DRAWLIST message. Each command starts with its uint8_t
+ * identifier, followed by its arguments in native byte order. Strings are
+ * stored as an uint32_t length followed by the characters.
+ */
+enum LuaDrawCommand {
+    /*
+     * Argument: float x, float y, uint32_t color, float anchor_x,
+     *           float anchor_y, float font_size, uint8_t monospace,
+     *           string text
+     */
+    LUA_DRAW_TEXT,
+
+    /*
+     * Argument: float x, float y, string id, string text
+     */
+    LUA_DRAW_WINDOW,
+
+    /*
+     * Argument: float x, float y, uint32_t color
+     */
+    LUA_DRAW_PIXEL,
+
+    /*
+     * Argument: float x, float y, float w, float h, float thickness,
+     *           uint32_t color, uint8_t filled
+     */
+    LUA_DRAW_RECT,
+
+    /*
+     * Argument: float x0, float y0, float x1, float y1, uint32_t color
+     */
+    LUA_DRAW_LINE,
+
+    /*
+     * Argument: float x0, float y0, float x1, float y1,
+     *           float x2, float y2, float x3, float y3,
+     *           float thickness, uint32_t color, uint8_t filled
+     */
+    LUA_DRAW_QUAD,
+
+    /*
+     * Argument: float center_x, float center_y, float radius_x,
+     *           float radius_y, float thickness, uint32_t color,
+     *           uint8_t filled
+     */
+    LUA_DRAW_ELLIPSE,
+};
+
+#endif
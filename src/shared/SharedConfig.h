@@ -71,6 +71,9 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     /* Which flags prevent triggering a debug message */
     LogCategoryFlag logging_exclude_flags = LCF_NONE;
 
+    /* Format and print log messages on a separate thread */
+    bool logging_async = false;
+
     /* Initial framerate at which the game is running, as a fraction */
     unsigned int initial_framerate_num = 60;
     unsigned int initial_framerate_den = 1;
@@ -79,9 +82,12 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     int nb_controllers = 0;
 
     /** Sound config **/
-    /* Bit depth of the buffer (usually 8 or 16) */
+    /* Bit depth of the buffer (8, 16 or 32) */
     int audio_bitdepth = 16;
 
+    /* Use floating point samples when the bit depth is 32 */
+    bool audio_float = false;
+
     /* Number of channels of the buffer */
     int audio_channels = 2;
 
@@ -115,6 +121,25 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     int audio_codec = ACODEC_AAC;
     int audio_bitrate = 128;
 
+    /* Encoder backend */
+    enum EncoderBackend {
+        ENCODER_FFMPEG_PIPE,
+        ENCODER_LIBAV,
+    };
+
+    /* Send frames to an ffmpeg process, or encode them inside the game
+     * process with libavcodec (falling back to ffmpeg if not available) */
+    int encoding_backend = ENCODER_FFMPEG_PIPE;
+
+    /* Number of frames that can be queued to the encoder thread before the
+     * game waits for it. 0 means that frames are encoded on the game thread */
+    int encoding_queue_size = 4;
+
+    /* Do not send video frames identical to the previous one to ffmpeg. The
+     * gaps in timestamps are filled by ffmpeg for constant framerate outputs,
+     * and become longer frames for variable framerate outputs */
+    bool encoding_skip_duplicates = false;
+
     /* An enum indicating which time-getting function query the time */
     enum TimeCallType
     {
@@ -255,6 +280,15 @@ struct __attribute__((packed, aligned(8))) SharedConfig {
     /* Savestate settings */
     int savestate_settings = SS_COMPRESSED;
 
+    /* Savestate slots. Slot 0 is the base savestate of incremental savestates,
+     * slots 1 to 10 are user savestates, and the remaining slots are used by
+     * the greenzone */
+    enum SaveStateSlots
+    {
+        SS_SLOT_GREENZONE = 11,
+        SS_SLOT_COUNT = SS_SLOT_GREENZONE + 32,
+    };
+
     /* Stacktrace hash to advance time */
     uint64_t busy_loop_hash = 0;
 
@@ -282,11 +282,20 @@ enum {
     MSGB_GIT_COMMIT,
 
     /*
-     * Send the hash and backtrace of a gettime function.
-     * Argument: uint64_t then size_t (string length) then char[len]
+     * Send the hash and backtrace of a gettime function, the first time the
+     * hash is encountered.
+     * Argument: int (type), uint64_t, then size_t (string length) then char[len]
      */
     MSGB_GETTIME_BACKTRACE,
 
+    /*
+     * Send the number of traced gettime calls for each stack hash during
+     * the frame. The backtrace of each hash is sent once beforehand.
+     * Argument: uint64_t (framecount) then int (number of hashes), then
+     *           for each hash: int (type), uint64_t (hash), unsigned int (count)
+     */
+    MSGB_GETTIME_COUNTS,
+
     /*
      * Indicate that the current frame is a non-draw frame.
      * Argument: None
@@ -300,51 +309,11 @@ enum {
     MSGB_SKIPDRAW_FRAME,
 
     /*
-     * Send to the game a text to be displayed from a lua script.
-     * Argument: float x, float y, string text, uint32_t color, float anchor_x
-     *           float anchor_y, float font_size, bool monospace
-     */
-    MSGN_LUA_TEXT,
-
-    /*
-     * Send to the game a text to be displayed inside a window.
-     * Argument: float x, float y, string id, string text
-     */
-    MSGN_LUA_WINDOW,
-
-    /*
-     * Send to the game a pixel to be displayed from a lua script.
-     * Argument: float x, float y, uint32_t color
-     */
-    MSGN_LUA_PIXEL,
-
-    /*
-     * Send to the game a rectangle to be displayed from a lua script.
-     * Argument: float x, float y, float w, float h, float thickness,
-     *           uint32_t color, uint32_t filled
+     * Send to the game all lua drawings of the frame, encoded as a list of
+     * commands described in LuaDrawCommands.h
+     * Argument: uint32_t size, char[size] commands
      */
-    MSGN_LUA_RECT,
-
-    /*
-     * Send to the game a line to be displayed from a lua script.
-     * Argument: float x0, float y0, float x1, float y1, uint32_t color
-     */
-    MSGN_LUA_LINE,
-
-    /*
-     * Send to the game a line to be displayed from a lua script.
-     * Argument: float x0, float y0, float x1, float y1,
-     *           float x2, float y2, float x3, float y3,
-     *           float thickness, uint32_t color, uint32_t filled
-     */
-    MSGN_LUA_QUAD,
-
-    /*
-     * Send to the game a line to be displayed from a lua script.
-     * Argument: float center_x, float center_y, float radius_x, float radius_y,
-     *           float thickness, uint32_t color, uint32_t filled
-     */
-    MSGN_LUA_ELLIPSE,
+    MSGN_LUA_DRAWLIST,
 
     /*
      * Ask the game to send the screen resolution.
@@ -387,6 +356,11 @@ enum {
      * Argument: uint64_t addr
      */
     MSGN_UNITY_WAIT_ADDR,
+
+    /* Ask the game to remove a savestate and free its memory
+     * Argument: int index
+     */
+    MSGN_REMOVE_SAVESTATE,
 };
 
 #endif
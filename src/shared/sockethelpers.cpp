@@ -37,6 +37,7 @@
 #include <vector>
 #include <mutex>
 #include <errno.h>
+#include <cstring>
 
 
 #define SOCKET_FILENAME "/tmp/libTAS.socket"
@@ -54,8 +55,28 @@ static int socket_fd = 0;
 
 static std::mutex mutex;
 
+const char* socketPath()
+{
+    static std::string path;
+    if (path.empty()) {
+        const char* env_path = getenv("LIBTAS_SOCKET_PATH");
+        path = (env_path && env_path[0]) ? env_path : SOCKET_FILENAME;
+    }
+    return path.c_str();
+}
+
+static void socketAddress(struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(struct sockaddr_un));
+#if defined(__APPLE__) && defined(__MACH__)
+    addr->sun_len = sizeof(struct sockaddr_un);
+#endif
+    addr->sun_family = AF_UNIX;
+    strncpy(addr->sun_path, socketPath(), sizeof(addr->sun_path) - 1);
+}
+
 int removeSocket(void) {
-    int ret = unlink(SOCKET_FILENAME);
+    int ret = unlink(socketPath());
     if ((ret == -1) && (errno != ENOENT))
         return errno;
     return 0;
@@ -64,11 +85,8 @@ int removeSocket(void) {
 #ifndef LIBTAS_LIBRARY
 bool initSocketProgram(pid_t fork_pid)
 {
-#ifdef __unix__
-    const struct sockaddr_un addr = { AF_UNIX, SOCKET_FILENAME };
-#elif defined(__APPLE__) && defined(__MACH__)
-    const struct sockaddr_un addr = { sizeof(struct sockaddr_un), AF_UNIX, SOCKET_FILENAME };
-#endif
+    struct sockaddr_un addr;
+    socketAddress(&addr);
     socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
 
     struct timespec tim = {0, 500L*1000L*1000L};
@@ -116,15 +134,12 @@ bool initSocketGame(void)
      * In this case, we just return immediately.
      */
     struct stat st;
-    int result = stat(SOCKET_FILENAME, &st);
+    int result = stat(socketPath(), &st);
     if (result == 0)
         return false;
 
-#ifdef __unix__
-    const struct sockaddr_un addr = { AF_UNIX, SOCKET_FILENAME };
-#elif defined(__APPLE__) && defined(__MACH__)
-    const struct sockaddr_un addr = { sizeof(struct sockaddr_un), AF_UNIX, SOCKET_FILENAME };
-#endif
+    struct sockaddr_un addr;
+    socketAddress(&addr);
     const int tmp_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (bind(tmp_fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(struct sockaddr_un)))
     {
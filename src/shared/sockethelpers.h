@@ -24,6 +24,10 @@
 #include <string>
 #include <sys/types.h>
 
+/* Path of the socket file. It can be changed with the LIBTAS_SOCKET_PATH
+ * environment variable, so that several game instances can run at once */
+const char* socketPath();
+
 /* Remove the socket file and return error */
 int removeSocket();
 